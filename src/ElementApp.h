@@ -43,6 +43,7 @@ namespace Tags
     const Identifier control            = "control";
     const Identifier controller         = "controller";
     const Identifier controllers        = "controllers";
+    const Identifier doublePrecision    = "doublePrecision";
     const Identifier collapsed          = "collapsed";
     const Identifier enabled            = "enabled";
     const Identifier gain               = "gain";
@@ -57,6 +58,7 @@ namespace Tags
     const Identifier nodes              = "nodes";
     const Identifier notes              = "notes";
     const Identifier oversamplingFactor = "oversamplingFactor";
+    const Identifier oversamplingQuality = "oversamplingQuality";
     const Identifier persistent         = "persistent";
     const Identifier placeholder        = "placeholder";
     const Identifier port               = "port";
@@ -111,6 +113,7 @@ namespace Tags
     const Identifier transpose          = "transpose";
     const Identifier keyStart           = "keyStart";
     const Identifier keyEnd             = "keyEnd";
+    const Identifier midiKinds          = "midiKinds";
 
     const Identifier velocityCurveMode  = "velocityCurveMode";
     const Identifier workspace          = "workspace";
@@ -33,6 +33,7 @@ const char* Settings::askToSaveSessionKey       = "askToSaveSession";
 const char* Settings::defaultNewSessionFile     = "defaultNewSessionFile";
 const char* Settings::generateMidiClockKey      = "generateMidiClockKey";
 const char* Settings::sendMidiClockToInputKey   = "sendMidiClockToInputKey";
+const char* Settings::transportSyncKey          = "transportSync";
 const char* Settings::hidePluginWindowsWhenFocusLostKey = "hidePluginWindowsWhenFocusLost";
 const char* Settings::lastGraphKey              = "lastGraph";
 const char* Settings::legacyInterfaceKey        = "legacyInterface";
@@ -40,6 +41,11 @@ const char* Settings::workspaceKey              = "workspace";
 const char* Settings::midiEngineKey             = "midiEngine";
 const char* Settings::oscHostPortKey            = "oscHostPortKey";
 const char* Settings::oscHostEnabledKey         = "oscHostEnabledKey";
+const char* Settings::autosaveEnabledKey        = "autosaveEnabled";
+const char* Settings::autosaveIntervalKey       = "autosaveInterval";
+const char* Settings::prefetchSubGraphsKey      = "prefetchSubGraphs";
+const char* Settings::pluginPoolTimeoutKey      = "pluginPoolTimeout";
+const char* Settings::pluginPoolMemoryKey       = "pluginPoolMemory";
 
 enum OptionsMenuItemId
 {
@@ -50,6 +56,8 @@ enum OptionsMenuItemId
     PluginWindowsOnTop,
     OpenLastUsedSession,
     AskToSaveSessions,
+    AutosaveSessions,
+    PrefetchSubGraphs,
 
     MidiInputDevice = 2000000,
     MidiOutputDevice = 3000000,
@@ -206,6 +214,19 @@ bool Settings::generateMidiClock() const
     return false;
 }
 
+void Settings::setTransportSync (const bool sync)
+{
+    if (auto* p = getProps())
+        p->setValue (transportSyncKey, sync);
+}
+
+bool Settings::transportSync() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (transportSyncKey, false);
+    return false;
+}
+
 bool Settings::pluginWindowsOnTop() const
 {
     if (auto* p = getProps())
@@ -321,6 +342,84 @@ File Settings::getWorkspaceFile() const
                              : File();
 }
 
+bool Settings::isAutosaveEnabled() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (autosaveEnabledKey, true);
+    return true;
+}
+
+void Settings::setAutosaveEnabled (bool enabled)
+{
+    if (isAutosaveEnabled() == enabled)
+        return;
+    if (auto* p = getProps())
+        p->setValue (autosaveEnabledKey, enabled);
+}
+
+int Settings::getAutosaveInterval() const
+{
+    if (auto* p = getProps())
+        return jlimit (5, 3600, p->getIntValue (autosaveIntervalKey, 60));
+    return 60;
+}
+
+void Settings::setAutosaveInterval (int seconds)
+{
+    seconds = jlimit (5, 3600, seconds);
+    if (getAutosaveInterval() == seconds)
+        return;
+    if (auto* p = getProps())
+        p->setValue (autosaveIntervalKey, seconds);
+}
+
+bool Settings::prefetchSubGraphs() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (prefetchSubGraphsKey, false);
+    return false;
+}
+
+void Settings::setPrefetchSubGraphs (bool prefetch)
+{
+    if (prefetchSubGraphs() == prefetch)
+        return;
+    if (auto* p = getProps())
+        p->setValue (prefetchSubGraphsKey, prefetch);
+}
+
+int Settings::getPluginPoolTimeout() const
+{
+    if (auto* p = getProps())
+        return jlimit (0, 3600, p->getIntValue (pluginPoolTimeoutKey, 120));
+    return 120;
+}
+
+void Settings::setPluginPoolTimeout (int seconds)
+{
+    seconds = jlimit (0, 3600, seconds);
+    if (getPluginPoolTimeout() == seconds)
+        return;
+    if (auto* p = getProps())
+        p->setValue (pluginPoolTimeoutKey, seconds);
+}
+
+int Settings::getPluginPoolMemory() const
+{
+    if (auto* p = getProps())
+        return jlimit (0, 8192, p->getIntValue (pluginPoolMemoryKey, 256));
+    return 256;
+}
+
+void Settings::setPluginPoolMemory (int megabytes)
+{
+    megabytes = jlimit (0, 8192, megabytes);
+    if (getPluginPoolMemory() == megabytes)
+        return;
+    if (auto* p = getProps())
+        p->setValue (pluginPoolMemoryKey, megabytes);
+}
+
 bool Settings::isOscHostEnabled() const
 {
     if (auto* p = getProps())
@@ -378,6 +477,10 @@ void Settings::addItemsToMenu (Globals& world, PopupMenu& menu)
         true, openLastUsedSession());
     sub.addItem (AskToSaveSessions, "Ask To Save Session", 
         true, askToSaveSession());
+    sub.addItem (AutosaveSessions, "Autosave Session", 
+        true, isAutosaveEnabled());
+    sub.addItem (PrefetchSubGraphs, "Load Disabled Graphs In Background", 
+        true, prefetchSubGraphs());
    #else
     sub.addItem (OpenLastUsedSession, "Open Last Saved Graph", 
         true, openLastUsedSession());
@@ -455,6 +558,8 @@ bool Settings::performMenuResult (Globals& world, const int result)
         case HidePluginWindowsWhenFocusLost: setHidePluginWindowsWhenFocusLost (! hidePluginWindowsWhenFocusLost()); break;
         case OpenLastUsedSession: setOpenLastUsedSession (! openLastUsedSession()); break;
         case AskToSaveSessions: setAskToSaveSession (! askToSaveSession()); break;
+        case AutosaveSessions: setAutosaveEnabled (! isAutosaveEnabled()); break;
+        case PrefetchSubGraphs: setPrefetchSubGraphs (! prefetchSubGraphs()); break;
         default: handled = false; break;
     }
 
@@ -42,6 +42,7 @@ public:
     static const char* defaultNewSessionFile;
     static const char* generateMidiClockKey;
     static const char* sendMidiClockToInputKey;
+    static const char* transportSyncKey;
     static const char* hidePluginWindowsWhenFocusLostKey;
     static const char* lastGraphKey;
     static const char* legacyInterfaceKey;
@@ -49,6 +50,11 @@ public:
     static const char* midiEngineKey;
     static const char* oscHostPortKey;
     static const char* oscHostEnabledKey;
+    static const char* autosaveEnabledKey;
+    static const char* autosaveIntervalKey;
+    static const char* prefetchSubGraphsKey;
+    static const char* pluginPoolTimeoutKey;
+    static const char* pluginPoolMemoryKey;
 
     std::unique_ptr<XmlElement> getLastGraph() const;
     void setLastGraph (const ValueTree& data);
@@ -96,6 +102,10 @@ public:
     void setSendMidiClockToInput (const bool);
     bool sendMidiClockToInput() const;
 
+    /** Share tempo and play state with other instances on this machine */
+    void setTransportSync (const bool);
+    bool transportSync() const;
+
     void setHidePluginWindowsWhenFocusLost (const bool);
     bool hidePluginWindowsWhenFocusLost() const;
 
@@ -106,6 +116,28 @@ public:
     String getWorkspace() const;
     File getWorkspaceFile() const;
 
+    /** True if the session should be periodically written to the
+        autosave journal */
+    bool isAutosaveEnabled() const;
+    void setAutosaveEnabled (bool);
+
+    /** Seconds between autosaves */
+    int getAutosaveInterval() const;
+    void setAutosaveInterval (int);
+
+    /** True if disabled sub graphs should be loaded in the background after
+        a session opens, rather than waiting until they are enabled */
+    bool prefetchSubGraphs() const;
+    void setPrefetchSubGraphs (bool);
+
+    /** Seconds a removed plugin instance is kept for reuse, zero disables */
+    int getPluginPoolTimeout() const;
+    void setPluginPoolTimeout (int);
+
+    /** Megabytes of removed plugin instances kept for reuse */
+    int getPluginPoolMemory() const;
+    void setPluginPoolMemory (int);
+
     bool isOscHostEnabled() const;
     void setOscHostEnabled (bool);
     int getOscHostPort() const;
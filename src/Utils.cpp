@@ -29,6 +29,7 @@ StringArray getFullVesrionPluginIdentifiers()
         EL_INTERNAL_ID_CHANNELIZE,
         EL_INTERNAL_ID_MIDI_CHANNEL_MAP,
         EL_INTERNAL_ID_MIDI_CHANNEL_SPLITTER,
+        EL_INTERNAL_ID_MIDI_SEQUENCER,
         EL_INTERNAL_ID_GRAPH,
         
         EL_INTERNAL_ID_AUDIO_ROUTER,
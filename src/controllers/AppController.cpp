@@ -119,9 +119,9 @@ void AppController::run()
    #if EL_PRO
     if (auto* sc = findChild<SessionController>())
     {
-        bool loadDefault = true;
+        bool loadDefault = ! sc->recoverAutosave();
 
-        if (world.getSettings().openLastUsedSession())
+        if (loadDefault && world.getSettings().openLastUsedSession())
         {
             const auto lastSession = getWorld().getSettings().getUserSettings()->getValue ("lastSession");
             if (File::isAbsolutePath(lastSession) && File(lastSession).existsAsFile())
@@ -24,6 +24,7 @@
 #include "engine/nodes/MidiDeviceProcessor.h"
 
 #include "engine/nodes/SubGraphProcessor.h"
+#include "engine/PluginInstancePool.h"
 #include "session/DeviceManager.h"
 #include "session/PluginManager.h"
 #include "session/Node.h"
@@ -78,7 +79,12 @@ struct RootGraphHolder
             root->setPlayConfigFor (devices);
             root->setRenderMode (mode);
             root->setMidiChannels (channels);
+            root->setMidiKinds ((int) model.getProperty (Tags::midiKinds, (int) MidiPrefilter::allKinds));
+            root->setMidiNoteRange ({ (int) model.getProperty (Tags::keyStart, 0),
+                                      (int) model.getProperty (Tags::keyEnd, 127) });
             root->setMidiProgram (program);
+            if ((bool) model.getProperty (Tags::doublePrecision, false))
+                root->setProcessingPrecision (AudioProcessor::doublePrecision);
 
             if (engine->addGraph (root))
             {
@@ -169,9 +175,15 @@ public:
             {
                 if (auto* sub = node->processor<SubGraphProcessor>())
                 {
-                    if (sub->getController().isControlling (n))
-                        return &sub->getController();
-                    else if (auto* sub2 = findSubGraphManager (&sub->getController(), n))
+                    auto& controller = sub->getController();
+                    if (controller.isControlling (n))
+                        return &controller;
+
+                    // graphs nested in a deferred graph don't exist yet
+                    if (controller.isDeferred() && n.getValueTree().isAChildOf (controller.getGraphModel().getValueTree()))
+                        controller.loadDeferredModel();
+
+                    if (auto* sub2 = findSubGraphManager (&controller, n))
                         return sub2;
                 }
             }
@@ -258,13 +270,27 @@ public:
                 if (controller->isControlling (graph))
                     return controller;
                 else if (auto* subController = findSubGraphManager (controller, graph))
+                {
+                    // callers are about to change the graph, so it has to be loaded
+                    subController->loadDeferredModel();
                     return subController;
+                }
             }
         }
 
         return nullptr;
     }
 
+    /** Returns the first sub graph which hasn't been loaded yet */
+    GraphManager* findDeferredSubGraph() const
+    {
+        for (const auto* h : graphs)
+            if (auto* controller = h->controller.get())
+                if (auto* deferred = controller->findDeferredSubGraph())
+                    return deferred;
+        return nullptr;
+    }
+
     RootGraphManager* findActiveRootGraphManager() const
     {
         if (auto* h = findActive())
@@ -309,6 +335,7 @@ EngineController::EngineController()
 
 EngineController::~EngineController()
 {
+    stopTimer();
     graphs = nullptr;
 }
 
@@ -633,6 +660,10 @@ void EngineController::activate()
     engine->setSession (session);
     engine->activate();
 
+    SharedResourcePointer<PluginInstancePool> pool;
+    pool->setTimeout (globals.getSettings().getPluginPoolTimeout());
+    pool->setMaxMemory ((int64) globals.getSettings().getPluginPoolMemory() * 1024 * 1024);
+
     sessionReloaded();
     devices.addChangeListener (this);
 }
@@ -640,6 +671,7 @@ void EngineController::activate()
 void EngineController::deactivate()
 {
     Controller::deactivate();
+    stopTimer();
     auto& globals (getWorld());
     auto& devices (globals.getDeviceManager());
     auto engine   (globals.getAudioEngine());
@@ -654,6 +686,10 @@ void EngineController::deactivate()
     
     session->saveGraphState();
     graphs->clear();
+
+    // pooled instances have to go before the engine does
+    SharedResourcePointer<PluginInstancePool> pool;
+    pool->clear();
     
     engine->deactivate();
     engine->setSession (nullptr);
@@ -662,6 +698,7 @@ void EngineController::deactivate()
 
 void EngineController::clear()
 {
+    stopTimer();
     graphs->clear();
 }
 
@@ -718,6 +755,9 @@ void EngineController::setRootNode (const Node& newRootNode)
     if (auto* proc = holder->getRootGraph())
     {
         proc->setMidiChannels (newRootNode.getMidiChannels().get());
+        proc->setMidiKinds ((int) newRootNode.getProperty (Tags::midiKinds, (int) MidiPrefilter::allKinds));
+        proc->setMidiNoteRange ({ (int) newRootNode.getProperty (Tags::keyStart, 0),
+                                  (int) newRootNode.getProperty (Tags::keyEnd, 127) });
         proc->setVelocityCurveMode ((VelocityCurve::Mode)(int) newRootNode.getProperty (
             Tags::velocityCurveMode, (int) VelocityCurve::Linear));
     }
@@ -847,6 +887,7 @@ Node EngineController::addPlugin (const Node& graph, const PluginDescription& de
 
 void EngineController::sessionReloaded()
 {
+    stopTimer();
     graphs->clear();
 
     auto session = getWorld().getSession();
@@ -869,6 +910,19 @@ void EngineController::sessionReloaded()
 
         setRootNode (session->getCurrentGraph());
     }
+
+    if (getWorld().getSettings().prefetchSubGraphs())
+        startTimer (250);
+}
+
+void EngineController::timerCallback()
+{
+    // one graph per tick so the UI stays responsive. plugins have to be
+    // created on the message thread so this can't go to a worker
+    if (auto* deferred = graphs->findDeferredSubGraph())
+        deferred->loadDeferredModel();
+    else
+        stopTimer();
 }
 
 Node EngineController::addPlugin (GraphManager& c, const PluginDescription& desc)
@@ -29,7 +29,8 @@ class GraphManager;
 class RootGraphManager;
     
 class EngineController : public AppController::Child,
-                         private ChangeListener
+                         private ChangeListener,
+                         private Timer
 {
 public:
     EngineController();
@@ -128,6 +129,7 @@ private:
     
     friend class ChangeBroadcaster;
     void changeListenerCallback (ChangeBroadcaster*) override;
+    void timerCallback() override;
     Node addPlugin (GraphManager& controller, const PluginDescription& desc);
 };
     
@@ -24,8 +24,10 @@
 #include "engine/nodes/MidiProgramMapNode.h"
 #include "engine/nodes/PlaceholderProcessor.h"
 #include "engine/nodes/SubGraphProcessor.h"
+#include "engine/PluginInstancePool.h"
 
 #include "session/PluginManager.h"
+#include "session/StateStore.h"
 #include "Globals.h"
 #include "Utils.h"
 
@@ -64,11 +66,14 @@ public:
     {
         portsChangedConnection = object->portsChanged.connect ( 
             std::bind (&NodeModelUpdater::onPortsChanged, this));
+        enablementChangedConnection = object->enablementChanged.connect (
+            std::bind (&NodeModelUpdater::onEnablementChanged, this));
     }
 
     ~NodeModelUpdater()
     {
         portsChangedConnection.disconnect();
+        enablementChangedConnection.disconnect();
     }
 
 private:
@@ -76,6 +81,7 @@ private:
     ValueTree data;
     GraphNodePtr object;
     SignalConnection portsChangedConnection;
+    SignalConnection enablementChangedConnection;
 
     void onPortsChanged()
     {
@@ -89,6 +95,14 @@ private:
         }
     }
 
+    void onEnablementChanged()
+    {
+        // disabled sub graphs get loaded the first time they are enabled
+        if (auto* sub = object->processor<SubGraphProcessor>())
+            if (object->isEnabled() && sub->getController().isDeferred())
+                sub->getController().loadDeferredModel();
+    }
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NodeModelUpdater);
 };
 
@@ -222,10 +236,20 @@ const GraphNodePtr GraphManager::getNodeForId (const uint32 uid) const noexcept
     return processor.getNodeForId (uid);
 }
 
-GraphNode* GraphManager::createFilter (const PluginDescription* desc, double x, double y, uint32 nodeId)
+GraphNode* GraphManager::createFilter (const PluginDescription* desc, double x, double y, uint32 nodeId,
+                                      bool reuseInstance)
 {
     String errorMessage;
 
+    if (reuseInstance)
+    {
+        SharedResourcePointer<PluginInstancePool> pool;
+        // a new node is made for the pooled instance so node settings
+        // don't carry over from where it was used before
+        if (auto* const pooled = pool->take (*desc))
+            return processor.addNode (pooled, nodeId);
+    }
+
     if (desc->pluginFormatName == "Element")
     {
         if (auto* const object = pluginManager.createGraphNode (*desc, errorMessage))
@@ -278,8 +302,11 @@ uint32 GraphManager::addNode (const Node& newNode)
     
     uint32 nodeId = KV_INVALID_NODE;
     const PluginDescription desc (pluginManager.findDescriptionFor (newNode));
+    // a saved state means the instance will be overwritten anyway, so a
+    // pooled one can be used
     if (auto* node = createFilter (&desc, 0, 0,
-        newNode.hasProperty(Tags::id) ? newNode.getNodeId() : 0))
+        newNode.hasProperty(Tags::id) ? newNode.getNodeId() : 0,
+        newNode.hasProperty (Tags::state)))
     {
         nodeId = node->nodeId;
         ValueTree data = newNode.getValueTree().createCopy();
@@ -401,14 +428,17 @@ void GraphManager::removeFilter (const uint32 uid)
             if (obj)
             {
                 obj->willBeRemoved();
-                obj->releaseResources();
+                obj->unprepare();
             }
 
             auto data = node.getValueTree();
             nodes.removeChild (data, nullptr);
             // clear all referecnce counted objects
             Node::sanitizeProperties (data, true);
-            // finally delete the node + plugin instance.
+            // finally delete the node + plugin instance, unless the pool
+            // keeps the instance around for undo
+            SharedResourcePointer<PluginInstancePool> pool;
+            pool->add (obj);
             obj = nullptr;
         }
     }
@@ -503,6 +533,7 @@ void GraphManager::removeConnection (uint32 sourceNode, uint32 sourcePort,
 void GraphManager::setNodeModel (const Node& node)
 {
     loaded = false;
+    deferred = false;
 
     processor.clear();
     graph   = node.getValueTree();
@@ -514,7 +545,8 @@ void GraphManager::setNodeModel (const Node& node)
     {
         Node node (nodes.getChild (i), false);
         const PluginDescription desc (pluginManager.findDescriptionFor (node));
-        if (GraphNodePtr obj = createFilter (&desc, 0.0, 0.0, node.getNodeId()))
+        if (GraphNodePtr obj = createFilter (&desc, 0.0, 0.0, node.getNodeId(),
+                                             node.hasProperty (Tags::state)))
         {
             setupNode (node.getValueTree(), obj);
             obj->setEnabled (node.isEnabled());
@@ -587,6 +619,45 @@ void GraphManager::setNodeModel (const Node& node)
     processorArcsChanged();
 }
 
+void GraphManager::deferNodeModel (const Node& node)
+{
+    loaded = false;
+    deferred = true;
+
+    processor.clear();
+    graph   = node.getValueTree();
+    arcs    = node.getArcsValueTree();
+    nodes   = node.getNodesValueTree();
+}
+
+void GraphManager::loadDeferredModel()
+{
+    if (! deferred)
+        return;
+    DBG("[EL] loading deferred graph: " << getGraphModel().getName());
+    setNodeModel (getGraphModel());
+}
+
+GraphManager* GraphManager::findDeferredSubGraph() const
+{
+    for (int i = 0; i < processor.getNumNodes(); ++i)
+    {
+        if (GraphNodePtr node = processor.getNode (i))
+        {
+            if (auto* sub = node->processor<SubGraphProcessor>())
+            {
+                auto& controller = sub->getController();
+                if (controller.isDeferred())
+                    return &controller;
+                if (auto* nested = controller.findDeferredSubGraph())
+                    return nested;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
 void GraphManager::savePluginStates()
 {
     for (int i = 0; i < nodes.getNumChildren(); ++i)
@@ -594,11 +665,16 @@ void GraphManager::savePluginStates()
         Node node (nodes.getChild (i), false);
         node.savePluginState();
     }
+
+    // drop the states that were just replaced
+    SharedResourcePointer<StateStore> store;
+    store->purgeUnused();
 }
 
 void GraphManager::clear()
 {
     loaded = false;
+    deferred = false;
 
     if (graph.isValid())
     {
@@ -667,7 +743,23 @@ void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
             AudioProcessor::BusesLayout layout;
             layout.inputBuses.add (AudioChannelSet::namedChannelSet (ins.size()));
             layout.outputBuses.add (AudioChannelSet::namedChannelSet (outs.size()));
-            
+
+            if (! proc->checkBusesLayoutSupported (layout) && proc->getBusCount (true) > 1)
+            {
+                // keep the main buses and give aux inputs (sidechains) what's
+                // left, so nodes saved before a sidechain existed keep their ports
+                layout = proc->getBusesLayout();
+                int remaining = ins.size() - layout.getMainInputChannels();
+                for (int i = 1; i < layout.inputBuses.size(); ++i)
+                {
+                    const int numChans = jlimit (0, layout.inputBuses[i].size(), remaining);
+                    layout.inputBuses.getReference(i) = numChans > 0
+                        ? AudioChannelSet::canonicalChannelSet (numChans)
+                        : AudioChannelSet::disabled();
+                    remaining -= numChans;
+                }
+            }
+
             if (proc->checkBusesLayoutSupported (layout))
             {
                 proc->suspendProcessing (true);
@@ -683,7 +775,12 @@ void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
     
     if (auto* sub = obj->processor<SubGraphProcessor>())
     {
-        sub->getController().setNodeModel (node);
+        // a disabled graph doesn't render, so its nodes aren't created
+        // until it's enabled. this keeps large sessions quick to open
+        if (node.isEnabled())
+            sub->getController().setNodeModel (node);
+        else
+            sub->getController().deferNodeModel (node);
         resetPorts = true;
     }
 
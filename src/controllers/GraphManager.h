@@ -88,6 +88,20 @@ public:
 
     void setNodeModel (const Node& node);
     inline Node getGraphModel() const { return Node (graph, false); }
+
+    /** Takes the model without creating any of its nodes. They get created
+        when loadDeferredModel() is called. Used for disabled sub graphs */
+    void deferNodeModel (const Node& node);
+
+    /** Returns true if the model was deferred and hasn't been loaded yet */
+    inline bool isDeferred() const { return deferred; }
+
+    /** Creates the nodes of a deferred model */
+    void loadDeferredModel();
+
+    /** Returns the first deferred graph nested in this one, or nullptr if
+        everything is loaded. This is recursive */
+    GraphManager* findDeferredSubGraph() const;
     
     void savePluginStates();
     
@@ -105,12 +119,13 @@ private:
     GraphProcessor& processor;
     ValueTree graph, arcs, nodes;
     bool loaded = false;
+    bool deferred = false;
     
     uint32 lastUID;
     uint32 getNextUID() noexcept;
     inline void changed() { sendChangeMessage(); }
     GraphNode* createFilter (const PluginDescription* desc, double x = 0.0f, double y = 0.0f,
-                             uint32 nodeId = 0);
+                             uint32 nodeId = 0, bool reuseInstance = false);
     GraphNode* createPlaceholder (const Node& node);
     void setupNode (const ValueTree& data, GraphNodePtr object);
     
@@ -18,12 +18,15 @@
 */
 
 #include "controllers/OSCController.h"
+#include "engine/MeterSource.h"
 #include "session/CommandManager.h"
+#include "session/Session.h"
 #include "Commands.h"
 #include "Globals.h"
 #include "Settings.h"
 
 #define EL_OSC_ADDRESS_COMMAND "/element/command"
+#define EL_OSC_ADDRESS_METER   "/element/meter"
 
 namespace Element {
 
@@ -53,6 +56,60 @@ private:
 
 //=============================================================================
 
+/** Replies to "/element/meter <node uuid> <host> <port>" with
+    "/element/meter <node uuid> <name> <value> ..." for nodes with meters */
+struct MeterOSCListener final : OSCReceiver::ListenerWithOSCAddress<>
+{
+    MeterOSCListener (Globals& w)
+        : world (w)
+    { }
+
+    void oscMessageReceived (const OSCMessage& message) override
+    {
+        if (message.size() < 3 || ! message[0].isString() || 
+            ! message[1].isString() || ! message[2].isInt32())
+            return;
+
+        auto session = world.getSession();
+        if (session == nullptr)
+            return;
+
+        const auto node = session->findNodeById (Uuid (message[0].getString()));
+        auto* const object = node.getGraphNode();
+        auto* const source = object != nullptr ? object->processor<MeterSource>() : nullptr;
+        if (source == nullptr)
+            return;
+
+        OSCMessage reply (EL_OSC_ADDRESS_METER);
+        reply.addString (message[0].getString());
+        for (int i = 0; i < source->getNumMeters(); ++i)
+        {
+            reply.addString (source->getMeterName (i));
+            reply.addFloat32 (source->getMeterValue (i));
+        }
+
+        const auto host = message[1].getString();
+        const auto port = message[2].getInt32();
+        if (host != replyHost || port != replyPort)
+        {
+            sender.disconnect();
+            replyHost = sender.connect (host, port) ? host : String();
+            replyPort = port;
+        }
+
+        if (replyHost.isNotEmpty())
+            sender.send (reply);
+    }
+
+private:
+    Globals& world;
+    OSCSender sender;
+    String replyHost;
+    int replyPort = 0;
+};
+
+//=============================================================================
+
 class OSCController::Impl
 {
 public:
@@ -98,6 +155,8 @@ public:
         
         application.reset (new CommandOSCListener (owner.getWorld()));
         receiver.addListener (application.get(), EL_OSC_ADDRESS_COMMAND);
+        meters.reset (new MeterOSCListener (owner.getWorld()));
+        receiver.addListener (meters.get(), EL_OSC_ADDRESS_METER);
 
         listenersReady = true;
     }
@@ -110,6 +169,8 @@ public:
 
         receiver.removeListener (application.get());
         application.reset();
+        receiver.removeListener (meters.get());
+        meters.reset();
     }
 
     int getHostPort() const { return serverPort; }
@@ -124,6 +185,7 @@ private:
     int serverPort { 9000 };
 
     std::unique_ptr<CommandOSCListener> application;
+    std::unique_ptr<MeterOSCListener> meters;
 };
 
 //=============================================================================
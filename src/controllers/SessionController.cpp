@@ -28,21 +28,42 @@
 #include "gui/ContentComponent.h"
 
 #include "session/Node.h"
+#include "session/SessionJournal.h"
+#include "session/StateStore.h"
 #include "Globals.h"
 #include "Settings.h"
 
 namespace Element {
 
+/** Every Nth autosave captures all nodes, including ones that
+    can't report their own state changes */
+static const int fullAutosaveInterval = 10;
+
+SessionController::SessionController() { }
+SessionController::~SessionController() { }
+
 void SessionController::activate()
 {
     auto* app = dynamic_cast<AppController*> (getRoot());
     currentSession = app->getWorld().getSession();
+    currentSession->addChangeListener (this);
     document = new SessionDocument (currentSession);
     document->setLastDocumentOpened (DataPath::defaultSessionDir().getChildFile ("Untitled.els"));
+   #if EL_PRO
+    // only builds which can recover the journal, and turn it off, write one
+    journal.reset (new SessionJournal());
+    startTimer (1000 * getSettings().getAutosaveInterval());
+   #endif
 }
 
 void SessionController::deactivate()
 {
+    stopTimer();
+    if (journal)
+        journal->discard(); // clean shutdown, nothing to recover
+    journal.reset();
+    currentSession->removeChangeListener (this);
+
     auto& world = getWorld();
     auto& settings (world.getSettings());
     auto* props = settings.getUserSettings();
@@ -64,6 +85,7 @@ void SessionController::openDefaultSession()
         gc->closeAllPluginWindows();
         
     loadNewSessionData();
+    resetAutosave();
     refreshOtherControllers();
     findSibling<GuiController>()->stabilizeContent();
     resetChanges();
@@ -98,6 +120,7 @@ void SessionController::openFile (const File& file)
         
         if (result.wasOk())
         {
+            resetAutosave();
             auto& gui = *findSibling<GuiController>();
             gui.closeAllPluginWindows();
             refreshOtherControllers();
@@ -184,6 +207,11 @@ void SessionController::saveSession (const bool saveAs)
         currentSession->dispatchPendingMessages();
         document->setChangedFlag (false);
         jassert (! hasSessionChanged());
+
+        // the saved file has every state, start the journal over from it
+        if (journal && journal->isActive())
+            journal->start (journal->getFile(), document->getFile(), currentSession->getValueTree());
+        modelChangedSinceAutosave = false;
     }
 }
 
@@ -205,6 +233,7 @@ void SessionController::newSession()
     {
         findSibling<GuiController>()->closeAllPluginWindows();
         loadNewSessionData();
+        resetAutosave();
         refreshOtherControllers();
         findSibling<GuiController>()->stabilizeContent();
         resetChanges (true);
@@ -241,6 +270,145 @@ void SessionController::refreshOtherControllers()
     findSibling<MappingController>()->learn (false);
     findSibling<PresetsController>()->refresh();
     sessionLoaded();
+
+    // states only held by the previous session can go now
+    SharedResourcePointer<StateStore> store;
+    store->purgeUnused();
+}
+
+//=============================================================================
+
+void SessionController::resetAutosave()
+{
+    if (journal)
+        journal->discard();
+    journaledStateVersions.clear();
+    numAutosaves = 0;
+    modelChangedSinceAutosave = true;
+}
+
+void SessionController::changeListenerCallback (ChangeBroadcaster* cb)
+{
+    if (cb == currentSession.get())
+        modelChangedSinceAutosave = true;
+}
+
+void SessionController::timerCallback()
+{
+    auto& settings = getSettings();
+    if (settings.isAutosaveEnabled())
+    {
+        autosave();
+    }
+    else if (journal && journal->isActive())
+    {
+        journal->discard();
+        journaledStateVersions.clear();
+    }
+
+    const int interval = 1000 * settings.getAutosaveInterval();
+    if (interval != getTimerInterval())
+        startTimer (interval);
+}
+
+void SessionController::autosave()
+{
+    if (! currentSession || ! journal || ! document)
+        return;
+
+    if (! journal->isActive())
+    {
+        journal->start (SessionJournal::getDefaultFile(), document->getFile(),
+                        currentSession->getValueTree());
+        modelChangedSinceAutosave = false;
+    }
+    else if (modelChangedSinceAutosave)
+    {
+        journal->writeSnapshot (currentSession->getValueTree());
+        modelChangedSinceAutosave = false;
+    }
+
+    const bool fullPass = (++numAutosaves % fullAutosaveInterval) == 0;
+
+    currentSession->forEach ([this, fullPass] (const ValueTree& tree)
+    {
+        if (! tree.hasType (Tags::node))
+            return;
+        
+        const Node node (tree, false);
+        GraphNodePtr object = node.getGraphNode();
+        if (object == nullptr || ! object->isPrepared || node.isGraph())
+            return;
+
+        const auto uuid = node.getUuidString();
+        const auto version = object->getStateVersion();
+        const auto iter = journaledStateVersions.find (uuid);
+        const bool journaled = iter != journaledStateVersions.end();
+        const bool wanted = object->tracksStateChanges()
+            ? ! journaled || iter->second != version
+            : ! journaled || fullPass;
+        if (! wanted)
+            return;
+
+        journaledStateVersions[uuid] = version;
+
+        if (object->canGetStateOffMessageThread())
+        {
+            journal->writeNodeState (uuid, object);
+        }
+        else
+        {
+            MemoryBlock state, programState;
+            if (auto* proc = object->getAudioProcessor())
+            {
+                proc->getStateInformation (state);
+                proc->getCurrentProgramStateInformation (programState);
+            }
+            else
+            {
+                object->getState (state);
+            }
+
+            journal->writeNodeState (uuid, state, programState);
+        }
+    });
+}
+
+bool SessionController::recoverAutosave()
+{
+    const auto journalFile = SessionJournal::getDefaultFile();
+    if (! SessionJournal::canRecover (journalFile))
+        return false;
+
+    if (! AlertWindow::showOkCancelBox (AlertWindow::WarningIcon, "Recover Session",
+            "Element did not shut down cleanly. Would you like to recover the autosaved session?",
+            "Recover", "Discard"))
+    {
+        journalFile.deleteFile();
+        return false;
+    }
+
+    File sessionFile;
+    const auto data = SessionJournal::recover (journalFile, sessionFile);
+    if (! data.isValid() || ! currentSession->loadData (data))
+    {
+        AlertWindow::showMessageBox (AlertWindow::WarningIcon, "Recover Session",
+            "The autosaved session could not be read.");
+        return false;
+    }
+
+    currentSession->forEach ([](const ValueTree& tree)
+    {
+        if (tree.hasType (Tags::node))
+            ignoreUnused (Node (tree, true));
+    });
+
+    resetAutosave();
+    document->setFile (sessionFile);
+    refreshOtherControllers();
+    findSibling<GuiController>()->stabilizeContent();
+    document->setChangedFlag (true);
+    return true;
 }
 
 }
@@ -25,11 +25,15 @@
 #include "Signals.h"
 
 namespace Element {
-class SessionController : public AppController::Child
+class SessionJournal;
+
+class SessionController : public AppController::Child,
+                          private ChangeListener,
+                          private Timer
 {
 public:
-    SessionController() { }
-    ~SessionController() { }
+    SessionController();
+    ~SessionController();
     
     void activate() override;
     void deactivate() override;
@@ -46,13 +50,29 @@ public:
     
     void exportGraph (const Node& node, const File& targetFile);
     void importGraph (const File& file);
+
+    /** Write changed node states, and the session model if it changed, to
+        the autosave journal. Called periodically when autosave is enabled */
+    void autosave();
+
+    /** If the last run left an autosave journal behind, ask the user if
+        it should be recovered. Returns true if a session was loaded */
+    bool recoverAutosave();
     
     Signal<void()> sessionLoaded;
 private:
     SessionPtr currentSession;
     ScopedPointer<SessionDocument> document;
+    std::unique_ptr<SessionJournal> journal;
+    std::map<String, int> journaledStateVersions;
+    int numAutosaves = 0;
+    bool modelChangedSinceAutosave = true;
+
     void loadNewSessionData();
     void refreshOtherControllers();
+    void resetAutosave();
+    void changeListenerCallback (ChangeBroadcaster*) override;
+    void timerCallback() override;
 };
 
 }
@@ -25,12 +25,16 @@
 #include "engine/MidiEngine.h"
 #include "engine/MidiTranspose.h"
 #include "engine/Transport.h"
+#include "engine/TransportSync.h"
 #include "Globals.h"
 #include "Settings.h"
 
 namespace Element {
 
-RootGraph::RootGraph() { }
+RootGraph::RootGraph()
+{
+    midiInputPrefiltered = true;
+}
 
 void RootGraph::setPlayConfigFor (DeviceManager& devices)
 {
@@ -102,6 +106,8 @@ struct RootGraphRender : public AsyncUpdater
     RootGraphRender()
     {
         graphs.ensureStorageAllocated (32);
+        graphFilters.ensureStorageAllocated (32);
+        receivingGraphs.ensureStorageAllocated (32);
     }
 
     void handleAsyncUpdate() override
@@ -132,6 +138,7 @@ struct RootGraphRender : public AsyncUpdater
         numInputChans   = numIns;
         numOutputChans  = numOuts;
         audioTemp.setSize (jmax (numIns, numOuts), numSamples);
+        audioTempDouble.setSize (audioTemp.getNumChannels(), audioTemp.getNumSamples());
         audioOut.setSize (audioTemp.getNumChannels(), audioTemp.getNumSamples());
     }
 
@@ -139,8 +146,10 @@ struct RootGraphRender : public AsyncUpdater
     {
         numInputChans = numOutputChans = 0;
         midiOut.clear();
-        midiTemp.clear();
+        for (auto* const graphMidi : graphInputs)
+            graphMidi->clear();
         audioTemp.setSize (1, 1);
+        audioTempDouble.setSize (1, 1);
         audioOut.setSize (1, 1);
     }
     void dumpGraphs() {
@@ -197,52 +206,91 @@ struct RootGraphRender : public AsyncUpdater
             for (int i = numChans; --i >= 0;)
                 audioOut.clear (i, 0, numSamples);
             midiOut.clear();
-            
-            for (auto* const graph : graphs)
+
+            auto shouldKillNotes = [&] (RootGraph* graph) {
+                return (last == graph && graphChanged && last->isSingle())
+                    || (graphChanged && current->isSingle() && graph != current);
+            };
+
+            // current single graph or parallel graphs get MIDI always
+            auto receivesInput = [&] (RootGraph* graph) {
+                return ! shouldKillNotes (graph) && ((current == graph && graph->isSingle())
+                    || (! current->isSingle() && ! graph->isSingle()));
+            };
+
+            receivingGraphs.clearQuick();
+            for (int g = 0; g < graphs.size(); ++g)
+            {
+                auto* const graph = graphs.getUnchecked (g);
+                // cleared, so IO node ins connected to IO node outs don't feed back
+                graphInputs.getUnchecked(g)->clear();
+                graphFilters.getReference (g) = graph->getMidiPrefilterCopy();
+                if (receivesInput (graph) && ! graphFilters.getReference(g).acceptsAll())
+                    receivingGraphs.add (g);
+            }
+
+            routeMidi (midi, numSamples);
+
+            for (int g = 0; g < graphs.size(); ++g)
             {
+                auto* const graph = graphs.getUnchecked (g);
+                auto& graphMidi = *graphInputs.getUnchecked (g);
+
+                // graphs taking everything read the device input in place
+                const bool sharesInput = receivesInput (graph) && graphFilters.getReference(g).acceptsAll();
+                const MidiBuffer& graphInput = sharesInput ? midi : graphMidi;
+
                 // copy inputs, clear outs if more than input count
                 for (int i = 0; i < numInputChans; ++i)
                     audioTemp.copyFrom (i, 0, buffer, i, 0, numSamples);
                 for (int i = numInputChans; i < numChans; ++i)
                     audioTemp.clear (i, 0, numSamples);
                 
-                // clear so messages: avoids feedback loop when IO node ins are 
-                // connected to IO node outs
-                midiTemp.clear (0, numSamples);
-                
-                if ((last == graph && graphChanged && last->isSingle())
-                    || (graphChanged && current != nullptr && current->isSingle() && graph != current))
+                if (shouldKillNotes (graph))
                 {
                     // send kill messages to the last graph(s) when the graph changes
                     // see http://nickfever.com/music/midi-cc-list
+                    const auto& prefilter = graphFilters.getReference (g);
                     for (int i = 0; i < 16; ++i)
                     {
-                        // sustain pedal off
-                        midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 64, 0), 0);
-                        // Sostenuto off
-                        midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 66, 0), 0);
-                        // Hold off
-                        midiTemp.addEvent (MidiMessage::controllerEvent (i + 1, 69, 0), 0);
-
-                        midiTemp.addEvent (MidiMessage::allNotesOff (i + 1), 0);
+                        const MidiMessage kill[] = {
+                            MidiMessage::controllerEvent (i + 1, 64, 0),    // sustain pedal off
+                            MidiMessage::controllerEvent (i + 1, 66, 0),    // Sostenuto off
+                            MidiMessage::controllerEvent (i + 1, 69, 0),    // Hold off
+                            MidiMessage::allNotesOff (i + 1)
+                        };
+
+                        for (const auto& msg : kill)
+                            if (prefilter.accepts (msg))
+                                graphMidi.addEvent (msg, 0);
                     }
                 }
-                else if ((current == graph && graph->isSingle()) 
-                            || (current != nullptr && !current->isSingle() && !graph->isSingle()))
-                {
-                    // current single graph or parallel graphs get MIDI always
-                    midiTemp.addEvents (midi, 0, numSamples, 0);
-                }
 
                 {
                     const ScopedLock sl (graph->getCallbackLock());
-                    if (graph->isSuspended())
+                    if (graph->isSuspended() && sharesInput)
+                    {
+                        // bypassed graphs pass their input through
+                        graphMidi.addEvents (midi, 0, numSamples, 0);
+                    }
+
+                    if (graph->isUsingDoublePrecision())
+                    {
+                        // devices are 32 bit, so convert at the graph's edges only
+                        audioTempDouble.makeCopyOf (audioTemp, true);
+                        if (graph->isSuspended())
+                            graph->processBlockBypassed (audioTempDouble, graphMidi);
+                        else
+                            graph->processBlock (audioTempDouble, graphInput, graphMidi);
+                        audioTemp.makeCopyOf (audioTempDouble, true);
+                    }
+                    else if (graph->isSuspended())
                     {
-                        graph->processBlockBypassed (audioTemp, midiTemp);
+                        graph->processBlockBypassed (audioTemp, graphMidi);
                     }
                     else
                     {
-                        graph->processBlock (audioTemp, midiTemp);
+                        graph->processBlock (audioTemp, graphInput, graphMidi);
                     }
                 }
                 
@@ -273,7 +321,7 @@ struct RootGraphRender : public AsyncUpdater
                             audioOut.addFrom (i, 0, audioTemp, i, 0, numSamples);
                     }
                     
-                    midiOut.addEvents (midiTemp, 0, numSamples, 0);
+                    midiOut.addEvents (graphMidi, 0, numSamples, 0);
                 }
             }
 
@@ -313,6 +361,9 @@ struct RootGraphRender : public AsyncUpdater
     {
         graph->setLocked (locked);
         graphs.add (graph);
+        graphInputs.add (new MidiBuffer())->ensureSize (3 * 128);
+        graphFilters.add (MidiPrefilter());
+        receivingGraphs.ensureStorageAllocated (graphs.size());
         graph->engineIndex = graphs.size() - 1;
 
         if (graph->engineIndex == 0)
@@ -328,6 +379,8 @@ struct RootGraphRender : public AsyncUpdater
     void removeGraph (RootGraph* graph)
     {
         jassert (graphs.contains (graph));
+        graphInputs.remove (graphs.indexOf (graph));
+        graphFilters.remove (graphs.indexOf (graph));
         graphs.removeFirstMatchingValue (graph);
         graph->engineIndex = -1;
         updateIndexes();
@@ -373,8 +426,31 @@ private:
     int numInputChans       = -1;
     int numOutputChans      = -1;
     AudioSampleBuffer   audioOut, audioTemp;
+    AudioBuffer<double> audioTempDouble;
 
-    MidiBuffer midiOut, midiTemp;
+    MidiBuffer midiOut;
+    OwnedArray<MidiBuffer> graphInputs;
+    Array<MidiPrefilter> graphFilters;
+    Array<int> receivingGraphs;
+
+    /** Copies each input event once into the input of every receiving
+        graph whose prefilter accepts it. Events stay raw bytes, and the
+        prefilters are copies taken for this block */
+    void routeMidi (const MidiBuffer& midi, const int numSamples)
+    {
+        if (receivingGraphs.isEmpty())
+            return;
+
+        MidiBuffer::Iterator iter (midi);
+        const uint8* data = nullptr;
+        int size = 0, frame = 0;
+        while (iter.getNextEvent (data, size, frame) && frame < numSamples)
+        {
+            for (const int g : receivingGraphs)
+                if (graphFilters.getReference(g).accepts (data, size))
+                    graphInputs.getUnchecked(g)->addEvent (data, size, frame);
+        }
+    }
 
     void updateIndexes()
     {
@@ -398,6 +474,12 @@ private:
     }
 };
 
+/** Smallest tempo change passed on from an external clock */
+static const double minClockTempoStep = 0.01;
+
+/** The transport is moved once it is this far from an external clock */
+static const double maxClockPhaseErrorMs = 2.0;
+
 class AudioEngine::Private : public AudioIODeviceCallback,
                              public MidiInputCallback,
                              public Value::Listener,
@@ -469,6 +551,10 @@ public:
         jassert (sampleRate > 0 && blockSize > 0);
         int totalNumChans = 0;
         ScopedNoDenormals denormals;
+        auto& midiOutputs = engine.world.getMidiEngine().getMidiOutputScheduler();
+        midiOutputs.beginBlock (sampleRate, numSamples);
+        syncToMidiClock (midiOutputs.getBlockTime() * 0.001);
+        syncToSession (midiOutputs.getBlockTime(), numSamples);
         if (numInputChannels > numOutputChannels)
         {
             // if there aren't enough output channels for the number of
@@ -518,30 +604,13 @@ public:
             {
                #if defined (EL_PRO)
                 if (sendMidiClockToInput.get() != 1 && generateMidiClock.get() == 1)
-                {
-                    if (wasPlaying != transport.isPlaying())
-                    {
-                        if (transport.isPlaying())
-                        {
-                            incomingMidi.addEvent (transport.getPositionFrames() <= 0 
-                                ? MidiMessage::midiStart() : MidiMessage::midiContinue(), 0);
-                        }
-                        else
-                        {
-                            incomingMidi.addEvent (MidiMessage::midiStop(), 0);
-                        }
-                    }
-
-                    midiClockMaster.setTempo (transport.getTempo());
-                    midiClockMaster.render (incomingMidi, numSamples);
-                }
+                    renderMidiClock (incomingMidi, wasPlaying, numSamples);
                #endif
 
-                const double delayMs = 6.0;
                 if (! incomingMidi.isEmpty())
                 {
                     midiIOMonitor->sent();
-                    midiOut->sendBlockOfMessages (incomingMidi, delayMs + Time::getMillisecondCounterHiRes(), sampleRate);
+                    midiOutputs.schedule (midiOut, incomingMidi, numSamples);
                 }
             }
         }
@@ -563,22 +632,7 @@ public:
         {
            #if defined (EL_PRO)
             if (generateMidiClock.get() == 1 && sendMidiClockToInput.get() == 1)
-            {
-                if (wasPlaying != transport.isPlaying())
-                {
-                    if (transport.isPlaying())
-                    {
-                        midi.addEvent (transport.getPositionFrames() <= 0 
-                            ? MidiMessage::midiStart() : MidiMessage::midiContinue(), 0);
-                    }
-                    else
-                    {
-                        midi.addEvent (MidiMessage::midiStop(), 0);
-                    }
-                }
-                midiClockMaster.setTempo (static_cast<double> (transport.getTempo()));
-                midiClockMaster.render (midi, numSamples);
-            }
+                renderMidiClock (midi, wasPlaying, numSamples);
            #endif
 
             if (currentGraph.get() != graphs.getCurrentGraphIndex())
@@ -598,6 +652,121 @@ public:
         transport.postProcess (numSamples);
     }
     
+    double getTransportBeats() const
+    {
+        return sampleRate > 0.0
+            ? (double) transport.getPositionFrames() * (double) transport.getTempo() / (60.0 * sampleRate)
+            : 0.0;
+    }
+
+    /** Renders clock, and start, stop or continue when the play state changed */
+    void renderMidiClock (MidiBuffer& midi, const bool wasPlaying, const int numSamples)
+    {
+        if (wasPlaying != transport.isPlaying())
+        {
+            if (transport.isPlaying())
+            {
+                const double beats = getTransportBeats();
+                midiClockMaster.setPositionBeats (beats);
+                if (transport.getPositionFrames() <= 0)
+                {
+                    midi.addEvent (MidiMessage::midiStart(), 0);
+                }
+                else
+                {
+                    midi.addEvent (MidiClockMaster::songPositionPointer (beats), 0);
+                    midi.addEvent (MidiMessage::midiContinue(), 0);
+                }
+            }
+            else
+            {
+                midi.addEvent (MidiMessage::midiStop(), 0);
+            }
+        }
+
+        midiClockMaster.setTempo (static_cast<double> (transport.getTempo()));
+        midiClockMaster.render (midi, numSamples);
+    }
+
+    /** Moves the transport onto the external clock's beat position. Tempo
+        is only changed in steps, since a change re-maps every frame to a
+        new beat, and the phase is corrected by relocating once it drifts
+        past a tolerance */
+    void syncToMidiClock (const double nowSeconds)
+    {
+        if (sampleRate <= 0.0 || ! isUsingExternalClock())
+            return;
+
+        double beats = 0.0, tempo = 0.0;
+        if (! midiClock.getPosition (nowSeconds, beats, tempo))
+            return;
+
+        if (std::abs (tempo - clockTempo) >= minClockTempoStep)
+        {
+            clockTempo = tempo;
+            transport.requestTempo (clockTempo);
+        }
+
+        const double framesPerBeat = 60.0 * sampleRate / clockTempo;
+        const double target = jmax (0.0, beats) * framesPerBeat;
+        const double error = target - (double) transport.getPositionFrames();
+        const bool relocate = std::abs (error) > maxClockPhaseErrorMs * 0.001 * sampleRate;
+        if (relocate)
+            transport.requestAudioFrame ((int64) std::llround (target));
+        midiClock.reportPhaseError (error / framesPerBeat, relocate);
+    }
+
+    /** Follows the tempo and play state shared with other instances. A
+        start is prepared one block ahead: the seek lands in postProcess,
+        so the next block starts playing from the frame the shared start
+        has reached by then */
+    void syncToSession (const double hostTimeMs, const int numSamples)
+    {
+        TransportSync::Snapshot state;
+        if (sampleRate <= 0.0 || isUsingExternalClock() || ! transportSync.getSnapshot (state))
+            return;
+
+        const auto& timeline  = state.timeline;
+        const auto& startStop = state.startStop;
+        const double now = hostTimeMs + state.offset;
+
+        // compared with the transport, other paths set its tempo too
+        if (std::abs (timeline.tempo - (double) transport.getTempo()) >= minClockTempoStep)
+            transport.requestTempo (timeline.tempo);
+
+        if (! startStop.playing)
+        {
+            syncStartPending = false;
+            if (transport.isPlaying())
+                transport.requestPlayState (false);
+            return;
+        }
+
+        const double framesPerBeat = 60.0 * sampleRate / timeline.tempo;
+        if (syncStartPending)
+        {
+            syncStartPending = false;
+            transport.requestPlayState (true);
+            return;
+        }
+
+        if (! transport.isPlaying())
+        {
+            const double nextBlock = now + 1000.0 * numSamples / sampleRate;
+            if (nextBlock < startStop.time)
+                return;
+            const double beats = timeline.getBeatsAt (nextBlock) - startStop.beats;
+            transport.requestAudioFrame ((int64) std::llround (jmax (0.0, beats) * framesPerBeat));
+            syncStartPending = true;
+            return;
+        }
+
+        const double target = (timeline.getBeatsAt (now) - startStop.beats) * framesPerBeat;
+        const double error = target - (double) transport.getPositionFrames();
+        if (std::abs (error) > maxClockPhaseErrorMs * 0.001 * sampleRate)
+            transport.requestAudioFrame ((int64) std::llround (jmax (0.0, target)));
+    }
+
     bool isTimeMaster() const
     {
        #if EL_RUNNING_AS_PLUGIN
@@ -667,21 +836,24 @@ public:
             midiIOMonitor->received();
         messageCollector.addMessageToQueue (message);
         const bool clockWanted = processMidiClock.get() > 0 && sessionWantsExternalClock.get() > 0;
-        if (clockWanted && message.isMidiClock())
+        if (clockWanted && (message.isMidiClock() || message.isSongPositionPointer()))
         {
             midiClock.process (message);
         }
         else if (clockWanted && message.isMidiStart())
         {
+            midiClock.process (message);
             transport.requestPlayState (true);
             transport.requestAudioFrame (0);
         }
         else if (clockWanted && message.isMidiStop())
         {
+            midiClock.process (message);
             transport.requestPlayState (false);
         }
         else if (clockWanted && message.isMidiContinue())
         {
+            midiClock.process (message);
             transport.requestPlayState (true);
         }   
     }
@@ -738,7 +910,9 @@ public:
         if (tempoValue.refersToSameSourceAs (value))
         {
             const float tempo = (float) tempoValue.getValue();
-            if (sessionWantsExternalClock.get() <= 0 || processMidiClock.get() <= 0)
+            if (transportSync.isEnabled())
+                transportSync.requestTempo (tempo);
+            else if (sessionWantsExternalClock.get() <= 0 || processMidiClock.get() <= 0)
                 transport.requestTempo (tempo);
         }
         else if (externalClockValue.refersToSameSourceAs (value))
@@ -764,7 +938,8 @@ public:
     
     void midiClockTempoChanged (const float bpm) override
     {
-        if (sessionWantsExternalClock.get() > 0 && processMidiClock.get() > 0)
+        // while running the audio thread follows the clock's phase
+        if (sessionWantsExternalClock.get() > 0 && processMidiClock.get() > 0 && ! midiClock.isRunning())
             transport.requestTempo (bpm);
     }
     
@@ -814,6 +989,10 @@ private:
 
     MidiClock midiClock;
     MidiClockMaster midiClockMaster;
+    double clockTempo = 120.0;
+
+    TransportSync transportSync;
+    bool syncStartPending = false;
     
     AudioPlayHead::CurrentPositionInfo hostPos, lastHostPos;
     
@@ -895,6 +1074,14 @@ void AudioEngine::applySettings (Settings& settings)
     priv->processMidiClock.set (useMidiClock ? 1 : 0);
     priv->generateMidiClock.set (settings.generateMidiClock() ? 1 : 0);
     priv->sendMidiClockToInput.set (settings.sendMidiClockToInput() ? 1 : 0);
+
+   #if ! EL_RUNNING_AS_PLUGIN
+    auto& sync (priv->transportSync);
+    if (settings.transportSync() && ! sync.isEnabled())
+        sync.enable (priv->transport.getTempo());
+    else if (! settings.transportSync() && sync.isEnabled())
+        sync.disable();
+   #endif
 }
 
 bool AudioEngine::removeGraph (RootGraph* graph)
@@ -963,13 +1150,20 @@ void AudioEngine::setMeter (int beatsPerBar, int beatDivisor)
 void AudioEngine::togglePlayPause()
 {
     auto& transport (priv->transport);
-    transport.requestPlayPause();
+    TransportSync::Snapshot shared;
+    if (priv->transportSync.getSnapshot (shared))
+        priv->transportSync.requestPlaying (! shared.startStop.playing, transport.getBeatsPerBar());
+    else
+        transport.requestPlayPause();
 }
 
 void AudioEngine::setPlaying (const bool shouldBePlaying)
 {
     auto& transport (priv->transport);
-    transport.requestPlayState (shouldBePlaying);
+    if (priv->transportSync.isEnabled())
+        priv->transportSync.requestPlaying (shouldBePlaying, transport.getBeatsPerBar());
+    else
+        transport.requestPlayState (shouldBePlaying);
 }
 
 void AudioEngine::setRecording (const bool shouldBeRecording)
@@ -995,6 +1189,8 @@ void AudioEngine::processExternalBuffers (AudioBuffer<float>& buffer, MidiBuffer
 {
     if (priv)
     {
+        // hosts don't pass a block time, the smoothed call time stands in
+        world.getMidiEngine().getMidiOutputScheduler().beginBlock (priv->sampleRate, buffer.getNumSamples());
        #if EL_RUNNING_AS_PLUGIN
         world.getMidiEngine().processMidiBuffer (midi, buffer.getNumSamples(), priv->sampleRate);
        #endif
@@ -1006,6 +1202,11 @@ bool AudioEngine::isUsingExternalClock() const {
     return priv && priv->isUsingExternalClock();
 }
 
+MidiClock::Stats AudioEngine::getMidiClockStats() const
+{
+    return priv != nullptr ? priv->midiClock.getStats() : MidiClock::Stats();
+}
+
 void AudioEngine::processExternalPlayhead (AudioPlayHead* playhead, const int nframes)
 {
     auto& pos (priv->hostPos);
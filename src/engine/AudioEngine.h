@@ -22,6 +22,7 @@
 #include "ElementApp.h"
 #include "engine/Engine.h"
 #include "engine/GraphProcessor.h"
+#include "engine/MidiClock.h"
 #include "engine/MidiIOMonitor.h"
 #include "engine/Transport.h"
 #include "session/DeviceManager.h"
@@ -148,6 +149,9 @@ public:
     void applySettings (Settings&);
     
     bool isUsingExternalClock() const;
+
+    /** Returns how well the transport is following an external MIDI clock */
+    MidiClock::Stats getMidiClockStats() const;
     
     void setSession (SessionPtr);
     void refreshSession();
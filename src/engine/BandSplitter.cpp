@@ -0,0 +1,257 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/BandSplitter.h"
+
+namespace Element {
+
+/** Samples interleaved per pass. Longer blocks are split */
+static const int interleavedSize = 256;
+static const int laneSize = (int) BandSplitter::Vec::SIMDNumElements;
+
+enum CrossoverType { lowPass, highPass, allPass };
+
+/** Butterworth sections designed in double precision. Two low passes plus
+    two high passes at the same frequency sum exactly to the all pass, which
+    is what keeps the bands flat */
+static BiquadCoefficients getCrossover (CrossoverType type, double sampleRate, double freq)
+{
+    const double q = MathConstants<double>::sqrt2 / 2.0;
+    const double k = std::tan (MathConstants<double>::pi * freq / sampleRate);
+    const double norm = 1.0 / (1.0 + k / q + k * k);
+    const double a1 = 2.0 * (k * k - 1.0) * norm;
+    const double a2 = (1.0 - k / q + k * k) * norm;
+
+    BiquadCoefficients c;
+    c.a1 = (float) a1;
+    c.a2 = (float) a2;
+
+    switch (type)
+    {
+        case lowPass:
+            c.b0 = (float) (k * k * norm);
+            c.b1 = 2.0f * c.b0;
+            c.b2 = c.b0;
+            break;
+        case highPass:
+            c.b0 = (float) norm;
+            c.b1 = -2.0f * c.b0;
+            c.b2 = c.b0;
+            break;
+        case allPass:
+            c.b0 = (float) a2;
+            c.b1 = (float) a1;
+            c.b2 = 1.0f;
+            break;
+    }
+
+    return c;
+}
+
+//=============================================================================
+
+BandSplitter::BandSplitter()
+{
+    interleaved.resize ((size_t) interleavedSize);
+}
+
+BandSplitter::~BandSplitter() { }
+
+void BandSplitter::prepare (int newNumBands, int newNumChannels)
+{
+    numBands    = jlimit (2, maxBands, newNumBands);
+    numChannels = jlimit (1, maxChannels, newNumChannels);
+    numLanes    = numBands * numChannels;
+    numVectors  = (numLanes + laneSize - 1) / laneSize;
+
+    // the top band passes every crossover's high pass
+    numStages = 2 * (numBands - 1);
+
+    sections.clear();
+    sections.resize ((size_t) (numStages * numVectors));
+    interleaved.resize ((size_t) (interleavedSize * numVectors));
+
+    // unity until crossovers are set
+    for (int stage = 0; stage < numStages; ++stage)
+        for (int lane = 0; lane < numVectors * laneSize; ++lane)
+            setLane (stage, lane, BiquadCoefficients(), false);
+    reset();
+}
+
+void BandSplitter::setLane (int stage, int lane, const BiquadCoefficients& coefs, bool ramp)
+{
+    auto& s = getSection (stage, lane / laneSize);
+    const auto i = (size_t) (lane % laneSize);
+    s.tb0.set (i, coefs.b0); s.tb1.set (i, coefs.b1); s.tb2.set (i, coefs.b2);
+    s.ta1.set (i, coefs.a1); s.ta2.set (i, coefs.a2);
+    if (! ramp)
+    {
+        s.b0.set (i, coefs.b0); s.b1.set (i, coefs.b1); s.b2.set (i, coefs.b2);
+        s.a1.set (i, coefs.a1); s.a2.set (i, coefs.a2);
+    }
+}
+
+void BandSplitter::setCrossovers (double sampleRate, const float* frequencies, bool ramp)
+{
+    const double nyquist = sampleRate / 2.0;
+    double freqs [maxBands];
+    for (int i = 0; i < numBands - 1; ++i)
+    {
+        const double lowest = i > 0 ? freqs[i - 1] : 10.0;
+        freqs[i] = jlimit (lowest, nyquist * 0.95, (double) frequencies[i]);
+    }
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        BiquadCoefficients chain [2 * maxBands];
+        int length = 0;
+
+        for (int i = 0; i < band; ++i)
+        {
+            const auto coefs = getCrossover (highPass, sampleRate, freqs[i]);
+            chain[length++] = coefs;
+            chain[length++] = coefs;
+        }
+
+        if (band < numBands - 1)
+        {
+            const auto coefs = getCrossover (lowPass, sampleRate, freqs[band]);
+            chain[length++] = coefs;
+            chain[length++] = coefs;
+            for (int i = band + 1; i < numBands - 1; ++i)
+                chain[length++] = getCrossover (allPass, sampleRate, freqs[i]);
+        }
+
+        jassert (length <= numStages);
+        for (int stage = 0; stage < numStages; ++stage)
+            for (int ch = 0; ch < numChannels; ++ch)
+                setLane (stage, band * numChannels + ch,
+                         stage < length ? chain[stage] : BiquadCoefficients(), ramp);
+    }
+
+    for (auto& s : sections)
+    {
+        s.ramping = false;
+        for (size_t i = 0; i < (size_t) laneSize; ++i)
+            s.ramping |= s.b0.get (i) != s.tb0.get (i) || s.b1.get (i) != s.tb1.get (i)
+                      || s.b2.get (i) != s.tb2.get (i) || s.a1.get (i) != s.ta1.get (i)
+                      || s.a2.get (i) != s.ta2.get (i);
+    }
+}
+
+void BandSplitter::reset()
+{
+    for (auto& s : sections)
+    {
+        s.b0 = s.tb0; s.b1 = s.tb1; s.b2 = s.tb2;
+        s.a1 = s.ta1; s.a2 = s.ta2;
+        s.z1 = Vec::expand (0.0f);
+        s.z2 = Vec::expand (0.0f);
+        s.ramping = false;
+    }
+}
+
+void BandSplitter::processSection (Section& s, Vec* data, int numSamples) const
+{
+    const auto b0 = s.b0, b1 = s.b1, b2 = s.b2, a1 = s.a1, a2 = s.a2;
+    auto z1 = s.z1, z2 = s.z2;
+
+    for (int i = 0; i < numSamples; ++i, data += numVectors)
+    {
+        const auto x = *data;
+        const auto y = x * b0 + z1;
+        z1 = x * b1 - y * a1 + z2;
+        z2 = x * b2 - y * a2;
+        *data = y;
+    }
+
+    s.z1 = z1;
+    s.z2 = z2;
+}
+
+void BandSplitter::processSectionRamped (Section& s, Vec* data, int numSamples) const
+{
+    const auto scale = Vec::expand (1.0f / (float) numSamples);
+    auto b0 = s.b0, b1 = s.b1, b2 = s.b2, a1 = s.a1, a2 = s.a2;
+    const auto db0 = (s.tb0 - b0) * scale, db1 = (s.tb1 - b1) * scale, db2 = (s.tb2 - b2) * scale,
+               da1 = (s.ta1 - a1) * scale, da2 = (s.ta2 - a2) * scale;
+    auto z1 = s.z1, z2 = s.z2;
+
+    for (int i = 0; i < numSamples; ++i, data += numVectors)
+    {
+        b0 += db0; b1 += db1; b2 += db2;
+        a1 += da1; a2 += da2;
+
+        const auto x = *data;
+        const auto y = x * b0 + z1;
+        z1 = x * b1 - y * a1 + z2;
+        z2 = x * b2 - y * a2;
+        *data = y;
+    }
+
+    s.b0 = s.tb0; s.b1 = s.tb1; s.b2 = s.tb2;
+    s.a1 = s.ta1; s.a2 = s.ta2;
+    s.ramping = false;
+    s.z1 = z1;
+    s.z2 = z2;
+}
+
+void BandSplitter::process (const float* const* input, float* const* output, int numSamples)
+{
+    if (numStages <= 0)
+        return;
+
+    auto* const data = interleaved.data();
+    auto* const raw  = reinterpret_cast<float*> (data);
+    const int width  = numVectors * laneSize;
+
+    for (int offset = 0; offset < numSamples; offset += interleavedSize)
+    {
+        const int count = jmin (interleavedSize, numSamples - offset);
+
+        // every band starts as a copy of its channel
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const auto* const src = input[lane % numChannels] + offset;
+            for (int i = 0; i < count; ++i)
+                raw[i * width + lane] = src[i];
+        }
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            for (int v = 0; v < numVectors; ++v)
+            {
+                auto& s = getSection (stage, v);
+                if (s.ramping)
+                    processSectionRamped (s, data + v, count);
+                else
+                    processSection (s, data + v, count);
+            }
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            auto* const dst = output[lane] + offset;
+            for (int i = 0; i < count; ++i)
+                dst[i] = raw[i * width + lane];
+        }
+    }
+}
+
+}
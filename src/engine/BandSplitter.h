@@ -0,0 +1,99 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/BiquadCascade.h"
+
+namespace Element {
+
+/** Splits audio into bands with Linkwitz-Riley 4th order crossovers.
+
+    Bands are built as a cascade: each crossover's low pass ends a band and
+    its high pass feeds the rest. Lower bands get an all pass for every
+    crossover above them, so the bands sum back to a flat all pass.
+
+    Every band and channel is a lane of its own filter chain. The lanes are
+    interleaved into SIMD registers with per-lane coefficients, so all bands
+    are filtered in one pass. Chains are padded to the same length with
+    unity sections. Coefficient changes ramp across the next processed
+    block.
+ */
+class BandSplitter
+{
+public:
+    using Vec = dsp::SIMDRegister<float>;
+
+    /** Most bands supported */
+    static constexpr int maxBands = 8;
+
+    /** Most channels supported */
+    static constexpr int maxChannels = 2;
+
+    BandSplitter();
+    ~BandSplitter();
+
+    /** Allocates filters for a band and channel count and clears them.
+        Crossovers must be set again afterwards */
+    void prepare (int numBands, int numChannels);
+
+    /** Returns the prepared band count */
+    int getNumBands() const noexcept        { return numBands; }
+
+    /** Returns the prepared channel count */
+    int getNumChannels() const noexcept     { return numChannels; }
+
+    /** Set getNumBands() - 1 ascending crossover frequencies. If ramp is
+        true the filters move to them over the next block */
+    void setCrossovers (double sampleRate, const float* frequencies, bool ramp = true);
+
+    /** Clears filter state and finishes any ramps */
+    void reset();
+
+    /** Splits the input. Band b of channel c is written to
+        output[b * getNumChannels() + c]. The input may share memory with
+        the first band */
+    void process (const float* const* input, float* const* output, int numSamples);
+
+private:
+    struct Section
+    {
+        Vec b0, b1, b2, a1, a2;
+        Vec tb0, tb1, tb2, ta1, ta2;
+        Vec z1, z2;
+        bool ramping = false;
+    };
+
+    int numBands = 0;
+    int numChannels = 0;
+    int numLanes = 0;
+    int numVectors = 0;
+    int numStages = 0;
+    std::vector<Section> sections;   // stage major
+    std::vector<Vec> interleaved;
+
+    Section& getSection (int stage, int vector) { return sections[(size_t) (stage * numVectors + vector)]; }
+    void setLane (int stage, int lane, const BiquadCoefficients& coefs, bool ramp);
+    void processSection (Section&, Vec* data, int numSamples) const;
+    void processSectionRamped (Section&, Vec* data, int numSamples) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BandSplitter)
+};
+
+}
@@ -0,0 +1,290 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/BiquadCascade.h"
+
+namespace Element {
+
+/** Samples interleaved per pass. Longer blocks are split */
+static const int interleavedSize = 256;
+
+//=============================================================================
+
+BiquadCoefficients BiquadCoefficients::bell (float fs, float freq, float q, float gain)
+{
+    float wc = MathConstants<float>::twoPi * freq / fs;
+    float c = 1.0f / dsp::FastMathApproximations::tan (wc / 2.0f);
+    float phi = c * c;
+    float Knum = c / q;
+    float Kdenom = Knum;
+
+    if (gain > 1.0f)
+        Knum *= gain;
+    else if (gain < 1.0f)
+        Kdenom /= gain;
+
+    float a0 = phi + Kdenom + 1.0f;
+
+    BiquadCoefficients coefs;
+    coefs.b0 = (phi + Knum + 1.0f) / a0;
+    coefs.b1 = 2.0f * (1.0f - phi) / a0;
+    coefs.b2 = (phi - Knum + 1.0f) / a0;
+    coefs.a1 = 2.0f * (1.0f - phi) / a0;
+    coefs.a2 = (phi - Kdenom + 1.0f) / a0;
+    return coefs;
+}
+
+BiquadCoefficients BiquadCoefficients::notch (float fs, float freq, float q, float gain)
+{
+    float wc = MathConstants<float>::twoPi * freq / fs;
+    float wS = dsp::FastMathApproximations::sin (wc);
+    float wC = dsp::FastMathApproximations::cos (wc);
+    float alpha = wS / (2.0f * q);
+
+    float a0 = 1.0f + alpha;
+
+    BiquadCoefficients coefs;
+    coefs.b0 = gain / a0;
+    coefs.b1 = -2.0f * wC * coefs.b0;
+    coefs.b2 = coefs.b0;
+    coefs.a1 = -2.0f * wC / a0;
+    coefs.a2 = (1.0f - alpha) / a0;
+    return coefs;
+}
+
+BiquadCoefficients BiquadCoefficients::lowShelf (float fs, float freq, float q, float gain)
+{
+    float A = sqrtf (gain);
+    float wc = MathConstants<float>::twoPi * freq / fs;
+    float wS = dsp::FastMathApproximations::sin (wc);
+    float wC = dsp::FastMathApproximations::cos (wc);
+    float beta = sqrtf (A) / q;
+
+    float a0 = ((A+1.0f) + ((A-1.0f) * wC) + (beta*wS));
+
+    BiquadCoefficients coefs;
+    coefs.b0 = A*((A+1.0f) - ((A-1.0f)*wC) + (beta*wS)) / a0;
+    coefs.b1 = 2.0f*A * ((A-1.0f) - ((A+1.0f)*wC)) / a0;
+    coefs.b2 = A*((A+1.0f) - ((A-1.0f)*wC) - (beta*wS)) / a0;
+    coefs.a1 = -2.0f * ((A-1.0f) + ((A+1.0f)*wC)) / a0;
+    coefs.a2 = ((A+1.0f) + ((A-1.0f)*wC)-(beta*wS)) / a0;
+    return coefs;
+}
+
+BiquadCoefficients BiquadCoefficients::highShelf (float fs, float freq, float q, float gain)
+{
+    float A = sqrtf (gain);
+    float wc = MathConstants<float>::twoPi * freq / fs;
+    float wS = dsp::FastMathApproximations::sin (wc);
+    float wC = dsp::FastMathApproximations::cos (wc);
+    float beta = sqrtf (A) / q;
+
+    float a0 = ((A+1.0f) - ((A-1.0f) * wC) + (beta*wS));
+
+    BiquadCoefficients coefs;
+    coefs.b0 = A*((A+1.0f) + ((A-1.0f)*wC) + (beta*wS)) / a0;
+    coefs.b1 = -2.0f*A * ((A-1.0f) + ((A+1.0f)*wC)) / a0;
+    coefs.b2 = A*((A+1.0f) + ((A-1.0f)*wC) - (beta*wS)) / a0;
+    coefs.a1 = 2.0f * ((A-1.0f) - ((A+1.0f)*wC)) / a0;
+    coefs.a2 = ((A+1.0f) - ((A-1.0f)*wC)-(beta*wS)) / a0;
+    return coefs;
+}
+
+BiquadCoefficients BiquadCoefficients::lowPass (float fs, float freq, float q, float gain)
+{
+    float wc = MathConstants<float>::twoPi * freq / fs;
+    float c = 1.0f / dsp::FastMathApproximations::tan (wc / 2.0f);
+    float phi = c * c;
+    float K = c / q;
+    float a0 = phi + K + 1.0f;
+
+    BiquadCoefficients coefs;
+    coefs.b0 = gain / a0;
+    coefs.b1 = 2.0f * coefs.b0;
+    coefs.b2 = coefs.b0;
+    coefs.a1 = 2.0f * (1.0f - phi) / a0;
+    coefs.a2 = (phi - K + 1.0f) / a0;
+    return coefs;
+}
+
+BiquadCoefficients BiquadCoefficients::highPass (float fs, float freq, float q, float gain)
+{
+    float wc = MathConstants<float>::twoPi * freq / fs;
+    float c = 1.0f / dsp::FastMathApproximations::tan (wc / 2.0f);
+    float phi = c * c;
+    float K = c / q;
+    float a0 = phi + K + 1.0f;
+
+    BiquadCoefficients coefs;
+    coefs.b0 = gain * phi / a0;
+    coefs.b1 = -2.0f * coefs.b0;
+    coefs.b2 = coefs.b0;
+    coefs.a1 = 2.0f * (1.0f - phi) / a0;
+    coefs.a2 = (phi - K + 1.0f) / a0;
+    return coefs;
+}
+
+BiquadCoefficients BiquadCoefficients::allPass (float fs, float freq, float q)
+{
+    float wc = MathConstants<float>::twoPi * freq / fs;
+    float wS = dsp::FastMathApproximations::sin (wc);
+    float wC = dsp::FastMathApproximations::cos (wc);
+    float alpha = wS / (2.0f * q);
+
+    float a0 = 1.0f + alpha;
+
+    BiquadCoefficients coefs;
+    coefs.b0 = (1.0f - alpha) / a0;
+    coefs.b1 = -2.0f * wC / a0;
+    coefs.b2 = 1.0f;
+    coefs.a1 = coefs.b1;
+    coefs.a2 = coefs.b0;
+    return coefs;
+}
+
+//=============================================================================
+
+BiquadCascade::BiquadCascade (int numStages)
+{
+    interleaved.resize ((size_t) interleavedSize);
+    setNumStages (numStages);
+}
+
+BiquadCascade::~BiquadCascade() { }
+
+void BiquadCascade::setNumStages (int numStages)
+{
+    stages.resize ((size_t) jmax (0, numStages));
+    reset();
+}
+
+void BiquadCascade::setCoefficients (int stage, const BiquadCoefficients& coefs, bool ramp)
+{
+    if (! isPositiveAndBelow (stage, getNumStages()))
+        return;
+    auto& s = stages[(size_t) stage];
+    s.target = coefs;
+    if (! ramp)
+        s.current = coefs;
+}
+
+void BiquadCascade::setCoefficients (const BiquadCoefficients& coefs, bool ramp)
+{
+    for (int i = 0; i < getNumStages(); ++i)
+        setCoefficients (i, coefs, ramp);
+}
+
+void BiquadCascade::reset()
+{
+    for (auto& stage : stages)
+    {
+        stage.current = stage.target;
+        stage.z1 = Vec::expand (0.0f);
+        stage.z2 = Vec::expand (0.0f);
+    }
+}
+
+void BiquadCascade::processStage (Stage& stage, Vec* data, int numSamples)
+{
+    const auto& c = stage.current;
+    const auto b0 = Vec::expand (c.b0), b1 = Vec::expand (c.b1), b2 = Vec::expand (c.b2);
+    const auto a1 = Vec::expand (c.a1), a2 = Vec::expand (c.a2);
+    auto z1 = stage.z1, z2 = stage.z2;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto x = data[i];
+        const auto y = x * b0 + z1;
+        z1 = x * b1 - y * a1 + z2;
+        z2 = x * b2 - y * a2;
+        data[i] = y;
+    }
+
+    stage.z1 = z1;
+    stage.z2 = z2;
+}
+
+void BiquadCascade::processStageRamped (Stage& stage, Vec* data, int numSamples)
+{
+    const auto& c = stage.current;
+    const auto& t = stage.target;
+    const float scale = 1.0f / (float) numSamples;
+    auto b0 = Vec::expand (c.b0), b1 = Vec::expand (c.b1), b2 = Vec::expand (c.b2);
+    auto a1 = Vec::expand (c.a1), a2 = Vec::expand (c.a2);
+    const auto db0 = Vec::expand ((t.b0 - c.b0) * scale), db1 = Vec::expand ((t.b1 - c.b1) * scale),
+               db2 = Vec::expand ((t.b2 - c.b2) * scale), da1 = Vec::expand ((t.a1 - c.a1) * scale),
+               da2 = Vec::expand ((t.a2 - c.a2) * scale);
+    auto z1 = stage.z1, z2 = stage.z2;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        b0 += db0; b1 += db1; b2 += db2;
+        a1 += da1; a2 += da2;
+
+        const auto x = data[i];
+        const auto y = x * b0 + z1;
+        z1 = x * b1 - y * a1 + z2;
+        z2 = x * b2 - y * a2;
+        data[i] = y;
+    }
+
+    stage.current = stage.target;
+    stage.z1 = z1;
+    stage.z2 = z2;
+}
+
+void BiquadCascade::process (float* const* channels, int numChannels, int numSamples)
+{
+    jassert (numChannels <= maxChannels);
+    numChannels = jmin (numChannels, maxChannels);
+    if (numChannels <= 0 || stages.empty())
+        return;
+
+    auto* const data = interleaved.data();
+    auto* const raw  = reinterpret_cast<float*> (data);
+
+    for (int offset = 0; offset < numSamples; offset += interleavedSize)
+    {
+        const int count = jmin (interleavedSize, numSamples - offset);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* const src = channels[ch] + offset;
+            for (int i = 0; i < count; ++i)
+                raw[i * maxChannels + ch] = src[i];
+        }
+
+        for (auto& stage : stages)
+        {
+            if (stage.current != stage.target)
+                processStageRamped (stage, data, count);
+            else
+                processStage (stage, data, count);
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* const dst = channels[ch] + offset;
+            for (int i = 0; i < count; ++i)
+                dst[i] = raw[i * maxChannels + ch];
+        }
+    }
+}
+
+}
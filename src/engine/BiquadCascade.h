@@ -0,0 +1,104 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Biquad coefficients normalized so a0 is 1. The factories follow the
+    "Audio EQ Cookbook" */
+struct BiquadCoefficients
+{
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+    float a1 = 0.0f, a2 = 0.0f;
+
+    bool operator== (const BiquadCoefficients& o) const noexcept
+    {
+        return b0 == o.b0 && b1 == o.b1 && b2 == o.b2 && a1 == o.a1 && a2 == o.a2;
+    }
+
+    bool operator!= (const BiquadCoefficients& o) const noexcept { return ! operator== (o); }
+
+    static BiquadCoefficients bell      (float sampleRate, float freq, float q, float gain);
+    static BiquadCoefficients notch     (float sampleRate, float freq, float q, float gain);
+    static BiquadCoefficients lowShelf  (float sampleRate, float freq, float q, float gain);
+    static BiquadCoefficients highShelf (float sampleRate, float freq, float q, float gain);
+    static BiquadCoefficients lowPass   (float sampleRate, float freq, float q, float gain = 1.0f);
+    static BiquadCoefficients highPass  (float sampleRate, float freq, float q, float gain = 1.0f);
+    static BiquadCoefficients allPass   (float sampleRate, float freq, float q);
+};
+
+/** A chain of direct form II transposed biquads which filters several
+    channels at once.
+
+    Channels are interleaved into SIMD registers so each stage runs one set
+    of vector operations per sample for all of them. Stereo and quad signals
+    cost about the same as mono. Coefficient changes are ramped linearly
+    across the next processed block, so callers can compute coefficients
+    once per block rather than per sample.
+ */
+class BiquadCascade
+{
+public:
+    using Vec = dsp::SIMDRegister<float>;
+
+    /** Most channels filtered together, four with SSE and NEON */
+    static constexpr int maxChannels = (int) Vec::SIMDNumElements;
+
+    explicit BiquadCascade (int numStages = 1);
+    ~BiquadCascade();
+
+    /** Change the number of stages. This allocates and clears state */
+    void setNumStages (int numStages);
+
+    /** Returns the number of stages */
+    int getNumStages() const noexcept { return static_cast<int> (stages.size()); }
+
+    /** Set coefficients for a stage. If ramp is true the stage moves to them
+        over the next block processed, otherwise they apply immediately */
+    void setCoefficients (int stage, const BiquadCoefficients& coefs, bool ramp = true);
+
+    /** Set coefficients for all stages */
+    void setCoefficients (const BiquadCoefficients& coefs, bool ramp = true);
+
+    /** Clears filter state and finishes any ramps */
+    void reset();
+
+    /** Filter channels in place. Channels beyond maxChannels are ignored */
+    void process (float* const* channels, int numChannels, int numSamples);
+
+private:
+    struct Stage
+    {
+        BiquadCoefficients current, target;
+        Vec z1, z2;
+    };
+
+    std::vector<Stage> stages;
+    std::vector<Vec> interleaved;
+
+    static void processStage (Stage&, Vec* data, int numSamples);
+    static void processStageRamped (Stage&, Vec* data, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BiquadCascade)
+};
+
+}
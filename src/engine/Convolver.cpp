@@ -0,0 +1,219 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/Convolver.h"
+
+namespace Element {
+
+/** Taps covered by the head and body together. The tail starts here */
+static const int bodyEnd = Convolver::headSize * 32;
+
+//=============================================================================
+
+/** Uniformly partitioned overlap-save convolution with a frequency domain
+    delay line. process() takes exactly one partition of input and returns
+    one partition of output */
+struct Convolver::Partitioned
+{
+    Partitioned (const float* impulse, int impulseLength, int partitionSize)
+        : size (partitionSize),
+          numBins (partitionSize + 1),
+          spectrumSize (2 * (partitionSize + 1)),
+          numParts (jmax (1, (impulseLength + partitionSize - 1) / partitionSize)),
+          fft (roundToInt (std::log2 (2.0 * partitionSize)))
+    {
+        irSpectra.allocate ((size_t) (numParts * spectrumSize), true);
+        inputSpectra.allocate ((size_t) (numParts * spectrumSize), true);
+        window.allocate ((size_t) (2 * size), true);
+        work.allocate ((size_t) (4 * size), true);
+
+        for (int k = 0; k < numParts; ++k)
+        {
+            FloatVectorOperations::clear (work, 4 * size);
+            const int count = jmin (size, impulseLength - k * size);
+            FloatVectorOperations::copy (work, impulse + k * size, count);
+            fft.performRealOnlyForwardTransform (work, true);
+            FloatVectorOperations::copy (irSpectra + k * spectrumSize, work, spectrumSize);
+        }
+    }
+
+    void reset()
+    {
+        FloatVectorOperations::clear (inputSpectra, numParts * spectrumSize);
+        FloatVectorOperations::clear (window, 2 * size);
+        current = 0;
+    }
+
+    void process (const float* input, float* output)
+    {
+        FloatVectorOperations::copy (window, window + size, size);
+        FloatVectorOperations::copy (window + size, input, size);
+
+        FloatVectorOperations::copy (work, window, 2 * size);
+        FloatVectorOperations::clear (work + 2 * size, 2 * size);
+        fft.performRealOnlyForwardTransform (work, true);
+
+        current = (current + numParts - 1) % numParts;
+        FloatVectorOperations::copy (inputSpectra + current * spectrumSize, work, spectrumSize);
+
+        FloatVectorOperations::clear (work, spectrumSize);
+        for (int k = 0; k < numParts; ++k)
+        {
+            const int slot = (current + k) % numParts;
+            multiplyAdd (work, inputSpectra + slot * spectrumSize,
+                         irSpectra + k * spectrumSize, numBins);
+        }
+
+        fft.performRealOnlyInverseTransform (work);
+        FloatVectorOperations::copy (output, work + size, size);
+    }
+
+    static void multiplyAdd (float* acc, const float* x, const float* h, int bins) noexcept
+    {
+        for (int i = 0; i < bins; ++i)
+        {
+            const int re = 2 * i, im = re + 1;
+            acc[re] += x[re] * h[re] - x[im] * h[im];
+            acc[im] += x[re] * h[im] + x[im] * h[re];
+        }
+    }
+
+    const int size, numBins, spectrumSize, numParts;
+    dsp::FFT fft;
+    HeapBlock<float> irSpectra, inputSpectra, window, work;
+    int current = 0;
+};
+
+//=============================================================================
+
+Convolver::Convolver (const float* impulse, int impulseLength)
+    : length (jmax (0, impulseLength))
+{
+    head.allocate ((size_t) headSize, true);
+    FloatVectorOperations::copy (head, impulse, jmin (headSize, length));
+
+    if (length > headSize)
+        body.reset (new Partitioned (impulse + headSize, jmin (length, bodyEnd) - headSize, headSize));
+    if (length > bodyEnd)
+        tail.reset (new Partitioned (impulse + bodyEnd, length - bodyEnd, tailSize));
+
+    headLine.allocate ((size_t) (2 * headSize - 1), true);
+    bodyOut.allocate ((size_t) headSize, true);
+    tailIn.allocate ((size_t) tailSize, true);
+    tailJobIn.allocate ((size_t) tailSize, true);
+    tailOut[0].allocate ((size_t) tailSize, true);
+    tailOut[1].allocate ((size_t) tailSize, true);
+}
+
+Convolver::~Convolver()
+{
+    waitForTail();
+}
+
+void Convolver::reset()
+{
+    waitForTail();
+
+    if (body) body->reset();
+    if (tail) tail->reset();
+
+    FloatVectorOperations::clear (headLine, 2 * headSize - 1);
+    FloatVectorOperations::clear (bodyOut, headSize);
+    FloatVectorOperations::clear (tailIn, tailSize);
+    FloatVectorOperations::clear (tailOut[0], tailSize);
+    FloatVectorOperations::clear (tailOut[1], tailSize);
+    blockPos = tailPos = tailSlot = 0;
+}
+
+void Convolver::process (const float* input, float* output, int numSamples, Scheduler* scheduler)
+{
+    while (numSamples > 0)
+    {
+        const int count = jmin (numSamples, headSize - blockPos);
+        auto* const line = headLine + headSize - 1 + blockPos;
+        FloatVectorOperations::copy (line, input, count);
+
+        // body and tail were computed ahead, the head is direct
+        FloatVectorOperations::copy (output, bodyOut + blockPos, count);
+        if (tail != nullptr)
+            FloatVectorOperations::add (output, tailOut[tailSlot] + tailPos, count);
+        for (int k = 0; k < headSize; ++k)
+            if (head[k] != 0.0f)
+                FloatVectorOperations::addWithMultiply (output, line - k, head[k], count);
+
+        blockPos += count;
+        tailPos  += count;
+        input    += count;
+        output   += count;
+        numSamples -= count;
+
+        if (blockPos == headSize)
+            finishBlock (scheduler);
+    }
+}
+
+void Convolver::finishBlock (Scheduler* scheduler)
+{
+    auto* const block = headLine + headSize - 1;
+
+    if (body != nullptr)
+        body->process (block, bodyOut);
+
+    if (tail != nullptr)
+    {
+        FloatVectorOperations::copy (tailIn + tailPos - headSize, block, headSize);
+
+        if (tailPos == tailSize)
+        {
+            // the job from the last tail block is output for the next one
+            waitForTail();
+            tailSlot = 1 - tailSlot;
+            FloatVectorOperations::copy (tailJobIn, tailIn, tailSize);
+            tailDone.reset();
+            tailBusy.store (true);
+            if (scheduler == nullptr || ! scheduler->schedule (*this))
+                runTail();
+            tailPos = 0;
+        }
+    }
+    else
+    {
+        tailPos = 0;
+    }
+
+    FloatVectorOperations::copy (headLine, headLine + headSize, headSize - 1);
+    blockPos = 0;
+}
+
+void Convolver::runTail()
+{
+    if (! tailBusy.load())
+        return;
+    tail->process (tailJobIn, tailOut[1 - tailSlot]);
+    tailBusy.store (false);
+    tailDone.signal();
+}
+
+void Convolver::waitForTail()
+{
+    while (tailBusy.load())
+        tailDone.wait (10);
+}
+
+}
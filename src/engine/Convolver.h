@@ -0,0 +1,98 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Zero latency convolution of one input with one impulse response.
+
+    The impulse response is split three ways:
+
+    - head: the first headSize taps, convolved directly in the time domain
+      so there is no latency.
+    - body: uniformly partitioned FFT convolution with headSize partitions,
+      computed on the render thread each time headSize samples arrive.
+    - tail: partitions of tailSize covering the rest, computed on a
+      background thread. Each tail job has a whole tailSize block of time
+      to finish before its output is needed.
+
+    Everything is allocated in the constructor, so build these off the
+    render thread and hand them over when ready.
+ */
+class Convolver
+{
+public:
+    /** Runs tail jobs. Called from the render thread, implementations should
+        not block and must eventually call Convolver::runTail() */
+    struct Scheduler
+    {
+        virtual ~Scheduler() { }
+        virtual bool schedule (Convolver&) = 0;
+    };
+
+    static constexpr int headSize = 64;
+    static constexpr int tailSize = headSize * 16;
+
+    Convolver (const float* impulse, int length);
+    ~Convolver();
+
+    /** Returns the impulse length in samples */
+    int getLength() const noexcept { return length; }
+
+    /** Clears all state. Not realtime safe while a tail job is running */
+    void reset();
+
+    /** Convolve numSamples of input into output. Input and output may be
+        the same buffer. If the scheduler is null or refuses, the tail is
+        computed inline */
+    void process (const float* input, float* output, int numSamples, Scheduler* scheduler);
+
+    /** Computes a scheduled tail job. Called by the scheduler's thread */
+    void runTail();
+
+    /** Waits for a scheduled tail job to finish */
+    void waitForTail();
+
+private:
+    struct Partitioned;
+    std::unique_ptr<Partitioned> body, tail;
+
+    int length = 0;
+    HeapBlock<float> head;          // first headSize taps
+    HeapBlock<float> headLine;      // headSize - 1 samples of history, then the current block
+    HeapBlock<float> bodyOut;       // body output for the current block
+    HeapBlock<float> tailIn;        // tail input being gathered
+    HeapBlock<float> tailJobIn;     // tail input being convolved
+    HeapBlock<float> tailOut[2];    // tail output for the current and next tail block
+    int blockPos = 0;
+    int tailPos = 0;
+    int tailSlot = 0;
+
+    std::atomic<bool> tailBusy { false };
+    WaitableEvent tailDone;
+
+    void finishBlock (Scheduler*);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Convolver)
+};
+
+}
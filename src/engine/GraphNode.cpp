@@ -29,8 +29,10 @@
 #include "engine/GraphNode.h"
 #include "engine/GraphProcessor.h"
 #include "engine/MidiPipe.h"
+#include "engine/MidiProgramCache.h"
 
 #include "session/Node.h"
+#include "session/StateStore.h"
 
 namespace Element {
 
@@ -39,9 +41,9 @@ GraphNode::GraphNode (const uint32 nodeId_) noexcept
       metadata (Tags::node),
       isPrepared (false),
       enablement (*this),
-      midiProgramLoader (*this),
       portResetter (*this)
 {
+    midiProgramCache.reset (new MidiProgramCache (*this));
     parent = nullptr;
     gain.set(1.0f); lastGain.set (1.0f);
     inputGain.set(1.0f); lastInputGain.set (1.0f);
@@ -57,6 +59,7 @@ GraphNode::~GraphNode()
    #endif
     parameters.clear();
     enablement.cancelPendingUpdate();
+    midiProgramCache.reset();
     parent = nullptr;
 }
 
@@ -295,6 +298,22 @@ void GraphNode::prepare (const double sampleRate, const int blockSize,
                          bool willBeEnabled)
 {
     parent = parentGraph;
+
+    // the processor has to be prepared again to change precision or rate
+    if (isPrepared && needsPrepareAgain (parentGraph))
+    {
+        // the current rendering sequence may still be running this node
+        if (parentGraph != nullptr)
+        {
+            const ScopedLock sl (parentGraph->getCallbackLock());
+            unprepare();
+            prepare (sampleRate, blockSize, parentGraph, willBeEnabled);
+            return;
+        }
+
+        unprepare();
+    }
+
     if ((willBeEnabled || enabled.get() == 1) && !isPrepared)
     {
         isPrepared = true;
@@ -302,9 +321,17 @@ void GraphNode::prepare (const double sampleRate, const int blockSize,
 
         initOversampling (jmax (getNumPorts (PortType::Audio, true), getNumPorts (PortType::Audio, false)), blockSize);
 
-        const int osFactor = getOversamplingFactor();
+        renderingDoublePrecision = wantsDoublePrecision (parentGraph);
+        if (auto* proc = getAudioProcessor())
+            if (proc->supportsDoublePrecisionProcessing())
+                proc->setProcessingPrecision (renderingDoublePrecision ? AudioProcessor::doublePrecision
+                                                                       : AudioProcessor::singlePrecision);
+
         prepareToRender (sampleRate * osFactor, blockSize * osFactor);
 
+        // program changes fade over a few milliseconds
+        midiProgramFadeSamples = jmax (1, roundToInt (sampleRate * 0.003));
+
         // TODO: move model code out of engine code
         // VERIFY: this portion is actually needed. This was here to ensure
         // port information is available before setting up the RMS buffers
@@ -387,7 +414,32 @@ void GraphNode::EnablementUpdater::handleAsyncUpdate()
 
 void GraphNode::reloadMidiProgram()
 {
-    midiProgramLoader.triggerAsyncUpdate();
+    if (midiProgramCache)
+        midiProgramCache->request (getMidiProgram());
+}
+
+void GraphNode::refreshMidiPrograms()
+{
+    if (midiProgramCache)
+        midiProgramCache->refresh();
+}
+
+bool GraphNode::isSwitchingMidiProgram() const
+{
+    return midiProgramCache != nullptr && midiProgramCache->isSwitching();
+}
+
+double GraphNode::getMidiProgramSwitchTime() const
+{
+    return midiProgramCache != nullptr ? midiProgramCache->getLastSwitchTime() : 0.0;
+}
+
+void GraphNode::setUseGlobalMidiPrograms (bool use)
+{
+    if (useGlobalMidiPrograms() == use)
+        return;
+    globalMidiPrograms.set (use ? 1 : 0);
+    refreshMidiPrograms();
 }
 
 File GraphNode::getMidiProgramFile (int program) const
@@ -432,6 +484,8 @@ void GraphNode::saveMidiProgram()
         program->state = MemoryBlock();
         getState (program->state);
     }
+
+    refreshMidiPrograms();
 }
 
 void GraphNode::removeMidiProgram (int program, bool global)
@@ -442,8 +496,9 @@ void GraphNode::removeMidiProgram (int program, bool global)
     if (global)
     {
         const auto file = getMidiProgramFile (program);
+        SharedResourcePointer<StateStore> store;
         if (file.existsAsFile())
-            file.deleteFile();
+            store->deleteExternalized (file);
     }
     else
     {
@@ -454,6 +509,8 @@ void GraphNode::removeMidiProgram (int program, bool global)
                 midiPrograms.remove (i);
         }
     }
+
+    refreshMidiPrograms();
 }
 
 GraphNode::MidiProgram* GraphNode::getMidiProgram (int program) const
@@ -468,60 +525,6 @@ GraphNode::MidiProgram* GraphNode::getMidiProgram (int program) const
     return ret;
 }
 
-void GraphNode::MidiProgramLoader::handleAsyncUpdate()
-{
-    const File programFile = node.getMidiProgramFile();
-    const bool globalPrograms = node.useGlobalMidiPrograms();
-    const auto requestedProgram = node.getMidiProgram();
-   #if 0
-    if (node.lastMidiProgram.get() == requestedProgram)
-    {
-        DBG("[EL] same program, not loading.");
-        return;
-    }
-   #endif
-
-    if (globalPrograms)
-    {
-        if (programFile.existsAsFile())
-        {
-            const auto programData = Node::parse (programFile);
-            auto data = programData.getProperty(Tags::state).toString().trim();
-            if (data.isNotEmpty())
-            {
-                MemoryBlock state;
-                state.fromBase64Encoding (data);
-                if (state.getSize() > 0)
-                {
-                    node.lastMidiProgram.set (requestedProgram);
-                    node.setState (state.getData(), (int) state.getSize());
-                    DBG("[EL] loaded program: " << requestedProgram);
-                }
-            }
-        }
-        else
-        {
-            DBG("[EL] Program file doesn't exist: " << node.getMidiProgramFile().getFileName());
-        }
-    }
-    else
-    {
-        if (auto* const program = node.getMidiProgram (requestedProgram))
-        {
-            node.setState (program->state.getData(), 
-                           static_cast<int> (program->state.getSize()));
-        }
-        else
-        {
-            DBG("[EL] program has no data");
-        }
-    }
-
-    node.midiProgramChanged(); // always notify the program # changed even if not loaded.
-                               // do this because there may not be data for the program but
-                               // the property is still relavent.
-}
-
 void GraphNode::setMidiProgram (const int program)
 {
     if (program < 0 || program > 127)
@@ -572,6 +575,9 @@ void GraphNode::getMidiProgramsState (String& state) const
         tree.appendChild (data, nullptr);
     }
 
+    // programs are often saved without changing anything
+    StateStore::pack (tree);
+
     MemoryOutputStream mo;
     {
         GZIPCompressorOutputStream gzipStream (mo, 9);
@@ -585,12 +591,17 @@ void GraphNode::setMidiProgramsState (const String& state)
 {
     midiPrograms.clearQuick (true);
     if (state.isEmpty())
+    {
+        refreshMidiPrograms();
         return;
+    }
     MemoryBlock mb;
     mb.fromBase64Encoding (state);
     const ValueTree tree = (mb.getSize() > 0)
         ? ValueTree::readFromGZIPData (mb.getData(), mb.getSize())
         : ValueTree();
+    SharedResourcePointer<StateStore> store;
+    store->internalize (tree);
     
     for (int i = 0; i < tree.getNumChildren(); ++i)
     {
@@ -606,6 +617,8 @@ void GraphNode::setMidiProgramsState (const String& state)
             midiPrograms.add (program.release());
         }
     }
+
+    refreshMidiPrograms();
 }
 
 //=============================================================================
@@ -704,45 +717,71 @@ void GraphNode::setMuted (bool muted)
 
 void GraphNode::initOversampling (int numChannels, int blockSize)
 {
-    osProcessors.clear();
-    numChannels = jmax (1, numChannels); // avoid assertion on nodes that don't have audio
-    for (int pow = 1; pow <= maxOsPow; ++pow)
-        osProcessors.add (new dsp::Oversampling<float> (numChannels, pow, dsp::Oversampling<float>::FilterType::filterHalfBandPolyphaseIIR));
+    // avoid assertion on nodes that don't have audio
+    oversampler.prepare (jmax (1, numChannels), blockSize, osFactor, osQuality);
+    osLatency = oversampler.getLatencySamples();
+}
 
-    prepareOversampling (blockSize);
+void GraphNode::resetOversampling()
+{
+    oversampler.reset();
 }
 
-void GraphNode::prepareOversampling (int blockSize)
+Oversampler* GraphNode::getOversampler()
 {
-    for (auto* osProcessor : osProcessors)
-        osProcessor->initProcessing (blockSize);
+    return oversampler.getFactor() > 1 ? &oversampler : nullptr;
 }
 
-void GraphNode::resetOversampling()
+void GraphNode::setOversamplingFactor (int factor)
 {
-    for (auto* osProcessor : osProcessors)
-        osProcessor->reset();
+    osFactor = jlimit (1, Oversampler::maxFactor, nextPowerOfTwo (jmax (1, factor)));
+    osLatency = Oversampler::getLatencySamples (osFactor, osQuality);
+    rebuildIfPrepared();
 }
 
-dsp::Oversampling<float>* GraphNode::getOversamplingProcessor()
+void GraphNode::setOversamplingQuality (Oversampler::Quality quality)
 {
-    return osProcessors[osPow-1];
+    osQuality = quality;
+    osLatency = Oversampler::getLatencySamples (osFactor, osQuality);
+    rebuildIfPrepared();
 }
 
-void GraphNode::setOversamplingFactor (int osFactor)
+bool GraphNode::needsPrepareAgain (GraphProcessor* graph) const
 {
-    osPow = (int) log2f ((float) osFactor);
-    if (auto* osProc = getOversamplingProcessor())
-        osLatency = osProc->getLatencyInSamples();
+    return renderingDoublePrecision != wantsDoublePrecision (graph)
+        || oversampler.getFactor() != osFactor
+        || (osFactor > 1 && oversampler.getQuality() != osQuality);
 }
 
-int GraphNode::getOversamplingFactor()
+void GraphNode::rebuildIfPrepared()
 {
-    if (osPow > 0)
-        if (auto* osProc = getOversamplingProcessor())
-            return static_cast<int> (osProc->getOversamplingFactor());
+    // the graph prepares this node again, and compensates the new latency,
+    // when it rebuilds its rendering sequence
+    if (isPrepared && parent != nullptr && needsPrepareAgain (parent))
+        parent->triggerAsyncUpdate();
+}
+
+void GraphNode::setDoublePrecision (bool useDoublePrecision)
+{
+    doublePrecision = useDoublePrecision;
+    rebuildIfPrepared();
+}
+
+bool GraphNode::wantsDoublePrecision (GraphProcessor* graph) const
+{
+    auto* proc = getAudioProcessor();
+    if (proc == nullptr || ! proc->supportsDoublePrecisionProcessing())
+        return false;
+
+    // IO nodes read and write the graph's own buffers
+    if (isAudioIONode() || isMidiIONode())
+        return graph != nullptr && graph->isUsingDoublePrecision();
+
+    // the oversampler and MIDI pipe render in 32 bit
+    if (osFactor > 1 || wantsMidiPipe())
+        return false;
 
-    return 1;
+    return doublePrecision || (graph != nullptr && graph->isUsingDoublePrecision());
 }
 
 //=========================================================================
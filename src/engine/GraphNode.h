@@ -20,6 +20,7 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/Oversampler.h"
 #include "engine/Parameter.h"
 
 namespace Element {
@@ -30,6 +31,7 @@ class ProcessBufferOp;
 }
 
 class GraphProcessor;
+class MidiProgramCache;
 class MidiPipe;
 
 class GraphNode : public ReferenceCountedObject
@@ -162,8 +164,9 @@ public:
     /** Suspend processing */
     void suspendProcessing (const bool);
 
-    /** Get latency audio samples */
-    int getLatencySamples() const { return latencySamples + roundFloatToInt (osLatency); }
+    /** Get latency audio samples. Includes oversampling filters and converts
+        latency reported at the oversampled rate */
+    int getLatencySamples() const { return (latencySamples + osFactor - 1) / osFactor + osLatency; }
 
     /** Set latency samples */
     void setLatencySamples (int latency) { if (latencySamples != latency) latencySamples = latency; }
@@ -247,7 +250,7 @@ public:
     inline bool useGlobalMidiPrograms() const          { return globalMidiPrograms.get() == 1; }
 
     /** Change usage of global midi programs to on or off */
-    inline void setUseGlobalMidiPrograms (bool use)    { globalMidiPrograms.set (use ? 1 : 0); }
+    void setUseGlobalMidiPrograms (bool use);
 
     /** True if MIDI programs should be loaded when Program change messages
         are received */
@@ -268,9 +271,21 @@ public:
     /** Gets the MIDI program's name */
     String getMidiProgramName (const int program) const;
 
-    /** Reloads the active MIDI program */
+    /** Reloads the active MIDI program. The state is applied in the
+        background from pre-decoded program data, so this can be called
+        from the render thread */
     void reloadMidiProgram();
 
+    /** Updates decoded program data after programs are changed on disk */
+    void refreshMidiPrograms();
+
+    /** Returns true while a program change is being applied */
+    bool isSwitchingMidiProgram() const;
+
+    /** Returns how long the last program change took in milliseconds,
+        from the request until the state was applied */
+    double getMidiProgramSwitchTime() const;
+
     /** Save the current MIDI program */
     void saveMidiProgram();
 
@@ -334,9 +349,51 @@ public:
     virtual void getState (MemoryBlock&) = 0;
     virtual void setState (const void*, int sizeInBytes) = 0;
 
+    /** Returns true if getState() may be called from a background thread.
+        Most plugin formats expect the message thread, so this is false
+        unless a subclass knows better */
+    virtual bool canGetStateOffMessageThread() const { return false; }
+
     //=========================================================================
+    /** Flag this node's state as changed */
+    inline void markStateDirty() noexcept           { ++stateVersion; }
+
+    /** Returns a counter which increments every time the state is marked
+        dirty. Compare with a previously stored value to see if the state
+        has changed since then */
+    inline int getStateVersion() const noexcept     { return stateVersion.get(); }
+
+    /** Returns true if this node reports its own state changes. If false,
+        getStateVersion() can't be trusted and the state should be
+        considered changed at all times */
+    virtual bool tracksStateChanges() const { return false; }
+
+    //=========================================================================
+    /** Set the oversampling factor. A prepared node is prepared again when
+        its graph next rebuilds, which this triggers */
     void setOversamplingFactor (int osFactor);
-    int getOversamplingFactor();
+
+    /** Returns the oversampling factor, 1 if not oversampling */
+    int getOversamplingFactor() const noexcept { return osFactor; }
+
+    /** Set the oversampling filter quality. Applied like the factor */
+    void setOversamplingQuality (Oversampler::Quality quality);
+
+    /** Returns the oversampling filter quality */
+    Oversampler::Quality getOversamplingQuality() const noexcept { return osQuality; }
+
+    //=========================================================================
+    /** Render this node in 64 bit even if its graph renders in 32. A
+        prepared node is prepared again when its graph next rebuilds */
+    void setDoublePrecision (bool useDoublePrecision);
+
+    /** Returns true if this node was asked to render in 64 bit */
+    bool isDoublePrecisionRequested() const noexcept { return doublePrecision; }
+
+    /** Returns true if this node's processor was prepared for 64 bit audio.
+        This is the case when it or its graph asked for it, the processor
+        supports it, and the node isn't oversampling */
+    bool isRenderingDoublePrecision() const noexcept { return renderingDoublePrecision; }
 
     //=========================================================================
     /** Triggered when the enabled state changes */
@@ -365,7 +422,7 @@ public:
 protected:
     GraphNode (uint32 nodeId) noexcept;
     virtual void createPorts() = 0;
-    
+
     void setName (const String& newName)
     {
         if (newName.isNotEmpty() && newName != name)
@@ -390,6 +447,8 @@ private:
     friend class GraphManager;
     friend class EngineController;
     friend class Node;
+    friend class SessionController;
+    friend class MidiProgramCache;
     
     GraphProcessor* parent = nullptr;
     bool isPrepared = false;
@@ -397,6 +456,7 @@ private:
     Atomic<int> bypassed { 0 };
     Atomic<int> mute { 0 };
     Atomic<int> muteInput { 0 };
+    Atomic<int> stateVersion { 0 };
 
     int latencySamples = 0;
     String name;
@@ -425,13 +485,8 @@ private:
         GraphNode& graph;
     } enablement;
 
-    struct MidiProgramLoader : public AsyncUpdater
-    {
-        MidiProgramLoader (GraphNode& n) : node (n) { }
-        ~MidiProgramLoader() { cancelPendingUpdate(); }
-        void handleAsyncUpdate() override;
-        GraphNode& node;    
-    } midiProgramLoader;
+    std::unique_ptr<MidiProgramCache> midiProgramCache;
+    int midiProgramFadeSamples = 128;
 
     friend struct PortResetter;
     struct PortResetter : public AsyncUpdater
@@ -456,16 +511,21 @@ private:
     void unprepare();
     void resetPorts();
     void initOversampling (int numChannels, int blockSize);
-    void prepareOversampling (int blockSize);
     void resetOversampling();
-    dsp::Oversampling<float>* getOversamplingProcessor();
+    Oversampler* getOversampler();
 
     Parameter::Ptr getOrCreateParameter (const PortDescription&);
 
-    int osPow = 0;
-    float osLatency = 0.0f;
-    OwnedArray<dsp::Oversampling<float>> osProcessors;
-    const int maxOsPow = 3;
+    bool doublePrecision = false;
+    bool renderingDoublePrecision = false;
+    bool wantsDoublePrecision (GraphProcessor*) const;
+    bool needsPrepareAgain (GraphProcessor*) const;
+    void rebuildIfPrepared();
+
+    int osFactor = 1;
+    int osLatency = 0;
+    Oversampler::Quality osQuality = Oversampler::IIR;
+    Oversampler oversampler;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphNode)
 };
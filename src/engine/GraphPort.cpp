@@ -84,18 +84,18 @@
             {
                 if (isOutput())
                 {
-                    for (int i = jmin (graph->currentAudioOutputBuffer.getNumChannels(),
+                    for (int i = jmin (graph->floatBuffers.currentOutput.getNumChannels(),
                                        buffer.getNumChannels()); --i >= 0;)
                     {
-                        graph->currentAudioOutputBuffer.addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
+                        graph->floatBuffers.currentOutput.addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
                     }
                 }
                 else
                 {
-                    for (int i = jmin (graph->currentAudioInputBuffer->getNumChannels(),
+                    for (int i = jmin (graph->floatBuffers.currentInput->getNumChannels(),
                                        buffer.getNumChannels()); --i >= 0;)
                     {
-                        buffer.copyFrom (i, 0, *graph->currentAudioInputBuffer, i, 0, buffer.getNumSamples());
+                        buffer.copyFrom (i, 0, *graph->floatBuffers.currentInput, i, 0, buffer.getNumSamples());
                     }
 
                     break;
@@ -20,8 +20,10 @@
 #include "engine/nodes/AudioProcessorNode.h"
 #include "engine/AudioEngine.h"
 #include "engine/GraphProcessor.h"
+#include "engine/MidiProgramCache.h"
 #include "engine/MidiPipe.h"
 #include "engine/MidiTranspose.h"
+#include "engine/Ump.h"
 #include "engine/nodes/SubGraphProcessor.h"
 #include "session/Node.h"
 
@@ -38,21 +40,56 @@ public:
     Task() { }
     virtual ~Task()  { }
 
-    virtual void perform (AudioSampleBuffer& sharedBufferChans,
+    virtual void perform (AudioBuffer<float>& sharedBufferChans,
+                          const OwnedArray <MidiBuffer>& sharedMidiBuffers,
+                          const int numSamples) = 0;
+
+    virtual void perform (AudioBuffer<double>& sharedBufferChans,
                           const OwnedArray <MidiBuffer>& sharedMidiBuffers,
                           const int numSamples) = 0;
 
     JUCE_LEAK_DETECTOR (Task);
 };
 
-class ClearChannelOp : public Task
+/** Forwards both precisions to OpType::process<FloatType> */
+template<class OpType>
+class TaskBase : public Task
+{
+public:
+    void perform (AudioBuffer<float>& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples) override
+    {
+        static_cast<OpType*> (this)->process (sharedBufferChans, sharedMidiBuffers, numSamples);
+    }
+
+    void perform (AudioBuffer<double>& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples) override
+    {
+        static_cast<OpType*> (this)->process (sharedBufferChans, sharedMidiBuffers, numSamples);
+    }
+};
+
+/** Converts samples between precisions */
+template<typename SourceType, typename DestType>
+static void convertChannels (const AudioBuffer<SourceType>& source, AudioBuffer<DestType>& dest,
+                             const int numChannels, const int numSamples)
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto* const src = source.getReadPointer (ch);
+        auto* const dst = dest.getWritePointer (ch);
+        for (int i = 0; i < numSamples; ++i)
+            dst[i] = static_cast<DestType> (src[i]);
+    }
+}
+
+class ClearChannelOp : public TaskBase<ClearChannelOp>
 {
 public:
     ClearChannelOp (const int channelNum_)
         : channelNum (channelNum_)
     { }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
     {
         sharedBufferChans.clear (channelNum, 0, numSamples);
     }
@@ -64,7 +101,7 @@ private:
 };
 
 
-class CopyChannelOp : public Task
+class CopyChannelOp : public TaskBase<CopyChannelOp>
 {
 public:
     CopyChannelOp (const int srcChannelNum_, const int dstChannelNum_)
@@ -72,7 +109,8 @@ public:
           dstChannelNum (dstChannelNum_)
     { }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
     {
         sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
@@ -84,7 +122,7 @@ private:
 };
 
 
-class AddChannelOp : public Task
+class AddChannelOp : public TaskBase<AddChannelOp>
 {
 public:
     AddChannelOp (const int srcChannelNum_, const int dstChannelNum_)
@@ -92,7 +130,8 @@ public:
           dstChannelNum (dstChannelNum_)
     { }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
     {
         sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
@@ -104,14 +143,15 @@ private:
 };
 
 
-class ClearMidiBufferOp : public Task
+class ClearMidiBufferOp : public TaskBase<ClearMidiBufferOp>
 {
 public:
     ClearMidiBufferOp (const int bufferNum_)
         : bufferNum (bufferNum_)
     {}
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
     {
         sharedMidiBuffers.getUnchecked (bufferNum)->clear();
     }
@@ -123,7 +163,7 @@ private:
 };
 
 
-class CopyMidiBufferOp : public Task
+class CopyMidiBufferOp : public TaskBase<CopyMidiBufferOp>
 {
 public:
     CopyMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_)
@@ -131,7 +171,8 @@ public:
           dstBufferNum (dstBufferNum_)
     { }
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
     {
         *sharedMidiBuffers.getUnchecked (dstBufferNum) = *sharedMidiBuffers.getUnchecked (srcBufferNum);
     }
@@ -143,7 +184,7 @@ private:
 };
 
 
-class AddMidiBufferOp : public Task
+class AddMidiBufferOp : public TaskBase<AddMidiBufferOp>
 {
 public:
     AddMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_)
@@ -151,7 +192,8 @@ public:
           dstBufferNum (dstBufferNum_)
     { }
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
         sharedMidiBuffers.getUnchecked (dstBufferNum)
             ->addEvents (*sharedMidiBuffers.getUnchecked (srcBufferNum), 0, numSamples, 0);
@@ -163,7 +205,7 @@ private:
     JUCE_DECLARE_NON_COPYABLE (AddMidiBufferOp)
 };
 
-class DelayChannelOp : public Task
+class DelayChannelOp : public TaskBase<DelayChannelOp>
 {
 public:
     DelayChannelOp (const int channel_, const int numSamplesDelay_)
@@ -174,14 +216,15 @@ public:
         buffer.calloc ((size_t) bufferSize);
     }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray <MidiBuffer>&, const int numSamples)
     {
-        float* data = sharedBufferChans.getWritePointer (channel, 0);
+        FloatType* data = sharedBufferChans.getWritePointer (channel, 0);
 
         for (int i = numSamples; --i >= 0;)
         {
             buffer [writeIndex] = *data;
-            *data++ = buffer [readIndex];
+            *data++ = static_cast<FloatType> (buffer [readIndex]);
 
             if (++readIndex  >= bufferSize) readIndex = 0;
             if (++writeIndex >= bufferSize) writeIndex = 0;
@@ -189,7 +232,8 @@ public:
     }
 
 private:
-    HeapBlock<float> buffer;
+    // doubles so either precision passes through unchanged
+    HeapBlock<double> buffer;
     const int channel, bufferSize;
     int readIndex, writeIndex;
 
@@ -197,14 +241,16 @@ private:
 };
 
 
-class ProcessBufferOp : public Task
+class ProcessBufferOp : public TaskBase<ProcessBufferOp>
 {
 public:
     ProcessBufferOp (const GraphNodePtr& node_,
                      const Array <int>& audioChannelsToUse_,
                      const int totalChans_,
                      const int midiBufferToUse_,
-                     const Array <int> chans [PortType::Unknown])
+                     const Array <int> chans [PortType::Unknown],
+                     const bool graphIsDouble,
+                     const int blockSize)
         : node (node_),
           processor (node_->getAudioPluginInstance()),
           audioChannelsToUse (audioChannelsToUse_),
@@ -215,6 +261,7 @@ public:
           midiBufferToUse (midiBufferToUse_)
     {
         channels.calloc ((size_t) totalChans);
+        channelsDouble.calloc ((size_t) totalChans);
 
         while (audioChannelsToUse.size() < totalChans)
             audioChannelsToUse.add (0);
@@ -223,15 +270,24 @@ public:
             midiBufferToUse = chans[PortType::Midi].getFirst();
 
         lastMute = node->isMuted();
+        ump.ensureSize (2048);
+
+        // space to convert at the boundary when the node and graph differ
+        if (graphIsDouble && ! node->isRenderingDoublePrecision())
+            floatTemp.setSize (totalChans, jmax (1, blockSize));
+        else if (! graphIsDouble && node->isRenderingDoublePrecision())
+            doubleTemp.setSize (totalChans, jmax (1, blockSize));
     }
 
-    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
+        auto* const chans = getChannels (sharedBufferChans);
         for (int i = totalChans; --i >= 0;) {
-            channels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
+            chans[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
         }
 
-        AudioSampleBuffer buffer (channels, totalChans, numSamples);
+        AudioBuffer<FloatType> buffer (chans, totalChans, numSamples);
         
         if (! node->isEnabled())
         {
@@ -271,102 +327,61 @@ public:
         }
 
         for (int i = numAudioIns; --i >= 0;)
-            node->setInputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
+            node->setInputRMS (i, (float) buffer.getRMSLevel (i, 0, numSamples));
 
        #ifndef EL_FREE
         // Begin MIDI filters
         {
-            jassert (tempMidi.getNumEvents() == 0);
             ScopedLock spl (node->getPropertyLock());
-            transpose.setNoteOffset (node->getTransposeOffset());
+            const int noteOffset = node->getTransposeOffset();
+            transpose.setNoteOffset (noteOffset);
             const auto keyRange (node->getKeyRange());
             const auto midiChans (node->getMidiChannels());
             const auto useMidiProgram (node->areMidiProgramsEnabled());
+            auto& midi = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
  
-            if (keyRange.getLength() > 0 || !midiChans.isOmni() || useMidiProgram)
+            if (! midi.isEmpty() && (keyRange.getLength() > 0 || !midiChans.isOmni() || useMidiProgram || noteOffset != 0))
             {
-                auto& midi = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
-                MidiBuffer::Iterator iter (midi);
-                int frame = 0; MidiMessage msg;
-                while (iter.getNextEvent (msg, frame))
+                // filter as packets, bytes again only where the plugin reads them
+                ump.clear();
+                ump.addFromMidiBuffer (midi);
+                ump.removeIf ([&] (int, const uint32* words, int) -> bool
                 {
-                    if (msg.isNoteOnOrOff())
+                    const uint32 word = words[0];
+                    if (! Ump::isChannelVoice (word))
+                        return false;
+
+                    const int status = Ump::getStatus (word);
+                    if (keyRange.getLength() > 0 && (status == Ump::noteOn || status == Ump::noteOff))
                     {
-                        // out of range 
-                        if (keyRange.getLength() > 0 && (msg.getNoteNumber() < keyRange.getStart() || msg.getNoteNumber() > keyRange.getEnd()))
-                            continue;
+                        // out of range
+                        const int note = Ump::getNoteNumber (word);
+                        if (note < keyRange.getStart() || note > keyRange.getEnd())
+                            return true;
                     }
 
-                    if (msg.getChannel() > 0 && midiChans.isOff (msg.getChannel()))
-                        continue;
+                    if (midiChans.isOff (Ump::getChannel (word)))
+                        return true;
 
-                    if (useMidiProgram && msg.isProgramChange())
+                    if (useMidiProgram && status == Ump::programChange)
                     {
-                        node->setMidiProgram (msg.getProgramChangeNumber());
+                        node->setMidiProgram ((int) ((words[1] >> 24) & 0x7f));
                         node->reloadMidiProgram();
-                        continue;
+                        return true;
                     }
 
-                    transpose.process (msg);
-                    tempMidi.addEvent (msg, frame);
-                }
+                    return false;
+                });
 
-                midi.swapWith (tempMidi);
-            }
-            else
-            {
-                transpose.process (*sharedMidiBuffers.getUnchecked (midiBufferToUse), numSamples);
+                transpose.process (ump, numSamples);
+                midi.clear();
+                ump.addToMidiBuffer (midi);
             }
         }
-        tempMidi.clear();
         // End MIDI filters
        #endif
         
-        if (node->wantsMidiPipe())
-        {
-            MidiPipe midiPipe (sharedMidiBuffers, midiChannelsToUse);
-            if (! node->isSuspended())
-                node->render (buffer, midiPipe);
-            else
-                node->renderBypassed (buffer, midiPipe);
-        }
-        else
-        {
-            auto pluginProcessBlock = [=, &sharedMidiBuffers] (AudioSampleBuffer& buffer, bool isSuspended)
-            {
-                if (! isSuspended)
-                {
-                    processor->processBlock (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
-                }
-                else
-                {
-                    processor->processBlockBypassed (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
-                }
-            };
-
-            if (node->getOversamplingFactor() > 1)
-            {
-                auto osProcessor = node->getOversamplingProcessor();
-
-                dsp::AudioBlock<float> block (buffer);
-                dsp::AudioBlock<float> osBlock = osProcessor->processSamplesUp (block);
-
-                std::unique_ptr<float*> ptrArray;
-                ptrArray.reset (new float* [buffer.getNumChannels()]);
-                for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
-                    ptrArray.get()[ch] = osBlock.getChannelPointer (ch);
-
-                AudioBuffer<float> osBuffer (ptrArray.get(), buffer.getNumChannels(), static_cast<int> (osBlock.getNumSamples()));
-                pluginProcessBlock (osBuffer, processor->isSuspended());
-
-                osProcessor->processSamplesDown (block);
-            }
-            else
-            {
-                pluginProcessBlock (buffer, processor->isSuspended());
-            }
-            
-        }
+        renderNode (buffer, sharedMidiBuffers);
         
         if (muted && !muteInput)
         {
@@ -395,11 +410,35 @@ public:
             buffer.applyGain (0, numSamples, node->getGain());
         }
 
+        // fade out while a MIDI program is applied and back in after
+        if (auto* programs = node->midiProgramCache.get())
+        {
+            const float programTarget = programs->isSwitching() ? 0.0f : 1.0f;
+            if (programGain != programTarget)
+            {
+                const int fadeSamples = jmax (1, node->midiProgramFadeSamples);
+                const int rampSamples = jmin (numSamples, fadeSamples);
+                const float delta = (float) rampSamples / (float) fadeSamples;
+                const float nextGain = programTarget > programGain ? jmin (programTarget, programGain + delta)
+                                                                   : jmax (programTarget, programGain - delta);
+                buffer.applyGainRamp (0, rampSamples, programGain, nextGain);
+                if (rampSamples < numSamples)
+                    buffer.applyGain (rampSamples, numSamples - rampSamples, nextGain);
+                programGain = nextGain;
+            }
+            else if (programGain == 0.0f)
+            {
+                buffer.applyGain (0, numSamples, 0.0f);
+            }
+
+            programs->setFadedOut (programGain == 0.0f);
+        }
+
         node->updateGain();
         lastMute = muted;
 
         for (int i = 0; i < numAudioOuts; ++i)
-            node->setOutputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
+            node->setOutputRMS (i, (float) buffer.getRMSLevel (i, 0, numSamples));
     }
 
     const GraphNodePtr node;
@@ -409,11 +448,97 @@ private:
     Array <int> audioChannelsToUse;
     Array <int> midiChannelsToUse;
     HeapBlock <float*> channels;
+    HeapBlock <double*> channelsDouble;
+    AudioBuffer<float> floatTemp;
+    AudioBuffer<double> doubleTemp;
     int totalChans, numAudioIns, numAudioOuts;
     int midiBufferToUse;
     bool lastMute = false;
+    float programGain = 1.0f;
     MidiTranspose transpose;
-    MidiBuffer tempMidi;
+    UmpBuffer ump;
+
+    float** getChannels (const AudioBuffer<float>&) noexcept    { return channels.getData(); }
+    double** getChannels (const AudioBuffer<double>&) noexcept  { return channelsDouble.getData(); }
+
+    /** Renders a 32 bit graph buffer */
+    void renderNode (AudioBuffer<float>& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers)
+    {
+        if (! node->isRenderingDoublePrecision())
+        {
+            renderSinglePrecision (buffer, sharedMidiBuffers);
+            return;
+        }
+
+        const int numSamples = buffer.getNumSamples();
+        doubleTemp.setSize (totalChans, numSamples, false, false, true);
+        convertChannels (buffer, doubleTemp, totalChans, numSamples);
+        renderDoublePrecision (doubleTemp, sharedMidiBuffers);
+        convertChannels (doubleTemp, buffer, totalChans, numSamples);
+    }
+
+    /** Renders a 64 bit graph buffer */
+    void renderNode (AudioBuffer<double>& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers)
+    {
+        if (node->isRenderingDoublePrecision())
+        {
+            renderDoublePrecision (buffer, sharedMidiBuffers);
+            return;
+        }
+
+        const int numSamples = buffer.getNumSamples();
+        floatTemp.setSize (totalChans, numSamples, false, false, true);
+        convertChannels (buffer, floatTemp, totalChans, numSamples);
+        renderSinglePrecision (floatTemp, sharedMidiBuffers);
+        convertChannels (floatTemp, buffer, totalChans, numSamples);
+    }
+
+    void renderDoublePrecision (AudioBuffer<double>& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers)
+    {
+        auto& midi = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
+        if (! processor->isSuspended())
+            processor->processBlock (buffer, midi);
+        else
+            processor->processBlockBypassed (buffer, midi);
+    }
+
+    void renderSinglePrecision (AudioBuffer<float>& buffer, const OwnedArray <MidiBuffer>& sharedMidiBuffers)
+    {
+        if (node->wantsMidiPipe())
+        {
+            MidiPipe midiPipe (sharedMidiBuffers, midiChannelsToUse);
+            if (! node->isSuspended())
+                node->render (buffer, midiPipe);
+            else
+                node->renderBypassed (buffer, midiPipe);
+        }
+        else
+        {
+            auto pluginProcessBlock = [=, &sharedMidiBuffers] (AudioSampleBuffer& buffer, bool isSuspended)
+            {
+                if (! isSuspended)
+                {
+                    processor->processBlock (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
+                }
+                else
+                {
+                    processor->processBlockBypassed (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse));
+                }
+            };
+
+            if (auto* oversampler = node->getOversampler())
+            {
+                auto& osBuffer = oversampler->processUp (buffer);
+                pluginProcessBlock (osBuffer, processor->isSuspended());
+                oversampler->processDown (buffer);
+            }
+            else
+            {
+                pluginProcessBlock (buffer, processor->isSuspended());
+            }
+        }
+    }
+
     JUCE_DECLARE_NON_COPYABLE (ProcessBufferOp)
 };
 
@@ -755,7 +880,9 @@ private:
         int totalChans = jmax (node->getNumPorts (PortType::Audio, true),
                                node->getNumPorts (PortType::Audio, false));
         renderingOps.add (new ProcessBufferOp (node, channelsToUse [PortType::Audio],
-                                               totalChans, 0, channelsToUse));
+                                               totalChans, 0, channelsToUse,
+                                               graph.isUsingDoublePrecision(),
+                                               graph.getBlockSize()));
     }
 
     int getFreeBuffer (PortType type)
@@ -860,11 +987,11 @@ GraphProcessor::Connection::Connection (const uint32 sourceNode_, const uint32 s
        .setProperty (Tags::destPort, (int) destPort, nullptr);
 }
     
+template<> GraphProcessor::AudioBuffers<float>& GraphProcessor::getAudioBuffers<float>() noexcept    { return floatBuffers; }
+template<> GraphProcessor::AudioBuffers<double>& GraphProcessor::getAudioBuffers<double>() noexcept  { return doubleBuffers; }
+
 GraphProcessor::GraphProcessor()
     : lastNodeId (0),
-      renderingBuffers (1, 1),
-      currentAudioInputBuffer (nullptr),
-      currentAudioOutputBuffer (1, 1),
       currentMidiInputBuffer (nullptr)
 {
     for (int i = 0; i < AudioGraphIOProcessor::numDeviceTypes; ++i)
@@ -1204,22 +1331,64 @@ bool GraphProcessor::removeIllegalConnections()
 void GraphProcessor::setMidiChannel (const int channel) noexcept
 {
     jassert (isPositiveAndBelow (channel, 17));
+    ScopedLock sl (getCallbackLock());
     if (channel <= 0)
         midiChannels.setOmni (true);
     else
         midiChannels.setChannel (channel);
+    updateMidiPrefilter();
 }
 
 void GraphProcessor::setMidiChannels (const BigInteger channels) noexcept
 {
     ScopedLock sl (getCallbackLock());
     midiChannels.setChannels (channels);
+    updateMidiPrefilter();
 }
 
 void GraphProcessor::setMidiChannels (const kv::MidiChannels channels) noexcept
 {
     ScopedLock sl (getCallbackLock());
     midiChannels = channels;
+    updateMidiPrefilter();
+}
+
+void GraphProcessor::setMidiKinds (const int kindMask) noexcept
+{
+    ScopedLock sl (getCallbackLock());
+    midiKinds = kindMask & MidiPrefilter::allKinds;
+    updateMidiPrefilter();
+}
+
+void GraphProcessor::setMidiNoteRange (const Range<int> notes) noexcept
+{
+    ScopedLock sl (getCallbackLock());
+    midiNoteRange = notes;
+    updateMidiPrefilter();
+}
+
+MidiPrefilter GraphProcessor::getMidiPrefilterCopy() const noexcept
+{
+    ScopedLock sl (getCallbackLock());
+    return midiPrefilter;
+}
+
+void GraphProcessor::updateMidiPrefilter() noexcept
+{
+    midiPrefilter.setKinds (midiKinds);
+    midiPrefilter.setNoteRange (midiNoteRange.getStart(), midiNoteRange.getEnd());
+
+    if (midiChannels.isOmni())
+    {
+        midiPrefilter.setOmni();
+        return;
+    }
+
+    int mask = 0;
+    for (int channel = 1; channel <= 16; ++channel)
+        if (midiChannels.isOn (channel))
+            mask |= 1 << (channel - 1);
+    midiPrefilter.setChannels (mask);
 }
 
 bool GraphProcessor::acceptsMidiChannel (const int channel) const noexcept
@@ -1312,8 +1481,20 @@ void GraphProcessor::buildRenderingSequence()
         // swap over to the new rendering sequence..
         const ScopedLock sl (getCallbackLock());
 
-        renderingBuffers.setSize (numRenderingBuffersNeeded, 4096);
-        renderingBuffers.clear();
+        // only the precision being rendered needs space
+        renderingDoublePrecision = isUsingDoublePrecision();
+        if (renderingDoublePrecision)
+        {
+            doubleBuffers.rendering.setSize (numRenderingBuffersNeeded, 4096);
+            doubleBuffers.rendering.clear();
+            floatBuffers.rendering.setSize (1, 1);
+        }
+        else
+        {
+            floatBuffers.rendering.setSize (numRenderingBuffersNeeded, 4096);
+            floatBuffers.rendering.clear();
+            doubleBuffers.rendering.setSize (1, 1);
+        }
 
         for (int i = midiBuffers.size(); --i >= 0;)
             midiBuffers.getUnchecked(i)->clear();
@@ -1353,8 +1534,12 @@ void GraphProcessor::handleAsyncUpdate()
 
 void GraphProcessor::prepareToPlay (double sampleRate, int estimatedSamplesPerBlock)
 {
-    currentAudioInputBuffer = nullptr;
-    currentAudioOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), estimatedSamplesPerBlock);
+    floatBuffers.release();
+    doubleBuffers.release();
+    if (isUsingDoublePrecision())
+        doubleBuffers.currentOutput.setSize (jmax (1, getTotalNumOutputChannels()), estimatedSamplesPerBlock);
+    else
+        floatBuffers.currentOutput.setSize (jmax (1, getTotalNumOutputChannels()), estimatedSamplesPerBlock);
     currentMidiInputBuffer = nullptr;
     currentMidiOutputBuffer.clear();
     clearRenderingSequence();
@@ -1376,11 +1561,10 @@ void GraphProcessor::releaseResources()
     for (int i = 0; i < nodes.size(); ++i)
         nodes.getUnchecked(i)->unprepare();
 
-    renderingBuffers.setSize (1, 1);
     midiBuffers.clear();
 
-    currentAudioInputBuffer = nullptr;
-    currentAudioOutputBuffer.setSize (1, 1);
+    floatBuffers.release();
+    doubleBuffers.release();
     currentMidiInputBuffer = nullptr;
     currentMidiOutputBuffer.clear();
 }
@@ -1396,14 +1580,46 @@ void GraphProcessor::reset()
 // MARK: Process Graph
 
 void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    processGraph (buffer, midiMessages, midiMessages);
+}
+
+void GraphProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+    processGraph (buffer, midiMessages, midiMessages);
+}
+
+void GraphProcessor::processBlock (AudioSampleBuffer& buffer, const MidiBuffer& midiIn, MidiBuffer& midiOut)
+{
+    processGraph (buffer, midiIn, midiOut);
+}
+
+void GraphProcessor::processBlock (AudioBuffer<double>& buffer, const MidiBuffer& midiIn, MidiBuffer& midiOut)
+{
+    processGraph (buffer, midiIn, midiOut);
+}
+
+template<typename FloatType>
+void GraphProcessor::processGraph (AudioBuffer<FloatType>& buffer, const MidiBuffer& midiMessages, MidiBuffer& midiOut)
 {
     const int32 numSamples = buffer.getNumSamples();
 
-    currentAudioInputBuffer = &buffer;
-    currentAudioOutputBuffer.setSize (jmax (1, buffer.getNumChannels()), numSamples);
-    currentAudioOutputBuffer.clear();
+    // the sequence is being rebuilt for the other precision
+    if (renderingDoublePrecision != std::is_same<FloatType, double>::value)
+    {
+        buffer.clear();
+        midiOut.clear();
+        return;
+    }
+
+    auto& audio = getAudioBuffers<FloatType>();
+    audio.currentInput = &buffer;
+    audio.currentOutput.setSize (jmax (1, buffer.getNumChannels()), numSamples, false, false, true);
+    audio.currentOutput.clear();
     
-    if (midiChannels.isOmni() && velocityCurve.getMode() == VelocityCurve::Linear)
+    // root graphs get input already filtered by the engine
+    const bool filterInput = ! midiInputPrefiltered && ! midiPrefilter.acceptsAll();
+    if (! filterInput && velocityCurve.getMode() == VelocityCurve::Linear)
     {
         currentMidiInputBuffer = &midiMessages;
     }
@@ -1411,40 +1627,45 @@ void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMe
     {
         filteredMidi.clear();
         MidiBuffer::Iterator iter (midiMessages);
-        MidiMessage msg; int frame = 0, chan = 0;
+        const uint8* data = nullptr;
+        int size = 0, frame = 0;
         
-        while (iter.getNextEvent (msg, frame))
+        while (iter.getNextEvent (data, size, frame))
         {
-            chan = msg.getChannel();
-            if (chan > 0 && midiChannels.isOff (chan))
+            if (filterInput && ! midiPrefilter.accepts (data, size))
                 continue;
 
-            if (msg.isNoteOn())
+           #ifndef EL_FREE
+            if (size == 3 && (data[0] & 0xf0) == 0x90 && data[2] != 0)
             {
-               #ifndef EL_FREE
-                msg.setVelocity (velocityCurve.process (msg.getFloatVelocity()));
-               #endif
+                const uint8 noteOn[3] = { data[0], data[1],
+                    (uint8) jlimit (1, 127, roundToInt (127.f * velocityCurve.process ((float) data[2] / 127.f))) };
+                filteredMidi.addEvent (noteOn, 3, frame);
+                continue;
             }
+           #endif
 
-            filteredMidi.addEvent (msg, frame);
+            filteredMidi.addEvent (data, size, frame);
         }
         
         currentMidiInputBuffer = &filteredMidi;
     }
     
+    midiInputTaken = false;
     currentMidiOutputBuffer.clear();
 
     for (int i = 0; i < renderingOps.size(); ++i)
     {
         GraphRender::Task* const op = static_cast<GraphRender::Task*> (renderingOps.getUnchecked (i));
-        op->perform (renderingBuffers, midiBuffers, numSamples);
+        op->perform (audio.rendering, midiBuffers, numSamples);
     }
 
     for (int i = 0; i < buffer.getNumChannels(); ++i)
-        buffer.copyFrom (i, 0, currentAudioOutputBuffer, i, 0, numSamples);
+        buffer.copyFrom (i, 0, audio.currentOutput, i, 0, numSamples);
     
-    midiMessages.clear();
-    midiMessages.addEvents (currentMidiOutputBuffer, 0, numSamples, 0);
+    // the input may be the same buffer, it isn't read after rendering
+    midiOut.clear();
+    midiOut.addEvents (currentMidiOutputBuffer, 0, numSamples, 0);
 }
 
 const String GraphProcessor::getInputChannelName (int channelIndex) const
@@ -1555,17 +1776,36 @@ void GraphProcessor::AudioGraphIOProcessor::releaseResources()
 
 void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioSampleBuffer& buffer,
                                                           MidiBuffer& midiMessages)
+{
+    processIO (buffer, midiMessages);
+}
+
+void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioBuffer<double>& buffer,
+                                                          MidiBuffer& midiMessages)
+{
+    processIO (buffer, midiMessages);
+}
+
+bool GraphProcessor::AudioGraphIOProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template<typename FloatType>
+void GraphProcessor::AudioGraphIOProcessor::processIO (AudioBuffer<FloatType>& buffer,
+                                                       MidiBuffer& midiMessages)
 {
     jassert (graph != nullptr);
+    auto& audio = graph->getAudioBuffers<FloatType>();
 
     switch (type)
     {
         case audioOutputNode:
         {
-            for (int i = jmin (graph->currentAudioOutputBuffer.getNumChannels(),
+            for (int i = jmin (audio.currentOutput.getNumChannels(),
                                buffer.getNumChannels()); --i >= 0;)
             {
-                graph->currentAudioOutputBuffer.addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
+                audio.currentOutput.addFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
             }
 
             break;
@@ -1573,10 +1813,17 @@ void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioSampleBuffer& buf
 
         case audioInputNode:
         {
-            for (int i = jmin (graph->currentAudioInputBuffer->getNumChannels(),
+            if (audio.currentInput == nullptr)
+            {
+                // the node's precision differs from the graph's
+                buffer.clear();
+                break;
+            }
+
+            for (int i = jmin (audio.currentInput->getNumChannels(),
                                buffer.getNumChannels()); --i >= 0;)
             {
-                buffer.copyFrom (i, 0, *graph->currentAudioInputBuffer, i, 0, buffer.getNumSamples());
+                buffer.copyFrom (i, 0, *audio.currentInput, i, 0, buffer.getNumSamples());
             }
 
             break;
@@ -1589,9 +1836,11 @@ void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioSampleBuffer& buf
             break;
 
         case midiInputNode:
+            // the first input node takes the events, the input may be shared
             midiMessages.clear();
-            midiMessages.addEvents (*graph->currentMidiInputBuffer, 0, buffer.getNumSamples(), 0);
-            graph->currentMidiInputBuffer->clear();
+            if (! graph->midiInputTaken)
+                midiMessages.addEvents (*graph->currentMidiInputBuffer, 0, buffer.getNumSamples(), 0);
+            graph->midiInputTaken = true;
             break;
 
         default:
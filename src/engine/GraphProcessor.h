@@ -21,6 +21,7 @@
 
 #include "ElementApp.h"
 #include "engine/GraphNode.h"
+#include "engine/MidiPrefilter.h"
 #include "engine/VelocityCurve.h"
 #include "Signals.h"
 
@@ -184,6 +185,21 @@ public:
     /** returns true if this graph is processing the given channel */
     bool acceptsMidiChannel (const int channel) const noexcept;
 
+    /** Set the kinds of MIDI message this graph accepts, a combination of
+        MidiPrefilter::Kind flags */
+    void setMidiKinds (const int kindMask) noexcept;
+
+    /** Limits the notes this graph accepts to a range, inclusive */
+    void setMidiNoteRange (const Range<int> notes) noexcept;
+
+    /** Returns the accept table built from the graph's MIDI channels, kinds
+        and note range. It is rewritten under the callback lock, so hold that
+        while reading it */
+    const MidiPrefilter& getMidiPrefilter() const noexcept { return midiPrefilter; }
+
+    /** Returns a copy of the accept table taken under the callback lock */
+    MidiPrefilter getMidiPrefilterCopy() const noexcept;
+
     /** Set the MIDI curve of this graph */
     void setVelocityCurveMode (const VelocityCurve::Mode) noexcept;
 
@@ -255,6 +271,8 @@ public:
         void prepareToPlay (double sampleRate, int estimatedSamplesPerBlock);
         void releaseResources();
         void processBlock (AudioSampleBuffer&, MidiBuffer&);
+        void processBlock (AudioBuffer<double>&, MidiBuffer&);
+        bool supportsDoublePrecisionProcessing() const;
 
         bool isInputChannelStereoPair (int index) const;
         bool isOutputChannelStereoPair (int index) const;
@@ -286,6 +304,9 @@ public:
         const IODeviceType type;
         GraphProcessor* graph;
 
+        template<typename FloatType>
+        void processIO (AudioBuffer<FloatType>&, MidiBuffer&);
+
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioGraphIOProcessor)
     };
 
@@ -296,6 +317,18 @@ public:
     virtual void prepareToPlay (double sampleRate, int estimatedBlockSize) override;
     virtual void releaseResources() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+
+    /** Renders in 64 bit when the graph's processing precision is set to
+        double. Nodes that can't process doubles are converted at their
+        boundaries */
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+
+    /** Renders with MIDI input read from a buffer other graphs may share.
+        The graph's MIDI output replaces the contents of midiOut */
+    void processBlock (AudioSampleBuffer&, const MidiBuffer& midiIn, MidiBuffer& midiOut);
+    void processBlock (AudioBuffer<double>&, const MidiBuffer& midiIn, MidiBuffer& midiOut);
+
+    bool supportsDoublePrecisionProcessing() const override          { return true; }
     
     void reset() override;
     
@@ -330,6 +363,9 @@ public:
     virtual void fillInPluginDescription (PluginDescription& d) const override;
 
 protected:
+    /** Set by graphs whose input was already filtered with getMidiPrefilter() */
+    bool midiInputPrefiltered = false;
+
     virtual GraphNode* createNode (uint32, AudioProcessor*);
     virtual void preRenderNodes() { }
     virtual void postRenderNodes() { }
@@ -341,24 +377,48 @@ private:
     uint32 ioNodes [AudioGraphIOProcessor::numDeviceTypes];
     
     uint32 lastNodeId;
-    AudioSampleBuffer renderingBuffers;
     OwnedArray <MidiBuffer> midiBuffers;
     Array<void*> renderingOps;
+    bool renderingDoublePrecision = false;
 
     friend class AudioGraphIOProcessor;
     friend class GraphPort;
 
-    AudioSampleBuffer* currentAudioInputBuffer;
-    AudioSampleBuffer currentAudioOutputBuffer;
-    MidiBuffer* currentMidiInputBuffer;
+    /** Audio buffers for one processing precision */
+    template<typename FloatType>
+    struct AudioBuffers
+    {
+        AudioBuffer<FloatType> rendering { 1, 1 };
+        AudioBuffer<FloatType>* currentInput = nullptr;
+        AudioBuffer<FloatType> currentOutput { 1, 1 };
+
+        void release()
+        {
+            rendering.setSize (1, 1);
+            currentInput = nullptr;
+            currentOutput.setSize (1, 1);
+        }
+    };
+
+    AudioBuffers<float> floatBuffers;
+    AudioBuffers<double> doubleBuffers;
+    template<typename FloatType> AudioBuffers<FloatType>& getAudioBuffers() noexcept;
+
+    const MidiBuffer* currentMidiInputBuffer;
+    bool midiInputTaken = false;
     MidiBuffer currentMidiOutputBuffer;
     
     kv::MidiChannels midiChannels;
+    int midiKinds = MidiPrefilter::allKinds;
+    Range<int> midiNoteRange { 0, 127 };
+    MidiPrefilter midiPrefilter;
     VelocityCurve velocityCurve;
     MidiBuffer filteredMidi;
     
     void handleAsyncUpdate() override;
+    template<typename FloatType> void processGraph (AudioBuffer<FloatType>&, const MidiBuffer&, MidiBuffer&);
     void clearRenderingSequence();
+    void updateMidiPrefilter() noexcept;
     void buildRenderingSequence();
     bool isAnInputTo (uint32 possibleInputId, uint32 possibleDestinationId, int recursionCheck) const;
 
@@ -25,8 +25,11 @@
 #include "engine/nodes/ChannelizeProcessor.h"
 #include "engine/nodes/CombFilterProcessor.h"
 #include "engine/nodes/CompressorProcessor.h"
+#include "engine/nodes/ConvolutionProcessor.h"
 #include "engine/nodes/EQFilterProcessor.h"
 #include "engine/nodes/FreqSplitterProcessor.h"
+#include "engine/nodes/LoudnessMeterProcessor.h"
+#include "engine/nodes/SamplerProcessor.h"
 #include "engine/nodes/LuaNode.h"
 #include "engine/nodes/MediaPlayerProcessor.h"
 #include "engine/nodes/MidiChannelMapProcessor.h"
@@ -34,7 +37,9 @@
 #include "engine/nodes/MidiDeviceProcessor.h"
 #include "engine/nodes/MidiMonitorNode.h"
 #include "engine/nodes/MidiRouterNode.h"
+#include "engine/nodes/MidiSequencerNode.h"
 #include "engine/nodes/PlaceholderProcessor.h"
+#include "engine/nodes/TruePeakLimiterProcessor.h"
 #include "engine/nodes/OSCReceiverNode.h"
 #include "engine/nodes/OSCSenderNode.h"
 #include "engine/nodes/ReverbProcessor.h"
@@ -237,6 +242,11 @@ void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescriptio
         auto* desc = ds.add (new PluginDescription());
         ReverbProcessor().fillInPluginDescription (*desc);
     }
+    else if (fileOrId == EL_INTERNAL_ID_CONVOLUTION)
+    {
+        auto* desc = ds.add (new PluginDescription());
+        ConvolutionProcessor().fillInPluginDescription (*desc);
+    }
     else if (fileOrId == EL_INTERNAL_ID_EQ_FILTER)
     {
         auto* desc = ds.add (new PluginDescription());
@@ -252,6 +262,21 @@ void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescriptio
         auto* desc = ds.add (new PluginDescription());
         CompressorProcessor().fillInPluginDescription (*desc);
     }
+    else if (fileOrId == EL_INTERNAL_ID_TRUE_PEAK_LIMITER)
+    {
+        auto* desc = ds.add (new PluginDescription());
+        TruePeakLimiterProcessor().fillInPluginDescription (*desc);
+    }
+    else if (fileOrId == EL_INTERNAL_ID_LOUDNESS_METER)
+    {
+        auto* desc = ds.add (new PluginDescription());
+        LoudnessMeterProcessor().fillInPluginDescription (*desc);
+    }
+    else if (fileOrId == EL_INTERNAL_ID_SAMPLER)
+    {
+        auto* desc = ds.add (new PluginDescription());
+        SamplerProcessor().fillInPluginDescription (*desc);
+    }
 
    #if defined (EL_PRO)
     else if (fileOrId == EL_INTERNAL_ID_GRAPH)
@@ -347,6 +372,11 @@ void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescriptio
         auto* const desc = ds.add (new PluginDescription());
         MidiMonitorNode().fillInPluginDescription (*desc);
     }
+    else if (fileOrId == EL_INTERNAL_ID_MIDI_SEQUENCER)
+    {
+        auto* const desc = ds.add (new PluginDescription());
+        MidiSequencerNode().fillInPluginDescription (*desc);
+    }
     else if (fileOrId == EL_INTERNAL_ID_OSC_RECEIVER)
     {
         auto* const desc = ds.add (new PluginDescription());
@@ -372,12 +402,16 @@ StringArray ElementAudioPluginFormat::searchPathsForPlugins (const FileSearchPat
     StringArray results;
     results.add (EL_INTERNAL_ID_COMB_FILTER);
     results.add (EL_INTERNAL_ID_COMPRESSOR);
+    results.add (EL_INTERNAL_ID_TRUE_PEAK_LIMITER);
+    results.add (EL_INTERNAL_ID_LOUDNESS_METER);
+    results.add (EL_INTERNAL_ID_SAMPLER);
     results.add (EL_INTERNAL_ID_EQ_FILTER);
     results.add (EL_INTERNAL_ID_FREQ_SPLITTER);
     results.add ("element.allPass");
     results.add ("element.volume");
     results.add (EL_INTERNAL_ID_WET_DRY);
     results.add (EL_INTERNAL_ID_REVERB);
+    results.add (EL_INTERNAL_ID_CONVOLUTION);
 
    #if defined EL_PRO
     results.add (EL_INTERNAL_ID_AUDIO_MIXER);
@@ -386,10 +420,8 @@ StringArray ElementAudioPluginFormat::searchPathsForPlugins (const FileSearchPat
     results.add (EL_INTERNAL_ID_MIDI_CHANNEL_MAP);
     results.add (EL_INTERNAL_ID_MIDI_CHANNEL_SPLITTER);
     results.add (EL_INTERNAL_ID_GRAPH);
-   #if EL_USE_MIDI_SEQUENCER
     results.add (EL_INTERNAL_ID_MIDI_SEQUENCER);
    #endif
-   #endif
 
    #if defined (EL_SOLO) || defined (EL_PRO)
     results.add (EL_INTERNAL_ID_AUDIO_FILE_PLAYER);
@@ -428,12 +460,20 @@ AudioPluginInstance* ElementAudioPluginFormat::instantiatePlugin (const PluginDe
         base = new WetDryProcessor();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_REVERB)
         base = new ReverbProcessor();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_CONVOLUTION)
+        base = new ConvolutionProcessor();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_EQ_FILTER)
         base = new EQFilterProcessor();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_FREQ_SPLITTER)
         base = new FreqSplitterProcessor();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_COMPRESSOR)
         base = new CompressorProcessor();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_TRUE_PEAK_LIMITER)
+        base = new TruePeakLimiterProcessor();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_LOUDNESS_METER)
+        base = new LoudnessMeterProcessor();
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_SAMPLER)
+        base = new SamplerProcessor();
 
    #if defined (EL_PRO)
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_GRAPH)
@@ -0,0 +1,306 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/LoudnessMeter.h"
+
+namespace Element {
+
+static const float absoluteGate = -70.0f;
+
+static float getLoudness (double energy)
+{
+    return energy > 0.0 ? jmax (LoudnessMeter::minLoudness, (float) (-0.691 + 10.0 * std::log10 (energy)))
+                        : LoudnessMeter::minLoudness;
+}
+
+/** Sum of squares with four partial sums so the loop vectorizes */
+static double getSumOfSquares (const float* data, int numSamples)
+{
+    float sums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    int i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+        for (int k = 0; k < 4; ++k)
+            sums[k] += data[i + k] * data[i + k];
+    for (; i < numSamples; ++i)
+        sums[0] += data[i] * data[i];
+    return (double) sums[0] + (double) sums[1] + (double) sums[2] + (double) sums[3];
+}
+
+/** The BS.1770 pre-filter and RLB high pass, designed for any rate */
+static void getKWeighting (double sampleRate, BiquadCoefficients& shelf, BiquadCoefficients& highPass)
+{
+    {
+        const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+        const double k = std::tan (MathConstants<double>::pi * f0 / sampleRate);
+        const double vh = std::pow (10.0, gain / 20.0);
+        const double vb = std::pow (vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelf.b0 = (float) ((vh + vb * k / q + k * k) / a0);
+        shelf.b1 = (float) (2.0 * (k * k - vh) / a0);
+        shelf.b2 = (float) ((vh - vb * k / q + k * k) / a0);
+        shelf.a1 = (float) (2.0 * (k * k - 1.0) / a0);
+        shelf.a2 = (float) ((1.0 - k / q + k * k) / a0);
+    }
+
+    {
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        const double k = std::tan (MathConstants<double>::pi * f0 / sampleRate);
+        const double a0 = 1.0 + k / q + k * k;
+        highPass.b0 = 1.0f;
+        highPass.b1 = -2.0f;
+        highPass.b2 = 1.0f;
+        highPass.a1 = (float) (2.0 * (k * k - 1.0) / a0);
+        highPass.a2 = (float) ((1.0 - k / q + k * k) / a0);
+    }
+}
+
+//=============================================================================
+
+void TruePeakDetector::prepare (int numChannels, int newMaxBlockSize)
+{
+    maxBlockSize = jmax (1, newMaxBlockSize);
+    oversampler.prepare (numChannels, maxBlockSize, factor, Oversampler::FIR);
+}
+
+void TruePeakDetector::process (const AudioBuffer<float>& input, float* result)
+{
+    const int numSamples = input.getNumSamples();
+    jassert (numSamples <= maxBlockSize);
+    FloatVectorOperations::clear (result, numSamples);
+
+    const auto& up = oversampler.processUp (input);
+    for (int ch = 0; ch < up.getNumChannels(); ++ch)
+    {
+        const auto* const data = up.getReadPointer (ch);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto* const frame = data + i * factor;
+            const float peak = jmax (jmax (std::abs (frame[0]), std::abs (frame[1])),
+                                     jmax (std::abs (frame[2]), std::abs (frame[3])));
+            result[i] = jmax (result[i], peak);
+        }
+    }
+}
+
+//=============================================================================
+
+void LoudnessMeter::Histogram::clear()
+{
+    zeromem (energy, sizeof (energy));
+    zeromem (count,  sizeof (count));
+}
+
+void LoudnessMeter::Histogram::add (double blockEnergy)
+{
+    const float loudness = getLoudness (blockEnergy);
+    if (loudness < absoluteGate)
+        return;
+    const int bin = jlimit (0, numBins - 1, (int) ((loudness - absoluteGate) * binsPerLU));
+    energy[bin] += blockEnergy;
+    ++count[bin];
+}
+
+double LoudnessMeter::Histogram::getGatedEnergy (float gate, uint32& total) const
+{
+    const int first = jlimit (0, numBins, (int) ((gate - absoluteGate) * binsPerLU));
+    double sum = 0.0;
+    total = 0;
+    for (int i = first; i < numBins; ++i)
+    {
+        sum += energy[i];
+        total += count[i];
+    }
+
+    return total > 0 ? sum / (double) total : 0.0;
+}
+
+//=============================================================================
+
+LoudnessMeter::LoudnessMeter()
+{
+    reset();
+}
+
+LoudnessMeter::~LoudnessMeter() { }
+
+void LoudnessMeter::prepare (double newSampleRate, int newNumChannels, int maxBlockSize)
+{
+    sampleRate = newSampleRate;
+    numChannels = jlimit (1, maxChannels, newNumChannels);
+    stepSize = jmax (1, roundToInt (sampleRate * 0.1));
+
+    BiquadCoefficients shelf, highPass;
+    getKWeighting (sampleRate, shelf, highPass);
+    weighting.setCoefficients (0, shelf, false);
+    weighting.setCoefficients (1, highPass, false);
+
+    const int blockSize = jmax (32, maxBlockSize);
+    scratch.setSize (numChannels, blockSize, false, false, true);
+    peaks.allocate ((size_t) blockSize, true);
+    truePeak.prepare (numChannels, blockSize);
+
+    reset();
+}
+
+void LoudnessMeter::reset()
+{
+    weighting.reset();
+    truePeak.reset();
+    stepCount = 0;
+    stepEnergy = 0.0;
+    numStepsDone = 0;
+    zeromem (steps, sizeof (steps));
+    peakLevel = 0.0f;
+    blocks.clear();
+    shortTerms.clear();
+
+    resetRequested.set (0);
+    momentary.set (minLoudness);
+    shortTerm.set (minLoudness);
+    integrated.set (minLoudness);
+    range.set (0.0f);
+    truePeakLevel.set (minLoudness);
+}
+
+void LoudnessMeter::process (const AudioBuffer<float>& buffer)
+{
+    if (resetRequested.get() != 0)
+        reset();
+
+    const int channels = jmin (numChannels, buffer.getNumChannels());
+    const int totalSamples = buffer.getNumSamples();
+    if (channels <= 0 || scratch.getNumSamples() <= 0)
+        return;
+
+    for (int offset = 0; offset < totalSamples;)
+    {
+        const int numSamples = jmin (totalSamples - offset, scratch.getNumSamples(), stepSize - stepCount);
+
+        // refers to the caller's data, no allocation below 32 channels
+        const AudioBuffer<float> input (const_cast<float**> (buffer.getArrayOfReadPointers()),
+                                        channels, offset, numSamples);
+        truePeak.process (input, peaks);
+        peakLevel = jmax (peakLevel, FloatVectorOperations::findMaximum (peaks.getData(), numSamples));
+
+        for (int ch = 0; ch < channels; ++ch)
+            scratch.copyFrom (ch, 0, input, ch, 0, numSamples);
+        weighting.process (scratch.getArrayOfWritePointers(), channels, numSamples);
+        for (int ch = 0; ch < channels; ++ch)
+            stepEnergy += getSumOfSquares (scratch.getReadPointer (ch), numSamples);
+
+        stepCount += numSamples;
+        if (stepCount >= stepSize)
+            finishStep();
+
+        offset += numSamples;
+    }
+
+    truePeakLevel.set (Decibels::gainToDecibels (peakLevel, minLoudness));
+}
+
+void LoudnessMeter::finishStep()
+{
+    steps[numStepsDone % numSteps] = stepEnergy / (double) stepSize;
+    ++numStepsDone;
+    stepEnergy = 0.0;
+    stepCount = 0;
+
+    double momentaryEnergy = 0.0, shortTermEnergy = 0.0;
+    for (int i = 0; i < numSteps; ++i)
+    {
+        const double energy = steps[(numStepsDone - 1 - i + numSteps) % numSteps];
+        if (i < 4)
+            momentaryEnergy += energy;
+        shortTermEnergy += energy;
+    }
+
+    momentaryEnergy /= 4.0;
+    shortTermEnergy /= (double) numSteps;
+    momentary.set (getLoudness (momentaryEnergy));
+    shortTerm.set (getLoudness (shortTermEnergy));
+
+    // gating blocks overlap by 75%, one finishes every step
+    if (numStepsDone >= 4)
+    {
+        blocks.add (momentaryEnergy);
+        updateIntegrated();
+    }
+
+    if (numStepsDone >= numSteps)
+    {
+        shortTerms.add (shortTermEnergy);
+        updateRange();
+    }
+}
+
+void LoudnessMeter::updateIntegrated()
+{
+    uint32 total = 0;
+    const double ungated = blocks.getGatedEnergy (absoluteGate, total);
+    if (total == 0)
+        return;
+    const double gated = blocks.getGatedEnergy (getLoudness (ungated) - 10.0f, total);
+    integrated.set (getLoudness (gated));
+}
+
+void LoudnessMeter::updateRange()
+{
+    // EBU Tech 3342: relative gate 20 LU down, then the 10th to 95th
+    // percentile of what is left
+    uint32 total = 0;
+    const double ungated = shortTerms.getGatedEnergy (absoluteGate, total);
+    if (total == 0)
+        return;
+    const float gate = getLoudness (ungated) - 20.0f;
+    shortTerms.getGatedEnergy (gate, total);
+    if (total == 0)
+        return;
+
+    const int first = jlimit (0, numBins, (int) ((gate - absoluteGate) * binsPerLU));
+    const auto lowCount  = (uint32) ((double) total * 0.10);
+    const auto highCount = (uint32) ((double) total * 0.95);
+    int lowBin = first, highBin = first;
+    uint32 counted = 0;
+    for (int i = first; i < numBins; ++i)
+    {
+        if (counted <= lowCount)
+            lowBin = i;
+        counted += shortTerms.count[i];
+        if (counted >= highCount)
+        {
+            highBin = i;
+            break;
+        }
+    }
+
+    range.set ((float) (highBin - lowBin) / binsPerLU);
+}
+
+LoudnessMeter::Snapshot LoudnessMeter::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.momentary  = momentary.get();
+    snapshot.shortTerm  = shortTerm.get();
+    snapshot.integrated = integrated.get();
+    snapshot.range      = range.get();
+    snapshot.truePeak   = truePeakLevel.get();
+    return snapshot;
+}
+
+}
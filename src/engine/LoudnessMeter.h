@@ -0,0 +1,151 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/BiquadCascade.h"
+#include "engine/Oversampler.h"
+
+namespace Element {
+
+/** Finds inter-sample peaks by upsampling 4x with the linear phase
+    oversampler, as ITU-R BS.1770 recommends.
+ */
+class TruePeakDetector
+{
+public:
+    TruePeakDetector() { }
+
+    /** Allocates the oversampler */
+    void prepare (int numChannels, int maxBlockSize);
+
+    /** Clears filter state */
+    void reset()                                { oversampler.reset(); }
+
+    /** Returns how many samples the peaks lag the input */
+    int getLatencySamples() const noexcept      { return (oversampler.getLatencySamples() + 1) / 2; }
+
+    /** Returns the largest block process() accepts */
+    int getMaxBlockSize() const noexcept        { return maxBlockSize; }
+
+    /** Writes the largest oversampled magnitude of all channels for each
+        input sample into peaks */
+    void process (const AudioBuffer<float>& input, float* peaks);
+
+private:
+    static constexpr int factor = 4;
+    Oversampler oversampler;
+    int maxBlockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TruePeakDetector)
+};
+
+/** An EBU R128 / ITU-R BS.1770 loudness meter.
+
+    Audio is K-weighted with a two stage BiquadCascade and its energy is
+    summed in 100 ms steps. Momentary (400 ms) and short term (3 s)
+    loudness come from a ring of steps. Integrated loudness and loudness
+    range are gated from histograms with 0.1 LU bins, so the renderer never
+    allocates or sorts.
+
+    Readings are published through atomics after each step and can be read
+    from any thread.
+ */
+class LoudnessMeter
+{
+public:
+    /** Reported when there is nothing to measure */
+    static constexpr float minLoudness = -100.0f;
+
+    /** Most channels measured */
+    static constexpr int maxChannels = BiquadCascade::maxChannels;
+
+    struct Snapshot
+    {
+        float momentary  = minLoudness;     // LUFS
+        float shortTerm  = minLoudness;     // LUFS
+        float integrated = minLoudness;     // LUFS
+        float range      = 0.0f;            // LU
+        float truePeak   = minLoudness;     // dBTP, highest since reset
+    };
+
+    LoudnessMeter();
+    ~LoudnessMeter();
+
+    /** Allocates buffers and clears the measurement */
+    void prepare (double sampleRate, int numChannels, int maxBlockSize);
+
+    /** Clears the measurement. Call when not processing, otherwise use
+        requestReset() */
+    void reset();
+
+    /** Clears the measurement before the next block is processed */
+    void requestReset()                         { resetRequested.set (1); }
+
+    /** Measures a block */
+    void process (const AudioBuffer<float>& buffer);
+
+    /** Returns the latest readings */
+    Snapshot getSnapshot() const;
+
+    /** Returns the first sample rate measured at */
+    double getSampleRate() const noexcept       { return sampleRate; }
+
+private:
+    static constexpr int numSteps       = 30;   // 3 s of 100 ms steps
+    static constexpr int numBins        = 800;  // -70 to +10 LUFS
+    static constexpr float binsPerLU    = 10.0f;
+
+    struct Histogram
+    {
+        double energy [numBins];
+        uint32 count [numBins];
+
+        void clear();
+        void add (double energy);
+        double getGatedEnergy (float gate, uint32& total) const;
+    };
+
+    double sampleRate = 44100.0;
+    int numChannels = 0;
+    int stepSize = 4410;
+    int stepCount = 0;
+    double stepEnergy = 0.0;
+    double steps [numSteps];
+    int numStepsDone = 0;
+
+    BiquadCascade weighting { 2 };
+    TruePeakDetector truePeak;
+    AudioBuffer<float> scratch;
+    HeapBlock<float> peaks;
+    float peakLevel = 0.0f;
+
+    Histogram blocks, shortTerms;
+
+    Atomic<int> resetRequested;
+    Atomic<float> momentary, shortTerm, integrated, range, truePeakLevel;
+
+    void finishStep();
+    void updateIntegrated();
+    void updateRange();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessMeter)
+};
+
+}
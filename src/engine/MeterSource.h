@@ -0,0 +1,45 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Implemented by processors with named meter readings. Scripting and OSC
+    use it to read meters without knowing the node type. The getters must
+    be safe to call from any thread while the processor renders.
+ */
+class MeterSource
+{
+public:
+    virtual ~MeterSource() { }
+
+    /** Returns the number of readings */
+    virtual int getNumMeters() const = 0;
+
+    /** Returns a short lowercase name for a reading, e.g. "momentary" */
+    virtual String getMeterName (int meter) const = 0;
+
+    /** Returns the latest value of a reading */
+    virtual float getMeterValue (int meter) const = 0;
+};
+
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "JuceHeader.h"
+#include "engine/Ump.h"
 
 namespace Element {
 
@@ -84,6 +85,15 @@ public:
         tempMidi.clear();
     }
 
+    /** Maps the channels of a UMP buffer in place */
+    inline void render (UmpBuffer& midi)
+    {
+        midi.processPackets ([this] (int, uint32* words, int) {
+            if (Ump::isChannelVoice (words[0]))
+                words[0] = Ump::withChannel (words[0], channelMap.getUnchecked (Ump::getChannel (words[0])));
+        });
+    }
+
     const Array<int>& getMap() const { return channelMap; }
 
 private:
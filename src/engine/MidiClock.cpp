@@ -21,38 +21,248 @@
 
 namespace Element
 {
-    
+
+/** Loop bandwidths while acquiring and once locked */
+static const double acquireBandwidthHz = 3.0;
+static const double trackBandwidthHz   = 0.5;
+
+/** Ticks within this fraction of a period count toward locking */
+static const double lockTolerance = 0.1;
+static const int ticksToLock = 24;
+
+/** Ticks this far off count toward losing lock */
+static const double unlockTolerance = 0.25;
+static const int badTicksToUnlock = 6;
+
+/** A gap this many periods long means the clock stopped */
+static const double dropoutPeriods = 4.0;
+
 void MidiClock::process (const MidiMessage& msg)
 {
     jassert (sampleRate > 0.0 && blockSize > 0);
-    jassert (msg.isMidiClock() || msg.isSongPositionPointer());
-    
-    if (midiClockTicks <= 0)
+    const double time = msg.getTimeStamp();
+
+    if (msg.isMidiClock())
+    {
+        tick (time);
+        return;
+    }
+
+    if (msg.isMidiStart())
     {
-        dll.reset (msg.getTimeStamp(), (double)blockSize / sampleRate, 1.0);
-        dll.setParams ((double)blockSize / sampleRate, 1.0);
+        nextTickPosition = 0;
+        running = true;
+    }
+    else if (msg.isMidiContinue())
+    {
+        running = true;
+    }
+    else if (msg.isMidiStop())
+    {
+        running = false;
+    }
+    else if (msg.isSongPositionPointer())
+    {
+        // sixteenths, six ticks each
+        nextTickPosition = (int64) msg.getSongPositionPointerMidiBeat() * 6;
     }
     else
     {
-        dll.update (msg.getTimeStamp());
+        return;
     }
-    
-    if (midiClockTicks == syncPeriodTicks)
+
+    publish();
+}
+
+void MidiClock::restart (double time)
+{
+    numTicks = 1;
+    firstTickTime = nextTickTime = lastTickTime = time;
+    period = 0.0;
+    numGoodTicks = numBadTicks = 0;
+    sumErrorSquares = 0.0;
+
+    if (locked.exchange (false))
         for (auto* listener : listeners)
-            listener->midiClockSignalAcquired();
-    
-    if (midiClockTicks >= syncPeriodTicks && msg.getTimeStamp() - timeOfLastUpdate >= 1.0)
+            listener->midiClockSignalDropped();
+
+    SpinLock::ScopedLockType sl (statsLock);
+    stats = Stats();
+}
+
+void MidiClock::setBandwidth (double hz)
+{
+    // normalized to the tick period, limited to stay stable at slow tempos
+    const double omega = jmin (0.5, MathConstants<double>::twoPi * hz * period);
+    loopB = MathConstants<double>::sqrt2 * omega;
+    loopC = omega * omega;
+}
+
+void MidiClock::tick (double time)
+{
+    if (numTicks <= 0 || (period > 0.0 && time - nextTickTime > dropoutPeriods * period))
     {
-        lastKnownTimeDiff   = dll.timeDiff();
-        const double bpm    = 60.0 / (lastKnownTimeDiff * 24.0);
-        timeOfLastUpdate    = msg.getTimeStamp();
-        
-        if (bpm >= 20.0 && bpm <= 999.0)
+        // the restart tick still moves the song position on
+        restart (time);
+        advance();
+        return;
+    }
+
+    if (numTicks == 1)
+    {
+        // second tick, the first period estimate
+        period = time - nextTickTime;
+        if (period <= 0.0 || period > 0.25)
+        {
+            restart (time);
+            advance();
+            return;
+        }
+
+        lastTickTime = time;
+        nextTickTime = time + period;
+        setBandwidth (acquireBandwidthHz);
+    }
+    else
+    {
+        const double error = jlimit (-0.5 * period, 0.5 * period, time - nextTickTime);
+        const double tickTime = nextTickTime;
+        nextTickTime += loopB * error + period;
+        period += loopC * error;
+        lastTickTime = tickTime;
+
+        const double relative = std::abs (error) / period;
+        if (relative < lockTolerance)
+        {
+            ++numGoodTicks;
+            numBadTicks = 0;
+        }
+        else if (relative > unlockTolerance)
+        {
+            ++numBadTicks;
+            numGoodTicks = 0;
+        }
+
+        if (! locked.load() && numGoodTicks >= ticksToLock)
+        {
+            locked = true;
+            setBandwidth (trackBandwidthHz);
+            {
+                SpinLock::ScopedLockType sl (statsLock);
+                stats.lockTimeSeconds = time - firstTickTime;
+            }
+            for (auto* listener : listeners)
+                listener->midiClockSignalAcquired();
+        }
+        else if (locked.load() && numBadTicks >= badTicksToUnlock)
+        {
+            locked = false;
+            numGoodTicks = 0;
+            setBandwidth (acquireBandwidthHz);
             for (auto* listener : listeners)
-                listener->midiClockTempoChanged (bpm);
+                listener->midiClockSignalDropped();
+        }
+
+        const double errorMs = 1000.0 * (time - tickTime);
+        const double bpm = 60.0 / (period * (double) ticksPerBeat);
+        {
+            SpinLock::ScopedLockType sl (statsLock);
+            stats.locked = locked.load();
+            stats.tempo = bpm;
+            if (stats.locked)
+            {
+                sumErrorSquares += errorMs * errorMs;
+                ++stats.numTicks;
+                stats.tickErrorRmsMs = std::sqrt (sumErrorSquares / (double) stats.numTicks);
+                stats.tickErrorMaxMs = jmax (stats.tickErrorMaxMs, std::abs (errorMs));
+            }
+        }
+
+        if (locked.load() && time - timeOfLastUpdate >= 0.25 && std::abs (bpm - lastReportedTempo) >= 0.01)
+        {
+            timeOfLastUpdate  = time;
+            lastReportedTempo = bpm;
+            if (bpm >= 20.0 && bpm <= 999.0)
+                for (auto* listener : listeners)
+                    listener->midiClockTempoChanged ((float) bpm);
+        }
     }
-    
-    ++midiClockTicks;
+
+    ++numTicks;
+    advance();
+}
+
+void MidiClock::advance()
+{
+    if (running.load())
+        ++nextTickPosition;
+    publish();
+}
+
+void MidiClock::publish()
+{
+    // the audio thread retries if it reads while this is odd
+    sequence.fetch_add (1, std::memory_order_acq_rel);
+    std::atomic_thread_fence (std::memory_order_release);
+    snapshot.tickTime = lastTickTime;
+    snapshot.period   = period;
+    snapshot.position = nextTickPosition - 1;
+    std::atomic_thread_fence (std::memory_order_release);
+    sequence.fetch_add (1, std::memory_order_release);
+}
+
+bool MidiClock::getPosition (double timeSeconds, double& beats, double& tempo) const noexcept
+{
+    if (! locked.load() || ! running.load())
+        return false;
+
+    Snapshot current;
+    for (int attempt = 0;; ++attempt)
+    {
+        if (attempt >= 8)
+            return false;
+        const uint32 before = sequence.load (std::memory_order_acquire);
+        if ((before & 1u) != 0)
+            continue;
+        current = snapshot;
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (sequence.load (std::memory_order_relaxed) == before)
+            break;
+    }
+
+    if (current.period <= 0.0)
+        return false;
+
+    const double elapsed = (timeSeconds - current.tickTime) / current.period;
+    if (elapsed > dropoutPeriods)
+        return false;
+
+    beats = ((double) current.position + jlimit (0.0, 2.0, elapsed)) / (double) ticksPerBeat;
+    tempo = 60.0 / (current.period * (double) ticksPerBeat);
+    return true;
+}
+
+void MidiClock::reportPhaseError (double beats, bool relocated) noexcept
+{
+    phaseError.store (beats, std::memory_order_relaxed);
+    if (std::abs (beats) > phaseErrorMax.load (std::memory_order_relaxed))
+        phaseErrorMax.store (std::abs (beats), std::memory_order_relaxed);
+    if (relocated)
+        numRelocations.fetch_add (1, std::memory_order_relaxed);
+}
+
+MidiClock::Stats MidiClock::getStats() const
+{
+    Stats result;
+    {
+        SpinLock::ScopedLockType sl (statsLock);
+        result = stats;
+    }
+
+    result.phaseErrorBeats    = phaseError.load (std::memory_order_relaxed);
+    result.phaseErrorMaxBeats = phaseErrorMax.load (std::memory_order_relaxed);
+    result.numRelocations     = numRelocations.load (std::memory_order_relaxed);
+    return result;
 }
 
 void MidiClock::reset (const double sr, const int bs)
@@ -60,8 +270,19 @@ void MidiClock::reset (const double sr, const int bs)
     sampleRate          = sr;
     blockSize           = bs;
     timeOfLastUpdate    = 0.0;
-    lastKnownTimeDiff   = 0.0;
-    midiClockTicks      = 0;
+    lastReportedTempo   = 0.0;
+    numTicks            = 0;
+    nextTickPosition    = 0;
+    running             = false;
+    locked              = false;
+    phaseError          = 0.0;
+    phaseErrorMax       = 0.0;
+    numRelocations      = 0;
+    {
+        SpinLock::ScopedLockType sl (statsLock);
+        stats = Stats();
+    }
+    publish();
 }
 
 void MidiClock::addListener (Listener* listener)
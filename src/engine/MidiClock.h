@@ -23,6 +23,17 @@
 
 namespace Element {
     
+/** Follows an incoming MIDI clock.
+
+    Tick times are filtered by a second order phase locked loop, so both
+    the tempo and the position of each tick are known with the input's
+    jitter removed. The loop acquires with a wide bandwidth and narrows
+    once locked. Start, stop, continue and song position pointer keep a
+    tick position, so the beat position at any time can be read on the
+    audio thread without locking.
+
+    Message times are in seconds, as MidiInput stamps them.
+ */
 class MidiClock
 {
 public:
@@ -36,12 +47,45 @@ public:
         virtual void midiClockSignalDropped() =0;
         virtual void midiClockTempoChanged (const float bpm) =0;
     };
-    
+
+    /** Tracking measurements, for monitoring */
+    struct Stats
+    {
+        bool locked = false;
+        int numTicks = 0;
+        double lockTimeSeconds = 0.0;   // first tick to lock
+        double tempo = 0.0;
+        double tickErrorRmsMs = 0.0;    // input jitter against the loop
+        double tickErrorMaxMs = 0.0;
+        double phaseErrorBeats = 0.0;   // last reported transport error
+        double phaseErrorMaxBeats = 0.0;
+        int numRelocations = 0;         // transport corrections
+    };
+
+    static constexpr int ticksPerBeat = 24;
+
     MidiClock() = default;
     ~MidiClock() { }
     
+    /** Handles clock, start, stop, continue and song position pointer */
     void process (const MidiMessage& msg);
     void reset (const double sampleRate, const int blockSize);
+
+    /** Returns true once the loop has settled on the input */
+    bool isLocked() const noexcept          { return locked.load(); }
+
+    /** Returns true between start or continue and stop */
+    bool isRunning() const noexcept         { return running.load(); }
+
+    /** Returns the beat position and tempo at a time. Returns false if not
+        locked, not running, or the clock has gone quiet. Realtime safe */
+    bool getPosition (double timeSeconds, double& beats, double& tempo) const noexcept;
+
+    /** Records how far the transport was from the clock, and whether it
+        was moved. Call from the audio thread */
+    void reportPhaseError (double beats, bool relocated) noexcept;
+
+    Stats getStats() const;
     
     void addListener (Listener*);
     void removeListener (Listener*);
@@ -49,16 +93,49 @@ public:
 private:
     double sampleRate = 0.0;
     int blockSize = 0;
-    DelayLockedLoop dll;
+
+    // input thread
+    int numTicks = 0;
+    double firstTickTime = 0.0, lastTickTime = 0.0;
+    double nextTickTime = 0.0, period = 0.0, loopB = 0.0, loopC = 0.0;
+    int64 nextTickPosition = 0;
+    int numGoodTicks = 0, numBadTicks = 0;
     double timeOfLastUpdate = 0.0;
-    double lastKnownTimeDiff = 0.0;
-    int midiClockTicks = 0;
-    int syncPeriodTicks = 48;
-    double bpmUpdateSeconds = 1.0;
-    
+    double lastReportedTempo = 0.0;
+    double sumErrorSquares = 0.0;
+
+    // published to the audio thread
+    struct Snapshot
+    {
+        double tickTime = 0.0;
+        double period = 0.0;
+        int64 position = 0;
+    };
+    std::atomic<uint32> sequence { 0 };
+    Snapshot snapshot;
+    std::atomic<bool> locked { false }, running { false };
+
+    // audio thread
+    std::atomic<double> phaseError { 0.0 }, phaseErrorMax { 0.0 };
+    std::atomic<int> numRelocations { 0 };
+
+    mutable SpinLock statsLock;
+    Stats stats;
+
     Array<Listener*> listeners;
+
+    void tick (double time);
+    void setBandwidth (double hz);
+    void advance();
+    void publish();
+    void restart (double time);
 };
 
+/** Generates MIDI clock from the transport.
+
+    Tick times are kept in fractional samples, so ticks land on the sample
+    nearest their true time and never drift, whatever the block size.
+ */
 class MidiClockMaster
 {
 public:
@@ -72,7 +149,7 @@ public:
 
     inline void reset()
     {
-        pos = 0;
+        ticks = 0.0;
         updateCoefficients();
     }
 
@@ -92,34 +169,50 @@ public:
         updateCoefficients();
     }
 
+    /** Moves the clock to a beat position, so ticks line up with beats */
+    inline void setPositionBeats (const double beats) noexcept
+    {
+        ticks = beats * (double) MidiClock::ticksPerBeat;
+    }
+
+    /** Returns a song position pointer message for a beat position. The
+        position is rounded down to a sixteenth */
+    static MidiMessage songPositionPointer (const double beats) noexcept
+    {
+        return MidiMessage::songPositionPointer (jlimit (0, 16383, (int) std::floor (beats * 4.0)));
+    }
+
     inline void render (MidiBuffer& midi, int numSamples) noexcept
     {
-        if (samplesPerClock <= 0)
+        if (ticksPerSample <= 0.0)
             return;
 
-        int frame = static_cast<int> (pos % samplesPerClock);
-        if (frame > 0) frame = samplesPerClock - frame;
-        while (frame < numSamples)
+        // ticks go to the nearest sample, so a block owns the ticks from
+        // half a sample before its start to half a sample before its end
+        double next = std::ceil (ticks - 0.5 * ticksPerSample);
+        for (;;)
         {
-            midi.addEvent (clockMessage, frame);
-            frame += samplesPerClock;
+            const int frame = (int) std::floor ((next - ticks) / ticksPerSample + 0.5);
+            if (frame >= numSamples)
+                break;
+            midi.addEvent (clockMessage, jmax (0, frame));
+            next += 1.0;
         }
 
-        pos += numSamples;
+        ticks += ticksPerSample * (double) numSamples;
     }
 
 private:
     MidiMessage clockMessage;
-    int64 pos = 0;
+    double ticks = 0.0;
     double tempo = 120.0;
     double sampleRate = 44100.0;
-    int samplesPerClock = 0;
-    double clocksPerMinute = 1.0;
+    double ticksPerSample = 0.0;
 
     void updateCoefficients()
     {
-        clocksPerMinute = 24.f * tempo;
-        samplesPerClock = roundToIntAccurate ((60.0 * sampleRate) / clocksPerMinute);
+        ticksPerSample = sampleRate > 0.0
+            ? (tempo * (double) MidiClock::ticksPerBeat) / (60.0 * sampleRate) : 0.0;
     }
 };
 
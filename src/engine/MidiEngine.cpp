@@ -146,10 +146,12 @@ void MidiEngine::MidiInputHolder::handleIncomingMidiMessage (MidiInput* source,
 MidiEngine::MidiEngine()
 {
     callbackHandler.reset (new CallbackHandler (*this));
+    outputScheduler.start();
 }
 
 MidiEngine::~MidiEngine()
 {
+    outputScheduler.stop();
     callbackHandler.reset (nullptr);
 }
 
@@ -310,7 +312,6 @@ void MidiEngine::setDefaultMidiOutput (const String& deviceName)
 
         if (newMidiOut)
         {
-            newMidiOut->startBackgroundThread();
             {
                 ScopedLock sl (midiOutputLock);
                 defaultMidiOutput.swap (newMidiOut);
@@ -318,7 +319,7 @@ void MidiEngine::setDefaultMidiOutput (const String& deviceName)
 
             if (newMidiOut) // is now the old output
             {
-                newMidiOut->stopBackgroundThread();
+                outputScheduler.removeOutput (newMidiOut.get());
                 newMidiOut.reset();
             }
         }
@@ -18,6 +18,7 @@
 */
 
 #include "JuceHeader.h"
+#include "engine/MidiOutputScheduler.h"
 
 #pragma once
 
@@ -118,6 +119,9 @@ public:
 
     CriticalSection& getMidiOutputLock() { return midiOutputLock; }
 
+    /** Returns the scheduler every MIDI output is sent through */
+    MidiOutputScheduler& getMidiOutputScheduler() noexcept          { return outputScheduler; }
+
 private:
     struct MidiCallbackInfo
     {
@@ -152,6 +156,7 @@ private:
 
     String defaultMidiOutputName;
     std::unique_ptr<MidiOutput> defaultMidiOutput;
+    MidiOutputScheduler outputScheduler;
     CriticalSection audioCallbackLock, midiCallbackLock, midiOutputLock;
 
     class CallbackHandler;
@@ -0,0 +1,272 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiOutputScheduler.h"
+
+namespace Element {
+
+/** Bandwidth of the callback clock filter */
+static const double clockBandwidthHz = 1.0;
+
+/** Added to a block of latency so the dispatcher has time to wake up */
+static const double safetyMs = 1.5;
+
+/** The dispatcher sleeps until this close to the next event, then spins.
+    With nothing queued it sleeps until schedule() wakes it */
+static const double spinMs = 2.0;
+
+/** Copies between a contiguous buffer and the two regions of a fifo. The
+    offset is into the record being read or written */
+static void scatter (uint8* fifoData, int start1, int size1, int start2,
+                     int offset, const uint8* src, int size)
+{
+    const int first = jlimit (0, size, size1 - offset);
+    if (first > 0)
+        memcpy (fifoData + start1 + offset, src, (size_t) first);
+    if (size > first)
+        memcpy (fifoData + start2 + (offset + first - size1), src + first, (size_t) (size - first));
+}
+
+static void gather (const uint8* fifoData, int start1, int size1, int start2,
+                    int offset, uint8* dst, int size)
+{
+    const int first = jlimit (0, size, size1 - offset);
+    if (first > 0)
+        memcpy (dst, fifoData + start1 + offset, (size_t) first);
+    if (size > first)
+        memcpy (dst + first, fifoData + start2 + (offset + first - size1), (size_t) (size - first));
+}
+
+//=============================================================================
+
+MidiOutputScheduler::MidiOutputScheduler()
+    : Thread ("MidiOutputScheduler")
+{
+    fifoData.allocate ((size_t) fifoSize, true);
+    message.allocate ((size_t) fifoSize, true);
+    pending.reserve (1024);
+}
+
+MidiOutputScheduler::~MidiOutputScheduler()
+{
+    stop();
+}
+
+void MidiOutputScheduler::start()
+{
+    if (! isThreadRunning())
+        startThread (9);
+}
+
+void MidiOutputScheduler::stop()
+{
+    stopThread (1000);
+    ScopedLock sl (lock);
+    drain();
+    pending.clear();
+}
+
+void MidiOutputScheduler::run()
+{
+    while (! threadShouldExit())
+    {
+        const double next = dispatch (Time::getMillisecondCounterHiRes());
+        if (next < 0.0)
+        {
+            wait (-1);
+            continue;
+        }
+
+        const double untilSpin = next - Time::getMillisecondCounterHiRes() - spinMs;
+        if (untilSpin >= 1.0)
+            wait ((int) untilSpin);
+        else
+            Thread::yield();
+    }
+}
+
+//=============================================================================
+
+void MidiOutputScheduler::beginBlock (double sampleRate, int numSamples)
+{
+    beginBlock (sampleRate, numSamples, Time::getMillisecondCounterHiRes());
+}
+
+void MidiOutputScheduler::beginBlock (double sampleRate, int numSamples, double nowMs)
+{
+    if (sampleRate <= 0.0 || numSamples <= 0)
+        return;
+
+    const double period = 1000.0 * (double) numSamples / sampleRate;
+
+    // restart on a new block size or when callbacks stalled
+    if (! dllRunning || period != nominalPeriod || std::abs (nowMs - dllNext) > 4.0 * period)
+    {
+        const double omega = MathConstants<double>::twoPi * clockBandwidthHz * period * 0.001;
+        dllB = MathConstants<double>::sqrt2 * omega;
+        dllC = omega * omega;
+        nominalPeriod = dllPeriod = period;
+        blockTime = nowMs;
+        dllNext = nowMs + period;
+        dllRunning = true;
+    }
+    else
+    {
+        const double error = nowMs - dllNext;
+        blockTime = dllNext;
+        dllNext += dllB * error + dllPeriod;
+        dllPeriod += dllC * error;
+    }
+
+    samplePeriod = dllPeriod / (double) numSamples;
+    latency = period + safetyMs;
+}
+
+double MidiOutputScheduler::getEventTime (int sampleOffset) const noexcept
+{
+    return blockTime + latency + (double) sampleOffset * samplePeriod;
+}
+
+bool MidiOutputScheduler::write (const Header& header, const uint8* data)
+{
+    const int total = (int) sizeof (Header) + header.size;
+    if (fifo.getFreeSpace() < total)
+        return false;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (total, start1, size1, start2, size2);
+    jassert (size1 + size2 == total);
+    scatter (fifoData, start1, size1, start2, 0, reinterpret_cast<const uint8*> (&header), (int) sizeof (Header));
+    scatter (fifoData, start1, size1, start2, (int) sizeof (Header), data, header.size);
+    fifo.finishedWrite (total);
+    return true;
+}
+
+bool MidiOutputScheduler::schedule (MidiOutput* output, const MidiBuffer& midi, int numSamples)
+{
+    MidiBuffer::Iterator iter (midi);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
+    bool ok = true;
+
+    while (iter.getNextEvent (data, size, frame))
+    {
+        if (frame >= numSamples)
+            break;
+
+        Header header;
+        header.time   = getEventTime (frame);
+        header.output = output;
+        header.size   = size;
+        if (! write (header, data))
+        {
+            dropped += 1;
+            ok = false;
+        }
+    }
+
+    if (! midi.isEmpty())
+        notify();
+    return ok;
+}
+
+//=============================================================================
+
+void MidiOutputScheduler::drain()
+{
+    while (fifo.getNumReady() >= (int) sizeof (Header))
+    {
+        int start1, size1, start2, size2;
+        Header header;
+        fifo.prepareToRead ((int) sizeof (Header), start1, size1, start2, size2);
+        gather (fifoData, start1, size1, start2, 0, reinterpret_cast<uint8*> (&header), (int) sizeof (Header));
+
+        // records are written whole
+        const int total = (int) sizeof (Header) + header.size;
+        fifo.prepareToRead (total, start1, size1, start2, size2);
+        jassert (size1 + size2 == total);
+        gather (fifoData, start1, size1, start2, (int) sizeof (Header), message, header.size);
+        fifo.finishedRead (total);
+
+        // events from one block arrive in order, so equal times stay in order
+        Pending event { header.time, header.output, MidiMessage (message, header.size, header.time) };
+        auto pos = std::upper_bound (pending.begin(), pending.end(), header.time,
+            [](double time, const Pending& p) { return time < p.time; });
+        pending.insert (pos, std::move (event));
+    }
+}
+
+double MidiOutputScheduler::dispatch (double nowMs)
+{
+    ScopedLock sl (lock);
+    drain();
+
+    size_t numDue = 0;
+    for (; numDue < pending.size() && pending[numDue].time <= nowMs; ++numDue)
+    {
+        const auto& event = pending[numDue];
+        if (event.output != nullptr)
+            event.output->sendMessageNow (event.message);
+
+        const double late = nowMs - event.time;
+        ++stats.numSent;
+        if (late > lateThresholdMs)
+            ++stats.numLate;
+        stats.maxMs = jmax (stats.maxMs, late);
+        sumMs += late;
+        sumSquaresMs += late * late;
+    }
+
+    if (numDue > 0)
+        pending.erase (pending.begin(), pending.begin() + (std::ptrdiff_t) numDue);
+    return pending.empty() ? -1.0 : pending.front().time;
+}
+
+void MidiOutputScheduler::removeOutput (MidiOutput* output)
+{
+    ScopedLock sl (lock);
+    drain();
+    pending.erase (std::remove_if (pending.begin(), pending.end(),
+        [output](const Pending& p) { return p.output == output; }), pending.end());
+}
+
+//=============================================================================
+
+MidiOutputScheduler::Stats MidiOutputScheduler::getStats() const
+{
+    ScopedLock sl (lock);
+    Stats result (stats);
+    result.numDropped = dropped.get();
+    if (result.numSent > 0)
+    {
+        result.meanMs = sumMs / (double) result.numSent;
+        result.rmsMs  = std::sqrt (sumSquaresMs / (double) result.numSent);
+    }
+    return result;
+}
+
+void MidiOutputScheduler::resetStats()
+{
+    ScopedLock sl (lock);
+    stats = Stats();
+    sumMs = sumSquaresMs = 0.0;
+    dropped.set (0);
+}
+
+}
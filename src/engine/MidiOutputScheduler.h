@@ -0,0 +1,141 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Sends MIDI from the audio thread to output devices at sample accurate
+    times.
+
+    The time of each audio block is taken from the audio callback and
+    smoothed with a delay locked loop, so callback jitter doesn't move
+    events. Events are stamped with the block time plus their sample offset
+    and one block of latency, queued without locks, and sent by one high
+    priority thread for every output.
+
+    Events sent to a null output are timed and measured but not sent.
+ */
+class MidiOutputScheduler : private Thread
+{
+public:
+    /** Timing of sent events, in milliseconds late */
+    struct Stats
+    {
+        int numSent = 0;
+        int numLate = 0;        // over lateThresholdMs
+        int numDropped = 0;     // queue was full
+        double meanMs = 0.0;
+        double rmsMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+    /** Sends after this are counted as late */
+    static constexpr double lateThresholdMs = 1.0;
+
+    MidiOutputScheduler();
+    ~MidiOutputScheduler();
+
+    /** Starts the dispatch thread */
+    void start();
+
+    /** Stops the dispatch thread. Events left are dropped */
+    void stop();
+
+    /** Call at the start of each audio callback, before anything is scheduled */
+    void beginBlock (double sampleRate, int numSamples);
+
+    /** Same as above with the time the callback started */
+    void beginBlock (double sampleRate, int numSamples, double nowMs);
+
+    /** Returns the time, in Time::getMillisecondCounterHiRes() units, an
+        event at a sample offset in the current block will be sent */
+    double getEventTime (int sampleOffset) const noexcept;
+
+    /** Returns the filtered start time of the current block, in
+        Time::getMillisecondCounterHiRes() units */
+    double getBlockTime() const noexcept    { return blockTime; }
+
+    /** Queues the events in a block for an output and wakes the dispatch
+        thread. Call from the audio thread after beginBlock(). Returns false
+        if events were dropped */
+    bool schedule (MidiOutput* output, const MidiBuffer& midi, int numSamples);
+
+    /** Drops events queued for an output. Call before deleting one that
+        has had events scheduled */
+    void removeOutput (MidiOutput* output);
+
+    /** Sends every event due by nowMs. The dispatch thread calls this, call
+        it directly only when not started. Returns the time of the next
+        event or a negative value if none are queued */
+    double dispatch (double nowMs);
+
+    /** Returns timing measured since the last reset */
+    Stats getStats() const;
+
+    /** Clears timing measurements */
+    void resetStats();
+
+private:
+    struct Header
+    {
+        double time;
+        MidiOutput* output;
+        int size;
+    };
+
+    struct Pending
+    {
+        double time;
+        MidiOutput* output;
+        MidiMessage message;
+    };
+
+    // records are a Header followed by the message bytes
+    enum { fifoSize = 65536 };
+    AbstractFifo fifo { fifoSize };
+    HeapBlock<uint8> fifoData;
+
+    // audio thread
+    double blockTime = 0.0;
+    double samplePeriod = 0.0;      // ms, filtered
+    double latency = 0.0;
+
+    // delay locked loop over callback times
+    double nominalPeriod = 0.0, dllPeriod = 0.0, dllNext = 0.0, dllB = 0.0, dllC = 0.0;
+    bool dllRunning = false;
+
+    // dispatch side
+    CriticalSection lock;
+    std::vector<Pending> pending;
+    HeapBlock<uint8> message;
+    Stats stats;
+    double sumMs = 0.0, sumSquaresMs = 0.0;
+    Atomic<int> dropped { 0 };
+
+    void run() override;
+    bool write (const Header& header, const uint8* data);
+    void drain();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiOutputScheduler)
+};
+
+}
@@ -0,0 +1,136 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Decides which raw MIDI messages a graph accepts by channel, message
+    kind and note range.
+
+    The settings are folded into a table indexed by status byte, so an
+    event is accepted or rejected with one or two lookups and without
+    decoding it into a MidiMessage.
+ */
+class MidiPrefilter
+{
+public:
+    enum Kind
+    {
+        notes               = (1 << 0),     // note on and off
+        polyPressure        = (1 << 1),
+        controllers         = (1 << 2),
+        programChanges      = (1 << 3),
+        channelPressure     = (1 << 4),
+        pitchBend           = (1 << 5),
+        system              = (1 << 6),
+        allKinds            = (1 << 7) - 1
+    };
+
+    MidiPrefilter()                                 { update(); }
+
+    /** Accepts all channels */
+    void setOmni()                                  { channels = 0xffff; update(); }
+
+    /** Accepts a set of channels, bit 0 is channel 1 */
+    void setChannels (const int channelMask)        { channels = channelMask & 0xffff; update(); }
+
+    /** Accepts a combination of Kind flags */
+    void setKinds (const int kindMask)              { kinds = kindMask & allKinds; update(); }
+
+    /** Limits note, and poly pressure, messages to a range of note numbers */
+    void setNoteRange (const int low, const int high)
+    {
+        lowNote  = jlimit (0, 127, low);
+        highNote = jlimit (lowNote, 127, high);
+        update();
+    }
+
+    int getChannels() const noexcept                { return channels; }
+    int getKinds() const noexcept                   { return kinds; }
+    Range<int> getNoteRange() const noexcept        { return { lowNote, highNote }; }
+
+    /** Returns true if every message is accepted */
+    bool acceptsAll() const noexcept                { return everything; }
+
+    /** Returns true if the message should reach the graph */
+    inline bool accepts (const uint8* data, const int size) const noexcept
+    {
+        const uint8 rule = statusRules [data[0]];
+        if (rule != checkNote)
+            return rule == accept;
+        return size > 1 && data[1] >= lowNote && data[1] <= highNote;
+    }
+
+    inline bool accepts (const MidiMessage& msg) const noexcept
+    {
+        return accepts (msg.getRawData(), msg.getRawDataSize());
+    }
+
+private:
+    enum Rule : uint8 { reject = 0, accept, checkNote };
+
+    int channels    = 0xffff;
+    int kinds       = allKinds;
+    int lowNote     = 0;
+    int highNote    = 127;
+    bool everything = true;
+    uint8 statusRules [256];
+
+    static int getKind (const int status) noexcept
+    {
+        switch (status & 0xf0)
+        {
+            case 0x80:
+            case 0x90: return notes;
+            case 0xa0: return polyPressure;
+            case 0xb0: return controllers;
+            case 0xc0: return programChanges;
+            case 0xd0: return channelPressure;
+            case 0xe0: return pitchBend;
+            default: break;
+        }
+
+        return system;
+    }
+
+    void update() noexcept
+    {
+        const bool fullRange = lowNote == 0 && highNote == 127;
+        everything = channels == 0xffff && kinds == allKinds && fullRange;
+
+        // data bytes never start an event, pass them like the graph did
+        for (int status = 0; status < 0x80; ++status)
+            statusRules[status] = accept;
+
+        for (int status = 0x80; status < 0x100; ++status)
+        {
+            const int kind = getKind (status);
+            const bool channelOn = status >= 0xf0 || (channels & (1 << (status & 0x0f))) != 0;
+            uint8 rule = (channelOn && (kinds & kind) != 0) ? accept : reject;
+            if (rule == accept && ! fullRange && (kind == notes || kind == polyPressure))
+                rule = checkNote;
+            statusRules[status] = rule;
+        }
+    }
+};
+
+}
@@ -0,0 +1,261 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/GraphNode.h"
+#include "engine/MidiProgramCache.h"
+#include "session/Node.h"
+
+namespace Element {
+
+/** Longest the worker waits for the renderer to fade out. Nodes which
+    aren't being rendered never report it */
+static const double maxFadeWaitMs = 50.0;
+
+/** How long an idle cache sleeps. Requests wake it, so this only bounds
+    how long the worker can go without checking in */
+static const int idleMs = 1000;
+
+struct MidiProgramCache::Thread : public TimeSliceThread
+{
+    Thread() : TimeSliceThread ("MidiPrograms") { startThread (5); }
+    ~Thread() { stopThread (2000); }
+};
+
+//=============================================================================
+
+MidiProgramCache::MidiProgramCache (GraphNode& n)
+    : node (n)
+{
+    lastSwitchTime.set (0.0);
+    thread->addTimeSliceClient (this);
+}
+
+MidiProgramCache::~MidiProgramCache()
+{
+    thread->removeTimeSliceClient (this);
+    cancelPendingUpdate();
+}
+
+void MidiProgramCache::refresh()
+{
+    const bool global = node.useGlobalMidiPrograms();
+    File firstFile;
+    String prefix;
+    if (global)
+    {
+        // building the file name queries the plugin, so derive the rest
+        // from the first one. see GraphNode::getMidiProgramFile
+        firstFile = node.getMidiProgramFile (0);
+        prefix = firstFile.getFileNameWithoutExtension().dropLastCharacters (3);
+    }
+
+    ScopedLock sl (lock);
+    for (int i = 0; i < 128; ++i)
+    {
+        auto& entry = entries[i];
+        if (global)
+        {
+            const auto file = firstFile.getSiblingFile (prefix + String(i).paddedLeft ('0', 3))
+                                       .withFileExtension (firstFile.getFileExtension());
+            const auto modified = file.getLastModificationTime();
+            if (! entry.global || entry.file != file || entry.modified != modified)
+            {
+                entry.file      = file;
+                entry.modified  = modified;
+                entry.loaded    = ! file.existsAsFile();
+                entry.state.reset();
+            }
+        }
+        else
+        {
+            entry.file      = File();
+            entry.modified  = Time();
+            entry.state.reset();
+            entry.loaded    = false;
+            for (const auto* program : node.midiPrograms)
+            {
+                if (program->program == i)
+                {
+                    entry.state  = program->state;
+                    entry.loaded = true;
+                    break;
+                }
+            }
+        }
+
+        entry.global = global;
+    }
+
+    pendingLoads.set (global ? 1 : 0);
+    thread->moveToFrontOfQueue (this);
+}
+
+void MidiProgramCache::request (int program)
+{
+    if (! isPositiveAndBelow (program, 128))
+        return;
+    requestTicks.set (Time::getHighResolutionTicks());
+    fadedOut.set (0);
+    switching.set (1);
+    requested.set (program);
+
+    // only the worker contends for this lock, and never for long
+    thread->moveToFrontOfQueue (this);
+}
+
+bool MidiProgramCache::isCached (int program) const
+{
+    if (! isPositiveAndBelow (program, 128))
+        return false;
+    ScopedLock sl (lock);
+    return entries[program].loaded;
+}
+
+//=============================================================================
+
+void MidiProgramCache::load (Entry& entry)
+{
+    File file; Time modified;
+    {
+        ScopedLock sl (lock);
+        file = entry.file;
+        modified = entry.modified;
+    }
+
+    MemoryBlock state;
+    if (file.existsAsFile())
+    {
+        const auto data = Node::parse (file);
+        state.fromBase64Encoding (data.getProperty (Tags::state).toString().trim());
+    }
+
+    ScopedLock sl (lock);
+    // skip if refreshed while reading
+    if (entry.file == file && entry.modified == modified)
+    {
+        entry.state.swapWith (state);
+        entry.loaded = true;
+    }
+}
+
+bool MidiProgramCache::getState (int program, MemoryBlock& state)
+{
+    auto& entry = entries[program];
+    bool loaded = false;
+    {
+        ScopedLock sl (lock);
+        loaded = entry.loaded;
+    }
+
+    if (! loaded)
+        load (entry);
+
+    ScopedLock sl (lock);
+    state = entry.state;
+    return state.getSize() > 0;
+}
+
+void MidiProgramCache::finishSwitch (int program)
+{
+    node.lastMidiProgram.set (program);
+    const auto ticks = Time::getHighResolutionTicks() - requestTicks.get();
+    lastSwitchTime.set (1000.0 * Time::highResolutionTicksToSeconds (ticks));
+    switching.set (0);
+    DBG("[EL] program " << program << " switched in " << lastSwitchTime.get() << " ms");
+}
+
+int MidiProgramCache::useTimeSlice()
+{
+    const int program = requested.get();
+    if (program >= 0)
+    {
+        const auto waited = 1000.0 * Time::highResolutionTicksToSeconds (
+            Time::getHighResolutionTicks() - requestTicks.get());
+        if (fadedOut.get() == 0 && waited < maxFadeWaitMs)
+            return 1;
+
+        // a newer request may have come in while waiting
+        if (requested.compareAndSetBool (-1, program))
+        {
+            MemoryBlock state;
+            getState (program, state);
+
+            {
+                ScopedLock sl (lock);
+                programToApply = program;
+                stateToApply.swapWith (state);
+            }
+
+            triggerAsyncUpdate();
+        }
+
+        return 0;
+    }
+
+    // decode global programs ahead of time, one per slice
+    if (pendingLoads.get() != 0)
+    {
+        for (auto& entry : entries)
+        {
+            bool needsLoad = false;
+            {
+                ScopedLock sl (lock);
+                needsLoad = entry.global && ! entry.loaded;
+            }
+
+            if (needsLoad)
+            {
+                load (entry);
+                return 0;
+            }
+        }
+
+        pendingLoads.set (0);
+    }
+
+    return idleMs;
+}
+
+void MidiProgramCache::handleAsyncUpdate()
+{
+    // Applied here and not on the worker: plugin formats expect state to be
+    // restored on the message thread, and setState notifies listeners of
+    // the node. The renderer has faded the node out, so the time this takes
+    // isn't heard.
+    int program = -1;
+    MemoryBlock state;
+    {
+        ScopedLock sl (lock);
+        std::swap (program, programToApply);
+        state.swapWith (stateToApply);
+    }
+
+    if (program >= 0)
+    {
+        if (state.getSize() > 0)
+            node.setState (state.getData(), (int) state.getSize());
+        finishSwitch (program);
+    }
+
+    node.midiProgramChanged(); // always notify the program # changed even if not loaded.
+                               // do this because there may not be data for the program but
+                               // the property is still relavent.
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+class GraphNode;
+
+/** Holds decoded MIDI program states for a node and applies them when a
+    program change is requested.
+
+    Local programs are copied in when the cache is refreshed, global program
+    files are read and decoded on a shared background thread ahead of time.
+    A switch goes like this: the render thread requests a program, wakes
+    the worker and fades the node out. The worker waits for silence and
+    hands the decoded state to the message thread, which applies it, then
+    the render thread fades back in. State is applied on the message
+    thread because plugins expect to be restored there. The worker never
+    calls into the node, so the cache can be destroyed with it at any time.
+ */
+class MidiProgramCache : private TimeSliceClient,
+                         private AsyncUpdater
+{
+public:
+    explicit MidiProgramCache (GraphNode& node);
+    ~MidiProgramCache();
+
+    /** Updates the cache from the node's programs. Call on the message thread
+        after programs are saved, removed, or global programs toggled */
+    void refresh();
+
+    /** Request a program be applied. This is called from the render thread,
+        sets atomics and wakes the worker */
+    void request (int program);
+
+    /** Returns true while a switch is in progress */
+    bool isSwitching() const noexcept { return switching.get() != 0; }
+
+    /** Called by the renderer once the node's output has faded out */
+    void setFadedOut (bool faded) noexcept { fadedOut.set (faded ? 1 : 0); }
+
+    /** Returns true if a decoded state is ready for the program */
+    bool isCached (int program) const;
+
+    /** Returns the time in milliseconds the last switch took, from the
+        request until the state was applied */
+    double getLastSwitchTime() const noexcept { return lastSwitchTime.get(); }
+
+private:
+    struct Entry
+    {
+        File file;
+        Time modified;
+        MemoryBlock state;
+        bool global = false;
+        bool loaded = false;
+    };
+
+    struct Thread;
+    SharedResourcePointer<Thread> thread;
+    GraphNode& node;
+    CriticalSection lock;
+    Entry entries [128];
+
+    Atomic<int> requested { -1 };
+    Atomic<int> switching { 0 };
+    Atomic<int> fadedOut { 0 };
+    Atomic<int> pendingLoads { 0 };
+    Atomic<int64> requestTicks { 0 };
+    AtomicValue<double> lastSwitchTime;
+
+    int programToApply = -1;
+    MemoryBlock stateToApply;
+
+    bool getState (int program, MemoryBlock& state);
+    void load (Entry&);
+    void finishSwitch (int program);
+
+    int useTimeSlice() override;
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiProgramCache)
+};
+
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "JuceHeader.h"
+#include "engine/Ump.h"
 
 namespace Element {
 
@@ -78,6 +79,20 @@ public:
         output.clear();
     }
 
+    /** Process a UMP buffer in place. Per-note controllers, pitch bend
+        and pressure move with their notes */
+    inline void process (UmpBuffer& midi, int numSamples)
+    {
+        const int noteOffset = offset.get();
+        if (0 == noteOffset)
+            return;
+
+        midi.processPackets ([noteOffset, numSamples] (int frame, uint32* words, int) {
+            if (frame < numSamples && Ump::hasNoteNumber (words[0]))
+                words[0] = Ump::withNoteNumber (words[0], Ump::getNoteNumber (words[0]) + noteOffset);
+        });
+    }
+
 private:
     Atomic<int> offset { 0 };
     MidiBuffer output;
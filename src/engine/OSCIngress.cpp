@@ -0,0 +1,461 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/OSCIngress.h"
+
+namespace Element {
+
+/** Largest UDP packet read */
+static const int maxPacketSize = 65536;
+
+static inline int padded (int size) noexcept  { return (size + 3) & ~3; }
+
+/** Length of a null terminated string, or -1 if it runs off the end */
+static int stringLength (const uint8* data, int size) noexcept
+{
+    for (int i = 0; i < size; ++i)
+        if (data[i] == 0)
+            return i;
+    return -1;
+}
+
+static float readFloat (const uint8* data) noexcept
+{
+    const uint32 bits = ByteOrder::bigEndianInt (data);
+    float value;
+    memcpy (&value, &bits, sizeof (value));
+    return value;
+}
+
+//=============================================================================
+
+int OSCMessageView::getInt (int index) const noexcept
+{
+    if (! isPositiveAndBelow (index, numArguments))
+        return 0;
+    switch (types[index])
+    {
+        case 'i': return (int) ByteOrder::bigEndianInt (arguments[index]);
+        case 'f': return (int) readFloat (arguments[index]);
+        case 'T': return 1;
+        default: break;
+    }
+    return 0;
+}
+
+float OSCMessageView::getFloat (int index) const noexcept
+{
+    if (! isPositiveAndBelow (index, numArguments))
+        return 0.0f;
+    switch (types[index])
+    {
+        case 'i': return (float) (int) ByteOrder::bigEndianInt (arguments[index]);
+        case 'f': return readFloat (arguments[index]);
+        case 'T': return 1.0f;
+        default: break;
+    }
+    return 0.0f;
+}
+
+const uint8* OSCMessageView::getBlob (int index, int& size) const noexcept
+{
+    size = 0;
+    if (! isPositiveAndBelow (index, numArguments) || types[index] != 'b')
+        return nullptr;
+    size = sizes[index];
+    return arguments[index];
+}
+
+const char* OSCMessageView::getString (int index) const noexcept
+{
+    if (! isPositiveAndBelow (index, numArguments) || (types[index] != 's' && types[index] != 'S'))
+        return nullptr;
+    return reinterpret_cast<const char*> (arguments[index]);
+}
+
+bool OSCMessageView::toMessage (OSCMessage& message) const
+{
+    try
+    {
+        message = OSCMessage (OSCAddressPattern (String::fromUTF8 (address, addressLength)));
+    }
+    catch (const OSCFormatError&)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < numArguments; ++i)
+    {
+        switch (types[i])
+        {
+            case 'i': message.addInt32 (getInt (i)); break;
+            case 'f': message.addFloat32 (getFloat (i)); break;
+            case 's':
+            case 'S': message.addString (String::fromUTF8 (getString (i))); break;
+            case 'b': message.addBlob (MemoryBlock (arguments[i], (size_t) sizes[i])); break;
+            default: break;
+        }
+    }
+
+    return true;
+}
+
+//=============================================================================
+
+bool OSCPacketParser::isBundle (const uint8* data, int size) noexcept
+{
+    return size >= 16 && memcmp (data, "#bundle", 8) == 0;
+}
+
+bool OSCPacketParser::parseMessage (const uint8* data, int size, OSCMessageView& view) noexcept
+{
+    view.numArguments = 0;
+    if (size < 4 || data[0] != '/')
+        return false;
+
+    view.address = reinterpret_cast<const char*> (data);
+    view.addressLength = stringLength (data, size);
+    if (view.addressLength < 0)
+        return false;
+
+    // messages without type tags have no arguments
+    int pos = padded (view.addressLength + 1);
+    if (pos >= size)
+        return true;
+    if (data[pos] != ',')
+        return false;
+
+    const auto* const types = data + pos + 1;
+    const int numTypes = stringLength (types, size - pos - 1);
+    if (numTypes < 0 || numTypes > OSCMessageView::maxArguments)
+        return false;
+    pos = padded (pos + numTypes + 2);
+
+    for (int i = 0; i < numTypes; ++i)
+    {
+        const char type = (char) types[i];
+        int argSize = 0, length = 0;
+
+        switch (type)
+        {
+            case 'i': case 'f': case 'c': case 'r': case 'm':
+                argSize = length = 4;
+                break;
+            case 'h': case 'd': case 't':
+                argSize = length = 8;
+                break;
+            case 's': case 'S':
+                length = stringLength (data + pos, jmax (0, size - pos));
+                if (length < 0)
+                    return false;
+                argSize = padded (length + 1);
+                break;
+            case 'b':
+                if (size - pos < 4)
+                    return false;
+                length = (int) ByteOrder::bigEndianInt (data + pos);
+                pos += 4;
+                // compare before padding, so a huge length can't wrap around
+                if (length < 0 || length > size - pos)
+                    return false;
+                argSize = padded (length);
+                break;
+            case 'T': case 'F': case 'N': case 'I':
+                break;
+            default:
+                return false;
+        }
+
+        if (argSize > size - pos)
+            return false;
+
+        view.types[i] = type;
+        view.arguments[i] = data + pos;
+        view.sizes[i] = length;
+        pos += argSize;
+    }
+
+    view.numArguments = numTypes;
+    return true;
+}
+
+//=============================================================================
+
+struct OSCAddressTrie::BuildNode
+{
+    std::map<std::string, std::unique_ptr<BuildNode>> children;
+    std::unique_ptr<BuildNode> wildcard;
+    int value = -1;
+};
+
+OSCAddressTrie::OSCAddressTrie()
+    : root (new BuildNode()) { }
+
+OSCAddressTrie::~OSCAddressTrie() { }
+
+void OSCAddressTrie::add (const String& pattern, int value)
+{
+    jassert (value >= 0);
+    auto* node = root.get();
+    for (const auto& segment : StringArray::fromTokens (pattern, "/", String()))
+    {
+        if (segment.isEmpty())
+            continue;
+
+        auto& child = segment == "*" ? node->wildcard
+                                     : node->children[segment.toStdString()];
+        if (child == nullptr)
+            child.reset (new BuildNode());
+        node = child.get();
+    }
+
+    node->value = value;
+}
+
+void OSCAddressTrie::compile()
+{
+    nodes.clear();
+    segments.clear();
+    nodes.emplace_back();
+    nodes.back().value = root->value;
+    flatten (0, *root);
+}
+
+void OSCAddressTrie::flatten (int index, const BuildNode& build)
+{
+    // literal children are stored together, sorted, so they can be searched
+    std::vector<const BuildNode*> order;
+    const int first = (int) nodes.size();
+
+    for (const auto& child : build.children)
+    {
+        Node node;
+        node.segment = (int) segments.size();
+        node.segmentLength = (int) child.first.size();
+        node.value = child.second->value;
+        segments.insert (segments.end(), child.first.begin(), child.first.end());
+        nodes.push_back (node);
+        order.push_back (child.second.get());
+    }
+
+    nodes[(size_t) index].firstChild = first;
+    nodes[(size_t) index].numChildren = (int) order.size();
+
+    int wildcard = -1;
+    if (build.wildcard != nullptr)
+    {
+        Node node;
+        node.value = build.wildcard->value;
+        nodes.push_back (node);
+        wildcard = (int) nodes.size() - 1;
+        nodes[(size_t) index].wildcard = wildcard;
+    }
+
+    for (size_t i = 0; i < order.size(); ++i)
+        flatten (first + (int) i, *order[i]);
+    if (wildcard >= 0)
+        flatten (wildcard, *build.wildcard);
+}
+
+int OSCAddressTrie::matchFrom (int index, const char* address, const char* end) const noexcept
+{
+    while (address < end && *address == '/')
+        ++address;
+
+    const auto& node = nodes[(size_t) index];
+    if (address >= end || *address == 0)
+        return node.value;
+
+    const char* segmentEnd = address;
+    while (segmentEnd < end && *segmentEnd != '/' && *segmentEnd != 0)
+        ++segmentEnd;
+    const int length = (int) (segmentEnd - address);
+
+    int low = node.firstChild, high = node.firstChild + node.numChildren;
+    while (low < high)
+    {
+        const int mid = (low + high) / 2;
+        const auto& child = nodes[(size_t) mid];
+        int order = memcmp (segments.data() + child.segment, address, (size_t) jmin (length, child.segmentLength));
+        if (order == 0)
+            order = child.segmentLength - length;
+
+        if (order == 0)
+        {
+            const int value = matchFrom (mid, segmentEnd, end);
+            if (value >= 0)
+                return value;
+            break;
+        }
+
+        if (order < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return node.wildcard >= 0 ? matchFrom (node.wildcard, segmentEnd, end) : -1;
+}
+
+int OSCAddressTrie::match (const char* address, int length) const noexcept
+{
+    return nodes.empty() ? -1 : matchFrom (0, address, address + length);
+}
+
+int OSCAddressTrie::match (const String& address) const
+{
+    const auto utf8 = address.toRawUTF8();
+    return match (utf8, (int) strlen (utf8));
+}
+
+//=============================================================================
+
+class OSCIngress::Port : public Thread
+{
+public:
+    Port (int number)
+        : Thread ("OSCIngress"),
+          portNumber (number)
+    {
+        buffer.allocate ((size_t) maxPacketSize, true);
+    }
+
+    ~Port()
+    {
+        close();
+    }
+
+    bool open()
+    {
+        socket.reset (new DatagramSocket (false));
+        if (! socket->bindToPort (portNumber))
+        {
+            socket = nullptr;
+            return false;
+        }
+
+        startThread (8);
+        return true;
+    }
+
+    void close()
+    {
+        signalThreadShouldExit();
+        if (socket != nullptr)
+            socket->shutdown();
+        stopThread (1000);
+        socket = nullptr;
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            const int ready = socket->waitUntilReady (true, 100);
+            if (ready < 0)
+                break;
+            if (ready == 0)
+                continue;
+
+            const int size = socket->read (buffer, maxPacketSize, false);
+            if (size <= 0)
+                continue;
+
+            const double now = Time::getMillisecondCounterHiRes();
+            ScopedLock sl (lock);
+            for (auto* subscriber : subscribers)
+                if (subscriber->wantsPackets())
+                    subscriber->oscPacketReceived (buffer, size);
+
+            OSCPacketParser::parse (buffer, size, [this, now] (const OSCMessageView& message)
+            {
+                for (auto* subscriber : subscribers)
+                    subscriber->oscMessageReceived (message, now);
+            });
+        }
+    }
+
+    const int portNumber;
+    CriticalSection lock;
+    Array<Subscriber*> subscribers;
+
+private:
+    std::unique_ptr<DatagramSocket> socket;
+    HeapBlock<uint8> buffer;
+};
+
+//=============================================================================
+
+OSCIngress::OSCIngress() { }
+
+OSCIngress::~OSCIngress()
+{
+    ScopedLock sl (lock);
+    ports.clear();
+}
+
+bool OSCIngress::subscribe (int portNumber, Subscriber* subscriber)
+{
+    jassert (subscriber != nullptr);
+    unsubscribe (subscriber);
+
+    ScopedLock sl (lock);
+    Port* port = nullptr;
+    for (auto* p : ports)
+        if (p->portNumber == portNumber)
+            port = p;
+
+    if (port == nullptr)
+    {
+        std::unique_ptr<Port> newPort (new Port (portNumber));
+        if (! newPort->open())
+            return false;
+        port = ports.add (newPort.release());
+    }
+
+    ScopedLock pl (port->lock);
+    port->subscribers.addIfNotAlreadyThere (subscriber);
+    return true;
+}
+
+void OSCIngress::unsubscribe (Subscriber* subscriber)
+{
+    ScopedLock sl (lock);
+    for (int i = ports.size(); --i >= 0;)
+    {
+        auto* port = ports.getUnchecked (i);
+        bool empty = false;
+        {
+            ScopedLock pl (port->lock);
+            port->subscribers.removeFirstMatchingValue (subscriber);
+            empty = port->subscribers.isEmpty();
+        }
+
+        if (empty)
+            ports.remove (i);
+    }
+}
+
+int OSCIngress::getNumPorts() const
+{
+    ScopedLock sl (lock);
+    return ports.size();
+}
+
+}
@@ -0,0 +1,195 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** One OSC message inside a packet. Everything points into the packet */
+struct OSCMessageView
+{
+    enum { maxArguments = 16 };
+
+    const char* address = nullptr;
+    int addressLength = 0;
+    int numArguments = 0;
+    char types [maxArguments];
+    const uint8* arguments [maxArguments];
+    int sizes [maxArguments];
+
+    /** Returns an int32 or float32 argument as an int, or 0 */
+    int getInt (int index) const noexcept;
+
+    /** Returns an int32 or float32 argument as a float, or 0 */
+    float getFloat (int index) const noexcept;
+
+    /** Returns a blob argument's bytes, or nullptr */
+    const uint8* getBlob (int index, int& size) const noexcept;
+
+    /** Returns a string argument, or nullptr */
+    const char* getString (int index) const noexcept;
+
+    /** Makes a juce OSCMessage from this. Allocates, so not for realtime
+        use. Returns false if the address is invalid */
+    bool toMessage (OSCMessage& message) const;
+};
+
+/** Parses OSC packets without allocating */
+struct OSCPacketParser
+{
+    /** Calls callback (const OSCMessageView&) for each message in a packet,
+        including those in nested bundles. Returns false if any part was
+        malformed */
+    template <typename Callback>
+    static bool parse (const void* data, int size, Callback&& callback, int depth = 0)
+    {
+        auto* const packet = static_cast<const uint8*> (data);
+        if (! isBundle (packet, size))
+        {
+            OSCMessageView view;
+            if (! parseMessage (packet, size, view))
+                return false;
+            callback (view);
+            return true;
+        }
+
+        // "#bundle", a time tag, then sized elements
+        if (depth >= 8)
+            return false;
+
+        bool ok = true;
+        for (int pos = 16; pos + 4 <= size;)
+        {
+            const int elementSize = (int) ByteOrder::bigEndianInt (packet + pos);
+            pos += 4;
+            if (elementSize <= 0 || elementSize > size - pos)
+                return false;
+            ok &= parse (packet + pos, elementSize, callback, depth + 1);
+            pos += elementSize;
+        }
+
+        return ok;
+    }
+
+    /** Returns true if the data starts an OSC bundle */
+    static bool isBundle (const uint8* data, int size) noexcept;
+
+    /** Parses a single message */
+    static bool parseMessage (const uint8* data, int size, OSCMessageView& view) noexcept;
+};
+
+//=============================================================================
+
+/** Maps OSC addresses to values.
+
+    Patterns are made of literal segments, and a `*` segment matches any
+    one segment. After compile() the trie is flat and lookups don't
+    allocate. Literal segments are preferred over wildcards.
+ */
+class OSCAddressTrie
+{
+public:
+    OSCAddressTrie();
+    ~OSCAddressTrie();
+
+    /** Adds a pattern with a value of 0 or more. Call before compile() */
+    void add (const String& pattern, int value);
+
+    /** Flattens the trie for lookups */
+    void compile();
+
+    /** Returns the value of the pattern an address matches, or -1 */
+    int match (const char* address, int length) const noexcept;
+
+    /** Returns the value of the pattern an address matches, or -1 */
+    int match (const String& address) const;
+
+private:
+    struct BuildNode;
+    std::unique_ptr<BuildNode> root;
+
+    struct Node
+    {
+        int segment = 0;            // offset in segments
+        int segmentLength = 0;
+        int firstChild = 0;
+        int numChildren = 0;        // literal children, sorted
+        int wildcard = -1;          // child matching any segment
+        int value = -1;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<char> segments;
+
+    void flatten (int index, const BuildNode&);
+    int matchFrom (int node, const char* address, const char* end) const noexcept;
+};
+
+//=============================================================================
+
+/** Receives OSC on UDP ports shared by every subscriber.
+
+    Each port has one socket and one thread. Packets are parsed in place,
+    so nothing is allocated per packet unless a subscriber asks for raw
+    packets.
+ */
+class OSCIngress
+{
+public:
+    class Subscriber
+    {
+    public:
+        virtual ~Subscriber() { }
+
+        /** Called on the port's thread for every message */
+        virtual void oscMessageReceived (const OSCMessageView& message, double timeMs) = 0;
+
+        /** Called on the port's thread with each packet if wantsPackets()
+            returns true */
+        virtual void oscPacketReceived (const void* data, int size) { ignoreUnused (data, size); }
+
+        /** Return true to receive whole packets too */
+        virtual bool wantsPackets() const { return false; }
+    };
+
+    OSCIngress();
+    ~OSCIngress();
+
+    /** Starts sending a port's messages to a subscriber. A subscriber gets
+        one port at a time. Returns false if the port couldn't be opened */
+    bool subscribe (int portNumber, Subscriber* subscriber);
+
+    /** Stops sending messages to a subscriber. No callbacks are running
+        for it once this returns */
+    void unsubscribe (Subscriber* subscriber);
+
+    /** Returns the number of open ports */
+    int getNumPorts() const;
+
+private:
+    class Port;
+    CriticalSection lock;
+    OwnedArray<Port> ports;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OSCIngress)
+};
+
+}
@@ -0,0 +1,388 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/Oversampler.h"
+
+namespace Element {
+
+/** A half-band filter split into its two polyphase branches */
+struct HalfBandFilter
+{
+    // FIR: taps of the even and odd phases. Up filters are scaled by 2
+    std::vector<float> taps[2];
+    int length = 0;
+
+    // IIR: first order allpass coefficients of each branch
+    std::vector<float> direct, delayed;
+
+    /** Returns the delay in samples at the oversampled rate */
+    double getDelay (bool isFIR) const
+    {
+        if (isFIR)
+            return 0.5 * (double) (taps[0].size() + taps[1].size() - 1);
+
+        // phase delay near DC of 0.5 * (A0(z^2) + z^-1 A1(z^2))
+        using Complex = std::complex<double>;
+        auto chain = [] (const std::vector<float>& alphas, Complex z) {
+            Complex r (1.0);
+            for (auto a : alphas)
+                r *= ((double) a + 1.0 / z) / (1.0 + (double) a / z);
+            return r;
+        };
+
+        const double w = 0.001;
+        const auto z = std::polar (1.0, w);
+        const auto h = 0.5 * (chain (direct, z * z) + chain (delayed, z * z) / z);
+        return -std::arg (h) / w;
+    }
+};
+
+struct Oversampler::Kernel : public ReferenceCountedObject
+{
+    struct StageFilters { HalfBandFilter up, down; };
+
+    Kernel (int f, Quality q)
+        : factor (f), quality (q)
+    {
+        for (int n = 0; (1 << (n + 1)) <= factor; ++n)
+        {
+            // same specifications as dsp::Oversampling in normal quality
+            const float widthUp   = 0.12f * (n == 0 ? 0.5f : 1.0f);
+            const float widthDown = 0.15f * (n == 0 ? 0.5f : 1.0f);
+            const float gainUp    = (quality == FIR ? -70.0f : -65.0f) + 8.0f * (float) n;
+            const float gainDown  = -60.0f + 8.0f * (float) n;
+
+            StageFilters stage;
+            design (stage.up,   widthUp,   gainUp,   true);
+            design (stage.down, widthDown, gainDown, false);
+            stages.push_back (stage);
+
+            const double scale = 1.0 / (double) (1 << (n + 1));
+            latency += (stage.up.getDelay (quality == FIR) + stage.down.getDelay (quality == FIR)) * scale;
+        }
+    }
+
+    void design (HalfBandFilter& filter, float width, float gainDB, bool isUp)
+    {
+        if (quality == FIR)
+        {
+            auto coefs = dsp::FilterDesign<float>::designFIRLowpassHalfBandEquirippleMethod (width, gainDB);
+            const int numTaps = (int) coefs->getFilterOrder() + 1;
+            const auto* const h = coefs->getRawCoefficients();
+            for (int k = 0; k < numTaps; ++k)
+                filter.taps[k % 2].push_back (isUp ? 2.0f * h[k] : h[k]);
+            filter.length = (int) jmax (filter.taps[0].size(), filter.taps[1].size());
+        }
+        else
+        {
+            auto structure = dsp::FilterDesign<float>::designIIRLowpassHalfBandPolyphaseAllpassMethod (width, gainDB);
+            for (int i = 0; i < structure.directPath.size(); ++i)
+                filter.direct.push_back (structure.directPath[i]->coefficients[0]);
+            for (int i = 0; i < structure.delayedPath.size(); ++i)
+                filter.delayed.push_back (structure.delayedPath[i]->coefficients[0]);
+        }
+    }
+
+    const int factor;
+    const Quality quality;
+    std::vector<StageFilters> stages;
+    double latency = 0.0;
+};
+
+struct Oversampler::KernelCache
+{
+    ReferenceCountedObjectPtr<Kernel> get (int factor, Quality quality)
+    {
+        ScopedLock sl (lock);
+        for (auto* kernel : kernels)
+            if (kernel->factor == factor && kernel->quality == quality)
+                return kernel;
+        return kernels.add (new Kernel (factor, quality));
+    }
+
+    CriticalSection lock;
+    ReferenceCountedArray<Kernel> kernels;
+};
+
+//=============================================================================
+
+/** Filter state for one stage */
+struct Oversampler::Stage
+{
+    Stage (const Kernel::StageFilters& f, bool fir, int channels, int maxInput)
+        : filters (f), isFIR (fir), numChannels (channels), maxInputSize (maxInput)
+    {
+        if (isFIR)
+        {
+            upLineSize   = filters.up.length - 1 + maxInputSize;
+            downLineSize = filters.down.length - 1 + maxInputSize;
+            upLine.allocate ((size_t) (numChannels * upLineSize), true);
+            evenLine.allocate ((size_t) (numChannels * downLineSize), true);
+            oddLine.allocate ((size_t) (numChannels * downLineSize), true);
+            scratch.allocate ((size_t) (2 * maxInputSize), true);
+        }
+        else
+        {
+            upState.allocate ((size_t) (numChannels * (filters.up.direct.size() + filters.up.delayed.size())), true);
+            downState.allocate ((size_t) (numChannels * (filters.down.direct.size() + filters.down.delayed.size())), true);
+        }
+
+        carry.allocate ((size_t) numChannels, true);
+    }
+
+    void reset()
+    {
+        if (isFIR)
+        {
+            FloatVectorOperations::clear (upLine, numChannels * upLineSize);
+            FloatVectorOperations::clear (evenLine, numChannels * downLineSize);
+            FloatVectorOperations::clear (oddLine, numChannels * downLineSize);
+        }
+        else
+        {
+            FloatVectorOperations::clear (upState, numChannels * (int) (filters.up.direct.size() + filters.up.delayed.size()));
+            FloatVectorOperations::clear (downState, numChannels * (int) (filters.down.direct.size() + filters.down.delayed.size()));
+        }
+
+        FloatVectorOperations::clear (carry, numChannels);
+    }
+
+    /** numSamples in, numSamples * 2 out */
+    void up (const float* const* input, float* const* output, int channels, int numSamples)
+    {
+        jassert (numSamples <= maxInputSize);
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            if (isFIR)
+                upFIR (input[ch], output[ch], upLine + ch * upLineSize, numSamples);
+            else
+                upIIR (input[ch], output[ch], upState + ch * (int) (filters.up.direct.size() + filters.up.delayed.size()), numSamples);
+        }
+    }
+
+    /** numSamples * 2 in, numSamples out */
+    void down (const float* const* input, float* const* output, int channels, int numSamples)
+    {
+        jassert (numSamples <= maxInputSize);
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            if (isFIR)
+                downFIR (input[ch], output[ch], evenLine + ch * downLineSize, oddLine + ch * downLineSize, carry[ch], numSamples);
+            else
+                downIIR (input[ch], output[ch], downState + ch * (int) (filters.down.direct.size() + filters.down.delayed.size()), carry[ch], numSamples);
+        }
+    }
+
+private:
+    const Kernel::StageFilters& filters;
+    const bool isFIR;
+    const int numChannels, maxInputSize;
+    int upLineSize = 0, downLineSize = 0;
+    HeapBlock<float> upLine, evenLine, oddLine, scratch;
+    HeapBlock<float> upState, downState, carry;
+
+    /** Adds one polyphase branch over a history line, a tap at a time so the
+        inner loops are vector operations */
+    static void convolve (const std::vector<float>& taps, const float* line, int history,
+                          float* dest, int numSamples)
+    {
+        for (int j = 0; j < (int) taps.size(); ++j)
+            if (taps[(size_t) j] != 0.0f)
+                FloatVectorOperations::addWithMultiply (dest, line + history - j, taps[(size_t) j], numSamples);
+    }
+
+    void upFIR (const float* input, float* output, float* line, int numSamples)
+    {
+        const int history = filters.up.length - 1;
+        FloatVectorOperations::copy (line + history, input, numSamples);
+
+        auto* const even = scratch.get();
+        auto* const odd  = scratch.get() + maxInputSize;
+        FloatVectorOperations::clear (even, numSamples);
+        FloatVectorOperations::clear (odd, numSamples);
+        convolve (filters.up.taps[0], line, history, even, numSamples);
+        convolve (filters.up.taps[1], line, history, odd, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            output[i << 1] = even[i];
+            output[(i << 1) + 1] = odd[i];
+        }
+
+        std::memmove (line, line + numSamples, sizeof (float) * (size_t) history);
+    }
+
+    void downFIR (const float* input, float* output, float* even, float* odd, float& last, int numSamples)
+    {
+        const int history = filters.down.length - 1;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            even[history + i] = input[i << 1];
+            odd[history + i]  = i == 0 ? last : input[(i << 1) - 1];
+        }
+        last = input[(numSamples << 1) - 1];
+
+        FloatVectorOperations::clear (output, numSamples);
+        convolve (filters.down.taps[0], even, history, output, numSamples);
+        convolve (filters.down.taps[1], odd, history, output, numSamples);
+
+        std::memmove (even, even + numSamples, sizeof (float) * (size_t) history);
+        std::memmove (odd, odd + numSamples, sizeof (float) * (size_t) history);
+    }
+
+    static inline float allpass (const std::vector<float>& alphas, float* state, float input) noexcept
+    {
+        for (size_t n = 0; n < alphas.size(); ++n)
+        {
+            const float output = alphas[n] * input + state[n];
+            state[n] = input - alphas[n] * output;
+            input = output;
+        }
+
+        return input;
+    }
+
+    void upIIR (const float* input, float* output, float* state, int numSamples)
+    {
+        auto* const delayedState = state + filters.up.direct.size();
+        for (int i = 0; i < numSamples; ++i)
+        {
+            output[i << 1]       = allpass (filters.up.direct, state, input[i]);
+            output[(i << 1) + 1] = allpass (filters.up.delayed, delayedState, input[i]);
+        }
+    }
+
+    void downIIR (const float* input, float* output, float* state, float& delayed, int numSamples)
+    {
+        auto* const delayedState = state + filters.down.direct.size();
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float direct = allpass (filters.down.direct, state, input[i << 1]);
+            output[i] = 0.5f * (direct + delayed);
+            delayed = allpass (filters.down.delayed, delayedState, input[(i << 1) + 1]);
+        }
+    }
+};
+
+//=============================================================================
+
+Oversampler::Oversampler() { }
+
+Oversampler::~Oversampler()
+{
+    stages.clear();
+    kernel = nullptr;
+}
+
+void Oversampler::prepare (int channels, int blockSize, int newFactor, Quality newQuality)
+{
+    stages.clear();
+    kernel = nullptr;
+    upBuffer.setSize (0, 0);
+    downBuffer.setSize (0, 0);
+
+    factor = jlimit (1, maxFactor, nextPowerOfTwo (jmax (1, newFactor)));
+    quality = newQuality;
+    numChannels = jmax (1, channels);
+    maxBlockSize = jmax (1, blockSize);
+    latency = 0;
+
+    if (factor <= 1)
+        return;
+
+    kernel = cache->get (factor, quality);
+    latency = roundToInt (kernel->latency);
+
+    int inputSize = maxBlockSize;
+    for (const auto& filters : kernel->stages)
+    {
+        stages.add (new Stage (filters, quality == FIR, numChannels, inputSize));
+        inputSize *= 2;
+    }
+
+    upBuffer.setSize (numChannels, maxBlockSize * factor);
+    downBuffer.setSize (numChannels, maxBlockSize * factor);
+    reset();
+}
+
+void Oversampler::reset()
+{
+    for (auto* stage : stages)
+        stage->reset();
+}
+
+int Oversampler::getLatencySamples (int factor, Quality quality)
+{
+    factor = jlimit (1, maxFactor, nextPowerOfTwo (jmax (1, factor)));
+    if (factor <= 1)
+        return 0;
+    SharedResourcePointer<KernelCache> cache;
+    return roundToInt (cache->get (factor, quality)->latency);
+}
+
+AudioBuffer<float>& Oversampler::processUp (const AudioBuffer<float>& buffer)
+{
+    const int channels = jmin (numChannels, buffer.getNumChannels());
+    const int numSamples = jmin (maxBlockSize, buffer.getNumSamples());
+    jassert (buffer.getNumSamples() <= maxBlockSize);
+
+    // stages alternate buffers so the last one writes to upBuffer
+    const float* const* input = buffer.getArrayOfReadPointers();
+    int inputSize = numSamples;
+    for (int i = 0; i < stages.size(); ++i)
+    {
+        auto& target = (stages.size() - 1 - i) % 2 == 0 ? upBuffer : downBuffer;
+        stages.getUnchecked(i)->up (input, target.getArrayOfWritePointers(), channels, inputSize);
+        input = target.getArrayOfReadPointers();
+        inputSize *= 2;
+    }
+
+    upView.setDataToReferTo (upBuffer.getArrayOfWritePointers(), channels, numSamples * factor);
+    return upView;
+}
+
+void Oversampler::processDown (AudioBuffer<float>& buffer)
+{
+    const int channels = jmin (numChannels, buffer.getNumChannels());
+    const int numSamples = jmin (maxBlockSize, buffer.getNumSamples());
+
+    const float* const* input = upBuffer.getArrayOfReadPointers();
+    int outputSize = numSamples * factor / 2;
+    for (int i = stages.size(); --i >= 0;)
+    {
+        auto& target = input == upBuffer.getArrayOfReadPointers() ? downBuffer : upBuffer;
+        auto* const* output = i == 0 ? buffer.getArrayOfWritePointers() : target.getArrayOfWritePointers();
+        stages.getUnchecked(i)->down (input, output, channels, outputSize);
+        input = target.getArrayOfReadPointers();
+        outputSize /= 2;
+    }
+}
+
+String Oversampler::getQualityName (Quality quality)
+{
+    switch (quality)
+    {
+        case IIR: return "Low Latency (IIR)"; break;
+        case FIR: return "Linear Phase (FIR)"; break;
+    }
+
+    return String();
+}
+
+}
@@ -0,0 +1,95 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Oversamples a node's audio by 2, 4 or 8 using cascaded half-band stages.
+
+    Filters are designed once per quality and factor and shared by every
+    Oversampler using them, so only the filter state is per node. All
+    allocation happens in prepare().
+ */
+class Oversampler
+{
+public:
+    enum Quality
+    {
+        /** Polyphase IIR allpass filters. Low latency, not linear phase */
+        IIR = 0,
+        /** Polyphase equiripple FIR filters. Linear phase, more latency */
+        FIR
+    };
+
+    /** The largest factor supported */
+    static constexpr int maxFactor = 8;
+
+    Oversampler();
+    ~Oversampler();
+
+    /** Allocates state and buffers. A factor of 1 releases everything */
+    void prepare (int numChannels, int maxBlockSize, int factor, Quality quality);
+
+    /** Clears filter state */
+    void reset();
+
+    /** Returns the prepared factor, 1 if not oversampling */
+    int getFactor() const noexcept { return factor; }
+
+    /** Returns the prepared quality */
+    Quality getQuality() const noexcept { return quality; }
+
+    /** Returns the round trip latency at the base rate */
+    int getLatencySamples() const noexcept { return latency; }
+
+    /** Returns the round trip latency at the base rate for a factor and
+        quality. Designs the filters if nothing is using them yet */
+    static int getLatencySamples (int factor, Quality quality);
+
+    /** Upsamples the buffer and returns the oversampled audio. The result is
+        valid until processDown() */
+    AudioBuffer<float>& processUp (const AudioBuffer<float>& buffer);
+
+    /** Downsamples the oversampled audio back into the buffer */
+    void processDown (AudioBuffer<float>& buffer);
+
+    /** Returns a display name for a quality */
+    static String getQualityName (Quality quality);
+
+private:
+    struct Kernel;
+    struct KernelCache;
+    struct Stage;
+    SharedResourcePointer<KernelCache> cache;
+    ReferenceCountedObjectPtr<Kernel> kernel;
+    OwnedArray<Stage> stages;
+    AudioBuffer<float> upBuffer, downBuffer, upView;
+    int factor = 1;
+    Quality quality = IIR;
+    int latency = 0;
+    int numChannels = 0;
+    int maxBlockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Oversampler)
+};
+
+}
@@ -0,0 +1,295 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/PatternSequencer.h"
+
+namespace Element {
+
+PatternSequencer::PatternSequencer()
+{
+    const Step step;
+    for (int i = 0; i < maxSteps; ++i)
+        steps[i].set (packStep (step));
+}
+
+void PatternSequencer::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void PatternSequencer::reset()
+{
+    numVoices = 0;
+    numHeld = 0;
+    wasPlaying = false;
+    expectedBeat = 0.0;
+}
+
+int PatternSequencer::packStep (const Step& step) noexcept
+{
+    return jlimit (0, 127, step.note)
+        | (jlimit (1, 127, step.velocity) << 7)
+        | (jlimit (1, 100, step.gate) << 14)
+        | (step.enabled ? (1 << 21) : 0);
+}
+
+PatternSequencer::Step PatternSequencer::unpackStep (const int packed) noexcept
+{
+    Step step;
+    step.note       = packed & 0x7f;
+    step.velocity   = (packed >> 7) & 0x7f;
+    step.gate       = (packed >> 14) & 0x7f;
+    step.enabled    = (packed & (1 << 21)) != 0;
+    return step;
+}
+
+void PatternSequencer::setStep (int index, const Step& step)
+{
+    if (isPositiveAndBelow (index, (int) maxSteps))
+        steps[index].set (packStep (step));
+}
+
+PatternSequencer::Step PatternSequencer::getStep (int index) const
+{
+    return isPositiveAndBelow (index, (int) maxSteps) ? unpackStep (steps[index].get()) : Step();
+}
+
+void PatternSequencer::setLoop (int startStep, int endStep)
+{
+    endStep   = jlimit (1, (int) maxSteps, endStep);
+    startStep = jlimit (0, endStep - 1, startStep);
+
+    // the audio thread reads both, so never publish an empty loop
+    loopStart.set (0);
+    loopEnd.set (endStep);
+    loopStart.set (startStep);
+}
+
+void PatternSequencer::setStepLength (double beats)     { stepLength.set (jlimit (1.0 / 64.0, 16.0, beats)); }
+void PatternSequencer::setSwing (float amount)          { swing.set (jlimit (0.f, 1.f, amount)); }
+void PatternSequencer::setMode (int newMode)            { mode.set (jlimit (0, numModes - 1, newMode)); }
+void PatternSequencer::setOctaves (int newOctaves)      { octaves.set (jlimit (1, 4, newOctaves)); }
+void PatternSequencer::setChannel (int newChannel)      { channel.set (jlimit (1, 16, newChannel)); }
+
+int PatternSequencer::getPatternStep (const int64 k) const noexcept
+{
+    const int end   = loopEnd.get();
+    const int start = jmin (loopStart.get(), end - 1);
+    if (k < (int64) end)
+        return (int) k;
+    return start + (int) ((k - start) % (int64) (end - start));
+}
+
+//=============================================================================
+
+void PatternSequencer::hold (const int note) noexcept
+{
+    if (numHeld >= maxHeldNotes)
+        return;
+
+    int index = 0;
+    while (index < numHeld && held[index] < note)
+        ++index;
+    if (index < numHeld && held[index] == note)
+        return;
+
+    for (int i = numHeld; i > index; --i)
+        held[i] = held[i - 1];
+    held[index] = note;
+    played[numHeld++] = note;
+}
+
+void PatternSequencer::release (const int note) noexcept
+{
+    int i = 0;
+    while (i < numHeld && held[i] != note)
+        ++i;
+    if (i == numHeld)
+        return;
+
+    for (; i < numHeld - 1; ++i)
+        held[i] = held[i + 1];
+
+    i = 0;
+    while (played[i] != note)
+        ++i;
+    for (; i < numHeld - 1; ++i)
+        played[i] = played[i + 1];
+
+    --numHeld;
+}
+
+int PatternSequencer::getArpNote (const int64 k, const int arpMode) const noexcept
+{
+    const int total = numHeld * octaves.get();
+    int index = 0;
+
+    switch (arpMode)
+    {
+        case arpDown:
+            index = total - 1 - (int) (k % total);
+            break;
+
+        case arpUpDown:
+        {
+            const int cycle = total > 1 ? 2 * total - 2 : 1;
+            const int phase = (int) (k % cycle);
+            index = phase < total ? phase : cycle - phase;
+            break;
+        }
+
+        default:
+            index = (int) (k % total);
+            break;
+    }
+
+    const int* const notes = arpMode == arpAsPlayed ? played : held;
+    return notes [index % numHeld] + 12 * (index / numHeld);
+}
+
+//=============================================================================
+
+void PatternSequencer::allNotesOff (MidiBuffer& output, int frame)
+{
+    const int ch = channel.get();
+    for (int i = 0; i < numVoices; ++i)
+        output.addEvent (MidiMessage::noteOff (ch, voices[i].note), frame);
+    numVoices = 0;
+}
+
+void PatternSequencer::releaseVoices (double untilBeat, bool inclusive, double blockBeat,
+                                      double samplesPerBeat, int numSamples, MidiBuffer& output)
+{
+    const int ch = channel.get();
+    for (int i = numVoices; --i >= 0;)
+    {
+        const auto& voice = voices[i];
+        if (voice.offBeat > untilBeat || (! inclusive && voice.offBeat == untilBeat))
+            continue;
+
+        const int frame = jlimit (0, numSamples - 1, roundToInt ((voice.offBeat - blockBeat) * samplesPerBeat));
+        output.addEvent (MidiMessage::noteOff (ch, voice.note), frame);
+        voices[i] = voices[--numVoices];
+    }
+}
+
+void PatternSequencer::trigger (int64 k, double onset, int frame, MidiBuffer& output)
+{
+    const auto step = unpackStep (steps [getPatternStep (k)].get());
+    if (! step.enabled)
+        return;
+
+    const int arpMode = mode.get();
+    int note = step.note;
+    if (arpMode != sequence)
+    {
+        if (numHeld <= 0)
+            return;
+        note = getArpNote (k, arpMode);
+        if (note > 127)
+            return;
+    }
+
+    const int ch = channel.get();
+    for (int i = numVoices; --i >= 0;)
+    {
+        if (voices[i].note == note)
+        {
+            output.addEvent (MidiMessage::noteOff (ch, note), frame);
+            voices[i] = voices[--numVoices];
+        }
+    }
+
+    // steal the note that started first when the pool is full
+    if (numVoices >= maxVoices)
+    {
+        int oldest = 0;
+        for (int i = 1; i < numVoices; ++i)
+            if (voices[i].onBeat < voices[oldest].onBeat)
+                oldest = i;
+
+        output.addEvent (MidiMessage::noteOff (ch, voices[oldest].note), frame);
+        voices[oldest] = voices[--numVoices];
+    }
+
+    output.addEvent (MidiMessage::noteOn (ch, note, (uint8) step.velocity), frame);
+    voices[numVoices++] = { note, onset, onset + stepLength.get() * step.gate * 0.01 };
+}
+
+void PatternSequencer::render (const Position& position, int numSamples,
+                               const MidiBuffer& input, MidiBuffer& output)
+{
+    const bool arpeggiating = mode.get() != sequence;
+    MidiBuffer::Iterator iter (input);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
+
+    while (iter.getNextEvent (data, size, frame))
+    {
+        const int status = data[0] & 0xf0;
+        if (arpeggiating && size >= 3 && (status == 0x90 || status == 0x80))
+        {
+            if (status == 0x90 && data[2] > 0)
+                hold (data[1]);
+            else
+                release (data[1]);
+            continue;
+        }
+
+        output.addEvent (data, size, frame);
+    }
+
+    if (! position.playing || position.tempo <= 0.0 || numSamples <= 0)
+    {
+        if (wasPlaying)
+            allNotesOff (output, 0);
+        wasPlaying = false;
+        return;
+    }
+
+    const double samplesPerBeat = sampleRate * 60.0 / position.tempo;
+    const double blockStart = position.beat;
+    const double blockEnd   = blockStart + (double) numSamples / samplesPerBeat;
+
+    // a jump in the playhead cuts what was sounding
+    if (wasPlaying && std::abs (blockStart - expectedBeat) > 0.5 / samplesPerBeat)
+        allNotesOff (output, 0);
+    wasPlaying = true;
+    expectedBeat = blockEnd;
+
+    const double length = stepLength.get();
+    const double swingOffset = 0.5 * swing.get() * length;
+    const int64 lastStep = (int64) std::floor (blockEnd / length);
+
+    for (int64 k = jmax ((int64) 0, (int64) std::floor (blockStart / length) - 1); k <= lastStep; ++k)
+    {
+        const double onset = (double) k * length + ((k & 1) != 0 ? swingOffset : 0.0);
+        if (onset < blockStart || onset >= blockEnd)
+            continue;
+
+        const int onsetFrame = jlimit (0, numSamples - 1, roundToInt ((onset - blockStart) * samplesPerBeat));
+        releaseVoices (onset, true, blockStart, samplesPerBeat, numSamples, output);
+        trigger (k, onset, onsetFrame, output);
+    }
+
+    releaseVoices (blockEnd, false, blockStart, samplesPerBeat, numSamples, output);
+}
+
+}
@@ -0,0 +1,161 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A step sequencer and arpeggiator locked to the transport's beats.
+
+    Step times are worked out from the block's beat range, so a block
+    only visits the steps that start inside it and the cost does not grow
+    with pattern length or density. Step k of the transport always lands
+    on the same pattern step, which keeps the pattern in place across
+    relocations and transport loops. Sounding notes are kept in a fixed
+    pool and nothing is allocated while rendering.
+
+    Steps and settings may be changed from another thread while rendering.
+ */
+class PatternSequencer
+{
+public:
+    enum
+    {
+        maxSteps        = 64,
+        maxVoices       = 32,
+        maxHeldNotes    = 16
+    };
+
+    enum Mode
+    {
+        sequence = 0,   // steps play their own notes
+        arpUp,          // steps walk the held notes
+        arpDown,
+        arpUpDown,
+        arpAsPlayed,
+        numModes
+    };
+
+    struct Step
+    {
+        int note        = 60;
+        int velocity    = 100;
+        int gate        = 50;       // percent of the step length, 1 to 100
+        bool enabled    = true;
+    };
+
+    /** Where a block starts on the transport */
+    struct Position
+    {
+        double beat     = 0.0;      // quarter notes
+        double tempo    = 120.0;
+        bool playing    = false;
+    };
+
+    PatternSequencer();
+
+    void prepare (double sampleRate);
+
+    /** Forgets sounding and held notes without sending note offs */
+    void reset();
+
+    void setStep (int index, const Step& step);
+    Step getStep (int index) const;
+
+    /** Sets the steps the pattern loops over. Steps before the loop play
+        once from the start of the transport */
+    void setLoop (int startStep, int endStep);
+    int getLoopStart() const                    { return loopStart.get(); }
+    int getLoopEnd() const                      { return loopEnd.get(); }
+
+    /** Sets the step length in quarter notes */
+    void setStepLength (double beats);
+    double getStepLength() const                { return stepLength.get(); }
+
+    /** Delays every second step. 0 is straight, 1 delays by half a step */
+    void setSwing (float amount);
+    float getSwing() const                      { return swing.get(); }
+
+    void setMode (int mode);
+    int getMode() const                         { return mode.get(); }
+
+    /** Sets how many octaves the arpeggiator spans, 1 to 4 */
+    void setOctaves (int octaves);
+    int getOctaves() const                      { return octaves.get(); }
+
+    /** Sets the output channel, 1 to 16 */
+    void setChannel (int channel);
+    int getChannel() const                      { return channel.get(); }
+
+    /** Renders one block. In arpeggiator modes notes from the input are
+        held and removed, everything else passes to the output */
+    void render (const Position& position, int numSamples,
+                 const MidiBuffer& input, MidiBuffer& output);
+
+    /** Sends note offs for the sounding notes */
+    void allNotesOff (MidiBuffer& output, int frame);
+
+    /** Returns the pattern step played at transport step k */
+    int getPatternStep (int64 k) const noexcept;
+
+    int getNumSoundingNotes() const noexcept    { return numVoices; }
+    int getNumHeldNotes() const noexcept        { return numHeld; }
+
+private:
+    Atomic<int> steps [maxSteps];
+    Atomic<int> loopStart { 0 }, loopEnd { 16 };
+    Atomic<double> stepLength { 0.25 };
+    Atomic<float> swing { 0.f };
+    Atomic<int> mode { sequence }, octaves { 1 }, channel { 1 };
+
+    double sampleRate = 44100.0;
+    double expectedBeat = 0.0;
+    bool wasPlaying = false;
+
+    struct Voice
+    {
+        int note;
+        double onBeat;
+        double offBeat;
+    };
+
+    Voice voices [maxVoices];       // unordered, removals swap the last one in
+    int numVoices = 0;
+
+    int held [maxHeldNotes];        // sorted by pitch
+    int played [maxHeldNotes];      // in the order they were pressed
+    int numHeld = 0;
+
+    static int packStep (const Step&) noexcept;
+    static Step unpackStep (int packed) noexcept;
+
+    void hold (int note) noexcept;
+    void release (int note) noexcept;
+    int getArpNote (int64 k, int arpMode) const noexcept;
+
+    void trigger (int64 k, double onset, int frame, MidiBuffer& output);
+    void releaseVoices (double untilBeat, bool inclusive, double blockBeat,
+                        double samplesPerBeat, int numSamples, MidiBuffer& output);
+
+    JUCE_DECLARE_NON_COPYABLE (PatternSequencer)
+};
+
+}
@@ -0,0 +1,157 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/AudioProcessorNode.h"
+#include "engine/PluginInstancePool.h"
+
+namespace Element {
+
+/** Least an instance is charged, most plugins save far less state than
+    they hold in memory */
+static const int64 minInstanceBytes = 8 * 1024 * 1024;
+
+PluginInstancePool::PluginInstancePool() { }
+
+PluginInstancePool::~PluginInstancePool()
+{
+    stopTimer();
+    clear();
+}
+
+void PluginInstancePool::setTimeout (int seconds)
+{
+    timeoutMs = jmax (0, seconds) * 1000;
+    expire();
+}
+
+void PluginInstancePool::setMaxMemory (int64 numBytes)
+{
+    maxMemory = jmax ((int64) 0, numBytes);
+    expire();
+}
+
+int64 PluginInstancePool::estimateSize (AudioPluginInstance& instance)
+{
+    MemoryBlock state;
+    instance.getStateInformation (state);
+    return jmax (minInstanceBytes, (int64) state.getSize());
+}
+
+bool PluginInstancePool::canPool (GraphNode& node) const
+{
+    if (timeoutMs <= 0 || maxMemory <= 0 || node.getAudioProcessor() == nullptr)
+        return false;
+    if (node.isAudioIONode() || node.isMidiIONode())
+        return false;
+    if (dynamic_cast<AudioProcessorNode*> (&node) == nullptr ||
+        dynamic_cast<AudioPluginInstance*> (node.getAudioProcessor()) == nullptr)
+        return false;
+
+    PluginDescription desc;
+    node.getPluginDescription (desc);
+    return desc.pluginFormatName != "Element" &&
+           desc.pluginFormatName != "Internal";
+}
+
+bool PluginInstancePool::add (GraphNodePtr node)
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    if (node == nullptr || ! canPool (*node))
+        return false;
+
+    auto* const processor = dynamic_cast<AudioProcessorNode*> (node.get())->releaseAudioProcessor();
+    auto* const instance  = dynamic_cast<AudioPluginInstance*> (processor);
+    jassert (instance != nullptr);
+    add (instance, estimateSize (*instance));
+    return true;
+}
+
+void PluginInstancePool::add (AudioPluginInstance* instance, int64 numBytes)
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    std::unique_ptr<AudioPluginInstance> deleter (instance);
+    if (instance == nullptr || timeoutMs <= 0 || numBytes > maxMemory)
+        return;
+
+    Entry entry;
+    entry.identifier = instance->getPluginDescription().createIdentifierString();
+    entry.instance.reset (deleter.release());
+    entry.numBytes   = numBytes;
+    entry.released   = Time::getMillisecondCounter();
+    entries.push_back (std::move (entry));
+    memoryUsed += numBytes;
+
+    expire();
+    if (! entries.empty() && ! isTimerRunning())
+        startTimer (1000);
+}
+
+AudioPluginInstance* PluginInstancePool::take (const PluginDescription& desc)
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    const auto identifier = desc.createIdentifierString();
+
+    // most recently removed first, it's the one most likely being undone
+    for (auto iter = entries.rbegin(); iter != entries.rend(); ++iter)
+    {
+        if (iter->identifier == identifier)
+        {
+            auto* const instance = iter->instance.release();
+            memoryUsed -= iter->numBytes;
+            entries.erase (std::next (iter).base());
+            if (entries.empty())
+                stopTimer();
+            DBG("[EL] reusing pooled instance: " << desc.name);
+            return instance;
+        }
+    }
+
+    return nullptr;
+}
+
+void PluginInstancePool::clear()
+{
+    std::vector<Entry> toDelete;
+    toDelete.swap (entries);
+    memoryUsed = 0;
+    toDelete.clear();
+}
+
+void PluginInstancePool::expire()
+{
+    const auto now = Time::getMillisecondCounter();
+    while (! entries.empty())
+    {
+        const auto& oldest = entries.front();
+        if (memoryUsed <= maxMemory && now - oldest.released < (uint32) timeoutMs)
+            break;
+        memoryUsed -= oldest.numBytes;
+        entries.erase (entries.begin());
+    }
+
+    if (entries.empty())
+        stopTimer();
+}
+
+void PluginInstancePool::timerCallback()
+{
+    expire();
+}
+
+}
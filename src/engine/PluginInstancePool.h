@@ -0,0 +1,105 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+#include "engine/GraphNode.h"
+
+namespace Element {
+
+/** Keeps recently removed plugin instances alive so they can be reused.
+
+    Some plugins take seconds to instantiate. When a node is removed its
+    plugin instance is detached and parked here for a while. Re-adding a
+    node of the same plugin with a saved state (undo, paste, duplicate graph,
+    replace) takes the parked instance, wraps it in a new node and restores
+    the state on it instead of creating a new one. Node settings like bypass,
+    gain and MIDI channels start from defaults, same as a fresh instance.
+    Only third party plugins are pooled, internal nodes are cheap.
+
+    The pool is limited by a memory budget. Plugins can't report how much
+    memory they hold, so each instance is charged its saved state size, with
+    a minimum per instance. See estimateSize.
+
+    Everything here happens on the message thread. Use it through
+    SharedResourcePointer<PluginInstancePool>.
+ */
+class PluginInstancePool : private Timer
+{
+public:
+    PluginInstancePool();
+    ~PluginInstancePool();
+
+    /** Seconds a removed instance is kept. Zero disables the pool */
+    void setTimeout (int seconds);
+
+    /** Maximum bytes of instances kept. The oldest go first */
+    void setMaxMemory (int64 numBytes);
+
+    /** Returns the bytes charged for the parked instances */
+    int64 getMemoryUsed() const noexcept { return memoryUsed; }
+
+    /** Returns true if the node's instance is worth keeping */
+    bool canPool (GraphNode& node) const;
+
+    /** Detaches and parks the instance of a node which has been removed from
+        its graph. The node can't be used afterwards. Returns false if it isn't
+        pooled, in which case the node is left as is */
+    bool add (GraphNodePtr node);
+
+    /** Parks an instance charged numBytes against the budget. The pool owns
+        it afterwards and deletes it right away if it doesn't fit */
+    void add (AudioPluginInstance* instance, int64 numBytes);
+
+    /** Takes a parked instance for the plugin, or nullptr if there isn't
+        one. The caller owns the returned instance */
+    AudioPluginInstance* take (const PluginDescription& desc);
+
+    /** Deletes all parked instances */
+    void clear();
+
+    /** Returns the number of parked instances */
+    int size() const { return static_cast<int> (entries.size()); }
+
+    /** Returns the bytes an instance is charged: its saved state, or 8 MB
+        if that's less */
+    static int64 estimateSize (AudioPluginInstance& instance);
+
+private:
+    struct Entry
+    {
+        String identifier;
+        std::unique_ptr<AudioPluginInstance> instance;
+        int64 numBytes = 0;
+        uint32 released = 0;
+    };
+
+    std::vector<Entry> entries;
+    int timeoutMs = 120 * 1000;
+    int64 maxMemory = 256 * 1024 * 1024;
+    int64 memoryUsed = 0;
+
+    void expire();
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginInstancePool)
+};
+
+}
@@ -0,0 +1,785 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/Sampler.h"
+
+namespace Element {
+
+using Vec = dsp::SIMDRegister<float>;
+static const int laneSize = (int) Vec::SIMDNumElements;
+
+/** Parses a MIDI note number or a note name like c4, f#3 or eb-1. c4 is 60 */
+static int parseNote (const String& text, int defaultNote)
+{
+    const auto t = text.trim().toLowerCase();
+    if (t.isEmpty())
+        return defaultNote;
+    if (CharacterFunctions::isDigit (t[0]) || t[0] == '-')
+        return jlimit (0, 127, t.getIntValue());
+
+    static const int semitones[] = { 9, 11, 0, 2, 4, 5, 7 }; // a to g
+    if (t[0] < 'a' || t[0] > 'g')
+        return defaultNote;
+
+    int note = semitones [t[0] - 'a'];
+    int i = 1;
+    if (t[i] == '#')        { ++note; ++i; }
+    else if (t[i] == 'b')   { --note; ++i; }
+
+    const auto octave = t.substring (i);
+    if (octave.isEmpty() || ! (CharacterFunctions::isDigit (octave[0]) || octave[0] == '-'))
+        return defaultNote;
+    return jlimit (0, 127, (octave.getIntValue() + 1) * 12 + note);
+}
+
+/** Returns the index where an SFZ value starting at `start` ends. Values
+    end at the next header or `opcode=`, so sample paths can have spaces */
+static int findValueEnd (const String& line, int start)
+{
+    for (int i = start; i < line.length(); ++i)
+    {
+        if (line[i] == '<')
+            return i;
+        if (! CharacterFunctions::isWhitespace (line[i]))
+            continue;
+
+        int j = i;
+        while (j < line.length() && CharacterFunctions::isWhitespace (line[j]))
+            ++j;
+        int k = j;
+        while (k < line.length() && (CharacterFunctions::isLetterOrDigit (line[k]) || line[k] == '_'))
+            ++k;
+        if (k > j && k < line.length() && line[k] == '=')
+            return i;
+    }
+
+    return line.length();
+}
+
+//=============================================================================
+
+SampleZone* SampleMap::findZone (int note, int velocity) const noexcept
+{
+    for (auto* zone : zones)
+        if (zone->matches (note, velocity))
+            return zone;
+    return nullptr;
+}
+
+size_t SampleMap::getHeadMemory() const
+{
+    size_t bytes = 0;
+    for (const auto* zone : zones)
+        bytes += sizeof (float) * (size_t) zone->head.getNumChannels() * (size_t) zone->head.getNumSamples();
+    return bytes;
+}
+
+bool SampleMap::addZone (SampleZone* newZone, AudioFormatManager& formats, int headFrames, String& error)
+{
+    std::unique_ptr<SampleZone> zone (newZone);
+    if (zone->file.existsAsFile())
+        zone->reader.reset (formats.createReaderFor (zone->file));
+
+    if (zone->reader == nullptr || zone->reader->lengthInSamples <= 0)
+    {
+        if (error.isEmpty())
+            error = String ("Could not read ") + zone->file.getFileName();
+        return false;
+    }
+
+    auto& reader = *zone->reader;
+    zone->sampleRate = reader.sampleRate;
+    zone->length     = reader.lengthInSamples;
+
+    const int numChannels = jlimit (1, 2, (int) reader.numChannels);
+    const int numFrames   = (int) jmin ((int64) jmax (1, headFrames), zone->length);
+    zone->head.setSize (numChannels, numFrames);
+    reader.read (&zone->head, 0, numFrames, 0, true, numChannels > 1);
+
+    // short samples never stream, so close them
+    if (zone->isFullyLoaded())
+        zone->reader = nullptr;
+
+    zones.add (zone.release());
+    return true;
+}
+
+SampleMap* SampleMap::fromSample (const File& file, AudioFormatManager& formats,
+                                  String& error, int headFrames)
+{
+    std::unique_ptr<SampleMap> map (new SampleMap());
+    map->file = file;
+    auto* zone = new SampleZone();
+    zone->file = file;
+    if (! map->addZone (zone, formats, headFrames, error))
+        return nullptr;
+    return map.release();
+}
+
+SampleMap* SampleMap::fromSFZ (const File& file, AudioFormatManager& formats,
+                               String& error, int headFrames)
+{
+    if (! file.existsAsFile())
+    {
+        error = String ("Could not open ") + file.getFileName();
+        return nullptr;
+    }
+
+    auto* map = fromSFZText (file.loadFileAsString(), file.getParentDirectory(),
+                             formats, error, headFrames);
+    if (map != nullptr)
+        map->file = file;
+    return map;
+}
+
+SampleMap* SampleMap::fromSFZText (const String& text, const File& baseDirectory,
+                                   AudioFormatManager& formats, String& error,
+                                   int headFrames)
+{
+    std::unique_ptr<SampleMap> map (new SampleMap());
+    StringPairArray control, global, group, region;
+    StringPairArray* scope = nullptr;
+    bool inRegion = false;
+
+    auto flushRegion = [&]()
+    {
+        if (! inRegion)
+            return;
+        inRegion = false;
+
+        StringPairArray opcodes (global);
+        opcodes.addMap (group);
+        opcodes.addMap (region);
+
+        const auto sample = opcodes ["sample"].replaceCharacter ('\\', '/');
+        if (sample.isEmpty())
+            return;
+
+        auto* zone = new SampleZone();
+        zone->file = baseDirectory.getChildFile (control["default_path"].replaceCharacter ('\\', '/') + sample);
+
+        const int key = parseNote (opcodes["key"], -1);
+        zone->loKey   = parseNote (opcodes["lokey"], key >= 0 ? key : 0);
+        zone->hiKey   = parseNote (opcodes["hikey"], key >= 0 ? key : 127);
+        zone->rootKey = parseNote (opcodes["pitch_keycenter"], key >= 0 ? key : 60);
+        zone->loVel   = jlimit (1, 127, opcodes["lovel"].isEmpty() ? 1 : opcodes["lovel"].getIntValue());
+        zone->hiVel   = jlimit (1, 127, opcodes["hivel"].isEmpty() ? 127 : opcodes["hivel"].getIntValue());
+        zone->gain    = Decibels::decibelsToGain (opcodes["volume"].getFloatValue());
+        zone->tune    = opcodes["tune"].getFloatValue() * 0.01f + (float) opcodes["transpose"].getIntValue();
+        zone->attack  = jmax (0.0f, opcodes["ampeg_attack"].getFloatValue());
+        if (opcodes.containsKey ("ampeg_release"))
+            zone->release = jmax (0.0f, opcodes["ampeg_release"].getFloatValue());
+
+        map->addZone (zone, formats, headFrames, error);
+    };
+
+    StringArray lines;
+    lines.addLines (text);
+    for (auto line : lines)
+    {
+        const int comment = line.indexOf ("//");
+        if (comment >= 0)
+            line = line.substring (0, comment);
+
+        int i = 0;
+        while (i < line.length())
+        {
+            if (CharacterFunctions::isWhitespace (line[i]))
+            {
+                ++i;
+                continue;
+            }
+
+            if (line[i] == '<')
+            {
+                const int end = line.indexOfChar (i, '>');
+                if (end < 0)
+                    break;
+
+                const auto header = line.substring (i + 1, end).trim();
+                flushRegion();
+
+                if (header == "control")      { control.clear(); scope = &control; }
+                else if (header == "global")  { global.clear(); group.clear(); scope = &global; }
+                else if (header == "group")   { group.clear(); scope = &group; }
+                else if (header == "region")  { region.clear(); scope = &region; inRegion = true; }
+                else                          { scope = nullptr; }
+
+                i = end + 1;
+                continue;
+            }
+
+            const int equals = line.indexOfChar (i, '=');
+            if (equals < 0)
+                break;
+
+            const int end = findValueEnd (line, equals + 1);
+            if (scope != nullptr)
+                scope->set (line.substring (i, equals).trim(), line.substring (equals + 1, end).trim());
+            i = end;
+        }
+    }
+
+    flushRegion();
+
+    if (map->zones.size() <= 0)
+    {
+        if (error.isEmpty())
+            error = "No regions found";
+        return nullptr;
+    }
+
+    return map.release();
+}
+
+//=============================================================================
+
+struct Sampler::Voice
+{
+    // audio thread
+    SampleZone* zone = nullptr;
+    bool active = false;
+    bool releasing = false;
+    bool sustained = false;
+    bool stolen = false;
+    int note = -1;
+    uint32 age = 0;
+    double position = 0.0;
+    double ratio = 1.0;
+    float gain = 1.0f;
+    float level = 0.0f;
+    float attackStep = 1.0f;
+    float releaseStep = 1.0f;
+
+    // streamed frames from the end of the zone's head. The renderer sets
+    // `stream` and bumps `request` to start a stream. The disk thread answers
+    // by setting `served` to that request, and the ring may only be read
+    // while the two are equal. Frame f is stored at f & (ringFrames - 1)
+    AudioBuffer<float> ring;
+    std::atomic<SampleZone*> stream { nullptr };
+    std::atomic<int> request { 0 };
+    std::atomic<int> served { 0 };
+    std::atomic<int64> written { 0 };
+    std::atomic<int64> consumed { 0 };
+
+    Voice() : ring (2, ringFrames) { ring.clear(); }
+};
+
+Sampler::Sampler() { }
+
+Sampler::~Sampler()
+{
+    release();
+    pending.store (nullptr);
+    active = nullptr;
+    maps.clear();
+}
+
+void Sampler::prepare (double newSampleRate, int maxBlockSize)
+{
+    ScopedLock sl (streamLock);
+    sampleRate = newSampleRate;
+    blockSize  = jmax (1, maxBlockSize);
+
+    if (voices.size() != maxVoices + stealVoices)
+    {
+        voices.clearQuick (true);
+        for (int i = 0; i < maxVoices + stealVoices; ++i)
+            voices.add (new Voice());
+    }
+
+    for (auto* voice : voices)
+        stopVoice (*voice);
+
+    // every voice renders through this, plus the interpolator's taps
+    scratch.setSize (2, (int) std::ceil (blockSize * maxPitchRatio) + 8, false, false, true);
+    voiceBuffer.setSize (3, blockSize, false, false, true);
+    chunk.setSize (2, chunkFrames, false, false, true);
+    sustain = false;
+    numActive.set (0);
+}
+
+void Sampler::release()
+{
+    ScopedLock sl (streamLock);
+    voices.clear();
+    scratch.setSize (1, 1);
+    voiceBuffer.setSize (1, 1);
+    chunk.setSize (1, 1);
+    numActive.set (0);
+}
+
+void Sampler::setSampleMap (SampleMap* newMap)
+{
+    if (newMap == nullptr)
+        newMap = new SampleMap();
+
+    {
+        ScopedLock sl (mapLock);
+        newMap->serial = nextSerial++;
+        maps.add (newMap);
+    }
+
+    // a map still pending was never rendered
+    if (auto* old = pending.exchange (newMap))
+    {
+        ScopedLock sl (mapLock);
+        maps.removeObject (old);
+    }
+}
+
+void Sampler::collectGarbage()
+{
+    const int serial = activeSerial.load();
+    ScopedLock sl (mapLock);
+    for (int i = maps.size(); --i >= 0;)
+        if (maps.getUnchecked(i)->serial < serial)
+            maps.remove (i);
+}
+
+size_t Sampler::getMemoryUsage() const
+{
+    size_t bytes = sizeof (float) * (size_t) voices.size() * 2 * (size_t) ringFrames;
+    bytes += sizeof (float) * (size_t) scratch.getNumChannels() * (size_t) scratch.getNumSamples();
+    bytes += sizeof (float) * (size_t) voiceBuffer.getNumChannels() * (size_t) voiceBuffer.getNumSamples();
+    bytes += sizeof (float) * (size_t) chunk.getNumChannels() * (size_t) chunk.getNumSamples();
+
+    ScopedLock sl (mapLock);
+    for (const auto* map : maps)
+        bytes += map->getHeadMemory();
+    return bytes;
+}
+
+//=============================================================================
+
+void Sampler::adoptPendingMap()
+{
+    auto* next = pending.exchange (nullptr);
+    if (next == nullptr)
+        return;
+
+    // zones of the old map go away with it, so nothing may still play them
+    for (auto* voice : voices)
+        stopVoice (*voice);
+    active = next;
+    activeSerial.store (next->serial);
+}
+
+void Sampler::stopVoice (Voice& voice)
+{
+    voice.active = false;
+    voice.stolen = false;
+    voice.zone = nullptr;
+    voice.note = -1;
+    voice.stream.store (nullptr);
+}
+
+void Sampler::startRelease (Voice& voice)
+{
+    voice.releasing = true;
+    voice.sustained = false;
+    voice.releaseStep = voice.zone->release > 0.0f
+        ? jmax (voice.level, 0.001f) / (voice.zone->release * (float) sampleRate)
+        : 1.0f;
+}
+
+void Sampler::steal (Voice& voice)
+{
+    // fades from wherever the envelope is, release or not
+    voice.releasing = true;
+    voice.sustained = false;
+    voice.stolen    = true;
+    voice.note      = -1;
+    voice.releaseStep = jmax (voice.level, 0.001f) / (stealFadeSeconds * (float) sampleRate);
+}
+
+Sampler::Voice* Sampler::findVoice()
+{
+    Voice* idle = nullptr;
+    Voice* oldest = nullptr;
+    Voice* quietest = nullptr;
+    int numPlaying = 0;
+
+    for (auto* v : voices)
+    {
+        if (! v->active)
+        {
+            if (idle == nullptr)
+                idle = v;
+            continue;
+        }
+
+        if (v->stolen)
+        {
+            if (quietest == nullptr || v->level < quietest->level)
+                quietest = v;
+            continue;
+        }
+
+        ++numPlaying;
+        if (oldest == nullptr || v->age < oldest->age)
+            oldest = v;
+    }
+
+    if (numPlaying >= maxVoices && oldest != nullptr)
+        steal (*oldest);
+
+    if (idle != nullptr)
+        return idle;
+
+    // every spare voice is still fading, cut the one closest to silence
+    if (quietest != nullptr)
+        return quietest;
+    return oldest;
+}
+
+void Sampler::allNotesOff()
+{
+    for (auto* voice : voices)
+        stopVoice (*voice);
+    sustain = false;
+    numActive.set (0);
+}
+
+void Sampler::noteOn (int note, int velocity)
+{
+    auto* zone = active != nullptr ? active->findZone (note, velocity) : nullptr;
+    if (zone == nullptr || voices.isEmpty())
+        return;
+
+    auto* const voice = findVoice();
+    if (voice == nullptr)
+        return;
+
+    auto& v = *voice;
+    v.zone      = zone;
+    v.active    = true;
+    v.releasing = false;
+    v.sustained = false;
+    v.stolen    = false;
+    v.note      = note;
+    v.age       = ++voiceCounter;
+    v.position  = 0.0;
+    v.ratio     = jmin (maxPitchRatio, (zone->sampleRate / sampleRate)
+                    * std::pow (2.0, ((double) (note - zone->rootKey) + zone->tune) / 12.0));
+
+    const float scale = (float) velocity / 127.0f;
+    v.gain       = zone->gain * scale * scale;
+    v.level      = zone->attack > 0.0f ? 0.0f : 1.0f;
+    v.attackStep = zone->attack > 0.0f ? 1.0f / (zone->attack * (float) sampleRate) : 1.0f;
+
+    if (zone->isFullyLoaded())
+    {
+        v.stream.store (nullptr);
+    }
+    else
+    {
+        v.consumed.store (0);
+        v.stream.store (zone);
+        v.request.fetch_add (1);
+    }
+}
+
+void Sampler::noteOff (int note)
+{
+    for (auto* voice : voices)
+    {
+        if (! voice->active || voice->releasing || voice->note != note)
+            continue;
+        if (sustain)
+            voice->sustained = true;
+        else
+            startRelease (*voice);
+    }
+}
+
+//=============================================================================
+
+void Sampler::render (AudioBuffer<float>& output, const MidiBuffer& midi)
+{
+    adoptPendingMap();
+    if (voices.isEmpty())
+        return;
+
+    const int numSamples = output.getNumSamples();
+    MidiBuffer::Iterator iter (midi);
+    MidiMessage msg;
+    int frame = 0, position = 0;
+
+    while (iter.getNextEvent (msg, frame))
+    {
+        frame = jlimit (0, numSamples, frame);
+        if (frame > position)
+            renderVoices (output, position, frame - position);
+        position = jmax (position, frame);
+
+        if (msg.isNoteOn())
+        {
+            noteOn (msg.getNoteNumber(), msg.getVelocity());
+        }
+        else if (msg.isNoteOff())
+        {
+            noteOff (msg.getNoteNumber());
+        }
+        else if (msg.isSustainPedalOn())
+        {
+            sustain = true;
+        }
+        else if (msg.isSustainPedalOff())
+        {
+            sustain = false;
+            for (auto* voice : voices)
+                if (voice->active && voice->sustained)
+                    startRelease (*voice);
+        }
+        else if (msg.isAllNotesOff())
+        {
+            sustain = false;
+            for (auto* voice : voices)
+                if (voice->active && ! voice->releasing)
+                    startRelease (*voice);
+        }
+        else if (msg.isAllSoundOff())
+        {
+            allNotesOff();
+        }
+    }
+
+    if (numSamples > position)
+        renderVoices (output, position, numSamples - position);
+
+    int count = 0;
+    for (auto* voice : voices)
+        if (voice->active)
+            ++count;
+    numActive.set (count);
+}
+
+void Sampler::renderVoices (AudioBuffer<float>& output, int start, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        const int count = jmin (numSamples, blockSize);
+        for (auto* voice : voices)
+            if (voice->active)
+                renderVoice (*voice, output, start, count);
+        start += count;
+        numSamples -= count;
+    }
+}
+
+void Sampler::fillScratch (Voice& voice, int64 first, int numFrames)
+{
+    const auto& zone = *voice.zone;
+    const int headFrames = zone.getHeadFrames();
+
+    // frames streamed for this voice's current request
+    int64 streamed = headFrames;
+    if (voice.stream.load() == &zone && voice.served.load() == voice.request.load())
+        streamed = jmin (zone.length, jmax ((int64) headFrames, voice.written.load()));
+
+    const int lead    = (int) jlimit ((int64) 0, (int64) numFrames, -first);
+    const int headEnd = (int) jlimit ((int64) lead, (int64) numFrames, (int64) headFrames - first);
+    const int ringEnd = (int) jlimit ((int64) headEnd, (int64) numFrames, streamed - first);
+    const int dataEnd = (int) jlimit ((int64) ringEnd, (int64) numFrames, zone.length - first);
+
+    if (dataEnd > ringEnd)
+        underruns += 1;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        auto* dst = scratch.getWritePointer (ch);
+        if (lead > 0)
+            FloatVectorOperations::clear (dst, lead);
+        if (headEnd > lead)
+            FloatVectorOperations::copy (dst + lead,
+                zone.head.getReadPointer (jmin (ch, zone.head.getNumChannels() - 1), (int) (first + lead)),
+                headEnd - lead);
+
+        const auto* ring = voice.ring.getReadPointer (ch);
+        for (int i = headEnd; i < ringEnd;)
+        {
+            const int slot = (int) ((first + i) & (ringFrames - 1));
+            const int count = jmin (ringEnd - i, ringFrames - slot);
+            FloatVectorOperations::copy (dst + i, ring + slot, count);
+            i += count;
+        }
+
+        if (numFrames > ringEnd)
+            FloatVectorOperations::clear (dst + ringEnd, numFrames - ringEnd);
+    }
+}
+
+/** 4 point, 3rd order Hermite. src[(int) position] must be preceded by one
+    frame and followed by two */
+static void interpolate (const float* src, double position, double ratio, float* dst, int numSamples)
+{
+    if (ratio == 1.0 && position == std::floor (position))
+    {
+        FloatVectorOperations::copy (dst, src + (int) position, numSamples);
+        return;
+    }
+
+    alignas (32) float xm1 [laneSize], x0 [laneSize], x1 [laneSize], x2 [laneSize], frac [laneSize], y [laneSize];
+    const auto half = Vec::expand (0.5f), oneAndHalf = Vec::expand (1.5f),
+               two = Vec::expand (2.0f), twoAndHalf = Vec::expand (2.5f);
+
+    int i = 0;
+    for (; i + laneSize <= numSamples; i += laneSize)
+    {
+        for (int lane = 0; lane < laneSize; ++lane)
+        {
+            const double p = position + (double) (i + lane) * ratio;
+            const int index = (int) p;
+            const float* s = src + index;
+            frac[lane] = (float) (p - (double) index);
+            xm1[lane] = s[-1]; x0[lane] = s[0]; x1[lane] = s[1]; x2[lane] = s[2];
+        }
+
+        const auto vm1 = Vec::fromRawArray (xm1), v0 = Vec::fromRawArray (x0),
+                   v1  = Vec::fromRawArray (x1),  v2 = Vec::fromRawArray (x2),
+                   f   = Vec::fromRawArray (frac);
+
+        const auto c1 = (v1 - vm1) * half;
+        const auto c2 = vm1 - v0 * twoAndHalf + v1 * two - v2 * half;
+        const auto c3 = (v2 - vm1) * half + (v0 - v1) * oneAndHalf;
+        (((c3 * f + c2) * f + c1) * f + v0).copyToRawArray (y);
+
+        for (int lane = 0; lane < laneSize; ++lane)
+            dst[i + lane] = y[lane];
+    }
+
+    for (; i < numSamples; ++i)
+    {
+        const double p = position + (double) i * ratio;
+        const int index = (int) p;
+        const float* s = src + index;
+        const float f = (float) (p - (double) index);
+        const float c1 = 0.5f * (s[1] - s[-1]);
+        const float c2 = s[-1] - 2.5f * s[0] + 2.0f * s[1] - 0.5f * s[2];
+        const float c3 = 0.5f * (s[2] - s[-1]) + 1.5f * (s[0] - s[1]);
+        dst[i] = ((c3 * f + c2) * f + c1) * f + s[0];
+    }
+}
+
+void Sampler::renderVoice (Voice& voice, AudioBuffer<float>& output, int start, int numSamples)
+{
+    const auto& zone = *voice.zone;
+
+    // envelope first, a finished release cuts the block short
+    auto* gains = voiceBuffer.getWritePointer (2);
+    int length = numSamples;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (voice.releasing)
+        {
+            voice.level -= voice.releaseStep;
+            if (voice.level <= 0.0f)
+            {
+                length = i;
+                break;
+            }
+        }
+        else if (voice.level < 1.0f)
+        {
+            voice.level = jmin (1.0f, voice.level + voice.attackStep);
+        }
+
+        gains[i] = voice.level * voice.gain;
+    }
+
+    // one frame before the first output and two after the last
+    const int64 first = (int64) std::floor (voice.position) - 1;
+    const double last = voice.position + voice.ratio * (double) jmax (0, length - 1);
+    const int numFrames = (int) ((int64) std::floor (last) + 3 - first);
+
+    if (length > 0)
+    {
+        fillScratch (voice, first, numFrames);
+        const double offset = voice.position - (double) first;
+        for (int ch = 0; ch < jmin (2, output.getNumChannels()); ++ch)
+        {
+            auto* temp = voiceBuffer.getWritePointer (ch);
+            interpolate (scratch.getReadPointer (ch), offset, voice.ratio, temp, length);
+            FloatVectorOperations::addWithMultiply (output.getWritePointer (ch, start), temp, gains, length);
+        }
+    }
+
+    voice.position += voice.ratio * (double) length;
+    if (length < numSamples || voice.position >= (double) zone.length)
+    {
+        stopVoice (voice);
+        return;
+    }
+
+    voice.consumed.store (jmax ((int64) 0, (int64) std::floor (voice.position) - 1));
+}
+
+//=============================================================================
+
+bool Sampler::serviceStreams()
+{
+    ScopedLock sl (streamLock);
+    bool worked = false;
+    for (auto* voice : voices)
+        worked |= streamVoice (*voice);
+    return worked;
+}
+
+bool Sampler::streamVoice (Voice& voice)
+{
+    const int request = voice.request.load();
+    auto* const zone = voice.stream.load();
+    if (zone == nullptr || zone->reader == nullptr)
+        return false;
+
+    if (voice.served.load() != request)
+    {
+        voice.written.store (zone->getHeadFrames());
+        voice.served.store (request);
+    }
+
+    const int64 written = voice.written.load();
+    const int64 limit = jmin (zone->length, voice.consumed.load() + (int64) ringFrames);
+    if (written >= limit)
+        return false;
+
+    const int numFrames = (int) jmin ((int64) chunkFrames, limit - written);
+    zone->reader->read (&chunk, 0, numFrames, written, true, true);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const auto* src = chunk.getReadPointer (ch);
+        auto* ring = voice.ring.getWritePointer (ch);
+        for (int i = 0; i < numFrames;)
+        {
+            const int slot = (int) ((written + i) & (ringFrames - 1));
+            const int count = jmin (numFrames - i, ringFrames - slot);
+            FloatVectorOperations::copy (ring + slot, src + i, count);
+            i += count;
+        }
+    }
+
+    // the renderer may have restarted the voice while reading
+    if (voice.request.load() == request)
+        voice.written.store (written + numFrames);
+    return true;
+}
+
+}
@@ -0,0 +1,217 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** One sample mapped to a key and velocity range */
+struct SampleZone
+{
+    File file;
+    int loKey = 0, hiKey = 127;
+    int loVel = 1, hiVel = 127;
+    int rootKey = 60;
+    float tune = 0.0f;          // semitones
+    float gain = 1.0f;
+    float attack = 0.0f;        // seconds
+    float release = 0.01f;      // seconds
+
+    double sampleRate = 44100.0;
+    int64 length = 0;
+
+    /** The first frames of the sample, always in memory */
+    AudioBuffer<float> head;
+
+    /** Reads the rest. Only used by the streaming thread */
+    std::unique_ptr<AudioFormatReader> reader;
+
+    int getHeadFrames() const noexcept      { return head.getNumSamples(); }
+    bool isFullyLoaded() const noexcept     { return (int64) head.getNumSamples() >= length; }
+
+    bool matches (int note, int velocity) const noexcept
+    {
+        return note >= loKey && note <= hiKey && velocity >= loVel && velocity <= hiVel;
+    }
+};
+
+/** A set of zones loaded from an SFZ file or a single sample */
+class SampleMap
+{
+public:
+    /** Frames preloaded from each sample by default */
+    static constexpr int defaultHeadFrames = 32768;
+
+    SampleMap() { }
+
+    /** Loads the regions of an SFZ file. Supports <control>, <global>,
+        <group> and <region> headers with sample, default_path, key, lokey,
+        hikey, pitch_keycenter, lovel, hivel, volume, tune, transpose,
+        ampeg_attack and ampeg_release */
+    static SampleMap* fromSFZ (const File& file, AudioFormatManager& formats,
+                               String& error, int headFrames = defaultHeadFrames);
+
+    /** Same as fromSFZ but reads from text. Samples are found relative
+        to baseDirectory */
+    static SampleMap* fromSFZText (const String& text, const File& baseDirectory,
+                                   AudioFormatManager& formats, String& error,
+                                   int headFrames = defaultHeadFrames);
+
+    /** Maps one sample across the keyboard with its root on middle C */
+    static SampleMap* fromSample (const File& file, AudioFormatManager& formats,
+                                  String& error, int headFrames = defaultHeadFrames);
+
+    /** Returns the file this was loaded from */
+    const File& getFile() const noexcept        { return file; }
+
+    int getNumZones() const noexcept            { return zones.size(); }
+    SampleZone* getZone (int index) const       { return zones [index]; }
+
+    /** Returns the first zone for a note and velocity, or nullptr */
+    SampleZone* findZone (int note, int velocity) const noexcept;
+
+    /** Returns bytes held by preloaded heads */
+    size_t getHeadMemory() const;
+
+private:
+    friend class Sampler;
+    File file;
+    OwnedArray<SampleZone> zones;
+    int serial = 0;
+
+    bool addZone (SampleZone* zone, AudioFormatManager& formats, int headFrames, String& error);
+};
+
+/** A polyphonic sample player.
+
+    Voices play the preloaded head of a zone straight away. The rest is
+    streamed from disk into a ring buffer per voice by serviceStreams(),
+    which should be called regularly from a background thread. Voices,
+    rings and scratch space are allocated in prepare(), so nothing is
+    allocated while rendering.
+
+    When every voice is in use the oldest note is stolen. It fades out
+    over a few milliseconds on a spare voice while the new note starts.
+
+    Samples are resampled with 4 point Hermite interpolation, four output
+    frames at a time in SIMD registers.
+ */
+class Sampler
+{
+public:
+    /** Notes that can sound at once */
+    static constexpr int maxVoices = 32;
+
+    /** Extra voices which fade out stolen notes, so stealing doesn't click */
+    static constexpr int stealVoices = 8;
+
+    /** Length of the fade on a stolen voice */
+    static constexpr float stealFadeSeconds = 0.005f;
+
+    /** Frames of streamed audio buffered per voice. A power of two */
+    static constexpr int ringFrames = 32768;
+
+    /** Frames read from disk at a time */
+    static constexpr int chunkFrames = 4096;
+
+    /** Highest playback rate relative to the output */
+    static constexpr double maxPitchRatio = 16.0;
+
+    Sampler();
+    ~Sampler();
+
+    /** Allocates voices and buffers. Not realtime safe */
+    void prepare (double sampleRate, int maxBlockSize);
+
+    /** Frees voices and buffers. Not realtime safe */
+    void release();
+
+    /** Hands over a new sample map. The sampler takes ownership and switches
+        to it at the start of the next render. Don't call from the render
+        thread */
+    void setSampleMap (SampleMap* newMap);
+
+    /** Renders voices for the MIDI in a block and adds them to the output */
+    void render (AudioBuffer<float>& output, const MidiBuffer& midi);
+
+    /** Stops every voice now */
+    void allNotesOff();
+
+    /** Streams disk audio for the voices that need it. Returns true if
+        there was anything to read. Call from one background thread */
+    bool serviceStreams();
+
+    /** Deletes sample maps the renderer no longer uses. Call from the same
+        thread as serviceStreams() */
+    void collectGarbage();
+
+    /** Returns the number of voices sounding. Safe from any thread */
+    int getNumActiveVoices() const noexcept     { return numActive.get(); }
+
+    /** Returns how many times a voice ran out of streamed audio */
+    int getNumUnderruns() const noexcept        { return underruns.get(); }
+
+    /** Returns bytes used by voices, scratch space and loaded heads */
+    size_t getMemoryUsage() const;
+
+private:
+    struct Voice;
+    OwnedArray<Voice> voices;
+    AudioBuffer<float> scratch;     // contiguous source frames for one voice
+    AudioBuffer<float> chunk;       // disk reads, streaming thread only
+    AudioBuffer<float> voiceBuffer; // interpolated frames and envelope
+    double sampleRate = 44100.0;
+    int blockSize = 0;
+    uint32 voiceCounter = 0;
+    bool sustain = false;
+
+    // held while streaming so prepare() and release() can't free voices
+    // under the disk thread
+    CriticalSection streamLock;
+
+    // maps are freed by collectGarbage(). the renderer takes `pending`, and
+    // maps older than `activeSerial` are no longer used
+    CriticalSection mapLock;
+    OwnedArray<SampleMap> maps;
+    std::atomic<SampleMap*> pending { nullptr };
+    std::atomic<int> activeSerial { 0 };
+    SampleMap* active = nullptr;
+    int nextSerial = 1;
+
+    Atomic<int> numActive { 0 };
+    Atomic<int> underruns { 0 };
+
+    void adoptPendingMap();
+    void stopVoice (Voice&);
+    void startRelease (Voice&);
+    void steal (Voice&);
+    Voice* findVoice();
+    void noteOn (int note, int velocity);
+    void noteOff (int note);
+    void renderVoices (AudioBuffer<float>& output, int start, int numSamples);
+    void renderVoice (Voice&, AudioBuffer<float>& output, int start, int numSamples);
+    void fillScratch (Voice&, int64 firstFrame, int numFrames);
+    bool streamVoice (Voice&);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Sampler)
+};
+
+}
@@ -0,0 +1,453 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/TransportSync.h"
+
+namespace Element {
+
+/** Site local group, packets don't leave the host's link */
+static const char* multicastGroup = "239.255.69.76";
+
+static const int packetMagic   = 0x53544c45;   // "ELTS"
+static const int packetVersion = 1;
+
+enum PacketType
+{
+    statePacket = 1,
+    pingPacket,
+    pongPacket
+};
+
+/** Header plus two stamps, a timeline and a start/stop */
+static const int statePacketSize        = 18 + 81;
+
+static const double broadcastIntervalMs = 200.0;
+static const double pingIntervalMs      = 100.0;
+static const double peerTimeoutMs       = 1500.0;
+
+/** A new peer waits this long for a session before founding one */
+static const double joinTimeoutMs       = 1000.0;
+
+//=============================================================================
+
+void ClockOffsetEstimator::addSample (double t1, double t2, double t3, double t4) noexcept
+{
+    auto& sample = samples [next];
+    sample.roundTrip = jmax (0.0, (t4 - t1) - (t3 - t2));
+    sample.offset    = ((t2 - t1) + (t3 - t4)) * 0.5;
+    next = (next + 1) % maxSamples;
+    numSamples = jmin (numSamples + 1, (int) maxSamples);
+
+    int best = 0;
+    for (int i = 1; i < numSamples; ++i)
+        if (samples[i].roundTrip < samples[best].roundTrip)
+            best = i;
+    offset    = samples[best].offset;
+    roundTrip = samples[best].roundTrip;
+}
+
+void ClockOffsetEstimator::reset() noexcept
+{
+    numSamples = next = 0;
+    offset = roundTrip = 0.0;
+}
+
+//=============================================================================
+
+TransportSync::TransportSync (int p)
+    : Thread ("TransportSync"),
+      port (p),
+      peerId ((Random::getSystemRandom().nextInt64() & 0x7fffffffffffffff) | 1)
+{
+    publish();
+}
+
+TransportSync::~TransportSync()
+{
+    disable();
+}
+
+bool TransportSync::enable (double tempo)
+{
+    if (enabled.load())
+        return true;
+
+    std::unique_ptr<DatagramSocket> newSocket (new DatagramSocket (false));
+    newSocket->setEnablePortReuse (true);
+    if (! newSocket->bindToPort (port) || ! newSocket->joinMulticast (multicastGroup))
+        return false;
+    newSocket->setMulticastLoopbackEnabled (true);
+
+    {
+        ScopedLock sl (lock);
+        socket = std::move (newSocket);
+        localAddresses = IPAddress::getAllAddresses();
+        localAddresses.addIfNotAlreadyThere (IPAddress::local());
+        peers.clearQuick();
+        estimator.reset();
+        timeline = Timeline();
+        timeline.tempo = jlimit (20.0, 999.0, tempo);
+        startStop = StartStop();
+        timelineStamp = startStopStamp = Stamp();
+        leaderId = peerId;
+        offset = 0.0;
+        established = false;
+        enabledTime = Time::getMillisecondCounterHiRes();
+        heardSelf = false;
+        enabled = true;
+        publish();
+    }
+
+    startThread (7);
+    return true;
+}
+
+void TransportSync::disable()
+{
+    if (! enabled.load())
+        return;
+
+    enabled = false;
+    signalThreadShouldExit();
+    if (socket != nullptr)
+        socket->shutdown();
+    stopThread (1000);
+
+    ScopedLock sl (lock);
+    socket = nullptr;
+    peers.clearQuick();
+}
+
+int TransportSync::getNumPeers() const
+{
+    ScopedLock sl (lock);
+    return peers.size();
+}
+
+bool TransportSync::isLeader() const
+{
+    ScopedLock sl (lock);
+    return leaderId == peerId;
+}
+
+double TransportSync::getNow() const
+{
+    return Time::getMillisecondCounterHiRes() + offset;
+}
+
+//=============================================================================
+
+void TransportSync::publish()
+{
+    // the audio thread retries if it reads while this is odd
+    sequence.fetch_add (1, std::memory_order_acq_rel);
+    std::atomic_thread_fence (std::memory_order_release);
+    published.timeline  = timeline;
+    published.startStop = startStop;
+    published.offset    = offset;
+    std::atomic_thread_fence (std::memory_order_release);
+    sequence.fetch_add (1, std::memory_order_release);
+}
+
+bool TransportSync::getSnapshot (Snapshot& snapshot) const noexcept
+{
+    if (! enabled.load())
+        return false;
+
+    for (int attempt = 0; attempt < 8; ++attempt)
+    {
+        const uint32 before = sequence.load (std::memory_order_acquire);
+        if ((before & 1u) != 0)
+            continue;
+        snapshot = published;
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (sequence.load (std::memory_order_relaxed) == before)
+            return true;
+    }
+
+    return false;
+}
+
+double TransportSync::getSessionTime (double hostTimeMs) const noexcept
+{
+    Snapshot snapshot;
+    return getSnapshot (snapshot) ? hostTimeMs + snapshot.offset : hostTimeMs;
+}
+
+double TransportSync::getQuantizedStart (double beats, double quantum) noexcept
+{
+    if (quantum <= 0.0)
+        return beats;
+    return std::ceil (beats / quantum - 1.0e-9) * quantum;
+}
+
+void TransportSync::requestTempo (double bpm)
+{
+    bpm = jlimit (20.0, 999.0, bpm);
+    ScopedLock sl (lock);
+    if (timeline.tempo == bpm)
+        return;
+
+    const double now = getNow();
+    Timeline changed;
+    changed.tempo      = bpm;
+    changed.beatOrigin = timeline.getBeatsAt (now);
+    changed.timeOrigin = now;
+
+    // a pending start keeps its beat, so it moves with the new tempo
+    if (startStop.playing && startStop.time > now)
+        startStop.time = changed.getTimeAt (startStop.beats);
+
+    timeline = changed;
+    timelineStamp = { now, peerId };
+    publish();
+    sendState();
+}
+
+void TransportSync::requestPlaying (bool shouldPlay, double quantum)
+{
+    ScopedLock sl (lock);
+    if (startStop.playing == shouldPlay)
+        return;
+
+    const double now = getNow();
+    const double beats = timeline.getBeatsAt (now);
+    startStop.playing = shouldPlay;
+    startStop.beats   = shouldPlay ? getQuantizedStart (beats, quantum) : beats;
+    startStop.time    = shouldPlay ? timeline.getTimeAt (startStop.beats) : now;
+    startStopStamp = { now, peerId };
+    publish();
+    sendState();
+}
+
+//=============================================================================
+
+bool TransportSync::write (const MemoryOutputStream& packet)
+{
+    return socket != nullptr
+        && socket->write (multicastGroup, port, packet.getData(), (int) packet.getDataSize()) > 0;
+}
+
+static void writeHeader (MemoryOutputStream& out, PacketType type, int64 peer, bool established)
+{
+    out.writeInt (packetMagic);
+    out.writeInt (packetVersion);
+    out.writeByte ((char) type);
+    out.writeInt64 (peer);
+    out.writeBool (established);
+}
+
+void TransportSync::sendState()
+{
+    MemoryOutputStream out (128);
+    writeHeader (out, statePacket, peerId, established);
+    out.writeDouble (timelineStamp.time);
+    out.writeInt64  (timelineStamp.peer);
+    out.writeDouble (timeline.tempo);
+    out.writeDouble (timeline.beatOrigin);
+    out.writeDouble (timeline.timeOrigin);
+    out.writeDouble (startStopStamp.time);
+    out.writeInt64  (startStopStamp.peer);
+    out.writeBool   (startStop.playing);
+    out.writeDouble (startStop.beats);
+    out.writeDouble (startStop.time);
+    write (out);
+}
+
+void TransportSync::sendPing()
+{
+    MemoryOutputStream out (64);
+    writeHeader (out, pingPacket, peerId, established);
+    out.writeInt64  (leaderId);
+    out.writeDouble (Time::getMillisecondCounterHiRes());
+    write (out);
+}
+
+void TransportSync::handlePacket (const void* data, int size, double receivedMs)
+{
+    MemoryInputStream in (data, (size_t) size, false);
+    if (size < 18 || in.readInt() != packetMagic || in.readInt() != packetVersion)
+        return;
+
+    const auto type = (int) in.readByte();
+    const int64 sender = in.readInt64();
+    const bool senderEstablished = in.readBool();
+
+    if (sender == peerId)
+    {
+        heardSelf = true;
+        return;
+    }
+
+    ScopedLock sl (lock);
+
+    int index = 0;
+    for (; index < peers.size(); ++index)
+        if (peers.getReference(index).id == sender)
+            break;
+    if (index == peers.size())
+        peers.add ({ sender, receivedMs, senderEstablished });
+    auto& peer = peers.getReference (index);
+    peer.lastHeard = receivedMs;
+    peer.established = senderEstablished;
+
+    if (type == statePacket)
+    {
+        if (size < statePacketSize)
+            return;
+
+        Stamp stamp;
+        Timeline newTimeline;
+        stamp.time = in.readDouble();
+        stamp.peer = in.readInt64();
+        newTimeline.tempo      = in.readDouble();
+        newTimeline.beatOrigin = in.readDouble();
+        newTimeline.timeOrigin = in.readDouble();
+
+        Stamp newStartStopStamp;
+        StartStop newStartStop;
+        newStartStopStamp.time = in.readDouble();
+        newStartStopStamp.peer = in.readInt64();
+        newStartStop.playing   = in.readBool();
+        newStartStop.beats     = in.readDouble();
+        newStartStop.time      = in.readDouble();
+
+        bool changed = false;
+        if (senderEstablished && newTimeline.tempo > 0.0 && stamp > timelineStamp)
+        {
+            timeline = newTimeline;
+            timelineStamp = stamp;
+            changed = true;
+        }
+
+        if (senderEstablished && newStartStopStamp > startStopStamp)
+        {
+            startStop = newStartStop;
+            startStopStamp = newStartStopStamp;
+            changed = true;
+        }
+
+        if (changed)
+            publish();
+    }
+    else if (type == pingPacket)
+    {
+        const int64 target = in.readInt64();
+        const double t1 = in.readDouble();
+        if (target != peerId)
+            return;
+
+        MemoryOutputStream out (64);
+        writeHeader (out, pongPacket, peerId, established);
+        out.writeInt64  (sender);
+        out.writeDouble (t1);
+        out.writeDouble (receivedMs + offset);
+        out.writeDouble (getNow());
+        write (out);
+    }
+    else if (type == pongPacket)
+    {
+        const int64 target = in.readInt64();
+        const double t1 = in.readDouble();
+        const double t2 = in.readDouble();
+        const double t3 = in.readDouble();
+        if (target != peerId || sender != leaderId)
+            return;
+
+        estimator.addSample (t1, t2, t3, receivedMs);
+        offset = estimator.getOffset();
+        established = true;
+        publish();
+    }
+}
+
+void TransportSync::updatePeers (double nowMs)
+{
+    for (int i = peers.size(); --i >= 0;)
+        if (nowMs - peers.getReference(i).lastHeard > peerTimeoutMs)
+            peers.remove (i);
+
+    int64 leader = established ? peerId : std::numeric_limits<int64>::max();
+    for (const auto& p : peers)
+        if (p.established && p.id < leader)
+            leader = p.id;
+
+    // alone, or everyone is new: found the session
+    if (! established && leader == std::numeric_limits<int64>::max())
+    {
+        if (nowMs - enabledTime < joinTimeoutMs)
+            return;
+        established = true;
+        leader = peerId;
+
+        // stamped now, so the latest of peers founding together wins
+        if (timelineStamp.peer == 0)
+        {
+            timelineStamp = { getNow(), peerId };
+            publish();
+        }
+    }
+
+    if (leader != leaderId)
+    {
+        // the offset is kept, so the session clock carries on
+        leaderId = leader;
+        estimator.reset();
+    }
+}
+
+void TransportSync::run()
+{
+    HeapBlock<char> buffer (2048);
+    double lastBroadcast = 0.0, lastPing = 0.0;
+
+    while (! threadShouldExit())
+    {
+        const int ready = socket->waitUntilReady (true, 20);
+        if (ready < 0)
+            break;
+
+        if (ready > 0)
+        {
+            String senderAddress;
+            int senderPort = 0;
+            const int size = socket->read (buffer, 2048, false, senderAddress, senderPort);
+            const double received = Time::getMillisecondCounterHiRes();
+            if (size > 0 && localAddresses.contains (IPAddress (senderAddress)))
+                handlePacket (buffer, size, received);
+        }
+
+        const double now = Time::getMillisecondCounterHiRes();
+        ScopedLock sl (lock);
+        if (now - lastBroadcast >= broadcastIntervalMs)
+        {
+            lastBroadcast = now;
+            updatePeers (now);
+            sendState();
+        }
+
+        if (leaderId != peerId && now - lastPing >= pingIntervalMs)
+        {
+            lastPing = now;
+            sendPing();
+        }
+    }
+}
+
+}
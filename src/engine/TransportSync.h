@@ -0,0 +1,204 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Estimates the offset between two clocks from ping round trips.
+
+    Each sample is the four NTP style times of a ping and its reply. The
+    sample with the shortest round trip among the recent ones is trusted,
+    since it had the least room for asymmetric delay.
+ */
+class ClockOffsetEstimator
+{
+public:
+    ClockOffsetEstimator() = default;
+
+    /** Adds a round trip. t1 and t4 are local send and receive times, t2
+        and t3 the remote receive and send times */
+    void addSample (double t1, double t2, double t3, double t4) noexcept;
+
+    /** Returns remote minus local time, or 0 if nothing was measured */
+    double getOffset() const noexcept       { return offset; }
+
+    /** Returns the round trip of the sample used */
+    double getRoundTrip() const noexcept    { return roundTrip; }
+
+    int getNumSamples() const noexcept      { return numSamples; }
+
+    void reset() noexcept;
+
+private:
+    enum { maxSamples = 8 };
+    struct Sample { double offset, roundTrip; };
+    Sample samples [maxSamples];
+    int numSamples = 0, next = 0;
+    double offset = 0.0, roundTrip = 0.0;
+};
+
+//=============================================================================
+
+/** Shares tempo, beat phase and play state between Element instances on
+    one machine.
+
+    Peers find each other with UDP multicast that loops back to the same
+    host, and packets from other hosts are ignored. The peer with the
+    lowest id keeps the session clock. The others measure their offset to
+    it with pings, so every peer places timeline events at the same
+    moment. Tempo and start/stop changes from any peer are stamped with
+    session time, and the latest change wins.
+
+    Starts wait for the next multiple of a quantum of beats on the shared
+    timeline, so peers starting at different moments still land on the
+    same bar. Reads for the audio thread don't lock.
+ */
+class TransportSync : private Thread
+{
+public:
+    /** Beats as a line through session time */
+    struct Timeline
+    {
+        double tempo = 120.0;
+        double beatOrigin = 0.0;
+        double timeOrigin = 0.0;            // session ms
+
+        double getBeatsAt (double timeMs) const noexcept
+        {
+            return beatOrigin + (timeMs - timeOrigin) * tempo / 60000.0;
+        }
+
+        double getTimeAt (double beats) const noexcept
+        {
+            return timeOrigin + (beats - beatOrigin) * 60000.0 / tempo;
+        }
+    };
+
+    /** When the play state last changed */
+    struct StartStop
+    {
+        bool playing = false;
+        double beats = 0.0;                 // timeline beat of the change
+        double time = 0.0;                  // session ms of the change
+    };
+
+    /** What the audio thread reads */
+    struct Snapshot
+    {
+        Timeline timeline;
+        StartStop startStop;
+        double offset = 0.0;                // add to host time for session time
+    };
+
+    enum { defaultPort = 20870 };
+
+    explicit TransportSync (int port = defaultPort);
+    ~TransportSync();
+
+    /** Joins the session. The tempo is used if this peer founds the
+        session, an existing one overrides it. Returns false if the socket
+        couldn't be opened */
+    bool enable (double tempo = 120.0);
+
+    /** Leaves the session */
+    void disable();
+
+    bool isEnabled() const noexcept         { return enabled.load(); }
+
+    /** Returns the number of other peers heard recently */
+    int getNumPeers() const;
+
+    /** Returns true if this peer keeps the session clock */
+    bool isLeader() const;
+
+    /** Returns true once this peer has heard its own packets, which shows
+        multicast loops back on this machine */
+    bool hasLoopback() const noexcept       { return heardSelf.load(); }
+
+    /** Returns the current state. Returns false if disabled. Realtime safe */
+    bool getSnapshot (Snapshot& snapshot) const noexcept;
+
+    /** Returns session time for a Time::getMillisecondCounterHiRes() time */
+    double getSessionTime (double hostTimeMs) const noexcept;
+
+    /** Changes the session tempo, keeping the current beat */
+    void requestTempo (double bpm);
+
+    /** Starts at the next multiple of quantum beats, or stops now */
+    void requestPlaying (bool shouldPlay, double quantum);
+
+    /** Returns the beat a start requested at a beat would begin on */
+    static double getQuantizedStart (double beats, double quantum) noexcept;
+
+private:
+    struct Stamp
+    {
+        double time = 0.0;
+        int64 peer = 0;
+        bool operator> (const Stamp& o) const noexcept
+        {
+            return time > o.time || (time == o.time && peer > o.peer);
+        }
+    };
+
+    struct Peer
+    {
+        int64 id;
+        double lastHeard;
+        bool established;
+    };
+
+    const int port;
+    const int64 peerId;
+    std::unique_ptr<DatagramSocket> socket;
+    std::atomic<bool> enabled { false }, heardSelf { false };
+
+    // network thread and requests
+    CriticalSection lock;
+    Array<Peer> peers;
+    Timeline timeline;
+    StartStop startStop;
+    Stamp timelineStamp, startStopStamp;
+    ClockOffsetEstimator estimator;
+    int64 leaderId = 0;
+    double offset = 0.0;
+    bool established = false;
+    double enabledTime = 0.0;
+    Array<IPAddress> localAddresses;
+
+    // published to the audio thread
+    std::atomic<uint32> sequence { 0 };
+    Snapshot published;
+
+    void run() override;
+    void publish();
+    void handlePacket (const void* data, int size, double receivedMs);
+    void sendState();
+    void sendPing();
+    void updatePeers (double nowMs);
+    double getNow() const;
+    bool write (const MemoryOutputStream& packet);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransportSync)
+};
+
+}
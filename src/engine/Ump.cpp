@@ -0,0 +1,415 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/Ump.h"
+
+namespace Element {
+namespace Ump {
+
+/** Sysex7 packet statuses */
+enum SysexStatus
+{
+    sysexComplete = 0x0,
+    sysexStart,
+    sysexContinue,
+    sysexEnd
+};
+
+/** Note off velocity for a MIDI 1.0 note on with velocity 0 */
+static const uint32 defaultReleaseVelocity = 0x8000;
+
+uint32 scaleUp (const uint32 value, const int srcBits, const int dstBits) noexcept
+{
+    const int scaleBits = dstBits - srcBits;
+    uint32 result = value << scaleBits;
+    if (value <= ((uint32) 1 << (srcBits - 1)))
+        return result;
+
+    // above the center the lower bits are repeated to reach the maximum
+    const int repeatBits = srcBits - 1;
+    uint32 repeat = value & (((uint32) 1 << repeatBits) - 1);
+    repeat = scaleBits > repeatBits ? repeat << (scaleBits - repeatBits)
+                                    : repeat >> (repeatBits - scaleBits);
+    while (repeat != 0)
+    {
+        result |= repeat;
+        repeat >>= repeatBits;
+    }
+
+    return result;
+}
+
+static int getMidi1Length (const uint8 status) noexcept
+{
+    if (status < 0xf0)
+        return (status & 0xe0) == 0xc0 ? 2 : 3;
+    if (status == 0xf1 || status == 0xf3)
+        return 2;
+    return status == 0xf2 ? 3 : 1;
+}
+
+int fromMidi1 (const uint8* data, const int size, uint32* words, const int group) noexcept
+{
+    if (size <= 0 || data[0] < 0x80 || data[0] == 0xf0 || data[0] == 0xf7)
+        return 0;
+
+    const uint32 status = data[0];
+    const uint32 d1 = size > 1 ? (data[1] & 0x7f) : 0;
+    const uint32 d2 = size > 2 ? (data[2] & 0x7f) : 0;
+    const uint32 prefix = (uint32) (group & 0xf) << 24;
+
+    if (status >= 0xf0)
+    {
+        words[0] = ((uint32) system << 28) | prefix | (status << 16) | (d1 << 8) | d2;
+        return 1;
+    }
+
+    uint32 type = status >> 4;
+    uint32 index = 0;
+    uint32 value = 0;
+
+    switch (type)
+    {
+        case noteOn:
+            if (d2 == 0)
+            {
+                type = noteOff;
+                index = d1;
+                value = defaultReleaseVelocity << 16;
+                break;
+            }
+            // fall through
+        case noteOff:
+            index = d1;
+            value = scaleUp (d2, 7, 16) << 16;
+            break;
+        case polyPressure:
+        case controlChange:
+            index = d1;
+            value = scaleUp (d2, 7, 32);
+            break;
+        case programChange:
+            value = d1 << 24;
+            break;
+        case channelPressure:
+            value = scaleUp (d1, 7, 32);
+            break;
+        case pitchBend:
+            value = scaleUp (d1 | (d2 << 7), 14, 32);
+            break;
+        default:
+            return 0;
+    }
+
+    words[0] = ((uint32) midi2Voice << 28) | prefix | (type << 20) | ((status & 0xf) << 16) | (index << 8);
+    words[1] = value;
+    return 2;
+}
+
+int toMidi1 (const uint32* words, uint8* data) noexcept
+{
+    const uint32 word = words[0];
+    const int type = getMessageType (word);
+
+    if (type == system || type == midi1Voice)
+    {
+        data[0] = (uint8) (word >> 16);
+        data[1] = (uint8) ((word >> 8) & 0x7f);
+        data[2] = (uint8) (word & 0x7f);
+        return getMidi1Length (data[0]);
+    }
+
+    if (type != midi2Voice)
+        return 0;
+
+    const int status = getStatus (word);
+    data[0] = (uint8) ((status << 4) | ((word >> 16) & 0xf));
+    data[1] = (uint8) ((word >> 8) & 0x7f);
+
+    switch (status)
+    {
+        case noteOff:
+        case noteOn:
+            data[2] = (uint8) scaleDown (words[1] >> 16, 16, 7);
+            if (status == noteOn && data[2] == 0)
+                data[2] = 1;
+            return 3;
+        case polyPressure:
+        case controlChange:
+            data[2] = (uint8) scaleDown (words[1], 32, 7);
+            return 3;
+        case programChange:
+            data[1] = (uint8) ((words[1] >> 24) & 0x7f);
+            return 2;
+        case channelPressure:
+            data[1] = (uint8) scaleDown (words[1], 32, 7);
+            return 2;
+        case pitchBend:
+        {
+            const uint32 value = scaleDown (words[1], 32, 14);
+            data[1] = (uint8) (value & 0x7f);
+            data[2] = (uint8) (value >> 7);
+            return 3;
+        }
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+}
+
+//=============================================================================
+
+UmpBuffer::UmpBuffer (const UmpBuffer& other)
+{
+    *this = other;
+}
+
+UmpBuffer& UmpBuffer::operator= (const UmpBuffer& other)
+{
+    if (this != &other)
+    {
+        clear();
+        ensureSize (other.numUsed);
+        if (other.numUsed > 0)
+            memcpy (data.get(), other.data.get(), sizeof (uint32) * (size_t) other.numUsed);
+        numUsed   = other.numUsed;
+        numEvents = other.numEvents;
+        lastFrame = other.lastFrame;
+    }
+
+    return *this;
+}
+
+void UmpBuffer::ensureSize (const int numWords)
+{
+    if (sysex.getSize() < 256)
+        sysex.setSize (256);
+    if (numWords <= numAllocated)
+        return;
+    numAllocated = jmax (numWords, 64, numAllocated * 2);
+    data.realloc ((size_t) numAllocated);
+}
+
+uint32* UmpBuffer::insertAt (const int frame, const int numWords)
+{
+    ensureSize (numUsed + 1 + numWords);
+    uint32* const end = data.get() + numUsed;
+    uint32* pos = end;
+
+    if (numEvents > 0 && frame < lastFrame)
+    {
+        // after any events at the same frame, like MidiBuffer
+        pos = data.get();
+        while ((int) pos[0] <= frame)
+            pos += 1 + Ump::getNumWords (pos[1]);
+        memmove (pos + 1 + numWords, pos, sizeof (uint32) * (size_t) (end - pos));
+    }
+    else
+    {
+        lastFrame = frame;
+    }
+
+    pos[0] = (uint32) frame;
+    numUsed += 1 + numWords;
+    ++numEvents;
+    return pos + 1;
+}
+
+void UmpBuffer::addPacket (const uint32* words, const int frame)
+{
+    const int numWords = Ump::getNumWords (words[0]);
+    memcpy (insertAt (frame, numWords), words, sizeof (uint32) * (size_t) numWords);
+}
+
+void UmpBuffer::addMidi1 (const uint8* bytes, const int size, const int frame, const int group)
+{
+    if (size <= 0)
+        return;
+
+    if (bytes[0] != 0xf0)
+    {
+        uint32 words[2];
+        if (Ump::fromMidi1 (bytes, size, words, group) > 0)
+            addPacket (words, frame);
+        return;
+    }
+
+    int length = size - 1;
+    if (length > 0 && bytes[size - 1] == 0xf7)
+        --length;
+    const uint8* payload = bytes + 1;
+
+    for (int offset = 0; offset < length || offset == 0; offset += 6)
+    {
+        const int count = jmin (6, length - offset);
+        const bool first = offset == 0, last = offset + count >= length;
+        const int status = first && last ? Ump::sysexComplete
+                         : first          ? Ump::sysexStart
+                         : last           ? Ump::sysexEnd
+                                          : Ump::sysexContinue;
+
+        uint8 chunk[6] = { 0 };
+        for (int i = 0; i < count; ++i)
+            chunk[i] = payload[offset + i] & 0x7f;
+
+        uint32 words[2];
+        words[0] = ((uint32) Ump::sysex7 << 28) | ((uint32) (group & 0xf) << 24)
+                 | ((uint32) status << 20) | ((uint32) count << 16)
+                 | ((uint32) chunk[0] << 8) | chunk[1];
+        words[1] = ((uint32) chunk[2] << 24) | ((uint32) chunk[3] << 16)
+                 | ((uint32) chunk[4] << 8) | chunk[5];
+        addPacket (words, frame);
+    }
+}
+
+void UmpBuffer::clear (const int startFrame, const int numFrames)
+{
+    uint32* write = data.get();
+    int kept = 0;
+    lastFrame = 0;
+
+    for (uint32* read = data.get(), * const end = read + numUsed; read < end;)
+    {
+        const int frame = (int) read[0];
+        const int numWords = 1 + Ump::getNumWords (read[1]);
+        if (frame < startFrame || frame >= startFrame + numFrames)
+        {
+            if (write != read)
+                memmove (write, read, sizeof (uint32) * (size_t) numWords);
+            write += numWords;
+            lastFrame = frame;
+            ++kept;
+        }
+        read += numWords;
+    }
+
+    numUsed = (int) (write - data.get());
+    numEvents = kept;
+}
+
+void UmpBuffer::addEvents (const UmpBuffer& other, const int startFrame, const int numFrames, const int frameOffset)
+{
+    Iterator iter (other);
+    const uint32* words = nullptr;
+    int numWords = 0, frame = 0;
+    while (iter.getNextEvent (words, numWords, frame))
+        if (frame >= startFrame && (numFrames < 0 || frame < startFrame + numFrames))
+            memcpy (insertAt (frame + frameOffset, numWords), words, sizeof (uint32) * (size_t) numWords);
+}
+
+void UmpBuffer::swapWith (UmpBuffer& other) noexcept
+{
+    data.swapWith (other.data);
+    std::swap (numAllocated, other.numAllocated);
+    std::swap (numUsed, other.numUsed);
+    std::swap (numEvents, other.numEvents);
+    std::swap (lastFrame, other.lastFrame);
+}
+
+void UmpBuffer::addFromMidiBuffer (const MidiBuffer& midi, const int group)
+{
+    MidiBuffer::Iterator iter (midi);
+    const uint8* bytes = nullptr;
+    int size = 0, frame = 0;
+    while (iter.getNextEvent (bytes, size, frame))
+        addMidi1 (bytes, size, frame, group);
+}
+
+void UmpBuffer::addToMidiBuffer (MidiBuffer& midi) const
+{
+    Iterator iter (*this);
+    const uint32* words = nullptr;
+    int numWords = 0, frame = 0;
+    size_t sysexSize = 0;
+
+    while (iter.getNextEvent (words, numWords, frame))
+    {
+        const uint32 word = words[0];
+        const int type = Ump::getMessageType (word);
+
+        if (type == Ump::sysex7)
+        {
+            const int status = Ump::getStatus (word);
+            const int count = jmin (6, (int) ((word >> 16) & 0xf));
+            const uint8 chunk[6] = { (uint8) (word >> 8), (uint8) word,
+                                     (uint8) (words[1] >> 24), (uint8) (words[1] >> 16),
+                                     (uint8) (words[1] >> 8), (uint8) words[1] };
+
+            if (status == Ump::sysexComplete || status == Ump::sysexStart)
+            {
+                sysex[0] = (char) 0xf0;
+                sysexSize = 1;
+            }
+            else if (sysexSize == 0)
+            {
+                continue;   // continuation without a start
+            }
+
+            sysex.ensureSize (sysexSize + (size_t) count + 1);
+            sysex.copyFrom (chunk, (int) sysexSize, (size_t) count);
+            sysexSize += (size_t) count;
+
+            if (status == Ump::sysexComplete || status == Ump::sysexEnd)
+            {
+                sysex[sysexSize++] = (char) 0xf7;
+                midi.addEvent (sysex.getData(), (int) sysexSize, frame);
+                sysexSize = 0;
+            }
+            continue;
+        }
+
+        if (type == Ump::midi2Voice)
+        {
+            const int status = Ump::getStatus (word);
+            const uint8 channelStatus = (uint8) (0xb0 | ((word >> 16) & 0xf));
+
+            if (status == Ump::registeredController || status == Ump::assignableController)
+            {
+                const bool registered = status == Ump::registeredController;
+                const uint32 value = Ump::scaleDown (words[1], 32, 14);
+                const uint8 controllers[4][3] = {
+                    { channelStatus, (uint8) (registered ? 101 : 99), (uint8) ((word >> 8) & 0x7f) },
+                    { channelStatus, (uint8) (registered ? 100 : 98), (uint8) (word & 0x7f) },
+                    { channelStatus, 6,  (uint8) (value >> 7) },
+                    { channelStatus, 38, (uint8) (value & 0x7f) }
+                };
+                for (const auto& controller : controllers)
+                    midi.addEvent (controller, 3, frame);
+                continue;
+            }
+
+            if (status == Ump::programChange && (word & 1) != 0)
+            {
+                const uint8 bankMsb[3] = { channelStatus, 0,  (uint8) ((words[1] >> 8) & 0x7f) };
+                const uint8 bankLsb[3] = { channelStatus, 32, (uint8) (words[1] & 0x7f) };
+                midi.addEvent (bankMsb, 3, frame);
+                midi.addEvent (bankLsb, 3, frame);
+            }
+        }
+
+        uint8 bytes[3];
+        if (const int size = Ump::toMidi1 (words, bytes))
+            midi.addEvent (bytes, size, frame);
+    }
+}
+
+}
@@ -0,0 +1,258 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Universal MIDI Packet helpers.
+
+    Packets are one to four 32 bit words. The first word holds the message
+    type, group, status and channel in its top two bytes. MIDI 1.0 byte
+    streams are translated to MIDI 2.0 channel voice packets, so 32 bit
+    controllers, 16 bit velocity and per-note messages can be carried
+    without loss, and are scaled back down only when leaving as bytes.
+ */
+namespace Ump {
+
+enum MessageType
+{
+    utility         = 0x0,
+    system          = 0x1,
+    midi1Voice      = 0x2,
+    sysex7          = 0x3,
+    midi2Voice      = 0x4,
+    data128         = 0x5
+};
+
+/** MIDI 2.0 channel voice statuses */
+enum Status
+{
+    registeredPerNoteController = 0x0,
+    assignablePerNoteController = 0x1,
+    registeredController        = 0x2,
+    assignableController        = 0x3,
+    perNotePitchBend            = 0x6,
+    noteOff                     = 0x8,
+    noteOn                      = 0x9,
+    polyPressure                = 0xa,
+    controlChange               = 0xb,
+    programChange               = 0xc,
+    channelPressure             = 0xd,
+    pitchBend                   = 0xe,
+    perNoteManagement           = 0xf
+};
+
+inline int getMessageType (const uint32 word) noexcept   { return (int) (word >> 28); }
+inline int getGroup (const uint32 word) noexcept         { return (int) ((word >> 24) & 0xf); }
+inline int getStatus (const uint32 word) noexcept        { return (int) ((word >> 20) & 0xf); }
+
+/** Returns the channel, 1 to 16 */
+inline int getChannel (const uint32 word) noexcept       { return (int) ((word >> 16) & 0xf) + 1; }
+inline int getNoteNumber (const uint32 word) noexcept    { return (int) ((word >> 8) & 0x7f); }
+
+/** Returns the number of words in a packet from its first word */
+inline int getNumWords (const uint32 word) noexcept
+{
+    static const int8 sizes[16] = { 1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4 };
+    return sizes [word >> 28];
+}
+
+inline bool isChannelVoice (const uint32 word) noexcept
+{
+    const int type = getMessageType (word);
+    return type == midi1Voice || type == midi2Voice;
+}
+
+/** Returns true for messages addressed to a note number */
+inline bool hasNoteNumber (const uint32 word) noexcept
+{
+    const int status = getStatus (word);
+    if (getMessageType (word) == midi1Voice)
+        return status >= noteOff && status <= polyPressure;
+    return getMessageType (word) == midi2Voice
+        && (status <= assignablePerNoteController || status == perNotePitchBend
+            || (status >= noteOff && status <= polyPressure) || status == perNoteManagement);
+}
+
+/** Changes the channel of a channel voice packet. Channels are 1 to 16 */
+inline uint32 withChannel (const uint32 word, const int channel) noexcept
+{
+    return (word & ~(uint32) 0x000f0000) | ((uint32) ((channel - 1) & 0xf) << 16);
+}
+
+inline uint32 withNoteNumber (const uint32 word, const int note) noexcept
+{
+    return (word & ~(uint32) 0x00007f00) | ((uint32) (note & 0x7f) << 8);
+}
+
+/** Returns the 16 bit velocity of a MIDI 2.0 note packet */
+inline int getVelocity (const uint32* words) noexcept    { return (int) (words[1] >> 16); }
+
+inline void setVelocity (uint32* words, const int velocity) noexcept
+{
+    words[1] = (words[1] & 0xffff) | ((uint32) (velocity & 0xffff) << 16);
+}
+
+/** Scales a value up keeping minimum, center and maximum, as the MIDI
+    2.0 translation rules require */
+uint32 scaleUp (uint32 value, int srcBits, int dstBits) noexcept;
+
+/** Scales a value down by dropping low bits */
+inline uint32 scaleDown (const uint32 value, const int srcBits, const int dstBits) noexcept
+{
+    return value >> (srcBits - dstBits);
+}
+
+/** Translates one MIDI 1.0 message that isn't sysex to a packet. Returns
+    the number of words written, or 0 if there is no translation */
+int fromMidi1 (const uint8* data, int size, uint32* words, int group = 0) noexcept;
+
+/** Translates a channel voice or system packet to MIDI 1.0 bytes. Returns
+    the number of bytes written, or 0 if the packet has no single message
+    translation, e.g. per-note controllers */
+int toMidi1 (const uint32* words, uint8* data) noexcept;
+
+}
+
+//=============================================================================
+
+/** A block of time stamped Universal MIDI Packets.
+
+    Packets are stored back to back as a frame word followed by the
+    packet's words, so buffers are filtered in place without copying
+    events to a second buffer. Events are kept in time order.
+ */
+class UmpBuffer
+{
+public:
+    UmpBuffer() = default;
+    UmpBuffer (const UmpBuffer&);
+    UmpBuffer& operator= (const UmpBuffer&);
+
+    /** Preallocates words, so adding that many won't allocate. Also
+        reserves room to join sysex when translating back to bytes */
+    void ensureSize (int numWords);
+
+    void clear() noexcept                   { numUsed = numEvents = 0; }
+
+    /** Removes events in a range of frames */
+    void clear (int startFrame, int numFrames);
+
+    bool isEmpty() const noexcept           { return numEvents == 0; }
+    int getNumEvents() const noexcept       { return numEvents; }
+
+    /** Returns the number of words used, including frame words */
+    int getNumWords() const noexcept        { return numUsed; }
+
+    /** Adds a packet, its size comes from the first word */
+    void addPacket (const uint32* words, int frame);
+
+    /** Adds a MIDI 1.0 message, translating it. Sysex is split into 7 bit
+        data packets */
+    void addMidi1 (const uint8* data, int size, int frame, int group = 0);
+
+    /** Adds events from another buffer in a range of frames, moved by an offset */
+    void addEvents (const UmpBuffer& other, int startFrame, int numFrames, int frameOffset);
+
+    void swapWith (UmpBuffer&) noexcept;
+
+    /** Translates and adds all events of a MidiBuffer */
+    void addFromMidiBuffer (const MidiBuffer& midi, int group = 0);
+
+    /** Translates all events to MIDI 1.0 and adds them to a MidiBuffer.
+        Registered and assignable controllers become the four controller
+        sequence, sysex packets are joined back into one message */
+    void addToMidiBuffer (MidiBuffer& midi) const;
+
+    /** Calls a function with every packet's frame, words and word count.
+        The words may be changed in place, but not the packet type */
+    template<class Function>
+    void processPackets (Function&& function)
+    {
+        for (uint32* word = data.get(), * const end = word + numUsed; word < end;)
+        {
+            const int numWords = Ump::getNumWords (word[1]);
+            function ((int) word[0], word + 1, numWords);
+            word += 1 + numWords;
+        }
+    }
+
+    /** Removes every packet the predicate returns true for, in place.
+        The predicate gets the packet's frame, words and word count */
+    template<class Predicate>
+    void removeIf (Predicate&& predicate)
+    {
+        uint32* write = data.get();
+        int kept = 0;
+
+        for (uint32* read = data.get(), * const end = read + numUsed; read < end;)
+        {
+            const int numWords = 1 + Ump::getNumWords (read[1]);
+            if (! predicate ((int) read[0], static_cast<const uint32*> (read + 1), numWords - 1))
+            {
+                if (write != read)
+                    memmove (write, read, sizeof (uint32) * (size_t) numWords);
+                lastFrame = (int) write[0];
+                write += numWords;
+                ++kept;
+            }
+            read += numWords;
+        }
+
+        numUsed = (int) (write - data.get());
+        numEvents = kept;
+        if (kept == 0)
+            lastFrame = 0;
+    }
+
+    class Iterator
+    {
+    public:
+        explicit Iterator (const UmpBuffer& b) noexcept
+            : word (b.data.get()), end (b.data.get() + b.numUsed) { }
+
+        bool getNextEvent (const uint32*& words, int& numWords, int& frame) noexcept
+        {
+            if (word >= end)
+                return false;
+            frame    = (int) word[0];
+            words    = word + 1;
+            numWords = Ump::getNumWords (word[1]);
+            word += 1 + numWords;
+            return true;
+        }
+
+    private:
+        const uint32* word;
+        const uint32* const end;
+    };
+
+private:
+    HeapBlock<uint32> data;
+    mutable MemoryBlock sysex;
+    int numAllocated = 0, numUsed = 0, numEvents = 0;
+    int lastFrame = 0;
+
+    uint32* insertAt (int frame, int numWords);
+};
+
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "ElementApp.h"
+#include "engine/Ump.h"
 
 namespace Element {
 
@@ -120,6 +121,29 @@ public:
             process (static_cast<float> (velocity) / 127.f)));
     }
 
+    /** Process a 16 bit MIDI 2.0 velocity */
+    inline uint16 process (const uint16 velocity)
+    {
+        if (mode == Linear)
+            return velocity;
+        else if (mode == Max)
+            return 0xffff;
+        return static_cast<uint16> (roundToInt (
+            65535.f * process (static_cast<float> (velocity) / 65535.f)));
+    }
+
+    /** Applies the curve to the note on velocities of a UMP buffer in place */
+    inline void process (UmpBuffer& midi)
+    {
+        if (mode == Linear)
+            return;
+
+        midi.processPackets ([this] (int, uint32* words, int) {
+            if (Ump::getMessageType (words[0]) == Ump::midi2Voice && Ump::getStatus (words[0]) == Ump::noteOn)
+                Ump::setVelocity (words, process (static_cast<uint16> (Ump::getVelocity (words))));
+        });
+    }
+
 private:
     Mode mode;
     float rsq;
@@ -29,7 +29,7 @@ namespace Element {
 typedef AudioMixerProcessor::MonitorPtr MonitorPtr;
 
 class AudioMixerEditor : public AudioProcessorEditor,
-                         private Timer
+                         private ChangeListener
 {
 public:
     AudioMixerEditor (AudioMixerProcessor& p) 
@@ -40,10 +40,13 @@ public:
         setName ("AudioMixerEditor");
         addAndMakeVisible (channels);
         setSize (330, 210);
-        startTimerHz (24);
+        owner.addChangeListener (this);
     }
 
-    ~AudioMixerEditor() noexcept { }
+    ~AudioMixerEditor() noexcept
+    {
+        owner.removeChangeListener (this);
+    }
 
     void paint (Graphics& g) override 
     {
@@ -75,8 +78,19 @@ public:
     void rebuildTracks()
     {
         monitors.clearQuick();
+        uint32 groupsInUse = 0;
         for (int i = 0; i < owner.getNumTracks(); ++i)
-            monitors.add (owner.getMonitor (i));
+        {
+            auto monitor = owner.getMonitor (i);
+            monitors.add (monitor);
+            if (monitor != nullptr && monitor->getGroup() >= 0)
+                groupsInUse |= (1u << monitor->getGroup());
+        }
+
+        for (int i = 0; i < AudioMixerProcessor::maxGroups; ++i)
+            if ((groupsInUse & (1u << i)) != 0)
+                monitors.add (owner.getGroupMonitor (i));
+
         channels.updateContent();
 
         masterMonitor = owner.getMonitor();
@@ -97,6 +111,17 @@ private:
             : editor (ed), monitor (mon),
               meter (mon->getNumChannels())
         {
+            if (monitor->getTrackId() >= 0)
+            {
+                addAndMakeVisible (pan);
+                pan.setSliderStyle (Slider::RotaryHorizontalVerticalDrag);
+                pan.setTextBoxStyle (Slider::NoTextBox, true, 1, 1);
+                pan.setRange (-1.0, 1.0, 0.01);
+                pan.setValue (0.0, dontSendNotification);
+                pan.setDoubleClickReturnValue (true, 0.0);
+                pan.addListener (this);
+            }
+
             addAndMakeVisible (fader);
             fader.setSliderStyle (Slider::LinearBarVertical);
             fader.setTextBoxStyle (Slider::NoTextBox, true, 1, 1);
@@ -111,8 +136,8 @@ private:
             addAndMakeVisible (name); 
             name.setFont (name.getFont().withHeight (14));
             name.setJustificationType (Justification::centred);
-            setTrackName (monitor->getTrackId() >= 0 ? "Track " + String(monitor->getTrackId() + 1)
-                                                     : "Master");
+            name.setInterceptsMouseClicks (false, false);
+            updateTrackName();
 
             addAndMakeVisible (mute);
             mute.setColour (TextButton::buttonOnColourId, Colors::toggleRed);
@@ -140,6 +165,63 @@ private:
             if (ptr == monitor)
                 return;
             monitor = ptr;
+            lastChangeCount = -1;
+            pan.setVisible (monitor != nullptr && monitor->getTrackId() >= 0);
+            updateTrackName();
+            stabilizeContent();
+        }
+
+        void mouseDown (const MouseEvent& ev) override
+        {
+            if (! ev.mods.isPopupMenu() || monitor == nullptr || monitor->getTrackId() < 0)
+                return;
+
+            enum { groupBase = 100, sendBase = 1000, addSendId = 5000 };
+            const float sendLevels[] = { 1.f, 0.5f, 0.25f, 0.f };
+            const char* sendNames[]  = { "0 dB", "-6 dB", "-12 dB", "Off" };
+
+            PopupMenu groupMenu;
+            groupMenu.addItem (groupBase, "None", true, monitor->getGroup() < 0);
+            for (int i = 0; i < AudioMixerProcessor::maxGroups; ++i)
+                groupMenu.addItem (groupBase + 1 + i, "Group " + String (i + 1), true, monitor->getGroup() == i);
+
+            PopupMenu menu;
+            menu.addSubMenu ("Group", groupMenu);
+
+            auto& processor = editor.owner;
+            for (int s = 0; s < processor.getNumSends(); ++s)
+            {
+                PopupMenu sendMenu;
+                for (int l = 0; l < 4; ++l)
+                    sendMenu.addItem (sendBase + s * 10 + l, sendNames[l], true,
+                                      monitor->getSendLevel (s) == sendLevels[l]);
+                sendMenu.addSeparator();
+                sendMenu.addItem (sendBase + s * 10 + 9, "Pre Fader", true, processor.isSendPreFader (s));
+                menu.addSubMenu ("Send " + String (s + 1), sendMenu);
+            }
+
+            menu.addSeparator();
+            menu.addItem (addSendId, "Add Send Bus", processor.getNumSends() < AudioMixerProcessor::maxSends);
+
+            const int result = menu.show();
+            if (result >= groupBase && result <= groupBase + AudioMixerProcessor::maxGroups)
+            {
+                monitor->requestGroup (result - groupBase - 1);
+                editor.rebuildTracks();
+            }
+            else if (result >= sendBase && result < addSendId)
+            {
+                const int send = (result - sendBase) / 10;
+                const int item = (result - sendBase) % 10;
+                if (item == 9)
+                    processor.setSendPreFader (send, ! processor.isSendPreFader (send));
+                else if (item < 4)
+                    monitor->requestSendLevel (send, sendLevels[item]);
+            }
+            else if (result == addSendId)
+            {
+                processor.setNumSends (processor.getNumSends() + 1);
+            }
         }
 
         void paint (Graphics& g) override
@@ -154,6 +236,8 @@ private:
             
             volume.setBounds (r.removeFromBottom (18));
             auto r2 = r.removeFromBottom (18);
+            if (pan.isVisible())
+                pan.setBounds (r2.removeFromLeft (18));
             mute.setBounds (r2.removeFromRight (getWidth() / 3));
             
             fader.setBounds (r.removeFromRight (getWidth() / 2));
@@ -175,6 +259,10 @@ private:
                 monitor->requestVolume (s->getValue());
                 updateLabels();
             }
+            else if (s == &pan)
+            {
+                monitor->requestPan ((float) s->getValue());
+            }
         }
 
         int getNumChannels() const { return (nullptr != monitor) ? monitor->getNumChannels()
@@ -186,10 +274,22 @@ private:
         AudioMixerEditor& editor;
         AudioMixerProcessor::MonitorPtr monitor;
         Slider fader;
+        Slider pan;
         DigitalMeter meter;
         TextButton mute;
         Label name;
         Label volume;
+        int lastChangeCount = -1;
+
+        void updateTrackName()
+        {
+            if (monitor == nullptr)
+                return;
+            const int trackId = monitor->getTrackId();
+            setTrackName (trackId >= 0  ? "Track " + String (trackId + 1) :
+                          trackId <= -2 ? "Group " + String (-1 - trackId)
+                                        : "Master");
+        }
 
         void updateLabels()
         {
@@ -208,6 +308,18 @@ private:
             }
 
             mute.setToggleState (monitor->isMuted(), dontSendNotification);
+            if (pan.isVisible() && ! pan.isMouseButtonDown())
+                pan.setValue ((double) monitor->getPan(), dontSendNotification);
+        }
+
+        /** Updates the strip if the monitor changed since last time */
+        void refresh()
+        {
+            if (monitor == nullptr || monitor->getChangeCount() == lastChangeCount)
+                return;
+            lastChangeCount = monitor->getChangeCount();
+            processMeter();
+            stabilizeContent();
         }
 
         void processMeter()
@@ -349,14 +461,10 @@ private:
     ScopedPointer<ChannelStrip> masterStrip;
     MonitorPtr masterMonitor;
 
-    friend class Timer;
-    void timerCallback() override
+    void changeListenerCallback (ChangeBroadcaster*) override
     {
         for (auto* const strip : strips)
-        {
-            strip->processMeter();
-            strip->stabilizeContent();
-        }
+            strip->refresh();
     }
 };
 
@@ -437,12 +545,101 @@ AudioProcessorEditor* AudioMixerProcessor::createEditor()
     return ed;
 }
 
+//=============================================================================
+
+/** Adds src * gain to dest, ramping the gain linearly from start to end.
+    Written so the compiler can vectorize the ramp */
+static inline void addWithRamp (float* dest, const float* src, int numSamples, float start, float end)
+{
+    if (start == end)
+    {
+        if (end != 0.f)
+            FloatVectorOperations::addWithMultiply (dest, src, end, numSamples);
+        return;
+    }
+
+    const float step = (end - start) / (float) numSamples;
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] += src[i] * (start + step * (float) i);
+}
+
+/** RMS with four partial sums so the loop vectorizes */
+static inline float getRMS (const float* data, int numSamples)
+{
+    if (numSamples <= 0)
+        return 0.f;
+
+    float sums[4] = { 0.f, 0.f, 0.f, 0.f };
+    int i = 0;
+    for (; i + 4 <= numSamples; i += 4)
+        for (int k = 0; k < 4; ++k)
+            sums[k] += data[i + k] * data[i + k];
+    for (; i < numSamples; ++i)
+        sums[0] += data[i] * data[i];
+
+    return std::sqrt ((sums[0] + sums[1] + sums[2] + sums[3]) / (float) numSamples);
+}
+
+/** Balance law for stereo tracks. Unity at center */
+static inline float getPanGain (float pan, int channel, int numChannels)
+{
+    if (numChannels != 2)
+        return 1.f;
+    const float amount = channel == 0 ? pan : -pan;
+    return amount <= 0.f ? 1.f : std::cos (amount * MathConstants<float>::halfPi);
+}
+
+void AudioMixerProcessor::resizeTempBuffer (int numSamples)
+{
+    // master channels, then each send
+    const int numChannels = jmax (1, getMainBusNumOutputChannels()) * (1 + getNumSends());
+    tempBuffer.setSize (numChannels, jmax (1, numSamples), false, true, true);
+}
+
 void AudioMixerProcessor::prepareToPlay (const double sampleRate, const int bufferSize)
 {
     setRateAndBufferSizeDetails (sampleRate, bufferSize);
     jassert (tracks.size() == getBusCount (true));
-    jassert (1 == getBusCount (false));
-    tempBuffer.setSize (getMainBusNumOutputChannels(), bufferSize, false, true, true);
+    resizeTempBuffer (bufferSize);
+}
+
+void AudioMixerProcessor::applyRequests (Track& track)
+{
+    auto& monitor = *track.monitor;
+    bool changed = false;
+
+    if (track.gain != monitor.nextGain.get())
+    {
+        track.gain = monitor.nextGain.get();
+        changed = true;
+    }
+
+    if (static_cast<int> (track.mute) != monitor.nextMute.get())
+    {
+        track.mute = monitor.nextMute.get() > 0;
+        changed = true;
+    }
+
+    if (track.pan != monitor.nextPan.get())
+    {
+        track.pan = monitor.nextPan.get();
+        changed = true;
+    }
+
+    if (track.group != monitor.nextGroup.get())
+    {
+        track.group = monitor.nextGroup.get();
+        changed = true;
+    }
+
+    for (int i = 0; i < maxSends; ++i)
+        track.sends[i] = monitor.sendLevels[i].get();
+
+    monitor.gain.set (track.gain);
+    monitor.muted.set (track.mute ? 1 : 0);
+    monitor.pan.set (track.pan);
+    if (changed)
+        ++monitor.changes;
 }
 
 void AudioMixerProcessor::processBlock (AudioSampleBuffer& audio, MidiBuffer& midi)
@@ -457,62 +654,128 @@ void AudioMixerProcessor::processBlock (AudioSampleBuffer& audio, MidiBuffer& mi
         return;
     }
 
-    auto output (getBusBuffer<float> (audio, false, 0));
     const int numSamples = audio.getNumSamples();
+    const int numMainChannels = jmin (2, getMainBusNumOutputChannels());
+    const int numSends = jmin (maxSends, getNumSends(), tempBuffer.getNumChannels() / jmax (1, numMainChannels) - 1);
+    jassert (numSamples <= tempBuffer.getNumSamples());
     tempBuffer.clear (0, numSamples);
 
-    for (int i = 0; i < tracks.size(); ++i)
+    // VCA groups only scale the tracks assigned to them
+    float groupGains [maxGroups];
+    for (int i = 0; i < maxGroups; ++i)
+    {
+        auto& group = *groups.getUnchecked (i);
+        const bool groupChanged = group.gain.get() != group.nextGain.get()
+                               || group.muted.get() != group.nextMute.get();
+        group.gain.set (group.nextGain.get());
+        group.muted.set (group.nextMute.get());
+        if (groupChanged)
+            ++group.changes;
+        groupGains[i] = group.muted.get() > 0 ? 0.f : group.gain.get();
+    }
+
+    bool preFader [maxSends];
+    for (int i = 0; i < maxSends; ++i)
+        preFader[i] = sendPreFader[i].get() != 0;
+
+    for (auto* const track : tracks)
     {
-        auto* const track = tracks.getUnchecked (i);
+        applyRequests (*track);
+
         auto input (getBusBuffer<float> (audio, true, track->busIdx));
-        auto& rms = track->monitor->rms;
+        auto& monitor = *track->monitor;
+        const int numChannels = jmin (numMainChannels, track->numInputs, input.getNumChannels());
+        const float fader = track->mute ? 0.f : track->gain * (track->group >= 0 ? groupGains[track->group] : 1.f);
 
-        if (track->mute)
+        for (int c = 0; c < numChannels; ++c)
         {
-            for (int c = 0; c < track->numInputs; ++c)
-                rms.getReference(c).set (0.0);
-        }
-        else
-        {
-            for (int c = 0; c < track->numInputs; ++c)
+            const auto* const src = input.getReadPointer (c);
+            const float gain = fader * getPanGain (track->pan, c, numChannels);
+            float& last = track->lastGains[c];
+
+            if (gain != 0.f || last != 0.f)
             {
-                rms.getReference(c).set (track->gain * input.getRMSLevel (c, 0, numSamples));
-                tempBuffer.addFromWithRamp (c, 0, input.getReadPointer(c), numSamples,
-                                            track->lastGain, track->gain);
+                addWithRamp (tempBuffer.getWritePointer (c), src, numSamples, last, gain);
+                monitor.setLevel (c, gain * getRMS (src, numSamples));
+            }
+            else
+            {
+                monitor.setLevel (c, 0.f);
             }
-        }
 
-        track->lastGain = track->gain;
+            last = gain;
 
-        if (track->gain != track->monitor->nextGain.get())
-            track->gain = track->monitor->nextGain.get();
-        track->monitor->gain.set (track->gain);
+            for (int s = 0; s < numSends; ++s)
+            {
+                const float sendGain = track->sends[s] * (preFader[s] ? (track->mute ? 0.f : 1.f) : gain);
+                float& lastSend = track->lastGains[(1 + s) * 2 + c];
+                addWithRamp (tempBuffer.getWritePointer ((1 + s) * numMainChannels + c), src,
+                             numSamples, lastSend, sendGain);
+                lastSend = sendGain;
+            }
+        }
+    }
 
-        if (static_cast<int> (track->mute) != track->monitor->nextMute.get())
-            track->mute = track->monitor->nextMute.get() > 0;
-        track->monitor->muted.set (track->mute ? 1 : 0);
+    auto output (getBusBuffer<float> (audio, false, 0));
+    const float gain = *masterMute ? 0.f : Decibels::decibelsToGain ((float)*masterVolume, (float) EL_FADER_MIN_DB);
+    for (int c = 0; c < output.getNumChannels(); ++c)
+    {
+        output.clear (c, 0, numSamples);
+        if (c < numMainChannels)
+            addWithRamp (output.getWritePointer (c), tempBuffer.getReadPointer (c), numSamples, lastGain, gain);
     }
 
-    output.clear (0, numSamples);
-    const float gain = Decibels::decibelsToGain ((float)*masterVolume, (float) EL_FADER_MIN_DB);
-    if (! *masterMute)
-        for (int c = 0; c < output.getNumChannels(); ++c)
-            output.copyFromWithRamp (c, 0, tempBuffer.getReadPointer(c), numSamples,
-                                     lastGain, gain);
+    for (int s = 0; s < getNumSends(); ++s)
+    {
+        // sends added while running have no channels until the graph catches up
+        auto* const bus = getBus (false, s + 1);
+        if (bus == nullptr || bus->getChannelIndexInProcessBlockBuffer (0) + bus->getNumberOfChannels() > audio.getNumChannels())
+            break;
 
-    if (gain != masterMonitor->nextGain.get())
+        auto send (getBusBuffer<float> (audio, false, s + 1));
+        for (int c = 0; c < send.getNumChannels(); ++c)
+        {
+            if (s < numSends && c < numMainChannels)
+                send.copyFrom (c, 0, tempBuffer, (1 + s) * numMainChannels + c, 0, numSamples);
+            else
+                send.clear (c, 0, numSamples);
+        }
+    }
+
+    const float masterGain = Decibels::decibelsToGain ((float)*masterVolume, (float) EL_FADER_MIN_DB);
+    if (masterGain != masterMonitor->nextGain.get())
         *masterVolume = Decibels::gainToDecibels (masterMonitor->nextGain.get(), (float) EL_FADER_MIN_DB);
     if (static_cast<int> (*masterMute) != masterMonitor->nextMute.get())
         *masterMute = masterMonitor->nextMute.get() <= 0 ? false : true;
 
+    if (masterMonitor->muted.get() != (*masterMute ? 1 : 0) || masterMonitor->gain.get() != masterGain)
+        ++masterMonitor->changes;
     masterMonitor->muted.set (*masterMute);
-    masterMonitor->gain.set (gain);
+    masterMonitor->gain.set (masterGain);
 
-    for (int i = 0; i < 2; ++i)
-        masterMonitor->rms.getReference(i).set (
-            output.getRMSLevel (i, 0, numSamples));
+    for (int i = 0; i < jmin (2, output.getNumChannels()); ++i)
+        masterMonitor->setLevel (i, getRMS (output.getReadPointer (i), numSamples));
 
     lastGain = gain;
+
+    // one counter for the editor to check
+    int total = masterMonitor->changes.get();
+    for (auto* const group : groups)
+        total += group->changes.get();
+    for (auto* const track : tracks)
+        total += track->monitor->changes.get();
+    changes.set (total);
+
+    // coalesced, a change held back here goes out with a later block
+    const int broadcastInterval = (int) (getSampleRate() / 30.0);
+    if (samplesSinceBroadcast < broadcastInterval)
+        samplesSinceBroadcast += numSamples;
+    if (total != lastBroadcast && samplesSinceBroadcast >= broadcastInterval)
+    {
+        lastBroadcast = total;
+        samplesSinceBroadcast = 0;
+        sendChangeMessage();
+    }
 }
 
 void AudioMixerProcessor::releaseResources()
@@ -520,6 +783,38 @@ void AudioMixerProcessor::releaseResources()
     tempBuffer.setSize (1, 1, false, false, false);
 }
 
+void AudioMixerProcessor::setNumSends (int numSends)
+{
+    numSends = jlimit (0, maxSends, numSends);
+    if (numSends == getNumSends())
+        return;
+
+    {
+        ScopedLock sl (getCallbackLock());
+        while (getNumSends() < numSends)
+            if (! addBus (false))
+                break;
+        while (getNumSends() > numSends)
+            if (! removeBus (false))
+                break;
+        resizeTempBuffer (jmax (getBlockSize(), tempBuffer.getNumSamples()));
+    }
+
+    // lets the node update its ports
+    updateHostDisplay();
+}
+
+void AudioMixerProcessor::setSendPreFader (const int send, const bool preFader)
+{
+    if (isPositiveAndBelow (send, maxSends))
+        sendPreFader[send].set (preFader ? 1 : 0);
+}
+
+bool AudioMixerProcessor::isSendPreFader (const int send) const
+{
+    return isPositiveAndBelow (send, maxSends) && sendPreFader[send].get() != 0;
+}
+
 bool AudioMixerProcessor::canApplyBusCountChange (bool isInput, bool isAdding,
                                                   AudioProcessor::BusProperties& outProperties)
 {
@@ -533,7 +828,7 @@ bool AudioMixerProcessor::canApplyBusCountChange (bool isInput, bool isAdding,
     
     if (isAdding)
     {
-        outProperties.busName = String (isInput ? "Input #" : "Output #") + String (getBusCount (isInput));
+        outProperties.busName = String (isInput ? "Input #" : "Send #") + String (getBusCount (isInput));
         outProperties.defaultLayout = (num > 0 ? getBus (isInput, num - 1)->getDefaultLayout() 
                                                : main->getDefaultLayout());
         outProperties.isActivatedByDefault = true;
@@ -544,17 +839,16 @@ bool AudioMixerProcessor::canApplyBusCountChange (bool isInput, bool isAdding,
 
 void AudioMixerProcessor::setTrackGain (const int track, const float gain)
 {
-    if (! isPositiveAndBelow (track, numTracks))
-        return;
-    ScopedLock sl (getCallbackLock());
-    tracks.getUnchecked(track)->gain = gain;
+    if (auto monitor = getMonitor (track))
+        if (track >= 0)
+            monitor->requestGain (gain);
 }
 
-void AudioMixerProcessor::setTrackMuted (const int track, const bool mute) {
-    if (! isPositiveAndBelow (track, numTracks))
-        return;
-    ScopedLock sl (getCallbackLock());
-    tracks.getUnchecked(track)->mute = mute;
+void AudioMixerProcessor::setTrackMuted (const int track, const bool mute)
+{
+    if (auto monitor = getMonitor (track))
+        if (track >= 0)
+            monitor->requestMute (mute);
 }
 
 bool AudioMixerProcessor::isTrackMuted (const int track) const
@@ -580,17 +874,22 @@ void AudioMixerProcessor::getStateInformation (juce::MemoryBlock& block)
         t.add (new Track());
     float volume = 0.0f;
     bool mute = false;
+    int numSends = 0;
     {
         ScopedLock sl (getCallbackLock());
         for (int i = 0; i < numTracks; ++i)
             t.getUnchecked(i)->update (tracks.getUnchecked (i));
         volume = *masterVolume;
         mute = *masterMute;
+        numSends = getNumSends();
     }
 
     ValueTree state ("audiomixer");
     state.setProperty (Tags::volume, volume, 0)
-         .setProperty ("mute", mute, 0);
+         .setProperty ("mute", mute, 0)
+         .setProperty ("numSends", numSends, 0);
+    for (int i = 0; i < numSends; ++i)
+        state.setProperty ("preFader" + String (i), isSendPreFader (i), 0);
     for (int i = 0; i < numTracks; ++i)
     {
         ValueTree trk ("track");
@@ -600,10 +899,26 @@ void AudioMixerProcessor::getStateInformation (juce::MemoryBlock& block)
            .setProperty ("numInputs",   track->numInputs, 0)
            .setProperty ("numOutputs",  track->numOutputs, 0)
            .setProperty ("gain",        track->gain, 0)
-           .setProperty ("mute",        track->mute, 0);
+           .setProperty ("mute",        track->mute, 0)
+           .setProperty ("pan",         track->pan, 0)
+           .setProperty ("group",       track->group, 0);
+        for (int s = 0; s < numSends; ++s)
+            trk.setProperty ("send" + String (s), track->sends[s], 0);
         state.addChild (trk, -1, 0);
     }
 
+    for (int i = 0; i < maxGroups; ++i)
+    {
+        auto group = groups.getUnchecked (i);
+        if (group->getGain() == 1.f && ! group->isMuted())
+            continue;
+        ValueTree grp ("group");
+        grp.setProperty ("index", i, 0)
+           .setProperty ("gain",  group->getGain(), 0)
+           .setProperty ("mute",  group->isMuted(), 0);
+        state.addChild (grp, -1, 0);
+    }
+
     if (auto xml = state.createXml())
     {
         copyXmlToBinary (*xml, block);
@@ -625,24 +940,50 @@ void AudioMixerProcessor::setStateInformation (const void* data, int size)
     for (int i = 0; i < state.getNumChildren(); ++i)
     {
         const ValueTree trk (state.getChild (i));
+        if (trk.hasType ("group"))
+        {
+            if (auto group = groups [(int) trk.getProperty ("index", -1)])
+            {
+                group->requestGain ((float) trk.getProperty ("gain", 1.f));
+                group->requestMute ((bool) trk.getProperty ("mute", false));
+            }
+            continue;
+        }
+
         auto* const track   = new Track();
-        track->index        = trk.getProperty ("index", i);
+        track->index        = newTracks.size();
         track->busIdx       = trk.getProperty ("busIdx", i);
         track->numInputs    = trk.getProperty ("numInputs", 2);
         track->numOutputs   = trk.getProperty ("numOutputs", 2);
         track->gain         = trk.getProperty ("gain", 1.f);
         track->lastGain     = track->gain;
         track->mute         = (bool) trk.getProperty ("mute", false);
+        track->pan          = trk.getProperty ("pan", 0.f);
+        track->group        = trk.getProperty ("group", -1);
 
         track->monitor = new Monitor (track->index, track->numInputs);
         track->monitor->gain.set (track->gain);
         track->monitor->nextGain.set (track->gain);
         track->monitor->muted.set (track->mute ? 1 : 0);
         track->monitor->nextMute.set (track->mute ? 1 : 0);
-        
+        track->monitor->pan.set (track->pan);
+        track->monitor->requestPan (track->pan);
+        track->monitor->requestGroup (track->group);
+        track->group = track->monitor->getGroup();
+        for (int s = 0; s < maxSends; ++s)
+        {
+            track->sends[s] = trk.getProperty ("send" + String (s), 0.f);
+            track->monitor->requestSendLevel (s, track->sends[s]);
+        }
+
         newTracks.add (track);
     }
 
+    const int numSends = jlimit (0, maxSends, (int) state.getProperty ("numSends", 0));
+    for (int i = 0; i < maxSends; ++i)
+        setSendPreFader (i, (bool) state.getProperty ("preFader" + String (i), false));
+    setNumSends (numSends);
+
     {
         ScopedLock sl (getCallbackLock());
         *masterVolume = (float) state.getProperty (Tags::volume, 0.0);
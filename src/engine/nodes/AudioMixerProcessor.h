@@ -23,12 +23,28 @@
 
 namespace Element {
 
-class AudioMixerProcessor : public BaseProcessor
+/** The summing mixer.
+
+    Each stereo input bus is a track with gain, pan, mute, an optional VCA
+    group and sends. Output bus 0 is the master, any further output buses
+    are sends. The GUI talks to the renderer through Monitors which are
+    lock free. Gain, pan and mute changes ramp over a block. The renderer
+    sends a change message, at most 30 times a second, when any monitor
+    changed so editors never have to poll.
+ */
+class AudioMixerProcessor : public BaseProcessor,
+                            public ChangeBroadcaster
 {
     AudioParameterBool* masterMute;
     AudioParameterFloat* masterVolume;
 
 public:
+    /** Most send buses */
+    static constexpr int maxSends = 8;
+
+    /** Number of VCA groups */
+    static constexpr int maxGroups = 8;
+
     class Monitor : public ReferenceCountedObject
     {
     public:
@@ -44,9 +60,16 @@ public:
         }
 
         inline float getGain()          const { return gain.get(); }
+        inline float getPan()           const { return pan.get(); }
+        inline int getGroup()           const { return nextGroup.get(); }
         inline int getNumChannels()     const { return numChannels; }
         inline int getTrackId()         const { return trackId; }
         inline bool isMuted()           const { return muted.get() > 0; }
+        inline bool isGroup()           const { return trackId < -1; }
+
+        /** Returns a counter which changes whenever the renderer applies a
+            request or the levels move */
+        inline int getChangeCount()     const { return changes.get(); }
 
         inline float getLevel (const int channel)
         {
@@ -55,6 +78,11 @@ public:
             return 0.f;
         }
 
+        inline float getSendLevel (const int send) const
+        {
+            return isPositiveAndBelow (send, maxSends) ? sendLevels[send].get() : 0.f;
+        }
+
         inline void requestMute (const bool muted)
         {
             nextMute.set (muted ? 1 : 0);
@@ -70,6 +98,24 @@ public:
             requestGain (Decibels::decibelsToGain (dB, -120.f));
         }
 
+        /** Request a balance from -1 (left) to 1 (right) */
+        inline void requestPan (const float newPan)
+        {
+            nextPan.set (jlimit (-1.f, 1.f, newPan));
+        }
+
+        /** Assign a track to a VCA group, -1 for none */
+        inline void requestGroup (const int group)
+        {
+            nextGroup.set (isPositiveAndBelow (group, maxGroups) ? group : -1);
+        }
+
+        inline void requestSendLevel (const int send, const float level)
+        {
+            if (isPositiveAndBelow (send, maxSends))
+                sendLevels[send].set (jmax (0.f, level));
+        }
+
     private:
         friend class AudioMixerProcessor;
         const int trackId;
@@ -79,6 +125,11 @@ public:
         Atomic<int> nextMute;
         Atomic<float> gain;
         Atomic<float> nextGain;
+        Atomic<float> pan;
+        Atomic<float> nextPan;
+        Atomic<int> nextGroup;
+        Atomic<float> sendLevels [maxSends];
+        Atomic<int> changes;
 
         void reset()
         {
@@ -86,11 +137,25 @@ public:
             nextMute = 0;
             gain = 1.f;
             nextGain = 1.f;
+            pan = 0.f;
+            nextPan = 0.f;
+            nextGroup = -1;
+            for (auto& level : sendLevels)
+                level = 0.f;
+            changes = 0;
             if (rms.size() > 0)
                 rms.clearQuick();
             while (rms.size() < numChannels)
                 rms.add (Atomic<float> (0.f));
         }
+
+        void setLevel (const int channel, const float level)
+        {
+            auto& value = rms.getReference (channel);
+            if (std::abs (value.get() - level) > 0.0005f)
+                ++changes;
+            value.set (level);
+        }
     };
 
     typedef ReferenceCountedObjectPtr<Monitor> MonitorPtr;
@@ -103,9 +168,15 @@ public:
         int numOutputs  = 0;
         float lastGain  = 1.0;
         float gain      = 1.0;
+        float pan       = 0.0;
+        int group       = -1;
         bool mute       = false;
+        float sends [maxSends] = {};
         MonitorPtr      monitor;
 
+        // gains applied last block, per channel for the master then each send
+        float lastGains [(1 + maxSends) * 2] = {};
+
         inline void update (const Track* const track)
         {
             this->index         = track->index;
@@ -114,7 +185,11 @@ public:
             this->numOutputs    = track->numOutputs;
             this->gain          = track->gain;
             this->lastGain      = track->gain;
+            this->pan           = track->pan;
+            this->group         = track->group;
             this->mute          = track->mute;
+            for (int i = 0; i < maxSends; ++i)
+                this->sends[i]  = track->sends[i];
             this->monitor       = track->monitor;
         }
     };
@@ -132,6 +207,8 @@ public:
         addParameter (masterMute = new AudioParameterBool ("masterMute", "Master Mute", false));
         addParameter (masterVolume  = new AudioParameterFloat ("masterVolume",  "Master Volume", -120.0f, 12.0f, 0.f));
         masterMonitor = new Monitor (-1, 2);
+        for (int i = 0; i < maxGroups; ++i)
+            groups.add (new Monitor (-2 - i, 2));
     }
 
     ~AudioMixerProcessor();
@@ -156,6 +233,22 @@ public:
     int getNumTracks() const { ScopedLock sl (getCallbackLock()); return tracks.size(); }
     
     MonitorPtr getMonitor (const int track = -1) const;
+
+    /** Returns the monitor controlling a VCA group */
+    MonitorPtr getGroupMonitor (const int group) const { return groups [group]; }
+
+    /** Returns a counter which changes when any monitor changes */
+    int getChangeCount() const { return changes.get(); }
+
+    /** Returns the number of send buses */
+    int getNumSends() const { return jmax (0, getBusCount (false) - 1); }
+
+    /** Change the number of send buses. Call from the message thread */
+    void setNumSends (int numSends);
+
+    /** Send before the track fader and pan instead of after */
+    void setSendPreFader (const int send, const bool preFader);
+    bool isSendPreFader (const int send) const;
     
     void setTrackGain  (const int track, const float gain);
     void setTrackMuted (const int track, const bool mute);
@@ -174,6 +267,8 @@ public:
 
     inline bool isBusesLayoutSupported (const BusesLayout& layout) const override
     {
+        if (layout.getMainOutputChannelSet().size() > 2)
+            return false;
         for (const auto& bus : layout.inputBuses)
             if (bus != layout.getMainOutputChannelSet())
                 return false;
@@ -201,10 +296,18 @@ public:
 
 private:
     MonitorPtr masterMonitor;
+    ReferenceCountedArray<Monitor> groups;
     Array<Track*> tracks;
     int numTracks = 0;
     AudioSampleBuffer tempBuffer;
     float lastGain = 0.f;
+    Atomic<int> sendPreFader [maxSends];
+    Atomic<int> changes;
+    int lastBroadcast = 0;
+    int samplesSinceBroadcast = 0;
+
+    void applyRequests (Track&);
+    void resizeTempBuffer (int numSamples);
     void addMonoTrack();
     void addStereoTrack();
 };
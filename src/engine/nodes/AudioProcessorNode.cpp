@@ -49,10 +49,19 @@ public:
 
     ~AudioProcessorNodeParameter()
     {
-        param.removeListener (this);
+        detach();
         removeListener (this);
     }
 
+    /** Stops listening to the processor's parameter, call before the
+        processor goes away */
+    void detach()
+    {
+        if (! detached)
+            param.removeListener (this);
+        detached = true;
+    }
+
     int getPortIndex() const noexcept override                  { return portIndex; }
     int getParameterIndex() const noexcept override             { return param.getParameterIndex(); }
     float getValue() const override                             { return param.getValue(); }    
@@ -77,6 +86,7 @@ private:
     AudioProcessorParameter& param;
     int portIndex = -1;
     bool ignoreChanges { false };
+    bool detached { false };
 
     void controlValueChanged (int /*index*/, float value) override
     {
@@ -142,9 +152,41 @@ void AudioProcessorNode::EnablementUpdater::handleAsyncUpdate()
     node.setEnabled (! node.isEnabled());
 }
 
+void AudioProcessorNode::audioProcessorChanged (AudioProcessor*)
+{
+    markStateDirty();
+    changes.triggerAsyncUpdate();
+}
+
+void AudioProcessorNode::ChangeUpdater::handleAsyncUpdate()
+{
+    auto* const proc = node.proc.get();
+    if (proc == nullptr)
+        return;
+
+    // processors can change latency after being added, the graph has to
+    // rebuild its delay compensation when they do
+    const int latency = node.getLatencySamples();
+    node.setLatencySamples (proc->getLatencySamples());
+    bool rebuild = latency != node.getLatencySamples();
+
+    // so can the bus layout, e.g. the mixer adding send buses
+    if (proc->getTotalNumInputChannels() != node.getNumAudioInputs() ||
+        proc->getTotalNumOutputChannels() != node.getNumAudioOutputs())
+    {
+        node.triggerPortReset();
+        rebuild = true;
+    }
+
+    if (rebuild)
+        if (auto* graph = node.getParentGraph())
+            graph->triggerAsyncUpdate();
+}
+
 AudioProcessorNode::AudioProcessorNode (uint32 nodeId, AudioProcessor* processor)
     : GraphNode (nodeId),
-      enablement (*this)
+      enablement (*this),
+      changes (*this)
 {
     proc = processor;
     jassert (proc != nullptr);
@@ -153,6 +195,7 @@ AudioProcessorNode::AudioProcessorNode (uint32 nodeId, AudioProcessor* processor
     
     for (auto* param : proc->getParameters())
         params.add (new AudioProcessorNodeParameter (*param));
+    proc->addListener (this);
     
     if (auto* instance = dynamic_cast<AudioPluginInstance*> (proc.get()))
     {
@@ -168,10 +211,28 @@ AudioProcessorNode::~AudioProcessorNode()
 {
     params.clear();
     enablement.cancelPendingUpdate();
+    changes.cancelPendingUpdate();
     pluginState.reset();
+    if (proc != nullptr)
+        proc->removeListener (this);
     proc = nullptr;
 }
 
+AudioProcessor* AudioProcessorNode::releaseAudioProcessor()
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    enablement.cancelPendingUpdate();
+    changes.cancelPendingUpdate();
+    if (proc == nullptr)
+        return nullptr;
+    for (auto* param : params)
+        if (auto* const nodeParam = dynamic_cast<AudioProcessorNodeParameter*> (param))
+            nodeParam->detach();
+    proc->removeListener (this);
+    proc->setPlayHead (nullptr);
+    return proc.release();
+}
+
 void AudioProcessorNode::getState (MemoryBlock& block)
 {
     if (proc != nullptr)
@@ -182,6 +243,15 @@ void AudioProcessorNode::setState (const void* data, int size)
 {
     if (proc != nullptr)
         proc->setStateInformation (data, size);
+    markStateDirty();
+}
+
+bool AudioProcessorNode::canGetStateOffMessageThread() const
+{
+    // graphs and third party plugins have to be asked on the message thread
+    if (auto* const base = dynamic_cast<BaseProcessor*> (proc.get()))
+        return base->canGetStateOffMessageThread();
+    return false;
 }
 
 void AudioProcessorNode::createPorts()
@@ -26,7 +26,8 @@ namespace Element {
 class GraphProcessor;
 class MidiPipe;
 
-class AudioProcessorNode : public GraphNode
+class AudioProcessorNode : public GraphNode,
+                           private AudioProcessorListener
 {
 public:
     AudioProcessorNode (uint32 nodeId, AudioProcessor* processor);
@@ -34,9 +35,16 @@ public:
 
     /** Returns the processor as an AudioProcessor */
     AudioProcessor* getAudioProcessor() const noexcept override { return proc; }
+
+    /** Detaches the processor and returns it, the caller owns it afterwards.
+        Used to pool plugin instances of removed nodes, the node can't be
+        used once this has been called */
+    AudioProcessor* releaseAudioProcessor();
     
     void getState (MemoryBlock&) override;
     void setState (const void*, int) override;
+    bool canGetStateOffMessageThread() const override;
+    bool tracksStateChanges() const override { return true; }
     
     void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override;
@@ -52,6 +60,9 @@ private:
 
     ParameterArray params;
 
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override  { markStateDirty(); }
+    void audioProcessorChanged (AudioProcessor*) override;
+
     struct EnablementUpdater : public AsyncUpdater
     {
         EnablementUpdater (AudioProcessorNode& n) : node (n) { }
@@ -60,6 +71,16 @@ private:
         AudioProcessorNode& node;
     } enablement;
 
+    /** Applies latency and layout changes on the message thread. Processors
+        may report changes from any thread, the audio thread included */
+    struct ChangeUpdater : public AsyncUpdater
+    {
+        ChangeUpdater (AudioProcessorNode& n) : node (n) { }
+        ~ChangeUpdater() { }
+        void handleAsyncUpdate() override;
+        AudioProcessorNode& node;
+    } changes;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioProcessorNode);
 };
 
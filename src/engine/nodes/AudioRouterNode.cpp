@@ -21,28 +21,26 @@
 #include "engine/nodes/AudioRouterNode.h"
 #include "Common.h"
 
-#define TRACE_AUDIO_ROUTER(output) 
-
 namespace Element {
 
 AudioRouterNode::AudioRouterNode (int ins, int outs)
     : GraphNode (0),
-      numSources (ins),
-      numDestinations (outs),
-      state (ins, outs),
-      toggles (ins, outs),
-      nextToggles (ins, outs)
+      numSources (jlimit (1, maxChannels, ins)),
+      numDestinations (jlimit (1, maxChannels, outs))
 {
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_AUDIO_ROUTER, nullptr);
     
-    fadeIn.setFadesIn (true);
-    fadeIn.setLength (fadeLengthSeconds);
-    fadeOut.setFadesIn (false);
-    fadeOut.setLength (fadeLengthSeconds);
+    fadeLengthSeconds.set (0.001); // 1 ms
+    gains.resize ((size_t) (numSources * numDestinations), 0.0f);
 
-    clearPatches();
+    // sized for the largest matrix so resizing never reallocates under the renderer
+    const auto numCrosspoints = (size_t) (maxChannels * maxChannels);
+    current.resize (numCrosspoints, 0.0f);
+    targets.resize (numCrosspoints, 0.0f);
+    mix.reserve (numCrosspoints);
+    nextMix.reserve (numCrosspoints);
 
     auto* program = programs.add (new Program ("Linear Stereo"));
     program->matrix.resize (ins, outs);
@@ -81,7 +79,17 @@ AudioRouterNode::AudioRouterNode (int ins, int outs)
     }
 }
 
-AudioRouterNode::~AudioRouterNode() { }
+AudioRouterNode::~AudioRouterNode()
+{
+    pending.store (nullptr);
+    routings.clear();
+}
+
+void AudioRouterNode::prepareToRender (double newSampleRate, int maxBufferSize)
+{
+    sampleRate = newSampleRate;
+    tempAudio.setSize (maxChannels, jmax (1, maxBufferSize), false, false, true);
+}
 
 void AudioRouterNode::setCurrentProgram (int index)
 {
@@ -92,24 +100,123 @@ void AudioRouterNode::setCurrentProgram (int index)
     }
 }
 
+void AudioRouterNode::setSize (int ins, int outs)
+{
+    ins  = jlimit (1, maxChannels, ins);
+    outs = jlimit (1, maxChannels, outs);
+    if (ins == numSources && outs == numDestinations)
+        return;
+
+    std::vector<float> newGains ((size_t) (ins * outs), 0.0f);
+    for (int src = 0; src < jmin (ins, numSources); ++src)
+        for (int dst = 0; dst < jmin (outs, numDestinations); ++dst)
+            newGains [(size_t) (src * outs + dst)] = getGain (src, dst);
+
+    numSources = ins;
+    numDestinations = outs;
+    gains.swap (newGains);
+    publish();
+    triggerPortReset();
+    sendChangeMessage();
+}
+
 void AudioRouterNode::setMatrixState (const MatrixState& matrix)
 {
-    jassert (state.sameSizeAs (matrix));
-    state = matrix;
-    ToggleGrid newPatches (state);
+    for (int src = 0; src < numSources; ++src)
+        for (int dst = 0; dst < numDestinations; ++dst)
+            gains [(size_t) (src * numDestinations + dst)] =
+                src < matrix.getNumRows() && dst < matrix.getNumColumns() && matrix.connected (src, dst)
+                    ? 1.0f : 0.0f;
+    publish();
+    sendChangeMessage();
+}
 
+MatrixState AudioRouterNode::getMatrixState() const
+{
+    MatrixState matrix (numSources, numDestinations);
+    for (int src = 0; src < numSources; ++src)
+        for (int dst = 0; dst < numDestinations; ++dst)
+            matrix.set (src, dst, getGain (src, dst) > 0.0f);
+    return matrix;
+}
+
+void AudioRouterNode::setGain (int src, int dst, float gain)
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return;
+    auto& value = gains [(size_t) (src * numDestinations + dst)];
+    gain = jmax (0.0f, gain);
+    if (value == gain)
+        return;
+    value = gain;
+    publish();
+    sendChangeMessage();
+}
+
+float AudioRouterNode::getGain (int src, int dst) const
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return 0.0f;
+    return gains [(size_t) (src * numDestinations + dst)];
+}
+
+void AudioRouterNode::publish()
+{
+    // visit outputs in order so each one stays hot in cache
+    auto routing = std::make_unique<Routing>();
+    for (int dst = 0; dst < numDestinations; ++dst)
     {
-        ScopedLock sl (getLock());
-        nextToggles.swapWith (newPatches);
-        togglesChanged = true; // initiate the crossfade
+        for (int src = 0; src < numSources; ++src)
+        {
+            const auto gain = gains [(size_t) (src * numDestinations + dst)];
+            if (gain > 0.0f)
+                routing->points.push_back ({ src, dst, gain });
+        }
     }
 
-    sendChangeMessage();
+    routing->serial = ++lastSerial;
+    auto* const skipped = pending.exchange (routing.get());
+    routings.push_back (std::move (routing));
+
+    // the renderer only moves forward, anything older than what it's using
+    // will never be picked up again. neither will one it didn't take in
+    // time, so nothing piles up while the node isn't rendering
+    const auto inUse = activeSerial.load();
+    routings.erase (std::remove_if (routings.begin(), routings.end(),
+        [inUse, skipped] (const std::unique_ptr<Routing>& r) { return r->serial < inUse || r.get() == skipped; }),
+        routings.end());
 }
 
-MatrixState AudioRouterNode::getMatrixState() const
+void AudioRouterNode::adopt (const Routing& routing)
 {
-    return state;
+    // start from what is being heard, which may be part way through a fade
+    const float progress = fadePosition < fadeLength ? (float) fadePosition / (float) fadeLength : 1.0f;
+    for (const auto& point : mix)
+    {
+        const auto index = (size_t) (point.source * maxChannels + point.destination);
+        current [index] = point.from + (point.to - point.from) * progress;
+        targets [index] = 0.0f;
+    }
+
+    nextMix.clear();
+    for (const auto& point : routing.points)
+    {
+        const auto index = (size_t) (point.source * maxChannels + point.destination);
+        targets [index] = point.gain;
+        nextMix.push_back ({ point.source, point.destination, current [index], point.gain });
+    }
+
+    // crosspoints turning off fade out, silent ones are dropped
+    for (const auto& point : mix)
+    {
+        const auto index = (size_t) (point.source * maxChannels + point.destination);
+        if (targets [index] <= 0.0f && current [index] > 0.0f)
+            nextMix.push_back ({ point.source, point.destination, current [index], 0.0f });
+    }
+
+    mix.swap (nextMix);
+    fadePosition = 0;
+    fadeLength = jmax (1, roundToInt (fadeLengthSeconds.get() * sampleRate));
 }
 
 void AudioRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
@@ -129,140 +236,68 @@ void AudioRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
             { DBG("program "); }
     }
 
-    const int numFrames = audio.getNumSamples();
-    const int numChannels = audio.getNumChannels();
-
-    tempAudio.setSize (numChannels, numFrames, false, false, true);
-    tempAudio.clear (0, numFrames);
-
-    if (togglesChanged)
+    if (auto* next = pending.exchange (nullptr))
     {
-        fadeIn.reset();
-        fadeIn.startFading();
-        fadeOut.reset();
-        fadeOut.startFading();
-        togglesChanged = false;
-        TRACE_AUDIO_ROUTER("fade start");
+        adopt (*next);
+        activeSerial.store (next->serial);
     }
 
-    if (fadeIn.isActive() || fadeOut.isActive())
+    const int numFrames = jmin (audio.getNumSamples(), tempAudio.getNumSamples());
+    const int numChannels = jmin (audio.getNumChannels(), tempAudio.getNumChannels());
+    jassert (numFrames == audio.getNumSamples());
+
+    for (int c = 0; c < numChannels; ++c)
+        FloatVectorOperations::clear (tempAudio.getWritePointer (c), numFrames);
+
+    if (! mix.empty())
     {
-        auto framesToProcess = numFrames;
-        int frame = 0;
-        ScopedLock sl (lock);
-        
-        float fadeInGain  = 0.0f;
-        float fadeOutGain = 1.0f;
-
-        while (--framesToProcess >= 0)
+        const bool fading = fadePosition < fadeLength;
+        const int rampFrames = fading ? jmin (numFrames, fadeLength - fadePosition) : 0;
+        const float rampStart = fading ? (float) fadePosition / (float) fadeLength : 1.0f;
+        const float rampEnd   = fading ? (float) (fadePosition + rampFrames) / (float) fadeLength : 1.0f;
+
+        for (const auto& point : mix)
         {
-            fadeInGain  = fadeIn.isActive()  ? fadeIn.getNextEnvelopeValue()  : 1.0f;
-            fadeOutGain = fadeOut.isActive() ? fadeOut.getNextEnvelopeValue() : 0.0f;
+            if (point.source >= numChannels || point.destination >= numChannels)
+                continue;
+
+            const auto* const src = audio.getReadPointer (point.source);
+            auto* const dst = tempAudio.getWritePointer (point.destination);
 
-            if (!fadeIn.isActive() && !fadeOut.isActive())
+            if (rampFrames > 0 && point.from != point.to)
             {
-                TRACE_AUDIO_ROUTER("last frame fade in gain  : " << fadeInGain);
-                TRACE_AUDIO_ROUTER("last frame fade out gain : " << fadeOutGain);
+                const auto delta = point.to - point.from;
+                tempAudio.addFromWithRamp (point.destination, 0, src, rampFrames,
+                                           point.from + delta * rampStart,
+                                           point.from + delta * rampEnd);
+                if (rampFrames < numFrames && point.to > 0.0f)
+                    FloatVectorOperations::addWithMultiply (dst + rampFrames, src + rampFrames,
+                                                            point.to, numFrames - rampFrames);
             }
-
-            for (int i = 0; i < numSources; ++i)
+            else if (point.to == 1.0f)
             {
-                for (int j = 0; j < numDestinations; ++j)
-                {
-                    if (toggles.get (i, j) && nextToggles.get (i, j))
-                    {
-                        // no patch change and on means 1 to 1 mix
-                        tempAudio.getWritePointer(j)[frame] += 
-                            audio.getReadPointer(i)[frame];
-                    }
-                    else if (! toggles.get (i, j) && ! nextToggles.get (i, j))
-                    {
-                        // no patch change and off means no fade and zero'd
-                        tempAudio.getWritePointer(j)[frame] += 0.0f;
-                    }
-                    else if (!toggles.get (i, j) && nextToggles.get (i, j))
-                    {
-                        tempAudio.getWritePointer(j)[frame] += 
-                            (audio.getReadPointer(i)[frame] * fadeInGain);
-                    }
-                    else if (toggles.get (i, j) && !nextToggles.get (i, j))
-                    {
-                        tempAudio.getWritePointer(j)[frame] += 
-                            (audio.getReadPointer(i)[frame] * fadeOutGain);
-                    }
-                }
+                FloatVectorOperations::add (dst, src, numFrames);
             }
-
-            ++frame;
-
-            if (!fadeIn.isActive() && !fadeOut.isActive())
-                break;
-        }
-
-        if (!fadeOut.isActive() && !fadeIn.isActive())
-        {
-            TRACE_AUDIO_ROUTER("fade stopped @ frame: " << (frame));
-            TRACE_AUDIO_ROUTER("fade in level  : " << fadeInGain);
-            TRACE_AUDIO_ROUTER("fade out level : " << fadeOutGain);
-
-            if (framesToProcess > 0)
+            else if (point.to > 0.0f)
             {
-                TRACE_AUDIO_ROUTER("rendering " << framesToProcess << " remainging frames");
-                for (int i = 0; i < numSources; ++i)
-                {
-                    for (int j = 0; j < numDestinations; ++j)
-                    {
-                        if (toggles.get(i, j) && nextToggles.get (i, j))
-                        {
-                            // no patch change and on means 1 to 1 mix
-                            tempAudio.addFrom (j, frame, audio.getReadPointer (i, frame), 
-                                               framesToProcess);
-                        }
-                        else if (! toggles.get (i, j) && ! nextToggles.get (i, j))
-                        {
-                            // patch not changed and of, so clear the out channel.
-                            // nothing to do
-                        }
-                        else if (!toggles.get (i, j) && nextToggles.get (i, j))
-                        {
-                            tempAudio.addFromWithRamp (j, frame, audio.getReadPointer (i, frame), 
-                                                          framesToProcess, fadeInGain, 1.0f);
-                        }
-                        else if (toggles.get (i, j) && !nextToggles.get (i, j))
-                        {
-                            tempAudio.addFromWithRamp (j, frame, audio.getReadPointer (i, frame),
-                                                          framesToProcess, fadeOutGain, 0.0f);
-                        }
-                        else
-                        {
-                            // this would be an unhandled fading scenario
-                            jassertfalse;
-                        }
-                    }
-                }
+                FloatVectorOperations::addWithMultiply (dst, src, point.to, numFrames);
             }
-
-            toggles.swapWith (nextToggles);
         }
-    }
-    else
-    {
-        ScopedLock sl (lock);
-        for (int i = 0; i < numSources; ++i)
-            for (int j = 0; j < numDestinations; ++j)
-                if (toggles.get (i, j))
-                    tempAudio.addFrom (j, 0, audio, i, 0, numFrames);
+
+        fadePosition += rampFrames;
     }
 
     for (int c = 0; c < numChannels; ++c)
-        audio.copyFrom (c, 0, tempAudio.getReadPointer(c), numFrames);
+        audio.copyFrom (c, 0, tempAudio.getReadPointer (c), numFrames);
     midi.clear();
 }
 
 void AudioRouterNode::getState (MemoryBlock& block)
 {
     MemoryOutputStream stream (block, false);
-    state.createValueTree().writeToStream (stream);
+    auto tree = getMatrixState().createValueTree();
+    tree.setProperty ("gains", MemoryBlock (gains.data(), sizeof (float) * gains.size()), nullptr);
+    tree.writeToStream (stream);
 }
 
 void AudioRouterNode::setState (const void* data, int sizeInBytes)
@@ -273,36 +308,20 @@ void AudioRouterNode::setState (const void* data, int sizeInBytes)
     {
         kv::MatrixState matrix;
         matrix.restoreFromValueTree (tree);
-        jassert (matrix.getNumRows() == numSources && matrix.getNumColumns() == numDestinations);
+        setSize (matrix.getNumRows(), matrix.getNumColumns());
         setMatrixState (matrix);
-    }
-}
 
-void AudioRouterNode::setWithoutLocking (int src, int dst, bool set)
-{
-    jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
-    toggles.set (src, dst, set);
-    state.set (src, dst, set);
-}
-
-void AudioRouterNode::set (int src, int dst, bool patched)
-{
-    jassert (src >= 0 && src < numSources && dst >= 0 && numDestinations < 4);
-    toggles.set (src, dst, patched);
-    state.set (src, dst, patched);
-}
-
-void AudioRouterNode::clearPatches()
-{
-    {
-        ScopedLock sl (getLock());
-        toggles.clear();
-        nextToggles.clear();
+        // routers saved before gains existed only have toggles
+        if (const auto* block = tree.getProperty ("gains").getBinaryData())
+        {
+            if (block->getSize() == sizeof (float) * gains.size())
+            {
+                block->copyTo (gains.data(), 0, block->getSize());
+                publish();
+                sendChangeMessage();
+            }
+        }
     }
-
-    for (int r = 0; r < state.getNumRows(); ++r)
-        for (int c = 0; c < state.getNumColumns(); ++c)
-            state.set (r, c, false);
 }
 
 }
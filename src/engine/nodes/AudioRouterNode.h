@@ -20,20 +20,29 @@
 #pragma once
 
 #include "engine/GraphNode.h"
-#include "engine/LinearFade.h"
-#include "engine/ToggleGrid.h"
 #include "engine/nodes/BaseProcessor.h"
 
 namespace Element {
 
+/** An N x M audio matrix mixer with a gain at each crosspoint.
+
+    The message thread keeps the full gain matrix. Whenever it changes, a
+    list of the non-zero crosspoints is built and handed to the renderer
+    through an atomic pointer, so rendering never locks and only touches
+    crosspoints which carry audio. Each change crossfades from the gains
+    being heard, even part way through a fade, over the fade length.
+ */
 class AudioRouterNode : public GraphNode,
                         public ChangeBroadcaster
 {
 public:
+    /** Largest number of inputs or outputs */
+    static constexpr int maxChannels = 64;
+
     explicit AudioRouterNode (int ins = 4, int outs = 4);
     ~AudioRouterNode();
 
-    void prepareToRender (double sampleRate, int maxBufferSize) override { ignoreUnused (sampleRate, maxBufferSize); }
+    void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override { }
 
     inline bool wantsMidiPipe() const override { return true; }
@@ -41,10 +50,24 @@ public:
     void getState (MemoryBlock&) override;
     void setState (const void*, int sizeInBytes) override;
 
+    /** Change the number of inputs and outputs. Gains which still fit are
+        kept and ports are reset asynchronously */
+    void setSize (int ins, int outs);
+
+    int getNumSources() const noexcept      { return numSources; }
+    int getNumDestinations() const noexcept { return numDestinations; }
+
+    /** Set every crosspoint from a toggle matrix, on is unity gain */
     void setMatrixState (const MatrixState&);
+
+    /** Returns which crosspoints have a non-zero gain */
     MatrixState getMatrixState() const;
-    void setWithoutLocking (int src, int dst, bool set);
-    CriticalSection& getLock() { return lock; }
+
+    /** Set the linear gain of one crosspoint */
+    void setGain (int src, int dst, float gain);
+
+    /** Returns the linear gain of a crosspoint */
+    float getGain (int src, int dst) const;
 
     int getNumPrograms() const override { return jmax (1, programs.size()); }
     int getCurrentProgram() const override { return currentProgram; }
@@ -58,11 +81,7 @@ public:
 
     void setFadeLength (double seconds)
     {
-        seconds = jlimit (0.001, 5.0, seconds);
-        ScopedLock sl (lock);
-        fadeLengthSeconds = seconds;
-        fadeIn.setLength (static_cast<float> (fadeLengthSeconds));
-        fadeOut.setLength (static_cast<float> (fadeLengthSeconds));
+        fadeLengthSeconds.set (jlimit (0.001, 5.0, seconds));
     }
 
     void getPluginDescription (PluginDescription& desc) const override
@@ -70,8 +89,8 @@ public:
         desc.fileOrIdentifier   = EL_INTERNAL_ID_AUDIO_ROUTER;
         desc.name               = "Audio Router";
         desc.descriptiveName    = "An Audio Patch Grid";
-        desc.numInputChannels   = numDestinations;
-        desc.numOutputChannels  = numSources;
+        desc.numInputChannels   = numSources;
+        desc.numOutputChannels  = numDestinations;
         desc.hasSharedContainer = false;
         desc.isInstrument       = false;
         desc.manufacturerName   = "Element";
@@ -83,27 +102,22 @@ public:
 protected:
     inline void createPorts() override
     {
-        if (ports.size() > 0)
-            return;
+        ports.clearQuick();
         int index = 0;
 
-        ports.add (PortType::Audio, index++, 0, "audio_in_0", "Input 1", true);
-        ports.add (PortType::Audio, index++, 1, "audio_in_1", "Input 2", true);
-        ports.add (PortType::Audio, index++, 2, "audio_in_2", "Input 3", true);
-        ports.add (PortType::Audio, index++, 3, "audio_in_3", "Input 4", true);
-
-        ports.add (PortType::Audio, index++, 0, "audio_out_0", "Output 1", false);
-        ports.add (PortType::Audio, index++, 1, "audio_out_1", "Output 2", false);
-        ports.add (PortType::Audio, index++, 2, "audio_out_2", "Output 3", false);
-        ports.add (PortType::Audio, index++, 3, "audio_out_3", "Output 4", false);
+        for (int i = 0; i < numSources; ++i)
+            ports.add (PortType::Audio, index++, i, String ("audio_in_") + String (i),
+                       String ("Input ") + String (i + 1), true);
+        for (int i = 0; i < numDestinations; ++i)
+            ports.add (PortType::Audio, index++, i, String ("audio_out_") + String (i),
+                       String ("Output ") + String (i + 1), false);
 
         ports.add (PortType::Midi, index++, 0, "midi_in",  "MIDI In",  true);
     }
 
 private:
-    CriticalSection lock;
-    const int numSources;
-    const int numDestinations;
+    int numSources;
+    int numDestinations;
     AudioSampleBuffer tempAudio { 1, 1 };
     
     struct Program
@@ -118,18 +132,45 @@ private:
     OwnedArray<Program> programs;
     int currentProgram = -1;
 
-    void set (int src, int dst, bool patched);
-    void clearPatches();
+    // message thread: the full matrix, row major by source
+    std::vector<float> gains;
+
+    struct Target
+    {
+        int source, destination;
+        float gain;
+    };
+
+    /** Non-zero crosspoints handed to the renderer. Sorted by destination */
+    struct Routing
+    {
+        uint32 serial = 0;
+        std::vector<Target> points;
+    };
+
+    std::vector<std::unique_ptr<Routing>> routings;     // owned by the message thread
+    uint32 lastSerial = 0;
+    std::atomic<Routing*> pending { nullptr };
+    std::atomic<uint32> activeSerial { 0 };
+
+    // render thread. gains are indexed by source * maxChannels + destination
+    struct Crosspoint
+    {
+        int source, destination;
+        float from, to;
+    };
+
+    std::vector<Crosspoint> mix, nextMix;   // what is being rendered
+    std::vector<float> current;             // gains heard when the fade last started
+    std::vector<float> targets;             // gains of the active routing
+    int fadePosition = 0;
+    int fadeLength = 0;
+    double sampleRate = 44100.0;
 
-    // used by the UI, but not the rendering
-    MatrixState state;
+    AtomicValue<double> fadeLengthSeconds;
 
-    double fadeLengthSeconds { 0.001 }; // 1 ms
-    LinearFade fadeIn;
-    LinearFade fadeOut;
-    ToggleGrid toggles;
-    ToggleGrid nextToggles;
-    bool togglesChanged { false };
+    void publish();
+    void adopt (const Routing&);
 };
 
 }
@@ -47,6 +47,10 @@
 #define EL_INTERNAL_ID_LUA                      "element.lua"
 #define EL_INTERNAL_ID_COMPRESSOR               "element.compressor"
 #define EL_INTERNAL_ID_MIDI_ROUTER              "element.midiRouter"
+#define EL_INTERNAL_ID_CONVOLUTION              "element.convolution"
+#define EL_INTERNAL_ID_TRUE_PEAK_LIMITER        "element.truePeakLimiter"
+#define EL_INTERNAL_ID_LOUDNESS_METER           "element.loudnessMeter"
+#define EL_INTERNAL_ID_SAMPLER                  "element.sampler"
 
 #define EL_INTERNAL_UID_AUDIO_FILE_PLAYER        1000
 #define EL_INTERNAL_UID_AUDIO_MIXER              1001
@@ -72,6 +76,10 @@
 #define EL_INTERNAL_UID_LUA                      1021
 #define EL_INTERNAL_UID_COMPRESSOR               1022
 #define EL_INTERNAL_UID_MIDI_ROUTER              1023
+#define EL_INTERNAL_UID_CONVOLUTION              1024
+#define EL_INTERNAL_UID_TRUE_PEAK_LIMITER        1025
+#define EL_INTERNAL_UID_LOUDNESS_METER           1026
+#define EL_INTERNAL_UID_SAMPLER                  1027
 
 namespace Element {
 
@@ -83,6 +91,11 @@ public:
         : AudioPluginInstance (ioLayouts) { }
     virtual ~BaseProcessor() { }
 
+    /** Returns true if getStateInformation() may be called from a background
+        thread while the processor runs. Override when the state is only
+        made of parameter values */
+    virtual bool canGetStateOffMessageThread() const { return false; }
+
 #if 0
     // Audio Processor Template
     virtual const String getName() const = 0;
@@ -82,6 +82,20 @@ public:
     inline void releaseResources() override { }
 
     inline void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override
+    {
+        ignoreUnused (buffer);
+        process (midiMessages);
+    }
+
+    inline void processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages) override
+    {
+        ignoreUnused (buffer);
+        process (midiMessages);
+    }
+
+    inline bool supportsDoublePrecisionProcessing() const override { return true; }
+
+    inline void process (MidiBuffer& midiMessages)
     {
         const int outChan = *channel;
         if (outChan <= 0)
@@ -136,15 +150,11 @@ public:
     // Audio Processor Template
     virtual StringArray getAlternateDisplayNames() const;
     
-
-    virtual void processBlock (AudioBuffer<double>& buffer, idiBuffer& midiMessages);
-    
     virtual void processBlockBypassed (AudioBuffer<float>& buffer, MidiBuffer& midiMessages);
     virtual void processBlockBypassed (AudioBuffer<double>& buffer, MidiBuffer& midiMessages);
     
     virtual bool canAddBus (bool isInput) const                     { ignoreUnused (isInput); return false; }
     virtual bool canRemoveBus (bool isInput) const                  { ignoreUnused (isInput); return false; }
-    virtual bool supportsDoublePrecisionProcessing() const;
     
     virtual void reset();
     virtual void setNonRealtime (bool isNonRealtime) noexcept;
@@ -22,13 +22,16 @@ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 
 namespace Element {
 
+static const float maxLookaheadMs = 10.0f;
+
 CompressorProcessor::CompressorProcessor (const int _numChannels)
     : BaseProcessor (BusesProperties()
         .withInput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))),
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
+        .withInput ("Sidechain", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)), false)),
     numChannels (jlimit (1, 2, _numChannels))
 {
-    setPlayConfigDetails (numChannels, numChannels, 44100.0, 1024);
+    setRateAndBufferSizeDetails (44100.0, 1024);
 
     NormalisableRange<float> ratioRange (0.5f, 10.0f);
     ratioRange.setSkewForCentre (2.0f);
@@ -45,10 +48,17 @@ CompressorProcessor::CompressorProcessor (const int _numChannels)
     addParameter (attackMs  = new AudioParameterFloat ("attack",  "Attack [ms]",    attackRange, 10.0f));
     addParameter (releaseMs = new AudioParameterFloat ("release", "Release [ms]",   releaseRange, 100.0f));
     addParameter (makeupDB  = new AudioParameterFloat ("makeup",  "Makeup [dB]",    -18.0f, 18.0f, 0.0f));
+    addParameter (lookaheadMs = new AudioParameterFloat ("lookahead", "Lookahead [ms]", 0.0f, maxLookaheadMs, 0.0f));
+    addParameter (detectorSource = new AudioParameterChoice ("detector", "Detector", { "Main", "Sidechain" }, 0));
 
     makeupGain.reset (numSteps);
 }
 
+CompressorProcessor::~CompressorProcessor()
+{
+    cancelPendingUpdate();
+}
+
 void CompressorProcessor::fillInPluginDescription (PluginDescription& desc) const
 {
     desc.name = getName();
@@ -77,38 +87,119 @@ void CompressorProcessor::updateParams()
 
 void CompressorProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
 {
+    setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+
+    updateParams();
     detector.reset ((float) sampleRate);
     gainComputer.reset();
+    makeupGain.setCurrentAndTargetValue (makeupGain.getTargetValue());
+
+    const int blockSize = jmax (32, maximumExpectedSamplesPerBlock);
+    maxDelaySamples = roundToInt (sampleRate * maxLookaheadMs / 1000.0);
+    scratch.setSize (2, blockSize, false, false, true);
+    delayLine.setSize (2, maxDelaySamples + blockSize, false, false, true);
+    delayLine.clear();
+    delaySamples = getLookaheadSamples();
+    pendingLatency.set (delaySamples);
+    setLatencySamples (delaySamples);
+
+    inputLevel.set (0.0f);
+    minGain.set (1.0f);
+}
 
-    setPlayConfigDetails (numChannels, numChannels, sampleRate, maximumExpectedSamplesPerBlock);
+void CompressorProcessor::releaseResources()
+{
+    scratch.setSize (1, 1);
+    delayLine.setSize (1, 1);
+    maxDelaySamples = delaySamples = 0;
 }
 
-void CompressorProcessor::releaseResources() {}
+int CompressorProcessor::getLookaheadSamples() const
+{
+    return jlimit (0, maxDelaySamples, roundToInt (getSampleRate() * (double) *lookaheadMs / 1000.0));
+}
 
-void CompressorProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+void CompressorProcessor::applyLookahead (int channel, float* data, int numSamples)
 {
-    auto numBuffChannels = buffer.getNumChannels();
+    // the line holds the last delaySamples of input followed by this block
+    auto* const line = delayLine.getWritePointer (channel);
+    FloatVectorOperations::copy (line + delaySamples, data, numSamples);
+    FloatVectorOperations::copy (data, line, numSamples);
+    memmove (line, line + numSamples, sizeof (float) * (size_t) delaySamples);
+}
 
+void CompressorProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
     updateParams();
 
-    float level = 0.0f;
-    for (int n = 0; n < buffer.getNumSamples(); ++n)
+    auto mainBuffer = getBusBuffer (buffer, true, 0);
+    auto sidechainBuffer = getBusBuffer (buffer, true, 1);
+    const auto& source = detectorSource->getIndex() == 1 && sidechainBuffer.getNumChannels() > 0
+        ? sidechainBuffer : mainBuffer;
+    const int numMainChannels = jmin (mainBuffer.getNumChannels(), delayLine.getNumChannels());
+    const int numSourceChannels = source.getNumChannels();
+
+    const int newDelay = getLookaheadSamples();
+    if (newDelay != delaySamples)
+    {
+        // latency can only be reported from the message thread
+        delayLine.clear();
+        delaySamples = newDelay;
+        pendingLatency.set (newDelay);
+        triggerAsyncUpdate();
+    }
+
+    auto* const levels = scratch.getWritePointer (0);
+    auto* const gains  = scratch.getWritePointer (1);
+    float peakLevel = 0.0f;
+    float lowestGain = 1.0f;
+
+    for (int offset = 0; offset < buffer.getNumSamples();)
     {
-        // Sum input from channels
-        float detectorInput = 0.0f;
-        for (int ch = 0; ch < numBuffChannels; ++ch)
-            detectorInput += buffer.getSample (ch, n);
-        detectorInput /= (float) numBuffChannels;
-
-        // Get level estimate, and compute gain
-        level = detector.process (detectorInput);
-        float gain = gainComputer.process (level);
-
-        // Apply gain
-        buffer.applyGain (n, 1, gain * makeupGain.getNextValue());
+        const int numSamples = jmin (buffer.getNumSamples() - offset, scratch.getNumSamples());
+
+        // mix down the detector input. this is taken before the lookahead
+        // delay so gain reduction leads the audio
+        FloatVectorOperations::copy (levels, source.getReadPointer (0, offset), numSamples);
+        for (int ch = 1; ch < numSourceChannels; ++ch)
+            FloatVectorOperations::add (levels, source.getReadPointer (ch, offset), numSamples);
+        if (numSourceChannels > 1)
+            FloatVectorOperations::multiply (levels, 1.0f / (float) numSourceChannels, numSamples);
+
+        detector.process (levels, numSamples);
+        gainComputer.process (levels, gains, numSamples);
+
+        peakLevel  = jmax (peakLevel, FloatVectorOperations::findMaximum (levels, numSamples));
+        lowestGain = jmin (lowestGain, FloatVectorOperations::findMinimum (gains, numSamples));
+
+        if (makeupGain.isSmoothing())
+        {
+            for (int i = 0; i < numSamples; ++i)
+                gains[i] *= makeupGain.getNextValue();
+        }
+        else
+        {
+            FloatVectorOperations::multiply (gains, makeupGain.getCurrentValue(), numSamples);
+        }
+
+        for (int ch = 0; ch < numMainChannels; ++ch)
+        {
+            auto* const data = mainBuffer.getWritePointer (ch, offset);
+            if (delaySamples > 0)
+                applyLookahead (ch, data, numSamples);
+            FloatVectorOperations::multiply (data, gains, numSamples);
+        }
+
+        offset += numSamples;
     }
 
-    listeners.call (&Listener::updateInGainDB, Decibels::gainToDecibels (level));
+    inputLevel.set (peakLevel);
+    minGain.set (lowestGain);
+}
+
+void CompressorProcessor::handleAsyncUpdate()
+{
+    setLatencySamples (pendingLatency.get());
 }
 
 float CompressorProcessor::calcGainDB (float db)
@@ -129,6 +220,8 @@ void CompressorProcessor::getStateInformation (juce::MemoryBlock& destData)
     state.setProperty ("attack",  (float) *attackMs,  0);
     state.setProperty ("release", (float) *releaseMs, 0);
     state.setProperty ("makeup",  (float) *makeupDB,  0);
+    state.setProperty ("lookahead", (float) *lookaheadMs, 0);
+    state.setProperty ("detector", detectorSource->getIndex(), 0);
     if (auto e = state.createXml())
         AudioProcessor::copyXmlToBinary (*e, destData);
 }
@@ -146,13 +239,15 @@ void CompressorProcessor::setStateInformation (const void* data, int sizeInBytes
             *attackMs  = (float) state.getProperty ("attack",  (float) *attackMs);
             *releaseMs = (float) state.getProperty ("release", (float) *releaseMs);
             *makeupDB  = (float) state.getProperty ("makeup",  (float) *makeupDB);
+            *lookaheadMs = (float) state.getProperty ("lookahead", 0.0f);
+            *detectorSource = (int) state.getProperty ("detector", 0);
         }
     }
 }
 
 void CompressorProcessor::numChannelsChanged()
 {
-    numChannels = getTotalNumInputChannels();
+    numChannels = getMainBusNumInputChannels();
 }
 
 }
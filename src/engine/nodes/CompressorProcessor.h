@@ -74,6 +74,22 @@ public:
         return levelEstimate;
     }
 
+    /* Process a block in place, replacing samples with the level estimate.
+       The filter is recursive so this can't be vectorized, but keeping it
+       in a tight loop over a contiguous buffer lets the compiler keep the
+       state and coefficients in registers */
+    inline void process (float* data, int numSamples)
+    {
+        auto level = levelEstimate;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto x = fabsf (data[i]);
+            level += (x > level ? b0_a : b0_r) * (x - level);
+            data[i] = level;
+        }
+        levelEstimate = level;
+    }
+
     void setLevelEstimate (float levelEst) { levelEstimate = levelEst; }
     float getLevelEstimate() { return levelEstimate; }
 
@@ -159,6 +175,23 @@ public:
         return calcGain (x, thresh.getNextValue(), ratio.getNextValue());
     }
 
+    /* Compute gains for a block of levels */
+    inline void process (const float* levels, float* gains, int numSamples)
+    {
+        if (thresh.isSmoothing() || ratio.isSmoothing())
+        {
+            for (int i = 0; i < numSamples; ++i)
+                gains[i] = process (levels[i]);
+            return;
+        }
+
+        // parameters are steady, skip stepping the smoothers per sample
+        const auto curThresh = thresh.getCurrentValue();
+        const auto curRatio  = ratio.getCurrentValue();
+        for (int i = 0; i < numSamples; ++i)
+            gains[i] = calcGain (levels[i], curThresh, curRatio);
+    }
+
 private:
     // recalculate knee values for a new threshold or knee width
     void recalcKnees()
@@ -189,11 +222,20 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GainComputer)
 };
 
-/** Compressor Processing */
-class CompressorProcessor : public BaseProcessor
+/** Compressor Processing
+
+    Audio is processed in blocks: the detector input is mixed down from the
+    main or sidechain bus, levels and gains are computed for the whole block,
+    then gain is applied to each channel in one pass. With lookahead the main
+    signal is delayed so gain reduction leads the audio, and the delay is
+    reported as latency.
+ */
+class CompressorProcessor : public BaseProcessor,
+                            private AsyncUpdater
 {
 public:
     explicit CompressorProcessor (const int _numChannels = 2);
+    ~CompressorProcessor();
 
     const String getName() const override { return "Compressor"; }
 
@@ -218,34 +260,33 @@ public:
     const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
     void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
 
+    bool canGetStateOffMessageThread() const override { return true; }
     void getStateInformation (juce::MemoryBlock& destData) override;
 
     void setStateInformation (const void* data, int sizeInBytes) override;
     void numChannelsChanged() override;
 
-    class Listener
-    {
-    public:
-        virtual ~Listener() {}
-        virtual void updateInGainDB (float /*inDB*/) {}
-    };
+    /** Returns the peak detector level of the last block in decibels.
+        Safe to call from any thread */
+    float getInputLevelDB() const noexcept  { return Decibels::gainToDecibels (inputLevel.get()); }
 
-    void addListener (Listener* l) { listeners.add (l); }
-    void removeListener (Listener* l) { listeners.remove (l); }
+    /** Returns the most gain reduction applied in the last block in decibels.
+        Safe to call from any thread */
+    float getGainReductionDB() const noexcept { return Decibels::gainToDecibels (minGain.get()); }
 
 protected:
     inline bool isBusesLayoutSupported (const BusesLayout& layout) const override 
     {
-        // supports single bus only
-        if (layout.inputBuses.size() != 1 && layout.outputBuses.size() != 1)
-            return false;
-
-        // ins must equal outs
+        // main ins must equal outs
         if (layout.getMainInputChannels() != layout.getMainOutputChannels())
             return false;
 
         const auto nchans = layout.getMainInputChannels();
-        return nchans >= 1 && nchans <= 2;
+        if (nchans < 1 || nchans > 2)
+            return false;
+
+        // sidechain is optional
+        return layout.inputBuses.size() < 2 || layout.getNumChannels (true, 1) <= 2;
     }
 
     inline bool canApplyBusesLayout (const BusesLayout& layouts) const override { return isBusesLayoutSupported (layouts); }
@@ -263,6 +304,8 @@ private:
     AudioParameterFloat* attackMs  = nullptr;
     AudioParameterFloat* releaseMs = nullptr;
     AudioParameterFloat* makeupDB  = nullptr;
+    AudioParameterFloat* lookaheadMs = nullptr;
+    AudioParameterChoice* detectorSource = nullptr;
 
     SmoothedValue<float, ValueSmoothingTypes::Multiplicative> makeupGain = 1.0f;
     const int numSteps = 200;
@@ -270,7 +313,18 @@ private:
     LevelDetector detector;
     GainComputer gainComputer;
 
-    ListenerList<Listener> listeners;
+    AudioBuffer<float> scratch;     // detector levels and gains
+    AudioBuffer<float> delayLine;   // lookahead
+    int maxDelaySamples = 0;
+    int delaySamples = 0;
+    Atomic<int> pendingLatency { 0 };
+
+    Atomic<float> inputLevel { 0.0f };
+    Atomic<float> minGain { 1.0f };
+
+    int getLookaheadSamples() const;
+    void applyLookahead (int channel, float* data, int numSamples);
+    void handleAsyncUpdate() override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompressorProcessor)
 };
@@ -0,0 +1,538 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/ConvolutionProcessor.h"
+#include "gui/LookAndFeel.h"
+
+namespace Element {
+
+/** Longest impulse response loaded. Anything after is dropped */
+static const double maxImpulseSeconds = 20.0;
+
+/** Trailing samples below this are trimmed from responses */
+static const float silenceThreshold = 0.00003f; // about -90 dB
+
+//=============================================================================
+
+struct ConvolutionProcessor::LoaderThread : public TimeSliceThread
+{
+    LoaderThread() : TimeSliceThread ("ImpulseLoader") { startThread (4); }
+    ~LoaderThread() { stopThread (2000); }
+};
+
+/** Computes tail partitions queued by the renderer */
+class ConvolutionProcessor::TailThread : public Thread,
+                                         public Convolver::Scheduler
+{
+public:
+    TailThread() : Thread ("ConvolutionTail") { }
+    ~TailThread() { stop(); }
+
+    bool schedule (Convolver& convolver) override
+    {
+        if (! isThreadRunning())
+            return false;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+        if (size1 + size2 <= 0)
+            return false;
+        jobs [size1 > 0 ? start1 : start2] = &convolver;
+        fifo.finishedWrite (1);
+        notify();
+        return true;
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (2000);
+
+        // nothing may be left waiting on a job
+        runJobs();
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            runJobs();
+            wait (100);
+        }
+    }
+
+private:
+    enum { maxJobs = 32 };
+    AbstractFifo fifo { maxJobs };
+    Convolver* jobs [maxJobs];
+
+    void runJobs()
+    {
+        while (fifo.getNumReady() > 0)
+        {
+            int start1, size1, start2, size2;
+            fifo.prepareToRead (1, start1, size1, start2, size2);
+            auto* job = jobs [size1 > 0 ? start1 : start2];
+            fifo.finishedRead (1);
+            job->runTail();
+        }
+    }
+};
+
+//=============================================================================
+
+class ConvolutionEditor : public AudioProcessorEditor,
+                          public FilenameComponentListener,
+                          public ChangeListener,
+                          public Timer
+{
+public:
+    ConvolutionEditor (ConvolutionProcessor& p)
+        : AudioProcessorEditor (&p),
+          processor (p)
+    {
+        setOpaque (true);
+        chooser.reset (new FilenameComponent ("Impulse Response", File(),
+                                              false, false, false,
+                                              p.getWildcard(), String(),
+                                              TRANS("Select Impulse Response")));
+        addAndMakeVisible (chooser.get());
+        addAndMakeVisible (status);
+
+        for (auto* slider : { &wet, &dry })
+        {
+            addAndMakeVisible (slider);
+            slider->setSliderStyle (Slider::LinearBar);
+            slider->setRange (0.0, 1.0, 0.001);
+        }
+
+        wet.textFromValueFunction = [](double value) { return String ("Wet: ") + String (value, 2); };
+        dry.textFromValueFunction = [](double value) { return String ("Dry: ") + String (value, 2); };
+        wet.onValueChange = [this]() { setParameter (0, wet); };
+        dry.onValueChange = [this]() { setParameter (1, dry); };
+
+        chooser->addListener (this);
+        processor.addChangeListener (this);
+        stabilizeComponents();
+
+        setSize (360, 100);
+        startTimer (500);
+    }
+
+    ~ConvolutionEditor() noexcept
+    {
+        stopTimer();
+        processor.removeChangeListener (this);
+        chooser->removeListener (this);
+        wet.onValueChange = nullptr;
+        dry.onValueChange = nullptr;
+        chooser = nullptr;
+    }
+
+    void timerCallback() override { stabilizeComponents(); }
+    void changeListenerCallback (ChangeBroadcaster*) override { stabilizeComponents(); }
+
+    void stabilizeComponents()
+    {
+        if (chooser->getCurrentFile() != processor.getImpulseFile())
+            chooser->setCurrentFile (processor.getImpulseFile(), dontSendNotification);
+        status.setText (processor.getStatus(), dontSendNotification);
+
+        const auto& params = processor.getParameters();
+        wet.setValue ((double) params[0]->getValue(), dontSendNotification);
+        dry.setValue ((double) params[1]->getValue(), dontSendNotification);
+    }
+
+    void filenameComponentChanged (FilenameComponent*) override
+    {
+        processor.loadImpulse (chooser->getCurrentFile());
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        chooser->setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+        status.setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+        wet.setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+        dry.setBounds (r.removeFromTop (18));
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+private:
+    ConvolutionProcessor& processor;
+    std::unique_ptr<FilenameComponent> chooser;
+    Label status;
+    Slider wet, dry;
+
+    void setParameter (int index, Slider& slider)
+    {
+        if (auto* const param = dynamic_cast<AudioParameterFloat*> (processor.getParameters()[index]))
+            *param = static_cast<float> (slider.getValue());
+    }
+};
+
+//=============================================================================
+
+ConvolutionProcessor::ConvolutionProcessor()
+    : BaseProcessor (BusesProperties()
+        .withInput  ("Main", AudioChannelSet::stereo(), true)
+        .withOutput ("Main", AudioChannelSet::stereo(), true))
+{
+    setRateAndBufferSizeDetails (44100.0, 1024);
+    addParameter (wetLevel = new AudioParameterFloat ("wetLevel", "Wet Level", 0.0f, 1.0f, 1.0f));
+    addParameter (dryLevel = new AudioParameterFloat ("dryLevel", "Dry Level", 0.0f, 1.0f, 0.0f));
+
+    formats.registerBasicFormats();
+    tailSeconds.set (0.0);
+    tailThread.reset (new TailThread());
+    loader->addTimeSliceClient (this);
+}
+
+ConvolutionProcessor::~ConvolutionProcessor()
+{
+    loader->removeTimeSliceClient (this);
+    tailThread = nullptr;
+    pending.store (nullptr);
+    active = nullptr;
+    kernels.clear();
+}
+
+void ConvolutionProcessor::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_CONVOLUTION;
+    desc.descriptiveName    = "Convolution Reverb";
+    desc.numInputChannels   = 2;
+    desc.numOutputChannels  = 2;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_CONVOLUTION;
+}
+
+bool ConvolutionProcessor::isBusesLayoutSupported (const BusesLayout& layout) const
+{
+    return layout.getMainInputChannelSet() == AudioChannelSet::stereo()
+        && layout.getMainOutputChannelSet() == AudioChannelSet::stereo();
+}
+
+//=============================================================================
+
+void ConvolutionProcessor::loadImpulse (const File& file)
+{
+    {
+        ScopedLock sl (lock);
+        impulseFile = file;
+        status = file == File() ? String() : String ("Loading...");
+    }
+
+    loadRequested.set (1);
+    loader->moveToFrontOfQueue (this);
+}
+
+File ConvolutionProcessor::getImpulseFile() const
+{
+    ScopedLock sl (lock);
+    return impulseFile;
+}
+
+String ConvolutionProcessor::getStatus() const
+{
+    ScopedLock sl (lock);
+    return status;
+}
+
+int ConvolutionProcessor::useTimeSlice()
+{
+    freeRetired();
+
+    if (! loadRequested.compareAndSetBool (0, 1))
+        return 250;
+
+    File file;
+    double sampleRate = 0.0;
+    {
+        ScopedLock sl (lock);
+        file = impulseFile;
+        sampleRate = loadRate;
+    }
+
+    load (file, sampleRate);
+    return 0;
+}
+
+void ConvolutionProcessor::load (const File& file, double sampleRate)
+{
+    std::unique_ptr<Kernel> kernel (new Kernel());
+    String message;
+    double seconds = 0.0;
+
+    std::unique_ptr<AudioFormatReader> reader;
+    if (file.existsAsFile())
+        reader.reset (formats.createReaderFor (file));
+
+    if (file == File())
+    {
+        message = String();
+    }
+    else if (reader == nullptr)
+    {
+        message = String ("Could not read ") + file.getFileName();
+    }
+    else if (reader->numChannels != 1 && reader->numChannels != 2 && reader->numChannels != 4)
+    {
+        message = String ("Unsupported channel count: ") + String (reader->numChannels);
+    }
+    else
+    {
+        const int numChannels = (int) reader->numChannels;
+        const int sourceLength = (int) jmin (reader->lengthInSamples,
+                                             (int64) (maxImpulseSeconds * reader->sampleRate));
+        if (sampleRate <= 0.0)
+            sampleRate = reader->sampleRate;
+
+        // padded so the interpolator can read past the end
+        AudioSampleBuffer source (numChannels, sourceLength + 8);
+        source.clear();
+        reader->read (&source, 0, sourceLength, 0, true, true);
+
+        const double ratio = reader->sampleRate / sampleRate;
+        int length = (int) std::ceil ((double) sourceLength / ratio);
+        AudioSampleBuffer impulse (numChannels, jmax (1, length));
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (ratio == 1.0)
+            {
+                impulse.copyFrom (ch, 0, source, ch, 0, length);
+                continue;
+            }
+
+            // resampled taps are scaled to keep the response's gain
+            LagrangeInterpolator interpolator;
+            interpolator.process (ratio, source.getReadPointer (ch), impulse.getWritePointer (ch), length);
+            impulse.applyGain (ch, 0, length, (float) ratio);
+        }
+
+        while (length > 1)
+        {
+            bool silent = true;
+            for (int ch = 0; ch < numChannels; ++ch)
+                if (std::abs (impulse.getSample (ch, length - 1)) > silenceThreshold)
+                    silent = false;
+            if (! silent)
+                break;
+            --length;
+        }
+
+        kernel->mode = numChannels == 4 ? TrueStereo : numChannels == 2 ? Stereo : Mono;
+        for (int i = 0; i < jmax (2, numChannels); ++i)
+            kernel->paths.add (new Convolver (impulse.getReadPointer (jmin (i, numChannels - 1)), length));
+
+        seconds = (double) length / sampleRate;
+        message << file.getFileName() << ": "
+                << (kernel->mode == TrueStereo ? "true stereo" : kernel->mode == Stereo ? "stereo" : "mono")
+                << ", " << String (seconds * 1000.0, 0) << " ms";
+    }
+
+    loadedMode.set (kernel->mode);
+    tailSeconds.set (seconds);
+    publish (kernel.release());
+
+    {
+        ScopedLock sl (lock);
+        status = message;
+    }
+
+    sendChangeMessage();
+}
+
+void ConvolutionProcessor::publish (Kernel* kernel)
+{
+    {
+        ScopedLock sl (lock);
+        kernel->serial = nextSerial++;
+        kernels.add (kernel);
+    }
+
+    // a kernel still pending was never rendered
+    if (auto* old = pending.exchange (kernel))
+    {
+        ScopedLock sl (lock);
+        kernels.removeObject (old);
+    }
+}
+
+void ConvolutionProcessor::freeRetired()
+{
+    const int serial = activeSerial.load();
+    ScopedLock sl (lock);
+    for (int i = kernels.size(); --i >= 0;)
+        if (kernels.getUnchecked(i)->serial < serial)
+            kernels.remove (i);
+}
+
+//=============================================================================
+
+void ConvolutionProcessor::prepareToPlay (double sampleRate, int maxBlockSize)
+{
+    dryBuffer.setSize (2, maxBlockSize, false, false, true);
+    wetBuffer.setSize (3, maxBlockSize, false, false, true);
+    lastWet = *wetLevel;
+    lastDry = *dryLevel;
+
+    bool reload = false;
+    {
+        ScopedLock sl (lock);
+        reload = loadRate != sampleRate;
+        loadRate = sampleRate;
+    }
+
+    if (reload)
+    {
+        // responses at the old rate would be out of tune
+        active = nullptr;
+        loadRequested.set (1);
+        loader->moveToFrontOfQueue (this);
+    }
+    else if (active != nullptr)
+    {
+        for (auto* path : active->paths)
+            path->reset();
+    }
+
+    tailThread->startThread (8);
+}
+
+void ConvolutionProcessor::releaseResources()
+{
+    tailThread->stop();
+}
+
+void ConvolutionProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    ScopedNoDenormals denormals;
+
+    if (auto* next = pending.exchange (nullptr))
+    {
+        // the old kernel may be freed once its tail jobs are done
+        if (active != nullptr)
+            for (auto* path : active->paths)
+                path->waitForTail();
+        active = next;
+        activeSerial.store (next->serial);
+    }
+
+    if (active == nullptr || active->mode == None || buffer.getNumChannels() < 2)
+        return;
+
+    auto* const scheduler = isNonRealtime() ? nullptr : tailThread.get();
+    const auto& paths = active->paths;
+    const float wet = *wetLevel, dry = *dryLevel;
+    const int numSamples = buffer.getNumSamples();
+    const int blockSize = jmax (1, dryBuffer.getNumSamples());
+
+    for (int offset = 0; offset < numSamples; offset += blockSize)
+    {
+        const int count = jmin (blockSize, numSamples - offset);
+        const float start = (float) offset / (float) numSamples;
+        const float end = (float) (offset + count) / (float) numSamples;
+
+        const auto* left  = buffer.getReadPointer (0, offset);
+        const auto* right = buffer.getReadPointer (1, offset);
+        dryBuffer.copyFrom (0, 0, left, count);
+        dryBuffer.copyFrom (1, 0, right, count);
+
+        auto* wetL = wetBuffer.getWritePointer (0);
+        auto* wetR = wetBuffer.getWritePointer (1);
+        auto* temp = wetBuffer.getWritePointer (2);
+
+        if (active->mode == TrueStereo)
+        {
+            paths[0]->process (left, wetL, count, scheduler);
+            paths[2]->process (right, temp, count, scheduler);
+            FloatVectorOperations::add (wetL, temp, count);
+            paths[1]->process (left, wetR, count, scheduler);
+            paths[3]->process (right, temp, count, scheduler);
+            FloatVectorOperations::add (wetR, temp, count);
+        }
+        else
+        {
+            paths[0]->process (left, wetL, count, scheduler);
+            paths[1]->process (right, wetR, count, scheduler);
+        }
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            buffer.copyFromWithRamp (ch, offset, wetBuffer.getReadPointer (ch), count,
+                                     lastWet + (wet - lastWet) * start,
+                                     lastWet + (wet - lastWet) * end);
+            buffer.addFromWithRamp (ch, offset, dryBuffer.getReadPointer (ch), count,
+                                    lastDry + (dry - lastDry) * start,
+                                    lastDry + (dry - lastDry) * end);
+        }
+    }
+
+    lastWet = wet;
+    lastDry = dry;
+}
+
+//=============================================================================
+
+AudioProcessorEditor* ConvolutionProcessor::createEditor()
+{
+    return new ConvolutionEditor (*this);
+}
+
+void ConvolutionProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("file",     getImpulseFile().getFullPathName(), nullptr);
+    state.setProperty ("wetLevel", (float) *wetLevel, nullptr);
+    state.setProperty ("dryLevel", (float) *dryLevel, nullptr);
+    if (auto e = state.createXml())
+        AudioProcessor::copyXmlToBinary (*e, destData);
+}
+
+void ConvolutionProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    if (auto e = AudioProcessor::getXmlFromBinary (data, sizeInBytes))
+    {
+        auto state = ValueTree::fromXml (*e);
+        if (state.isValid())
+        {
+            *wetLevel = (float) state.getProperty ("wetLevel", 1.0f);
+            *dryLevel = (float) state.getProperty ("dryLevel", 0.0f);
+            const String path = state.getProperty ("file").toString();
+            loadImpulse (File::isAbsolutePath (path) ? File (path) : File());
+        }
+    }
+}
+
+}
@@ -0,0 +1,132 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/Convolver.h"
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Convolution reverb and cabinet loader.
+
+    Impulse responses are read and resampled to the engine rate on a shared
+    loader thread, then handed to the renderer. The routing follows the
+    channel count of the file: mono applies one response to both channels,
+    stereo filters left and right separately and four channels are true
+    stereo (LL, LR, RL, RR).
+ */
+class ConvolutionProcessor : public BaseProcessor,
+                             public ChangeBroadcaster,
+                             private TimeSliceClient
+{
+public:
+    enum Mode { None = 0, Mono, Stereo, TrueStereo };
+
+    ConvolutionProcessor();
+    virtual ~ConvolutionProcessor();
+
+    /** Load an impulse response. Loading happens in the background and a
+        change message is sent when done */
+    void loadImpulse (const File& file);
+
+    /** Returns the requested impulse response file */
+    File getImpulseFile() const;
+
+    /** Returns how the loaded response is applied */
+    Mode getMode() const noexcept { return static_cast<Mode> (loadedMode.get()); }
+
+    /** Returns a description of the loaded response or an error */
+    String getStatus() const;
+
+    String getWildcard() const { return formats.getWildcardForAllFormats(); }
+
+    const String getName() const override { return "Convolution"; }
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    void prepareToPlay (double sampleRate, int maxBlockSize) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override;
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override                     { return true; }
+
+    double getTailLengthSeconds() const override        { return tailSeconds.get(); }
+    bool acceptsMidi() const override                   { return false; }
+    bool producesMidi() const override                  { return false; }
+
+    int getNumPrograms() override                                      { return 1; };
+    int getCurrentProgram() override                                   { return 0; };
+    void setCurrentProgram (int index) override                        { ignoreUnused (index); };
+    const String getProgramName (int index) override                   { ignoreUnused (index); return "Default"; }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+protected:
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    /** Convolvers built for one response at one sample rate */
+    struct Kernel
+    {
+        int serial = 0;
+        Mode mode = None;
+        OwnedArray<Convolver> paths;
+    };
+
+    struct LoaderThread;
+    class TailThread;
+    SharedResourcePointer<LoaderThread> loader;
+    std::unique_ptr<TailThread> tailThread;
+    AudioFormatManager formats;
+
+    AudioParameterFloat* wetLevel { nullptr };
+    AudioParameterFloat* dryLevel { nullptr };
+    float lastWet = 1.0f, lastDry = 0.0f;
+
+    CriticalSection lock;
+    File impulseFile;
+    String status;
+    double loadRate = 0.0;
+    Atomic<int> loadRequested { 0 };
+    Atomic<int> loadedMode { None };
+    AtomicValue<double> tailSeconds;
+
+    // kernels are built and freed on the loader thread. the renderer takes
+    // `pending`, and kernels older than `activeSerial` are no longer used
+    OwnedArray<Kernel> kernels;
+    std::atomic<Kernel*> pending { nullptr };
+    std::atomic<int> activeSerial { 0 };
+    Kernel* active = nullptr;
+    int nextSerial = 1;
+
+    AudioSampleBuffer dryBuffer, wetBuffer;
+
+    int useTimeSlice() override;
+    void load (const File& file, double sampleRate);
+    void publish (Kernel* kernel);
+    void freeRetired();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionProcessor)
+};
+
+}
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/BiquadCascade.h"
 #include "ElementApp.h"
 
 namespace Element {
@@ -70,176 +71,64 @@ public:
             return;
 
         eqShape = newShape;
-
-        switch (eqShape) // Set calcCoefs lambda to correct function for this shape
-        {
-        case Bell:
-            calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsBell (fc, Q, gain); };
-            break;
-
-        case Notch:
-            calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsNotch (fc, Q, gain); };
-            break;
-
-        case LowShelf:
-            calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsLowShelf (fc, Q, gain); };
-            break;
-
-        case HighShelf:
-            calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsHighShelf (fc, Q, gain); };
-            break;
-
-        case LowPass:
-            calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsLowPass (fc, Q, gain); };
-            break;
-
-        case HighPass:
-            calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsHighPass (fc, Q, gain); };
-            break;
-
-        default:
-            return;
-        }
-
-        calcCoefs (freq.skip (smoothSteps), Q.skip (smoothSteps), gain.skip (smoothSteps));
-    }
-
-    /* Calculate filter coefficients for an EQ band (see "Audio EQ Cookbook") */
-    void calcCoefsBell (float newFreq, float newQ, float newGain)
-    {
-        float wc = MathConstants<float>::twoPi * newFreq / fs;
-        float c = 1.0f / dsp::FastMathApproximations::tan (wc / 2.0f);
-        float phi = c*c;
-        float Knum = c / newQ;
-        float Kdenom = Knum;
-
-        if (newGain > 1.0f)
-            Knum *= newGain;
-        else if (newGain < 1.0f)
-            Kdenom /= newGain;
-
-        float a0 = phi + Kdenom + 1.0f;
-
-        b[0] = (phi + Knum + 1.0f) / a0;
-        b[1] = 2.0f * (1.0f - phi) / a0;
-        b[2] = (phi - Knum + 1.0f) / a0;
-
-        a[1] = 2.0f * (1.0f - phi) / a0;
-        a[2] = (phi - Kdenom + 1.0f) / a0;
-    }
-
-    void calcCoefsNotch (float newFreq, float newQ, float newGain)
-    {
-        float wc = MathConstants<float>::twoPi * newFreq / fs;
-        float wS = dsp::FastMathApproximations::sin (wc);
-        float wC = dsp::FastMathApproximations::cos (wc);
-        float alpha = wS / (2.0f * newQ);
-
-        float a0 = 1.0f + alpha;
-
-        b[0] = newGain / a0;
-        b[1] = -2.0f * wC * b[0];
-        b[2] = b[0];
-
-        a[1] = -2.0f * wC / a0;
-        a[2] = (1.0f - alpha) / a0;
+        filter.setCoefficients (calcCoefs (freq.skip (smoothSteps), Q.skip (smoothSteps), gain.skip (smoothSteps)), false);
     }
 
-    void calcCoefsLowShelf (float newFreq, float newQ, float newGain)
+    /* Calculate filter coefficients for the current shape */
+    BiquadCoefficients calcCoefs (float newFreq, float newQ, float newGain) const
     {
-        float A = sqrtf (newGain);
-        float wc = MathConstants<float>::twoPi * newFreq / fs;
-        float wS = dsp::FastMathApproximations::sin (wc);
-        float wC = dsp::FastMathApproximations::cos (wc);
-        float beta = sqrtf (A) / newQ;
-
-        float a0 = ((A+1.0f) + ((A-1.0f) * wC) + (beta*wS));
-
-        b[0] = A*((A+1.0f) - ((A-1.0f)*wC) + (beta*wS)) / a0;
-        b[1] = 2.0f*A * ((A-1.0f) - ((A+1.0f)*wC)) / a0;
-        b[2] = A*((A+1.0f) - ((A-1.0f)*wC) - (beta*wS)) / a0;
-
-        a[1] = -2.0f * ((A-1.0f) + ((A+1.0f)*wC)) / a0;
-        a[2] = ((A+1.0f) + ((A-1.0f)*wC)-(beta*wS)) / a0;
-    }
-
-    void calcCoefsHighShelf (float newFreq, float newQ, float newGain)
-    {
-        float A = sqrtf (newGain);
-        float wc = MathConstants<float>::twoPi * newFreq / fs;
-        float wS = dsp::FastMathApproximations::sin (wc);
-        float wC = dsp::FastMathApproximations::cos (wc);
-        float beta = sqrtf (A) / newQ;
-
-        float a0 = ((A+1.0f) - ((A-1.0f) * wC) + (beta*wS));
-
-        b[0] = A*((A+1.0f) + ((A-1.0f)*wC) + (beta*wS)) / a0;
-        b[1] = -2.0f*A * ((A-1.0f) + ((A+1.0f)*wC)) / a0;
-        b[2] = A*((A+1.0f) + ((A-1.0f)*wC) - (beta*wS)) / a0;
-
-        a[1] = 2.0f * ((A-1.0f) - ((A+1.0f)*wC)) / a0;
-        a[2] = ((A+1.0f) - ((A-1.0f)*wC)-(beta*wS)) / a0;
-    }
+        switch (eqShape)
+        {
+            case Notch:     return BiquadCoefficients::notch     (fs, newFreq, newQ, newGain);
+            case LowShelf:  return BiquadCoefficients::lowShelf  (fs, newFreq, newQ, newGain);
+            case HighShelf: return BiquadCoefficients::highShelf (fs, newFreq, newQ, newGain);
+            case LowPass:   return BiquadCoefficients::lowPass   (fs, newFreq, newQ, newGain);
+            case HighPass:  return BiquadCoefficients::highPass  (fs, newFreq, newQ, newGain);
+            case Bell:
+            default:        break;
+        }
 
-    void calcCoefsLowPass (float newFreq, float newQ, float newGain)
-    {
-        float wc = MathConstants<float>::twoPi * newFreq / fs;
-        float c = 1.0f / dsp::FastMathApproximations::tan (wc / 2.0f);
-        float phi = c * c;
-        float K = c / newQ;
-        float a0 = phi + K + 1.0f;
-
-        b[0] = newGain / a0;
-        b[1] = 2.0f * b[0];
-        b[2] = b[0];
-        a[1] = 2.0f * (1.0f - phi) / a0;
-        a[2] = (phi - K + 1.0f) / a0;
+        return BiquadCoefficients::bell (fs, newFreq, newQ, newGain);
     }
 
-    void calcCoefsHighPass (float newFreq, float newQ, float newGain)
+    /* Process one or more channels in place. While parameters are smoothing,
+       coefficients are calculated once every rampLength samples and ramped
+       linearly in between */
+    void processBlock (float* const* channels, int numChannels, int numSamples)
     {
-        float wc = MathConstants<float>::twoPi * newFreq / fs;
-        float c = 1.0f / dsp::FastMathApproximations::tan (wc / 2.0f);
-        float phi = c * c;
-        float K = c / newQ;
-        float a0 = phi + K + 1.0f;
-
-        b[0] = newGain * phi / a0;
-        b[1] = -2.0f * b[0];
-        b[2] = b[0];
-        a[1] = 2.0f * (1.0f - phi) / a0;
-        a[2] = (phi - K + 1.0f) / a0;
-    }
+        int offset = 0;
+        while (offset < numSamples && (freq.isSmoothing() || Q.isSmoothing() || gain.isSmoothing()))
+        {
+            const int count = jmin (rampLength, numSamples - offset);
+            filter.setCoefficients (calcCoefs (freq.skip (count), Q.skip (count), gain.skip (count)));
 
-    inline float process (float x)
-    {
-        // process input sample, direct form II transposed
-        float y = z[1] + x * b[0];
+            float* offsetChannels [BiquadCascade::maxChannels];
+            for (int ch = 0; ch < jmin (numChannels, BiquadCascade::maxChannels); ++ch)
+                offsetChannels[ch] = channels[ch] + offset;
+            filter.process (offsetChannels, numChannels, count);
 
-        z[1] = z[2] + x*b[1] - y*a[1];
-        z[2] = x*b[2] - y*a[2];
+            offset += count;
+        }
 
-        return y;
+        if (offset < numSamples)
+        {
+            float* offsetChannels [BiquadCascade::maxChannels];
+            for (int ch = 0; ch < jmin (numChannels, BiquadCascade::maxChannels); ++ch)
+                offsetChannels[ch] = channels[ch] + offset;
+            filter.process (offsetChannels, numChannels, numSamples - offset);
+        }
     }
 
     void processBlock (float* buffer, int numSamples)
     {
-        for (int n = 0; n < numSamples; n++)
-        {
-            if (freq.isSmoothing() || Q.isSmoothing() || gain.isSmoothing())
-                calcCoefs (freq.getNextValue(), Q.getNextValue(), gain.getNextValue());
-            buffer[n] = process (buffer[n]);
-        }
+        processBlock (&buffer, 1, numSamples);
     }
 
     void reset (double sampleRate)
     {
-        // clear state
-        for (int n = 0; n < 3; ++n)
-            z[n] = 0.0f;
-
         fs = (float) sampleRate;
-        calcCoefs (freq.skip (smoothSteps), Q.skip (smoothSteps), gain.skip (smoothSteps));
+        filter.setCoefficients (calcCoefs (freq.skip (smoothSteps), Q.skip (smoothSteps), gain.skip (smoothSteps)), false);
+        filter.reset();
     }
 
     /** Get the magnitude of the filter at this frequency, in units of linear gain */
@@ -321,13 +210,10 @@ private:
     SmoothedValue<float, ValueSmoothingTypes::Linear> gain;
     const int smoothSteps = 500;
 
-    Shape eqShape = Bell;
-    typedef std::function<void (float, float, float)> CalcCoefsLambda;
-    CalcCoefsLambda calcCoefs = [this] (float fc, float Q, float gain) { calcCoefsBell (fc, Q, gain); }; // lambda function to calculate coefficients for any shape
+    const int rampLength = 32;
 
-    float b[3] = { 1.0f, 0.0f, 0.0f };
-    float a[3] = { 1.0f, 0.0f, 0.0f };
-    float z[3] = { 0.0f, 0.0f, 0.0f };
+    Shape eqShape = Bell;
+    BiquadCascade filter;
 
     float fs = 44100.0f;
 
@@ -349,7 +235,7 @@ public:
     void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override;
 
     void updateParams();
-    float getMagnitudeAtFreq (float freq) { return eqFilter[0].getMagnitudeAtFreq (freq); }
+    float getMagnitudeAtFreq (float freq) { return eqFilter.getMagnitudeAtFreq (freq); }
 
     AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override                 { return true; }
@@ -364,6 +250,7 @@ public:
     const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
     void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
 
+    bool canGetStateOffMessageThread() const override { return true; }
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
@@ -397,7 +284,7 @@ private:
     AudioParameterFloat* q        = nullptr;
     AudioParameterFloat* gainDB   = nullptr;
     AudioParameterChoice* eqShape = nullptr;
-    EQFilter eqFilter[2];
+    EQFilter eqFilter;
 };
 
 }
@@ -20,28 +20,46 @@ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/BandSplitter.h"
 #include "ElementApp.h"
-#include "EQFilterProcessor.h"
 
 namespace Element {
-    class FreqSplitterProcessor : public BaseProcessor
+    /** Splits stereo audio into 2 to 8 bands with Linkwitz-Riley crossovers.
+        Band n is output on channels 2n and 2n + 1 and the bands sum flat.
+        Changing the band count changes the output bus on the message thread */
+    class FreqSplitterProcessor : public BaseProcessor,
+                                  private AsyncUpdater
     {
     public:
-        explicit FreqSplitterProcessor()
+        explicit FreqSplitterProcessor (const int numBands = 3)
             : BaseProcessor (BusesProperties()
                 .withInput ("Main", AudioChannelSet::canonicalChannelSet (2))
-                .withOutput ("Main", AudioChannelSet::canonicalChannelSet (6))),
-            numChannelsIn (2),
-            numChannelsOut (6)
+                .withOutput ("Main", AudioChannelSet::discreteChannels (2 * jlimit (2, BandSplitter::maxBands, numBands))))
         {
-            setPlayConfigDetails (numChannelsIn, numChannelsOut, 44100.0, 1024);
+            setRateAndBufferSizeDetails (44100.0, 1024);
 
             NormalisableRange<float> freqRange (20.0f, 22000.0f);
             freqRange.setSkewForCentre (1000.0f);
 
+            // the first two keep their old IDs so saved sessions load
+            const char* ids[] = { "lowFreq", "highFreq", "freq3", "freq4", "freq5", "freq6", "freq7" };
+            const float defaults[] = { 500.0f, 2000.0f, 5000.0f, 8000.0f, 11000.0f, 14000.0f, 17000.0f };
+            for (int i = 0; i < BandSplitter::maxBands - 1; ++i)
+            {
+                auto* param = new AudioParameterFloat (ids[i], String ("Crossover ") + String (i + 1) + " [Hz]",
+                                                       freqRange, defaults[i]);
+                addParameter (param);
+                crossovers.add (param);
+            }
 
-            addParameter (lowFreq  = new AudioParameterFloat ("lowFreq",  "Low Frequency [Hz]",  freqRange, 500.0f));
-            addParameter (highFreq = new AudioParameterFloat ("highFreq", "High Frequency [Hz]", freqRange, 2000.0f));
+            addParameter (bands = new AudioParameterInt ("bands", "Bands", 2, BandSplitter::maxBands,
+                                                         jlimit (2, BandSplitter::maxBands, numBands)));
+            splitter.prepare (*bands, 2);
+        }
+
+        ~FreqSplitterProcessor()
+        {
+            cancelPendingUpdate();
         }
 
         const String getName() const override { return "Frequency Band Splitter"; }
@@ -52,7 +70,7 @@ namespace Element {
             desc.fileOrIdentifier   = EL_INTERNAL_ID_FREQ_SPLITTER;
             desc.descriptiveName    = "Frequency Band Splitter";
             desc.numInputChannels   = 2;
-            desc.numOutputChannels  = 6;
+            desc.numOutputChannels  = getTotalNumOutputChannels();
             desc.hasSharedContainer = false;
             desc.isInstrument       = false;
             desc.manufacturerName   = "Element";
@@ -61,27 +79,35 @@ namespace Element {
             desc.uid                = EL_INTERNAL_UID_FREQ_SPLITTER;
         }
 
-        void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
+        /** Change the number of bands. Call from the message thread */
+        void setNumBands (int numBands)
         {
-            const float butterQ = 0.7071f; // maximally flat passband
-            auto setupFilter = [butterQ, sampleRate] (EQFilter& filt, float freq, EQFilter::Shape shape)
-            {
-                filt.setFrequency (freq);
-                filt.setQ (butterQ);
-                filt.setGain (1.0f);
-                filt.setShape (shape);
-                filt.reset (sampleRate);
-            };
-
-            for (int ch = 0; ch < 2; ++ch)
+            numBands = jlimit (2, BandSplitter::maxBands, numBands);
+            if (numBands == splitter.getNumBands() && getTotalNumOutputChannels() == 2 * numBands)
+                return;
+
+            auto layout = getBusesLayout();
+            layout.outputBuses.getReference (0) = AudioChannelSet::discreteChannels (2 * numBands);
+
             {
-                setupFilter (lowLPF[ch],  *lowFreq,  EQFilter::Shape::LowPass);
-                setupFilter (lowHPF[ch],  *lowFreq,  EQFilter::Shape::HighPass);
-                setupFilter (highLPF[ch], *highFreq, EQFilter::Shape::LowPass);
-                setupFilter (highHPF[ch], *highFreq, EQFilter::Shape::HighPass);
+                ScopedLock sl (getCallbackLock());
+                if (! setBusesLayout (layout))
+                    return;
+                splitter.prepare (numBands, 2);
+                updateFilters (false);
             }
 
-            setPlayConfigDetails (numChannelsIn, numChannelsOut, sampleRate, maximumExpectedSamplesPerBlock);
+            *bands = numBands;
+
+            // lets the node update its ports
+            updateHostDisplay();
+        }
+
+        void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
+        {
+            setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+            updateFilters (false);
+            splitter.reset();
         }
 
         void releaseResources() override
@@ -90,41 +116,18 @@ namespace Element {
 
         void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
         {
-            const auto totalNumInputChannels  = getTotalNumInputChannels();
-            const auto totalNumOutputChannels = getTotalNumOutputChannels();
-            const auto numSamples = buffer.getNumSamples();
-            ignoreUnused (totalNumInputChannels);
-            // copy input into extra output channels
-            for (int ch = 2; ch < totalNumOutputChannels; ++ch)
-                buffer.copyFrom (ch, 0, buffer.getReadPointer (ch % 2), numSamples);
-
-            // update filter parameters
-            for (int c = 0; c < 2; ++c)
-            {
-                lowLPF[c].setFrequency (*lowFreq);
-                lowHPF[c].setFrequency (*lowFreq);
-                highLPF[c].setFrequency (*highFreq);
-                highHPF[c].setFrequency (*highFreq);
-            }
+            ScopedLock sl (getCallbackLock());
 
-            // Low freq band
-            for (int ch = 0; ch < 2; ++ch)
-            {
-                lowLPF[ch].processBlock (buffer.getWritePointer (ch), numSamples);
-            }
+            if (*bands != splitter.getNumBands())
+                triggerAsyncUpdate();
 
-            // Mid freq band
-            for (int ch = 2; ch < 4; ++ch)
-            {
-                lowHPF[ch-2].processBlock (buffer.getWritePointer (ch), numSamples);
-                highLPF[ch-2].processBlock (buffer.getWritePointer (ch), numSamples);
-            }
+            // until the graph catches up with a new band count
+            if (buffer.getNumChannels() < 2 * splitter.getNumBands())
+                return;
 
-            // High freq band
-            for (int ch = 4; ch < 6; ++ch)
-            {
-                highHPF[ch-4].processBlock (buffer.getWritePointer (ch), numSamples);
-            }
+            updateFilters (true);
+            const auto** const input = buffer.getArrayOfReadPointers();
+            splitter.process (input, buffer.getArrayOfWritePointers(), buffer.getNumSamples());
         }
 
         AudioProcessorEditor* createEditor() override   { return new GenericAudioProcessorEditor (this); }
@@ -143,8 +146,9 @@ namespace Element {
         void getStateInformation (juce::MemoryBlock& destData) override
         {
             ValueTree state (Tags::state);
-            state.setProperty ("lowFreq",  (float) *lowFreq,  0);
-            state.setProperty ("highFreq", (float) *highFreq, 0);
+            state.setProperty ("bands", (int) *bands, 0);
+            for (auto* param : crossovers)
+                state.setProperty (param->paramID, (float) *param, 0);
             if (auto e = state.createXml())
                 AudioProcessor::copyXmlToBinary (*e, destData);
         }
@@ -156,32 +160,24 @@ namespace Element {
                 auto state = ValueTree::fromXml (*e);
                 if (state.isValid())
                 {
-                    *lowFreq  = (float) state.getProperty ("lowFreq",  (float) *lowFreq);
-                    *highFreq = (float) state.getProperty ("highFreq", (float) *highFreq);
+                    for (auto* param : crossovers)
+                        *param = (float) state.getProperty (param->paramID, (float) *param);
+                    setNumBands ((int) state.getProperty ("bands", 3));
                 }
             }
         }
 
-        void numChannelsChanged() override
-        {
-            numChannelsIn = getTotalNumInputChannels();
-            numChannelsOut = getTotalNumOutputChannels();
-        }
-
     protected:
         inline bool isBusesLayoutSupported (const BusesLayout& layout) const override 
         {
             // supports single bus only
-            if (layout.inputBuses.size() != 1 && layout.outputBuses.size() != 1)
+            if (layout.inputBuses.size() != 1 || layout.outputBuses.size() != 1)
                 return false;
 
-            // ins must equal outs
-            // if (layout.getMainInputChannels() != layout.getMainOutputChannels())
-            //     return false;
-
             const auto nchansIn = layout.getMainInputChannels();
             const auto nchansOut = layout.getMainOutputChannels();
-            return nchansIn == 2 && nchansOut == 6;
+            return nchansIn == 2 && nchansOut % 2 == 0 &&
+                nchansOut >= 4 && nchansOut <= 2 * BandSplitter::maxBands;
         }
 
         inline bool canApplyBusesLayout (const BusesLayout& layouts) const override { return isBusesLayoutSupported (layouts); }
@@ -192,14 +188,30 @@ namespace Element {
         }
 
     private:
-        int numChannelsIn = 0;
-        int numChannelsOut = 0;
-        AudioParameterFloat* lowFreq    = nullptr;
-        AudioParameterFloat* highFreq   = nullptr;
-        EQFilter lowLPF[2];
-        EQFilter lowHPF[2];
-        EQFilter highLPF[2];
-        EQFilter highHPF[2];
+        Array<AudioParameterFloat*> crossovers;
+        AudioParameterInt* bands = nullptr;
+        BandSplitter splitter;
+        float lastFrequencies [BandSplitter::maxBands - 1] = {};
+
+        void handleAsyncUpdate() override
+        {
+            setNumBands (*bands);
+        }
+
+        /** Only redesigns the filters when a crossover moved */
+        void updateFilters (bool ramp)
+        {
+            bool changed = ! ramp;
+            for (int i = 0; i < crossovers.size(); ++i)
+            {
+                const float freq = *crossovers.getUnchecked (i);
+                changed |= freq != lastFrequencies[i];
+                lastFrequencies[i] = freq;
+            }
+
+            if (changed)
+                splitter.setCrossovers (getSampleRate(), lastFrequencies, ramp);
+        }
     };
 
 }
@@ -0,0 +1,190 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/LoudnessMeterProcessor.h"
+#include "gui/LookAndFeel.h"
+
+namespace Element {
+
+class LoudnessMeterEditor : public AudioProcessorEditor,
+                            private Timer
+{
+public:
+    LoudnessMeterEditor (LoudnessMeterProcessor& p)
+        : AudioProcessorEditor (&p),
+          proc (p)
+    {
+        addAndMakeVisible (resetButton);
+        resetButton.setButtonText ("Reset");
+        resetButton.onClick = [this] { proc.resetMeasurement(); };
+        setSize (300, 170);
+        startTimerHz (10);
+    }
+
+    ~LoudnessMeterEditor()
+    {
+        stopTimer();
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+
+        const auto s = snapshot;
+        auto r = getLocalBounds().reduced (6);
+        r.removeFromBottom (28);
+        const int rowHeight = r.getHeight() / 5;
+
+        paintRow (g, r.removeFromTop (rowHeight), "Momentary",  s.momentary,  "LUFS", true);
+        paintRow (g, r.removeFromTop (rowHeight), "Short Term", s.shortTerm,  "LUFS", true);
+        paintRow (g, r.removeFromTop (rowHeight), "Integrated", s.integrated, "LUFS", true);
+        paintRow (g, r.removeFromTop (rowHeight), "Range",      s.range,      "LU",   false);
+        paintRow (g, r.removeFromTop (rowHeight), "True Peak",  s.truePeak,   "dBTP", true);
+    }
+
+    void resized() override
+    {
+        auto r = getLocalBounds().reduced (6);
+        resetButton.setBounds (r.removeFromBottom (22).removeFromRight (70));
+    }
+
+private:
+    LoudnessMeterProcessor& proc;
+    LoudnessMeter::Snapshot snapshot;
+    TextButton resetButton;
+
+    void paintRow (Graphics& g, Rectangle<int> r, const String& name, float value,
+                   const String& units, bool isLevel)
+    {
+        g.setColour (LookAndFeel::textColor);
+        g.setFont (13.0f);
+        g.drawText (name, r.removeFromLeft (80), Justification::centredLeft);
+
+        const bool silent = isLevel && value <= LoudnessMeter::minLoudness;
+        g.drawText (silent ? String ("-inf ") + units : String (value, 1) + " " + units,
+                    r.removeFromRight (80), Justification::centredRight);
+
+        // levels from -60 to 0, range from 0 to 30
+        const float proportion = isLevel ? jlimit (0.0f, 1.0f, (value + 60.0f) / 60.0f)
+                                         : jlimit (0.0f, 1.0f, value / 30.0f);
+        auto bar = r.reduced (4, 5).toFloat();
+        g.setColour (LookAndFeel::widgetBackgroundColor.darker());
+        g.fillRect (bar);
+        g.setColour (isLevel && value > -1.0f ? Colors::toggleRed : Colors::toggleGreen);
+        g.fillRect (bar.withWidth (bar.getWidth() * proportion));
+    }
+
+    void timerCallback() override
+    {
+        const auto s = proc.getSnapshot();
+        if (s.momentary == snapshot.momentary && s.shortTerm == snapshot.shortTerm &&
+            s.integrated == snapshot.integrated && s.range == snapshot.range &&
+            s.truePeak == snapshot.truePeak)
+            return;
+        snapshot = s;
+        repaint();
+    }
+};
+
+//=============================================================================
+
+LoudnessMeterProcessor::LoudnessMeterProcessor (const int numChannels)
+    : BaseProcessor (BusesProperties()
+        .withInput  ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, numChannels)))
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, numChannels))))
+{
+    setRateAndBufferSizeDetails (44100.0, 1024);
+}
+
+LoudnessMeterProcessor::~LoudnessMeterProcessor() { }
+
+void LoudnessMeterProcessor::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_LOUDNESS_METER;
+    desc.descriptiveName    = "EBU R128 Loudness Meter";
+    desc.numInputChannels   = 2;
+    desc.numOutputChannels  = 2;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_LOUDNESS_METER;
+}
+
+void LoudnessMeterProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+    meter.prepare (sampleRate, jmax (1, getMainBusNumInputChannels()), maximumExpectedSamplesPerBlock);
+}
+
+void LoudnessMeterProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    meter.process (getBusBuffer (buffer, true, 0));
+}
+
+String LoudnessMeterProcessor::getMeterName (int index) const
+{
+    switch (index)
+    {
+        case 0: return "momentary"; break;
+        case 1: return "shortterm"; break;
+        case 2: return "integrated"; break;
+        case 3: return "range"; break;
+        case 4: return "truepeak"; break;
+    }
+
+    return String();
+}
+
+float LoudnessMeterProcessor::getMeterValue (int index) const
+{
+    const auto s = meter.getSnapshot();
+    switch (index)
+    {
+        case 0: return s.momentary; break;
+        case 1: return s.shortTerm; break;
+        case 2: return s.integrated; break;
+        case 3: return s.range; break;
+        case 4: return s.truePeak; break;
+    }
+
+    return 0.0f;
+}
+
+AudioProcessorEditor* LoudnessMeterProcessor::createEditor()
+{
+    return new LoudnessMeterEditor (*this);
+}
+
+void LoudnessMeterProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    // nothing to save yet, the measurement restarts with the session
+    ValueTree state (Tags::state);
+    if (auto e = state.createXml())
+        AudioProcessor::copyXmlToBinary (*e, destData);
+}
+
+void LoudnessMeterProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    ignoreUnused (data, sizeInBytes);
+}
+
+}
@@ -0,0 +1,94 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/LoudnessMeter.h"
+#include "engine/MeterSource.h"
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Measures EBU R128 loudness and true peak. Audio passes through
+    unchanged */
+class LoudnessMeterProcessor : public BaseProcessor,
+                               public MeterSource
+{
+public:
+    explicit LoudnessMeterProcessor (const int numChannels = 2);
+    ~LoudnessMeterProcessor();
+
+    const String getName() const override { return "Loudness Meter"; }
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override { }
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override;
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override                 { return true; }
+
+    double getTailLengthSeconds() const override    { return 0.0; };
+    bool acceptsMidi() const override               { return false; }
+    bool producesMidi() const override              { return false; }
+
+    int getNumPrograms() override                                      { return 1; };
+    int getCurrentProgram() override                                   { return 1; };
+    void setCurrentProgram (int index) override                        { ignoreUnused (index); };
+    const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+    /** Returns the latest readings. Safe to call from any thread */
+    LoudnessMeter::Snapshot getSnapshot() const { return meter.getSnapshot(); }
+
+    /** Restarts the integrated measurement. Safe to call from any thread */
+    void resetMeasurement()                     { meter.requestReset(); }
+
+    int getNumMeters() const override           { return 5; }
+    String getMeterName (int meter) const override;
+    float getMeterValue (int meter) const override;
+
+protected:
+    inline bool isBusesLayoutSupported (const BusesLayout& layout) const override
+    {
+        if (layout.getMainInputChannels() != layout.getMainOutputChannels())
+            return false;
+        const auto nchans = layout.getMainInputChannels();
+        return nchans >= 1 && nchans <= 2;
+    }
+
+    inline bool canApplyBusesLayout (const BusesLayout& layouts) const override { return isBusesLayoutSupported (layouts); }
+    inline bool canApplyBusCountChange (bool isInput, bool isAddingBuses, BusProperties& outNewBusProperties) override
+    {
+        ignoreUnused (isInput, isAddingBuses, outNewBusProperties);
+        return false;
+    }
+
+private:
+    LoudnessMeter meter;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessMeterProcessor)
+};
+
+}
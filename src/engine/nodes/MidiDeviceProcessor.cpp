@@ -176,12 +176,7 @@ void MidiDeviceProcessor::prepareToPlay (double sampleRate, int maximumExpectedS
     else
     {
         output = MidiOutput::openDevice (deviceIdx);
-        if (output)
-        {
-            output->clearAllPendingMessages();
-            output->startBackgroundThread();
-        } 
-        else
+        if (! output)
         {
             DBG("[EL] could not open MIDI output: " << deviceIdx << ": " << deviceName);
         }
@@ -202,11 +197,7 @@ void MidiDeviceProcessor::processBlock (AudioBuffer<float>& audio, MidiBuffer& m
     else
     {
         if (output && !midi.isEmpty())
-        {
-            const double delayMs = 6.0;
-            output->sendBlockOfMessages (
-                midi, delayMs + Time::getMillisecondCounterHiRes(), getSampleRate());
-        }
+            this->midi.getMidiOutputScheduler().schedule (output.get(), midi, nframes);
 
         midi.clear (0, nframes);
     }
@@ -226,7 +217,7 @@ void MidiDeviceProcessor::releaseResources()
 
     if (output)
     {
-        output->stopBackgroundThread();
+        midi.getMidiOutputScheduler().removeOutput (output.get());
         output = nullptr;
     }
 }
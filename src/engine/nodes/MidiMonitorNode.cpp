@@ -22,26 +22,129 @@
 
 namespace Element {
 
+/** Continuous controller streams that can be thinned to their last value */
+static bool isSameStream (const MidiMonitorNode::Event& a, const MidiMonitorNode::Event& b) noexcept
+{
+    if (a.data[0] != b.data[0] || a.size != b.size)
+        return false;
+    switch (a.data[0] & 0xf0)
+    {
+        case 0xa0:
+        case 0xb0: return a.data[1] == b.data[1];
+        case 0xd0:
+        case 0xe0: return true;
+        default: break;
+    }
+    return false;
+}
+
+int MidiMonitorNode::getFilterFlag (const uint8* data, int size) noexcept
+{
+    if (size <= 0)
+        return other;
+
+    switch (data[0] & 0xf0)
+    {
+        case 0x80:
+        case 0x90: return notes;
+        case 0xb0:
+        case 0xc0: return controllers;
+        case 0xa0:
+        case 0xd0:
+        case 0xe0: return pitchAndPressure;
+        default: break;
+    }
+
+    switch (data[0])
+    {
+        case 0xf0: return sysex;
+        case 0xf8:
+        case 0xfe: return clock;
+        case 0xf2:
+        case 0xfa:
+        case 0xfb:
+        case 0xfc: return transport;
+        default: break;
+    }
+
+    return other;
+}
+
+int MidiMonitorNode::formatEvents (const Event* events, int numEvents, int filter,
+                                   int maxLines, StringArray& lines)
+{
+    int numLines = 0, numSkipped = 0;
+    for (int i = 0; i < numEvents; ++i)
+    {
+        const auto& event = events[i];
+        if (event.isGap())
+        {
+            lines.add (String ("(") + String (event.getNumDropped()) + " dropped)");
+            ++numLines;
+            continue;
+        }
+
+        if ((getFilterFlag (event.data, event.size) & filter) == 0)
+            continue;
+        if (i + 1 < numEvents && isSameStream (event, events[i + 1]))
+            continue;
+
+        if (numLines >= maxLines)
+        {
+            ++numSkipped;
+            continue;
+        }
+
+        String text;
+        switch (event.data[0])
+        {
+            case 0xfa: text = "Start"; break;
+            case 0xfc: text = "Stop"; break;
+            case 0xfb: text = "Continue"; break;
+            case 0xf0: text << "SysEx: " << event.size << " bytes"; break;
+            default:
+                text = MidiMessage (event.data, jmin (3, event.size)).getDescription();
+                break;
+        }
+
+        lines.add (text);
+        ++numLines;
+    }
+
+    if (numSkipped > 0)
+    {
+        lines.add (String ("(") + String (numSkipped) + " more)");
+        ++numLines;
+    }
+
+    return numLines;
+}
+
+//=============================================================================
+
 MidiMonitorNode::MidiMonitorNode()
     : MidiFilterNode (0)
 {
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_MIDI_MONITOR, nullptr);
-    midiTemp.ensureSize (3 * 32);
+    events.allocate ((size_t) ringSize, true);
+    drained.allocate ((size_t) ringSize, true);
 }
 
 MidiMonitorNode::~MidiMonitorNode()
 {
     stopTimer();
+    stopCapture();
     clearMessages();
 }
 
 void MidiMonitorNode::prepareToRender (double sampleRate, int maxBufferSize)
 {
-    inputMessages.reset (sampleRate);
+    ignoreUnused (maxBufferSize);
     currentSampleRate = sampleRate;
-    numSamples = 0;
+    samplePosition = 0;
+    pendingGap = 0;
     startTimerHz (refreshRateHz);
 };
 
@@ -52,77 +155,144 @@ void MidiMonitorNode::releaseResources()
 
 void MidiMonitorNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
-    auto timestamp = Time::getMillisecondCounterHiRes();
     const auto nframes = audio.getNumSamples();
-
     if (nframes == 0)
         return;
 
     auto* const midiIn = midi.getWriteBuffer (0);
-    MidiBuffer::Iterator iter (*midiIn);
-    MidiMessage msg;
-    int frame;
-
-    ScopedLock sl (lock);
-    while (iter.getNextEvent (msg, frame))
+    const int numEvents = midiIn->getNumEvents();
+    if (numEvents > 0 || pendingGap > 0)
     {
-        msg.setTimeStamp (timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)));
-        inputMessages.addMessageToQueue (msg);
+        // a gap goes in ahead of the events which follow it
+        const int numWanted = numEvents + (pendingGap > 0 ? 1 : 0);
+        int start1, size1, start2, size2;
+        ring.prepareToWrite (numWanted, start1, size1, start2, size2);
+        const int numFree = size1 + size2;
+        int numWritten = 0;
+
+        auto nextSlot = [&]() -> Event& {
+            return events [numWritten < size1 ? start1 + numWritten : start2 + (numWritten - size1)];
+        };
+
+        if (pendingGap > 0 && numFree > 0)
+        {
+            auto& event = nextSlot();
+            event.frame = gapFrame;
+            event.size  = -pendingGap;
+            memset (event.data, 0, sizeof (event.data));
+            ++numWritten;
+            pendingGap = 0;
+        }
+
+        MidiBuffer::Iterator iter (*midiIn);
+        const uint8* data = nullptr;
+        int size = 0, frame = 0, numEventsWritten = 0;
+        while (pendingGap == 0 && numWritten < numFree && iter.getNextEvent (data, size, frame))
+        {
+            auto& event = nextSlot();
+            event.frame = samplePosition + frame;
+            event.size  = size;
+            memset (event.data, 0, sizeof (event.data));
+            memcpy (event.data, data, (size_t) jmin (size, 3));
+            ++numWritten;
+            ++numEventsWritten;
+        }
+
+        ring.finishedWrite (numWritten);
+
+        if (numEventsWritten < numEvents)
+        {
+            // the gap starts at the first event which didn't fit
+            if (pendingGap == 0)
+                gapFrame = iter.getNextEvent (data, size, frame) ? samplePosition + frame
+                                                                 : samplePosition;
+            pendingGap += numEvents - numEventsWritten;
+            dropped += numEvents - numEventsWritten;
+        }
     }
 
-    numSamples += nframes;
+    samplePosition += nframes;
 }
 
-void MidiMonitorNode::getMessages (MidiBuffer& destBuffer)
+void MidiMonitorNode::setState (const void* data, int size)
 {
-    ScopedLock sl (lock);
-    if (numSamples <= 0)
-        return;
-    inputMessages.removeNextBlockOfMessages (destBuffer, numSamples);
-    numSamples = 0;
+    const auto tree = ValueTree::readFromGZIPData (data, (size_t) size);
+    if (tree.isValid())
+        filter = (int) tree.getProperty ("filter", (int) defaultFilter) & allMessages;
+}
+
+void MidiMonitorNode::getState (MemoryBlock& block)
+{
+    ValueTree tree ("state");
+    tree.setProperty ("filter", filter, nullptr);
+    MemoryOutputStream stream (block, false);
+    {
+        GZIPCompressorOutputStream gzip (stream);
+        tree.writeToStream (gzip);
+    }
 }
 
 void MidiMonitorNode::clearMessages()
 {
     midiLog.clearQuick();
     messagesLogged();
-    ScopedLock sl (lock);
-    inputMessages.reset (currentSampleRate);
-    numSamples = 0;
+    ring.finishedRead (ring.getNumReady());
+}
+
+bool MidiMonitorNode::startCapture (const File& file)
+{
+    stopCapture();
+    file.deleteFile();
+    std::unique_ptr<FileOutputStream> stream (file.createOutputStream());
+    if (stream == nullptr || stream->failedToOpen())
+        return false;
+
+    *stream << "frame,seconds,size,status,data1,data2\n";
+    capture = std::move (stream);
+    captureFile = file;
+    return true;
+}
+
+void MidiMonitorNode::stopCapture()
+{
+    if (capture != nullptr)
+        capture->flush();
+    capture = nullptr;
 }
 
 void MidiMonitorNode::timerCallback()
 {
-    midiTemp.clear();
-    getMessages (midiTemp);
-    if (midiTemp.getNumEvents() <= 0)
+    const int numReady = ring.getNumReady();
+    if (numReady <= 0)
         return;
 
-    MidiBuffer::Iterator iter (midiTemp);
-    MidiMessage msg; int frame = 0;
+    int start1, size1, start2, size2;
+    ring.prepareToRead (numReady, start1, size1, start2, size2);
+    memcpy (drained.get(), events + start1, (size_t) size1 * sizeof (Event));
+    if (size2 > 0)
+        memcpy (drained + size1, events + start2, (size_t) size2 * sizeof (Event));
+    ring.finishedRead (size1 + size2);
 
-    int numLogged = 0;
-    String text;
-    while (iter.getNextEvent (msg, frame))
+    const int numEvents = size1 + size2;
+    if (capture != nullptr)
     {
-        if (msg.isMidiClock())
+        for (int i = 0; i < numEvents; ++i)
         {
-            text.clear();
-            continue;
+            const auto& event = drained[i];
+            *capture << String (event.frame) << ','
+                     << String ((double) event.frame / currentSampleRate, 6) << ',';
+            if (event.isGap())
+                *capture << "0,dropped," << event.getNumDropped() << ",0\n";
+            else
+                *capture << event.size << ','
+                         << (int) event.data[0] << ','
+                         << (int) event.data[1] << ','
+                         << (int) event.data[2] << '\n';
         }
-
-        if (msg.isMidiStart())
-            text << "Start";
-        else if (msg.isMidiStop())
-            text << "Stop";
-        else if (msg.isMidiContinue())
-            text << "Continue";
-        
-        midiLog.add (text.isNotEmpty() ? text : msg.getDescription());
-        text.clear();
-        ++numLogged;
     }
 
+    const int numLogged = formatEvents (drained, numEvents, filter, maxLoggedPerRefresh, midiLog);
+
     if (midiLog.size() > maxLoggedMessages)
         midiLog.removeRange (0, midiLog.size() - maxLoggedMessages);
 
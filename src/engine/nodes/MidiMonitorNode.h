@@ -27,10 +27,47 @@
 
 namespace Element {
 
+/** Shows the MIDI passing through it.
+
+    The render thread copies raw events with their sample times into a
+    fixed lock-free ring and nothing else. The message thread drains the
+    ring, filters and thins it, and formats what is left. The full stream
+    can also be written to a file.
+
+    If the ring fills up, the events that don't fit are counted and a gap
+    marker goes into the ring once there is room again. Gaps show up in
+    the log and in the capture file, so missing events are never silent.
+ */
 class MidiMonitorNode   : public MidiFilterNode,
                           private Timer
 {
 public:
+    /** Kinds of message shown in the log */
+    enum Filter
+    {
+        notes           = 1 << 0,
+        controllers     = 1 << 1,   // control and program changes
+        pitchAndPressure= 1 << 2,
+        clock           = 1 << 3,   // timing clock and active sensing
+        transport       = 1 << 4,   // start, stop, continue and song position
+        sysex           = 1 << 5,
+        other           = 1 << 6,
+        allMessages     = (1 << 7) - 1,
+        defaultFilter   = allMessages & ~clock
+    };
+
+    /** An event as captured on the render thread */
+    struct Event
+    {
+        int64 frame;        // samples since prepareToRender
+        int size;           // full size, only the first 3 bytes are kept.
+                            // negative marks a gap of -size dropped events
+        uint8 data [3];
+
+        bool isGap() const noexcept { return size < 0; }
+        int getNumDropped() const noexcept { return isGap() ? -size : 0; }
+    };
+
     MidiMonitorNode();
     virtual ~MidiMonitorNode();
 
@@ -56,27 +93,66 @@ public:
 
     void render (AudioSampleBuffer& audio, MidiPipe& midi) override;
 
-    void setState (const void* data, int size) override {};
-    void getState (MemoryBlock& block) override {};
+    void setState (const void* data, int size) override;
+    void getState (MemoryBlock& block) override;
 
     void clearMessages();
     
     const StringArray& getLog() const { return midiLog; }
 
+    /** Sets which kinds of message are logged, a combination of Filter flags */
+    void setFilter (int newFilter)          { filter = newFilter; }
+    int getFilter() const                   { return filter; }
+
+    /** Sets how many lines are logged per refresh. The rest are counted */
+    void setMaxMessagesPerRefresh (int maxMessages) { maxLoggedPerRefresh = jmax (1, maxMessages); }
+
+    /** Writes every captured event to a CSV file, until stopCapture().
+        Gaps are written as rows with 'dropped' in the status column and
+        the number of events lost in data1 */
+    bool startCapture (const File& file);
+    void stopCapture();
+    bool isCapturing() const                { return capture != nullptr; }
+    File getCaptureFile() const             { return captureFile; }
+
+    /** Returns the number of events dropped because the ring was full */
+    int getNumDropped() const               { return dropped.get(); }
+
+    /** Returns the Filter flag for a message */
+    static int getFilterFlag (const uint8* data, int size) noexcept;
+
+    /** Formats captured events into lines, skipping filtered ones. Runs of
+        controller changes are thinned to their last value, and past
+        maxLines the remainder is counted in one line. Gaps are always
+        shown. Returns lines added */
+    static int formatEvents (const Event* events, int numEvents, int filter,
+                             int maxLines, StringArray& lines);
+
 private:
     friend class MidiMonitorNodeEditor;
      Signal<void()> messagesLogged;
     double currentSampleRate = 44100.0;
-    int numSamples = 0;
-    MidiMessageCollector inputMessages;
     bool createdPorts = false;
-    CriticalSection lock;
-    
-    MidiBuffer  midiTemp;
+
+    // render thread to message thread
+    enum { ringSize = 4096 };
+    AbstractFifo ring { ringSize };
+    HeapBlock<Event> events;
+    HeapBlock<Event> drained;
+    int64 samplePosition = 0;
+    Atomic<int> dropped { 0 };
+    int pendingGap = 0;         // render thread, dropped but not yet marked
+    int64 gapFrame = 0;
+
     StringArray midiLog;
     int maxLoggedMessages { 100 };
+    int maxLoggedPerRefresh { 32 };
+    int filter { defaultFilter };
     float refreshRateHz { 60.0 };
 
+    std::unique_ptr<FileOutputStream> capture;
+    File captureFile;
+
     inline void createPorts() override
     {
         if (createdPorts)
@@ -88,7 +164,6 @@ private:
         createdPorts = true;
     }
 
-    void getMessages (MidiBuffer &destBuffer);
     void timerCallback() override;
 };
 
@@ -25,13 +25,93 @@
 
 namespace Element {
 
+static void addRoutedEvents (MidiBuffer& out, const MidiBuffer& in, const MidiPrefilter& filter,
+                             const int channel, const int numSamples)
+{
+    MidiBuffer::Iterator iter (in);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
+
+    while (iter.getNextEvent (data, size, frame))
+    {
+        if (frame >= numSamples)
+            break;
+        if (! filter.accepts (data, size))
+            continue;
+
+        if (channel > 0 && size <= 3 && data[0] >= 0x80 && data[0] < 0xf0)
+        {
+            const uint8 moved[3] = { (uint8) ((data[0] & 0xf0) | (channel - 1)),
+                                     size > 1 ? data[1] : (uint8) 0,
+                                     size > 2 ? data[2] : (uint8) 0 };
+            out.addEvent (moved, size, frame);
+        }
+        else
+        {
+            out.addEvent (data, size, frame);
+        }
+    }
+}
+
+MidiRouterNode::RouteTable::RouteTable (const MatrixState& matrix, const Array<RouteOptions>& options)
+{
+    const int numSources = matrix.getNumRows();
+    const int numDestinations = matrix.getNumColumns();
+    HeapBlock<int> uses ((size_t) jmax (1, numSources), true);
+
+    for (int dst = 0; dst < numDestinations; ++dst)
+    {
+        firstRoutes.add (routes.size());
+        for (int src = 0; src < numSources; ++src)
+        {
+            if (! matrix.connected (src, dst))
+                continue;
+
+            Route route;
+            route.source  = src;
+            route.channel = 0;
+            for (const auto& opts : options)
+            {
+                if (opts.source == src && opts.destination == dst)
+                {
+                    route.filter.setChannels (opts.channels);
+                    route.channel = opts.channel;
+                    break;
+                }
+            }
+
+            route.plain = route.channel == 0 && route.filter.acceptsAll();
+            routes.add (route);
+            ++uses[src];
+        }
+    }
+
+    firstRoutes.add (routes.size());
+
+    for (int dst = 0; dst < numDestinations; ++dst)
+    {
+        const int first = firstRoutes.getUnchecked (dst);
+        const int count = firstRoutes.getUnchecked (dst + 1) - first;
+
+        if (count == 0)
+        {
+            fills.add (empty);
+            continue;
+        }
+
+        const auto& route = routes.getReference (first);
+        if (count == 1 && route.plain && uses[route.source] == 1)
+            fills.add (route.source == dst ? keep : move);
+        else
+            fills.add (merge);
+    }
+}
+
 MidiRouterNode::MidiRouterNode (int ins, int outs)
     : GraphNode (0),
       numSources (ins),
       numDestinations (outs),
-      state (ins, outs),
-      toggles (ins, outs),
-      nextToggles (ins, outs)
+      state (ins, outs)
 {
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
@@ -70,7 +150,12 @@ MidiRouterNode::MidiRouterNode (int ins, int outs)
     }
 }
 
-MidiRouterNode::~MidiRouterNode() { }
+MidiRouterNode::~MidiRouterNode()
+{
+    pendingTable.store (nullptr);
+    activeTable = nullptr;
+    tables.clear();
+}
 
 void MidiRouterNode::setCurrentProgram (int index)
 {
@@ -85,14 +170,7 @@ void MidiRouterNode::setMatrixState (const MatrixState& matrix)
 {
     jassert (state.sameSizeAs (matrix));
     state = matrix;
-    ToggleGrid newPatches (state);
-
-    {
-        ScopedLock sl (getLock());
-        toggles.swapWith (newPatches);
-        togglesChanged = true; // initiate the crossfade
-    }
-
+    publishRoutes();
     sendChangeMessage();
 }
 
@@ -109,38 +187,115 @@ void MidiRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
     const auto nbuffers = midi.getNumBuffers();
     audio.clear();
 
-    ScopedLock sl (getLock());
-    for (int src = 0; src < numSources; ++src)
+    adoptRoutes();
+    const auto* const table = activeTable;
+
+    // inputs are still intact while merging, so copies go first
+    if (table != nullptr)
     {
-        if (src >= nbuffers)
-            break;
-        
-        const auto& rb = *midi.getReadBuffer (src);
         for (int dst = 0; dst < numDestinations; ++dst)
-            if (toggles.get (src, dst))
-                midiOuts.getUnchecked(dst)->addEvents (rb, 0, nsamples, 0);
+        {
+            if (table->fills.getUnchecked (dst) != RouteTable::merge)
+                continue;
+
+            auto& out = *midiOuts.getUnchecked (dst);
+            for (int r = table->firstRoutes.getUnchecked (dst); r < table->firstRoutes.getUnchecked (dst + 1); ++r)
+            {
+                const auto& route = table->routes.getReference (r);
+                if (route.source >= nbuffers)
+                    continue;
+
+                const auto& rb = *midi.getReadBuffer (route.source);
+                if (route.plain)
+                    out.addEvents (rb, 0, nsamples, 0);
+                else
+                    addRoutedEvents (out, rb, route.filter, route.channel, nsamples);
+            }
+        }
+
+        // an input used by one route only is handed over without copying
+        for (int dst = 0; dst < numDestinations; ++dst)
+        {
+            if (table->fills.getUnchecked (dst) != RouteTable::move)
+                continue;
+            const int src = table->routes.getReference (table->firstRoutes.getUnchecked (dst)).source;
+            if (src < nbuffers)
+                midiOuts.getUnchecked (dst)->swapWith (*midi.getWriteBuffer (src));
+        }
     }
 
     for (int i = midiOuts.size(); --i >= 0;)
     {
+        if (table != nullptr && table->fills.getUnchecked (i) == RouteTable::keep)
+            continue;
+
         auto* const ob = midiOuts.getUnchecked (i);
         ob->swapWith (*midi.getWriteBuffer (i));
         ob->clear();
     }
 }
 
+void MidiRouterNode::publishRoutes()
+{
+    auto table = std::make_unique<RouteTable> (state, routeOptions);
+    table->serial = ++lastSerial;
+    auto* const skipped = pendingTable.exchange (table.get(), std::memory_order_acq_rel);
+    tables.push_back (std::move (table));
+
+    // the audio thread only moves forward, tables older than the one it's
+    // using won't be picked up again, nor will one it didn't take in time
+    const auto inUse = activeSerial.load (std::memory_order_acquire);
+    tables.erase (std::remove_if (tables.begin(), tables.end(),
+        [inUse, skipped] (const std::unique_ptr<RouteTable>& t) { return t->serial < inUse || t.get() == skipped; }),
+        tables.end());
+}
+
+void MidiRouterNode::adoptRoutes() noexcept
+{
+    if (auto* const next = pendingTable.exchange (nullptr, std::memory_order_acq_rel))
+    {
+        activeTable = next;
+        activeSerial.store (next->serial, std::memory_order_release);
+    }
+}
+
 void MidiRouterNode::getState (MemoryBlock& block)
 {
     MemoryOutputStream stream (block, false);
     state.createValueTree().writeToStream (stream);
+
+    ValueTree routes ("routes");
+    for (const auto& opts : routeOptions)
+    {
+        ValueTree route ("route");
+        route.setProperty ("source", opts.source, nullptr)
+             .setProperty ("destination", opts.destination, nullptr)
+             .setProperty ("channels", opts.channels, nullptr)
+             .setProperty ("channel", opts.channel, nullptr);
+        routes.appendChild (route, nullptr);
+    }
+    routes.writeToStream (stream);
 }
 
 void MidiRouterNode::setState (const void* data, int sizeInBytes)
 { 
-    const auto tree = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    MemoryInputStream stream (data, (size_t) sizeInBytes, false);
+    const auto tree = ValueTree::readFromStream (stream);
     
     if (tree.isValid())
     {
+        // older sessions have no route options after the matrix
+        routeOptions.clearQuick();
+        const auto routes = stream.isExhausted() ? ValueTree() : ValueTree::readFromStream (stream);
+        for (int i = 0; i < routes.getNumChildren(); ++i)
+        {
+            const auto route = routes.getChild (i);
+            const RouteOptions opts { route["source"], route["destination"],
+                                      route.getProperty ("channels", 0xffff), route["channel"] };
+            if (isPositiveAndBelow (opts.source, numSources) && isPositiveAndBelow (opts.destination, numDestinations))
+                routeOptions.add (opts);
+        }
+
         kv::MatrixState matrix;
         matrix.restoreFromValueTree (tree);
         jassert (matrix.getNumRows() == numSources && matrix.getNumColumns() == numDestinations);
@@ -151,25 +306,51 @@ void MidiRouterNode::setState (const void* data, int sizeInBytes)
 void MidiRouterNode::setWithoutLocking (int src, int dst, bool set)
 {
     jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
-    toggles.set (src, dst, set);
     state.set (src, dst, set);
+    publishRoutes();
+}
+
+void MidiRouterNode::setRouteChannels (int src, int dst, int channelMask, int outputChannel)
+{
+    jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
+    channelMask &= 0xffff;
+    outputChannel = jlimit (0, 16, outputChannel);
+
+    for (int i = routeOptions.size(); --i >= 0;)
+        if (routeOptions.getReference(i).source == src && routeOptions.getReference(i).destination == dst)
+            routeOptions.remove (i);
+    if (channelMask != 0xffff || outputChannel != 0)
+        routeOptions.add ({ src, dst, channelMask, outputChannel });
+
+    publishRoutes();
+    sendChangeMessage();
+}
+
+int MidiRouterNode::getRouteChannelMask (int src, int dst) const
+{
+    for (const auto& opts : routeOptions)
+        if (opts.source == src && opts.destination == dst)
+            return opts.channels;
+    return 0xffff;
+}
+
+int MidiRouterNode::getRouteOutputChannel (int src, int dst) const
+{
+    for (const auto& opts : routeOptions)
+        if (opts.source == src && opts.destination == dst)
+            return opts.channel;
+    return 0;
 }
 
 void MidiRouterNode::set (int src, int dst, bool patched)
 {
-    jassert (src >= 0 && src < numSources && dst >= 0 && numDestinations < 4);
-    toggles.set (src, dst, patched);
+    jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
     state.set (src, dst, patched);
+    publishRoutes();
 }
 
 void MidiRouterNode::clearPatches()
 {
-    {
-        ScopedLock sl (getLock());
-        toggles.clear();
-        nextToggles.clear();
-    }
-
     for (int r = 0; r < state.getNumRows(); ++r)
         for (int c = 0; c < state.getNumColumns(); ++c)
             state.set (r, c, false);
@@ -21,7 +21,7 @@
 
 #include "engine/GraphNode.h"
 #include "engine/LinearFade.h"
-#include "engine/ToggleGrid.h"
+#include "engine/MidiPrefilter.h"
 #include "engine/nodes/BaseProcessor.h"
 
 namespace Element {
@@ -44,7 +44,13 @@ public:
     void setMatrixState (const MatrixState&);
     MatrixState getMatrixState() const;
     void setWithoutLocking (int src, int dst, bool set);
-    CriticalSection& getLock() { return lock; }
+
+    /** Limits a route to a set of source channels, bit 0 is channel 1, and
+        optionally moves its channel messages to one output channel. An
+        output channel of 0 keeps the channels */
+    void setRouteChannels (int src, int dst, int channelMask, int outputChannel = 0);
+    int getRouteChannelMask (int src, int dst) const;
+    int getRouteOutputChannel (int src, int dst) const;
 
     int getNumPrograms() const override { return jmax (1, programs.size()); }
     int getCurrentProgram() const override { return currentProgram; }
@@ -90,7 +96,6 @@ protected:
     }
 
 private:
-    CriticalSection lock;
     const int numSources;
     const int numDestinations;
     
@@ -112,9 +117,52 @@ private:
     // used by the UI, but not the rendering
     MatrixState state;
 
-    ToggleGrid toggles;
-    ToggleGrid nextToggles;
-    bool togglesChanged { false };
+    struct RouteOptions
+    {
+        int source, destination;
+        int channels;
+        int channel;
+    };
+
+    Array<RouteOptions> routeOptions;
+
+    /** The patched routes only, grouped by destination. Built on the
+        message thread and handed to the audio thread without locking */
+    struct RouteTable
+    {
+        RouteTable (const MatrixState&, const Array<RouteOptions>&);
+
+        enum Fill
+        {
+            empty = 0,  // nothing routed
+            keep,       // an input passes to its own output untouched
+            move,       // the only use of an input, its buffer is swapped over
+            merge       // events are copied from each route
+        };
+
+        struct Route
+        {
+            int source;
+            MidiPrefilter filter;
+            int channel;
+            bool plain;
+        };
+
+        Array<Route> routes;
+        Array<int> firstRoutes;
+        Array<int> fills;
+        int serial = 0;
+    };
+
+    // tables are owned by the message thread and deleted once the audio
+    // thread has moved past them, or never picked them up
+    std::vector<std::unique_ptr<RouteTable>> tables;
+    int lastSerial = 0;
+    RouteTable* activeTable = nullptr;
+    std::atomic<RouteTable*> pendingTable { nullptr };
+    std::atomic<int> activeSerial { 0 };
+    void publishRoutes();
+    void adoptRoutes() noexcept;
 
     OwnedArray<MidiBuffer> midiOuts;
     void initMidiOuts (OwnedArray<MidiBuffer>& outs);
@@ -0,0 +1,130 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+    Author Eliot Akira <me@eliotakira.com>
+    
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/GraphProcessor.h"
+#include "engine/nodes/MidiSequencerNode.h"
+
+namespace Element {
+
+MidiSequencerNode::MidiSequencerNode()
+    : MidiFilterNode (0)
+{
+    jassert (metadata.hasType (Tags::node));
+    metadata.setProperty (Tags::format, "Element", nullptr);
+    metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_MIDI_SEQUENCER, nullptr);
+}
+
+MidiSequencerNode::~MidiSequencerNode() { }
+
+void MidiSequencerNode::prepareToRender (double sampleRate, int maxBufferSize)
+{
+    sequencer.prepare (sampleRate);
+    output.ensureSize ((size_t) jmax (512, maxBufferSize) * 3);
+}
+
+void MidiSequencerNode::releaseResources()
+{
+    sequencer.reset();
+}
+
+void MidiSequencerNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
+{
+    const auto nframes = audio.getNumSamples();
+    auto* const buffer = midi.getWriteBuffer (0);
+
+    PatternSequencer::Position position;
+    AudioPlayHead::CurrentPositionInfo info;
+    if (auto* const graph = getParentGraph())
+    {
+        if (auto* const playhead = graph->getPlayHead())
+        {
+            if (playhead->getCurrentPosition (info))
+            {
+                position.beat    = info.ppqPosition;
+                position.tempo   = info.bpm;
+                position.playing = info.isPlaying;
+            }
+        }
+    }
+
+    output.clear();
+    sequencer.render (position, nframes, *buffer, output);
+    buffer->swapWith (output);
+}
+
+void MidiSequencerNode::setState (const void* data, int size)
+{
+    const auto tree = ValueTree::readFromGZIPData (data, (size_t) size);
+    if (! tree.isValid())
+        return;
+
+    sequencer.setStepLength (tree.getProperty ("stepLength", 0.25));
+    sequencer.setSwing (tree.getProperty ("swing", 0.0));
+    sequencer.setMode (tree.getProperty ("mode", (int) PatternSequencer::sequence));
+    sequencer.setOctaves (tree.getProperty ("octaves", 1));
+    sequencer.setChannel (tree.getProperty ("channel", 1));
+    sequencer.setLoop (tree.getProperty ("loopStart", 0), tree.getProperty ("loopEnd", 16));
+
+    for (int i = 0; i < tree.getNumChildren(); ++i)
+    {
+        const auto child = tree.getChild (i);
+        PatternSequencer::Step step;
+        step.note       = child.getProperty ("note", step.note);
+        step.velocity   = child.getProperty ("velocity", step.velocity);
+        step.gate       = child.getProperty ("gate", step.gate);
+        step.enabled    = child.getProperty ("enabled", step.enabled);
+        sequencer.setStep (child.getProperty ("index", i), step);
+    }
+
+    sendChangeMessage();
+}
+
+void MidiSequencerNode::getState (MemoryBlock& block)
+{
+    ValueTree tree ("state");
+    tree.setProperty ("stepLength", sequencer.getStepLength(), nullptr)
+        .setProperty ("swing", sequencer.getSwing(), nullptr)
+        .setProperty ("mode", sequencer.getMode(), nullptr)
+        .setProperty ("octaves", sequencer.getOctaves(), nullptr)
+        .setProperty ("channel", sequencer.getChannel(), nullptr)
+        .setProperty ("loopStart", sequencer.getLoopStart(), nullptr)
+        .setProperty ("loopEnd", sequencer.getLoopEnd(), nullptr);
+
+    // every step, so steps outside the loop survive a reload
+    for (int i = 0; i < PatternSequencer::maxSteps; ++i)
+    {
+        const auto step = sequencer.getStep (i);
+        ValueTree child ("step");
+        child.setProperty ("index", i, nullptr)
+             .setProperty ("note", step.note, nullptr)
+             .setProperty ("velocity", step.velocity, nullptr)
+             .setProperty ("gate", step.gate, nullptr)
+             .setProperty ("enabled", step.enabled, nullptr);
+        tree.appendChild (child, nullptr);
+    }
+
+    MemoryOutputStream stream (block, false);
+    {
+        GZIPCompressorOutputStream gzip (stream);
+        tree.writeToStream (gzip);
+    }
+}
+
+}
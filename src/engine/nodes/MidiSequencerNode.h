@@ -0,0 +1,88 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+    Author Eliot Akira <me@eliotakira.com>
+    
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/MidiPipe.h"
+#include "engine/PatternSequencer.h"
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/nodes/MidiFilterNode.h"
+
+namespace Element {
+
+/** Plays a step pattern, or arpeggiates held notes, in time with the
+    transport of the graph it is in.
+
+    Beats are read from the parent graph's play head, which is the
+    engine's transport, at the start of every block.
+
+    MidiSequencerEditor edits the pattern and its settings.
+ */
+class MidiSequencerNode : public MidiFilterNode,
+                          public ChangeBroadcaster
+{
+public:
+    MidiSequencerNode();
+    virtual ~MidiSequencerNode();
+
+    void fillInPluginDescription (PluginDescription& desc)
+    {
+        desc.name               = "MIDI Sequencer";
+        desc.fileOrIdentifier   = EL_INTERNAL_ID_MIDI_SEQUENCER;
+        desc.uid                = EL_INTERNAL_UID_MIDI_SEQUENCER;
+        desc.descriptiveName    = "Step Sequencer and Arpeggiator";
+        desc.numInputChannels   = 0;
+        desc.numOutputChannels  = 0;
+        desc.hasSharedContainer = false;
+        desc.isInstrument       = false;
+        desc.manufacturerName   = "Element";
+        desc.pluginFormatName   = "Element";
+        desc.version            = "1.0.0";
+    }
+
+    void prepareToRender (double sampleRate, int maxBufferSize) override;
+    void releaseResources() override;
+
+    void render (AudioSampleBuffer& audio, MidiPipe& midi) override;
+
+    void setState (const void* data, int size) override;
+    void getState (MemoryBlock& block) override;
+
+    /** The pattern, its settings can be changed while rendering */
+    PatternSequencer& getSequencer()            { return sequencer; }
+
+private:
+    PatternSequencer sequencer;
+    MidiBuffer output;
+    bool createdPorts = false;
+
+    inline void createPorts() override
+    {
+        if (createdPorts)
+            return;
+
+        ports.clearQuick();
+        ports.add (PortType::Midi, 0, 0, "midi_in", "MIDI In", true);
+        ports.add (PortType::Midi, 1, 0, "midi_out", "MIDI Out", false);
+        createdPorts = true;
+    }
+};
+
+}
@@ -19,24 +19,182 @@
 */
 
 #include "engine/nodes/OSCReceiverNode.h"
-#include "Utils.h"
 
 namespace Element {
 
+enum MidiCommand
+{
+    rawCommand = 0,
+    noteOnCommand,
+    noteOffCommand,
+    programChangeCommand,
+    pitchBendCommand,
+    afterTouchCommand,
+    channelPressureCommand,
+    controlChangeCommand,
+    allNotesOffCommand,
+    allSoundOffCommand,
+    allControllersOffCommand,
+    startCommand,
+    continueCommand,
+    stopCommand,
+    clockCommand,
+    songPositionPointerCommand
+};
+
+/** Addresses understood, with or without a device name */
+static const OSCAddressTrie& getMidiCommands()
+{
+    static const OSCAddressTrie commands = []()
+    {
+        const char* names[] = { "raw", "noteOn", "noteOff", "programChange", "pitchBend",
+                                "afterTouch", "channelPressure", "controlChange", "allNotesOff",
+                                "allSoundOff", "allControllersOff", "start", "continue", "stop",
+                                "clock", "songPositionPointer" };
+        OSCAddressTrie trie;
+        for (int i = 0; i < numElementsInArray (names); ++i)
+        {
+            trie.add (String ("/midi/") + names[i], i);
+            trie.add (String ("/midi/*/") + names[i], i);
+        }
+        trie.compile();
+        return trie;
+    }();
+
+    return commands;
+}
+
+static inline uint8 channelStatus (int status, int channel) noexcept
+{
+    return (uint8) (status | (jlimit (1, 16, channel) - 1));
+}
+
+static inline uint8 dataByte (int value) noexcept
+{
+    return (uint8) jlimit (0, 127, value);
+}
+
+int OSCReceiverNode::decodeMidi (const OSCMessageView& message, uint8* data, int maxSize) noexcept
+{
+    jassert (maxSize >= 3);
+    const int command = getMidiCommands().match (message.address, message.addressLength);
+    const int numArgs = message.numArguments;
+
+    switch (command)
+    {
+        case rawCommand:
+        {
+            for (int i = 0; i < numArgs; ++i)
+            {
+                int size = 0;
+                if (const auto* blob = message.getBlob (i, size))
+                {
+                    if (size <= 0 || size > maxSize)
+                        return 0;
+                    memcpy (data, blob, (size_t) size);
+                    return size;
+                }
+            }
+            break;
+        }
+
+        case noteOnCommand:
+        case noteOffCommand:
+            if (numArgs < 3)
+                break;
+            data[0] = channelStatus (command == noteOnCommand ? 0x90 : 0x80, message.getInt (0));
+            data[1] = dataByte (message.getInt (1));
+            data[2] = MidiMessage::floatValueToMidiByte (message.getFloat (2));
+            return 3;
+
+        case programChangeCommand:
+            if (numArgs < 2)
+                break;
+            data[0] = channelStatus (0xc0, message.getInt (0));
+            data[1] = dataByte (message.getInt (1));
+            return 2;
+
+        case pitchBendCommand:
+        {
+            if (numArgs < 2)
+                break;
+            const int value = jlimit (0, 16383, message.getInt (1));
+            data[0] = channelStatus (0xe0, message.getInt (0));
+            data[1] = (uint8) (value & 127);
+            data[2] = (uint8) (value >> 7);
+            return 3;
+        }
+
+        case afterTouchCommand:
+            if (numArgs < 3)
+                break;
+            data[0] = channelStatus (0xa0, message.getInt (0));
+            data[1] = dataByte (message.getInt (1));
+            data[2] = dataByte (message.getInt (2));
+            return 3;
+
+        case channelPressureCommand:
+            if (numArgs < 2)
+                break;
+            data[0] = channelStatus (0xd0, message.getInt (0));
+            data[1] = dataByte (message.getInt (1));
+            return 2;
+
+        case controlChangeCommand:
+        case allNotesOffCommand:
+        case allSoundOffCommand:
+        case allControllersOffCommand:
+        {
+            const int needed = command == controlChangeCommand ? 3 : 1;
+            if (numArgs < needed)
+                break;
+            data[0] = channelStatus (0xb0, message.getInt (0));
+            data[1] = command == allNotesOffCommand       ? (uint8) 123
+                    : command == allSoundOffCommand       ? (uint8) 120
+                    : command == allControllersOffCommand ? (uint8) 121
+                    : dataByte (message.getInt (1));
+            data[2] = command == controlChangeCommand ? dataByte (message.getInt (2)) : (uint8) 0;
+            return 3;
+        }
+
+        case startCommand:      data[0] = 0xfa; return 1;
+        case continueCommand:   data[0] = 0xfb; return 1;
+        case stopCommand:       data[0] = 0xfc; return 1;
+        case clockCommand:      data[0] = 0xf8; return 1;
+
+        case songPositionPointerCommand:
+        {
+            if (numArgs < 1)
+                break;
+            const int value = jlimit (0, 16383, message.getInt (0));
+            data[0] = 0xf2;
+            data[1] = (uint8) (value & 127);
+            data[2] = (uint8) (value >> 7);
+            return 3;
+        }
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+//=============================================================================
+
 OSCReceiverNode::OSCReceiverNode()
     : MidiFilterNode (0)
 {
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_OSC_RECEIVER, nullptr);
-
-    oscReceiver.addListener (this);
+    events.allocate ((size_t) queueSize, true);
 }
 
 OSCReceiverNode::~OSCReceiverNode()
 {
-    oscReceiver.removeListener (this);
-    oscReceiver.disconnect();
+    ingress->unsubscribe (this);
+    cancelPendingUpdate();
 }
 
 void OSCReceiverNode::setState (const void* data, int size)
@@ -69,7 +227,7 @@ void OSCReceiverNode::getState (MemoryBlock& block)
     tree.setProperty ("hostName", currentHostName, nullptr);
     tree.setProperty ("portNumber", currentPortNumber, nullptr);
     tree.setProperty ("connected", connected, nullptr);
-    tree.setProperty ("paused", paused, nullptr);
+    tree.setProperty ("paused", paused.load(), nullptr);
 
     MemoryOutputStream stream (block, false);
 
@@ -95,41 +253,89 @@ inline void OSCReceiverNode::createPorts()
 
 void OSCReceiverNode::prepareToRender (double sampleRate, int maxBufferSize)
 {
-    if (! outputMidiMessagesInitDone) {
-        outputMidiMessages.reset (sampleRate);
-        currentSampleRate = sampleRate;
-        outputMidiMessagesInitDone = true;
-    }
+    ignoreUnused (maxBufferSize);
+    currentSampleRate = sampleRate;
 }
 
 void OSCReceiverNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     const auto nframes = audio.getNumSamples();
-    if (nframes == 0) {
+    if (nframes == 0 || queue.getNumReady() <= 0)
         return;
-    }
 
-    outputMidiMessages.removeNextBlockOfMessages ( *midi.getWriteBuffer (0), nframes );
+    // events land where they arrived during the last block
+    auto& output = *midi.getWriteBuffer (0);
+    const double now = Time::getMillisecondCounterHiRes();
+    const double samplesPerMs = currentSampleRate * 0.001;
+
+    int start1, size1, start2, size2;
+    const int numReady = queue.getNumReady();
+    queue.prepareToRead (numReady, start1, size1, start2, size2);
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        const auto& event = events [i < size1 ? start1 + i : start2 + (i - size1)];
+        const int frame = nframes - 1 - roundToInt ((now - event.time) * samplesPerMs);
+        output.addEvent (event.data, event.size, jlimit (0, nframes - 1, frame));
+    }
+    queue.finishedRead (size1 + size2);
 }
 
-/** OSCReceiver real-time callbacks */
+/** Shared ingress callbacks, on the port thread */
 
-void OSCReceiverNode::oscMessageReceived (const OSCMessage& message)
+void OSCReceiverNode::oscMessageReceived (const OSCMessageView& message, double timeMs)
 {
-    if (paused)
+    if (paused.load())
         return;
 
-    auto timestamp = Time::getMillisecondCounterHiRes();
+    uint8 data [sizeof (Event::data)];
+    const int size = decodeMidi (message, data, (int) sizeof (data));
+    if (size <= 0)
+        return;
 
-    MidiMessage midiMsg = Util::processOscToMidiMessage (message);
-    midiMsg.setTimeStamp (timestamp);
+    int start1, size1, start2, size2;
+    queue.prepareToWrite (1, start1, size1, start2, size2);
+    if (size1 + size2 <= 0)
+        return;
 
-    outputMidiMessages.addMessageToQueue( midiMsg );
-};
+    auto& event = events [size1 > 0 ? start1 : start2];
+    event.time = timeMs;
+    event.size = size;
+    memcpy (event.data, data, (size_t) size);
+    queue.finishedWrite (1);
+}
 
-void OSCReceiverNode::oscBundleReceived(const OSCBundle& bundle)
+void OSCReceiverNode::oscPacketReceived (const void* data, int size)
 {
-};
+    {
+        ScopedLock sl (monitorLock);
+        if (monitorPackets.size() >= 256)
+            return;
+        monitorPackets.add (MemoryBlock (data, (size_t) size));
+    }
+
+    triggerAsyncUpdate();
+}
+
+void OSCReceiverNode::handleAsyncUpdate()
+{
+    Array<MemoryBlock> packets;
+    {
+        ScopedLock sl (monitorLock);
+        packets.swapWith (monitorPackets);
+    }
+
+    for (const auto& packet : packets)
+    {
+        OSCPacketParser::parse (packet.getData(), (int) packet.getSize(), [this] (const OSCMessageView& view)
+        {
+            OSCMessage message ("/");
+            if (view.toMessage (message))
+                monitors.call ([&message] (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>& l) {
+                    l.oscMessageReceived (message);
+                });
+        });
+    }
+}
 
 /** For node editor */
 
@@ -139,7 +345,7 @@ bool OSCReceiverNode::connect (int portNumber)
         return connected;
 
     currentPortNumber = portNumber;
-    connected = oscReceiver.connect (portNumber);
+    connected = ingress->subscribe (portNumber, this);
 
     return connected;
 }
@@ -149,7 +355,8 @@ bool OSCReceiverNode::disconnect ()
     if (!connected)
         return true;
     connected = false;
-    return oscReceiver.disconnect();
+    ingress->unsubscribe (this);
+    return true;
 }
 
 bool OSCReceiverNode::isConnected ()
@@ -208,12 +415,14 @@ void OSCReceiverNode::setHostName (String hostName)
 
 void OSCReceiverNode::addMessageLoopListener (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>* callback)
 {
-    oscReceiver.addListener (callback);
+    monitors.add (callback);
+    numMonitors.store (monitors.size());
 }
 
 void OSCReceiverNode::removeMessageLoopListener (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>* callback)
 {
-    oscReceiver.removeListener (callback);
+    monitors.remove (callback);
+    numMonitors.store (monitors.size());
 }
 
 }
@@ -21,14 +21,22 @@
 #pragma once
 
 #include "engine/MidiPipe.h"
+#include "engine/OSCIngress.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
 
 namespace Element {
 
+/** Turns OSC messages addressed to /midi/{command} or
+    /midi/{deviceName}/{command} into MIDI.
+
+    The node subscribes to a port on the shared OSCIngress. Messages are
+    decoded on the port's thread and queued without locks for render().
+ */
 class OSCReceiverNode : public MidiFilterNode,
                         public ChangeBroadcaster,
-                        public OSCReceiver::Listener<OSCReceiver::RealtimeCallback>
+                        private OSCIngress::Subscriber,
+                        private AsyncUpdater
 {
 public:
 
@@ -76,23 +84,45 @@ public:
     void addMessageLoopListener (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>* callback);
     void removeMessageLoopListener (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>* callback);
 
+    /** Decodes a /midi message into raw MIDI. Returns the number of bytes
+        written, or 0 if the message isn't MIDI */
+    static int decodeMidi (const OSCMessageView& message, uint8* data, int maxSize) noexcept;
+
 private:
 
     /** MIDI */
     bool createdPorts = false;
-    double currentSampleRate;
-    bool outputMidiMessagesInitDone = false;
-    MidiMessageCollector outputMidiMessages;
+    double currentSampleRate = 44100.0;
+
+    /** Decoded MIDI from the port thread to render() */
+    struct Event
+    {
+        double time;
+        int size;
+        uint8 data [20];
+    };
+
+    enum { queueSize = 1024 };
+    AbstractFifo queue { queueSize };
+    HeapBlock<Event> events;
 
     /** OSC */
-    OSCReceiver oscReceiver;
+    SharedResourcePointer<OSCIngress> ingress;
     bool connected = false;
-    bool paused = false;
+    std::atomic<bool> paused { false };
     int currentPortNumber = 9001;
     String currentHostName = "";
 
-    void oscMessageReceived(const OSCMessage& message) override;
-    void oscBundleReceived(const OSCBundle& bundle) override;
+    /** Raw packets for message loop listeners */
+    ListenerList<OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>> monitors;
+    std::atomic<int> numMonitors { 0 };
+    CriticalSection monitorLock;
+    Array<MemoryBlock> monitorPackets;
+
+    void oscMessageReceived (const OSCMessageView& message, double timeMs) override;
+    void oscPacketReceived (const void* data, int size) override;
+    bool wantsPackets() const override { return numMonitors.load() > 0; }
+    void handleAsyncUpdate() override;
 };
 
 
@@ -23,6 +23,178 @@
 
 namespace Element {
 
+/** Seconds from the OSC epoch, 1900, to the unix epoch */
+static const double ntpEpochOffset = 2208988800.0;
+
+OSCSenderNode::PacketWriter::PacketWriter (uint8* d, int c) noexcept
+    : data (d), capacity (c) { }
+
+void OSCSenderNode::PacketWriter::reset() noexcept
+{
+    position = depth = numMessages = 0;
+}
+
+bool OSCSenderNode::PacketWriter::writeInt (int32 value) noexcept
+{
+    if (position + 4 > capacity)
+        return false;
+    const auto bits = (uint32) value;
+    data[position++] = (uint8) (bits >> 24);
+    data[position++] = (uint8) (bits >> 16);
+    data[position++] = (uint8) (bits >> 8);
+    data[position++] = (uint8) bits;
+    return true;
+}
+
+bool OSCSenderNode::PacketWriter::writeFloat (float value) noexcept
+{
+    int32 bits;
+    memcpy (&bits, &value, sizeof (bits));
+    return writeInt (bits);
+}
+
+bool OSCSenderNode::PacketWriter::writeString (const char* text) noexcept
+{
+    const int length = (int) strlen (text);
+    const int padded = (length + 4) & ~3;
+    if (position + padded > capacity)
+        return false;
+    memcpy (data + position, text, (size_t) length);
+    memset (data + position + length, 0, (size_t) (padded - length));
+    position += padded;
+    return true;
+}
+
+bool OSCSenderNode::PacketWriter::beginBundle (uint64 timeTag) noexcept
+{
+    if (depth >= numElementsInArray (sizes))
+        return false;
+
+    const int start = position;
+    sizes[depth] = position;
+    const bool ok = (depth == 0 || writeInt (0))
+        && writeString ("#bundle")
+        && writeInt ((int32) (timeTag >> 32))
+        && writeInt ((int32) (timeTag & 0xffffffff));
+
+    if (! ok)
+    {
+        position = start;
+        return false;
+    }
+
+    ++depth;
+    return true;
+}
+
+void OSCSenderNode::PacketWriter::endBundle() noexcept
+{
+    jassert (depth > 0);
+    if (--depth == 0)
+        return;
+
+    // nested elements are preceded by their size
+    const int start = sizes[depth];
+    const int end = position;
+    position = start;
+    writeInt (end - start - 4);
+    position = end;
+}
+
+bool OSCSenderNode::PacketWriter::addMidi (const uint8* midi, int size) noexcept
+{
+    if (size <= 0)
+        return true;
+
+    const int status = midi[0];
+    const int channel = (status & 0x0f) + 1;
+    auto byte = [midi, size] (int index) { return index < size ? (int) (midi[index] & 0x7f) : 0; };
+
+    const char* address = nullptr;
+    const char* types = ",";
+    int32 args[3] = { 0, 0, 0 };
+    float velocity = 0.f;
+
+    if (status >= 0xf0)
+    {
+        switch (status)
+        {
+            case 0xfa: address = "/midi/start"; break;
+            case 0xfb: address = "/midi/continue"; break;
+            case 0xfc: address = "/midi/stop"; break;
+            case 0xf8: address = "/midi/clock"; break;
+            case 0xfe: address = "/midi/activeSense"; break;
+            case 0xf2:
+                address = "/midi/songPositionPointer";
+                types = ",i";
+                args[0] = byte (1) | (byte (2) << 7);
+                break;
+            default: break;
+        }
+    }
+    else
+    {
+        args[0] = channel;
+        args[1] = byte (1);
+        args[2] = byte (2);
+
+        switch (status & 0xf0)
+        {
+            case 0x90:
+            case 0x80:
+                address = (status & 0xf0) == 0x90 && args[2] > 0 ? "/midi/noteOn" : "/midi/noteOff";
+                types = ",iif";
+                velocity = (float) args[2] / 127.f;
+                break;
+            case 0xa0: address = "/midi/afterTouch";     types = ",iii"; break;
+            case 0xb0: address = "/midi/controlChange";  types = ",iii"; break;
+            case 0xc0: address = "/midi/programChange";  types = ",ii";  break;
+            case 0xd0: address = "/midi/channelPressure"; types = ",ii"; break;
+            case 0xe0:
+                address = "/midi/pitchBend";
+                types = ",ii";
+                args[1] = byte (1) | (byte (2) << 7);
+                break;
+            default: break;
+        }
+    }
+
+    if (address == nullptr)
+        return true;
+
+    const int start = position;
+    bool ok = (depth == 0 || writeInt (0)) && writeString (address) && writeString (types);
+    for (int i = 1; ok && types[i] != 0; ++i)
+        ok = types[i] == 'f' ? writeFloat (velocity) : writeInt (args[i - 1]);
+
+    if (! ok)
+    {
+        position = start;
+        return false;
+    }
+
+    if (depth > 0)
+    {
+        const int end = position;
+        position = start;
+        writeInt (end - start - 4);
+        position = end;
+    }
+
+    ++numMessages;
+    return true;
+}
+
+uint64 OSCSenderNode::toTimeTag (double timeMs, double counterNowMs, int64 wallNowMs) noexcept
+{
+    const double seconds = ((double) wallNowMs + (timeMs - counterNowMs)) * 0.001 + ntpEpochOffset;
+    const double whole = std::floor (seconds);
+    const auto fraction = (uint64) ((seconds - whole) * 4294967296.0);
+    return ((uint64) whole << 32) | (fraction & 0xffffffff);
+}
+
+//=============================================================================
+
 OSCSenderNode::OSCSenderNode()
     : MidiFilterNode (0),
       Thread ("osc sender midi processing thread")
@@ -31,13 +203,17 @@ OSCSenderNode::OSCSenderNode()
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_OSC_SENDER, nullptr);
 
+    events.allocate ((size_t) queueSize, true);
+    sending.allocate ((size_t) queueSize, true);
+    packet.allocate ((size_t) maxPacketSize, true);
+
     startThread();
 }
 
 OSCSenderNode::~OSCSenderNode()
 {
     stop();
-    oscSender.disconnect();
+    disconnect();
 }
 
 void OSCSenderNode::setState (const void* data, int size)
@@ -69,8 +245,8 @@ void OSCSenderNode::getState (MemoryBlock& block)
     ValueTree tree ("state");
     tree.setProperty ("hostName", currentHostName, nullptr);
     tree.setProperty ("portNumber", currentPortNumber, nullptr);
-    tree.setProperty ("connected", connected, nullptr);
-    tree.setProperty ("paused", paused, nullptr);
+    tree.setProperty ("connected", connected.load(), nullptr);
+    tree.setProperty ("paused", paused.load(), nullptr);
 
     MemoryOutputStream stream (block, false);
 
@@ -89,35 +265,95 @@ void OSCSenderNode::run ()
         if (threadShouldExit())
             break;
 
-        /** MIDI queue -> OSC messages */
+        // copy out so blocks that wrap around the queue are contiguous
+        const int numReady = queue.getNumReady();
+        if (numReady <= 0)
+            continue;
 
-        MidiBuffer messages;
+        int start1, size1, start2, size2;
+        queue.prepareToRead (numReady, start1, size1, start2, size2);
+        memcpy (sending.get(), events + start1, (size_t) size1 * sizeof (Event));
+        if (size2 > 0)
+            memcpy (sending + size1, events + start2, (size_t) size2 * sizeof (Event));
+        queue.finishedRead (size1 + size2);
 
-        midiMessageQueue.removeNextBlockOfMessages (messages, numSamples.get());
-        numSamples = 0;
+        const int numEvents = size1 + size2;
+        for (int first = 0; first < numEvents;)
+        {
+            int last = first + 1;
+            while (last < numEvents && sending[last].block == sending[first].block)
+                ++last;
+            sendBlock (sending + first, last - first);
+            first = last;
+        }
+    }
 
-        MidiBuffer::Iterator iter1 (messages);
-        MidiMessage msg;
-        int frame;
+    DBG("[EL] OSCSenderNode: MIDI -> OSC sending thread exited");
+}
 
-        ScopedLock sl (lock);
+void OSCSenderNode::sendBlock (const Event* block, int numEvents)
+{
+    const double counterNow = Time::getMillisecondCounterHiRes();
+    const int64 wallNow = Time::currentTimeMillis();
+    const uint64 blockTag = toTimeTag (block[0].time, counterNow, wallNow);
 
-        while (iter1.getNextEvent (msg, frame))
+    PacketWriter writer (packet, maxPacketSize);
+    auto flush = [this, &writer]()
+    {
+        while (writer.getDepth() > 0)
+            writer.endBundle();
+        if (! writer.isEmpty())
+            sendPacket (writer);
+        writer.reset();
+    };
+
+    for (int i = 0; i < numEvents; ++i)
+    {
+        const auto& event = block[i];
+        const bool newOffset = i == 0 || event.time != block[i - 1].time;
+        const uint64 tag = toTimeTag (event.time, counterNow, wallNow);
+
+        // one bundle per block, and one inside it per sample offset
+        if (newOffset && writer.getDepth() == 2)
+            writer.endBundle();
+        if (writer.getDepth() == 0 && ! writer.beginBundle (blockTag))
+            continue;
+        if (writer.getDepth() == 1 && ! writer.beginBundle (tag))
         {
-            OSCMessage oscMsg = Util::processMidiToOscMessage (msg);
-            oscSender.send ( oscMsg );
+            flush();
+            if (! writer.beginBundle (blockTag) || ! writer.beginBundle (tag))
+                continue;
+        }
 
-            if (! msg.isMidiClock())
-            {
-                oscMessagesToLog.push_back ( oscMsg );
-            }
+        if (! writer.addMidi (event.data, event.size))
+        {
+            flush();
+            if (! writer.beginBundle (blockTag) || ! writer.beginBundle (tag)
+                || ! writer.addMidi (event.data, event.size))
+                continue;
         }
 
-        while (oscMessagesToLog.size() > maxOscMessages)
-            oscMessagesToLog.erase ( oscMessagesToLog.begin() );
+        if (event.size == 1 && event.data[0] == 0xf8)
+            continue;
+
+        SpinLock::ScopedLockType sl (logLock);
+        auto& entry = logEntries [(logStart + logSize) % maxOscMessages];
+        entry.size = event.size;
+        memcpy (entry.data, event.data, sizeof (entry.data));
+        if (logSize < maxOscMessages)
+            ++logSize;
+        else
+            logStart = (logStart + 1) % maxOscMessages;
     }
 
-    DBG("[EL] OSCSenderNode: OSC -> MIDI processing thread exited");
+    flush();
+}
+
+void OSCSenderNode::sendPacket (PacketWriter& writer)
+{
+    ScopedLock sl (lock);
+    if (socket != nullptr)
+        socket->write (currentHostName, currentPortNumber, packet, writer.getSize());
 }
 
 void OSCSenderNode::stop ()
@@ -143,37 +379,51 @@ inline void OSCSenderNode::createPorts()
     createdPorts = true;
 }
 
-void OSCSenderNode::prepareToRender (double sampleRate, int maxBufferSize) {
-    if (! midiMessageQueueInitDone) {
-        midiMessageQueue.reset (sampleRate);
-        currentSampleRate = sampleRate;
-        midiMessageQueueInitDone = true;
-    }
-};
+void OSCSenderNode::prepareToRender (double sampleRate, int maxBufferSize)
+{
+    ignoreUnused (maxBufferSize);
+    currentSampleRate = sampleRate;
+}
 
 void OSCSenderNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     const auto nframes = audio.getNumSamples();
     auto* const midiIn = midi.getWriteBuffer (0);
 
-    if (nframes == 0 || !connected || paused) {
+    if (nframes == 0 || ! connected.load() || paused.load() || midiIn->isEmpty())
+    {
         midiIn->clear();
         return;
     }
 
-    MidiBuffer::Iterator iter1 (*midiIn);
-    MidiMessage msg;
-    int frame;
-    auto timestamp = Time::getMillisecondCounterHiRes();
+    // a block is published whole so it goes out in one packet
+    int start1, size1, start2, size2;
+    queue.prepareToWrite (midiIn->getNumEvents(), start1, size1, start2, size2);
 
-    while (iter1.getNextEvent (msg, frame))
+    MidiBuffer::Iterator iter (*midiIn);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0, numWritten = 0;
+    const double timestamp = Time::getMillisecondCounterHiRes();
+    const double msPerSample = 1000.0 / currentSampleRate;
+    ++blockSerial;
+
+    while (numWritten < size1 + size2 && iter.getNextEvent (data, size, frame))
     {
-        msg.setTimeStamp ( timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)) );
-        midiMessageQueue.addMessageToQueue ( msg );
+        if (size > 3)
+            continue;
+
+        auto& event = events [numWritten < size1 ? start1 + numWritten : start2 + (numWritten - size1)];
+        event.time  = timestamp + msPerSample * (double) frame;
+        event.block = blockSerial;
+        event.size  = size;
+        memset (event.data, 0, sizeof (event.data));
+        memcpy (event.data, data, (size_t) size);
+        ++numWritten;
     }
 
-    numSamples += nframes;
-    sem.post();
+    queue.finishedWrite (numWritten);
+    if (numWritten > 0)
+        sem.post();
     midiIn->clear();
 }
 
@@ -181,22 +431,26 @@ void OSCSenderNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 
 bool OSCSenderNode::connect (String hostName, int portNumber)
 {
-   if (connected && currentPortNumber == portNumber)
+    if (connected && currentPortNumber == portNumber && currentHostName == hostName)
         return connected;
 
+    ScopedLock sl (lock);
     currentHostName = hostName;
     currentPortNumber = portNumber;
-    connected = oscSender.connect (hostName, portNumber);
+    socket.reset (new DatagramSocket (false));
+    if (! socket->bindToPort (0))
+        socket = nullptr;
+    connected = socket != nullptr;
 
     return connected;
 }
 
 bool OSCSenderNode::disconnect ()
 {
-   if (!connected)
-        return true;
+    ScopedLock sl (lock);
     connected = false;
-    return oscSender.disconnect();
+    socket = nullptr;
+    return true;
 }
 
 bool OSCSenderNode::isConnected ()
@@ -226,7 +480,7 @@ bool OSCSenderNode::togglePause ()
     else
         pause();
 
-    return paused;
+    return paused.load();
 }
 
 int OSCSenderNode::getCurrentPortNumber ()
@@ -251,14 +505,21 @@ void OSCSenderNode::setHostName (String hostName)
 
 std::vector<OSCMessage> OSCSenderNode::getOscMessages()
 {
-    std::vector<OSCMessage> copied;
+    LogEntry entries [maxOscMessages];
+    int numEntries = 0;
 
     {
-        ScopedLock sl (lock);
-        std::copy ( oscMessagesToLog.begin(), oscMessagesToLog.end(), std::back_inserter( copied ) );
-        oscMessagesToLog.clear();
+        SpinLock::ScopedLockType sl (logLock);
+        for (; numEntries < logSize; ++numEntries)
+            entries[numEntries] = logEntries [(logStart + numEntries) % maxOscMessages];
+        logStart = logSize = 0;
     }
 
+    std::vector<OSCMessage> copied;
+    copied.reserve ((size_t) numEntries);
+    for (int i = 0; i < numEntries; ++i)
+        copied.push_back (Util::processMidiToOscMessage (MidiMessage (entries[i].data, entries[i].size)));
+
     return copied;
 }
 
@@ -26,6 +26,13 @@
 
 namespace Element {
 
+/** Sends the MIDI it receives as OSC.
+
+    Events are queued by the render thread without locks. The sender
+    thread writes each block's events into one OSC bundle, with a nested
+    bundle per sample offset carrying that offset's time, so a block costs
+    one packet however dense the input is.
+ */
 class OSCSenderNode   : public MidiFilterNode,
                         public ChangeBroadcaster,
                         public Thread
@@ -53,7 +60,7 @@ public:
     void getState (MemoryBlock& block) override;
     void setState (const void* data, int size) override;
 
-    /** OSC -> MIDI processing thread */
+    /** MIDI -> OSC sending thread */
 
     void run() override;
     void stop();
@@ -81,9 +88,61 @@ public:
     void setPortNumber (int port);
     void setHostName (String hostName);
 
+    /** Returns messages sent since the last call, oldest first */
     std::vector<OSCMessage> getOscMessages();
 
+    //=========================================================================
+    /** Writes OSC packets into a fixed buffer */
+    class PacketWriter
+    {
+    public:
+        PacketWriter (uint8* data, int capacity) noexcept;
+
+        /** Starts a bundle, nested in the current one if open */
+        bool beginBundle (uint64 timeTag) noexcept;
+
+        /** Closes the innermost bundle */
+        void endBundle() noexcept;
+
+        /** Writes a MIDI message as an OSC message. Returns false, leaving
+            the packet unchanged, if it doesn't fit. Messages without an OSC
+            address are skipped and return true */
+        bool addMidi (const uint8* midi, int size) noexcept;
+
+        /** Returns the number of open bundles */
+        int getDepth() const noexcept       { return depth; }
+
+        /** Returns the packet size so far */
+        int getSize() const noexcept        { return position; }
+
+        /** Returns true if nothing but bundle headers was written */
+        bool isEmpty() const noexcept       { return numMessages == 0; }
+
+        /** Starts again with an empty packet */
+        void reset() noexcept;
+
+    private:
+        uint8* const data;
+        const int capacity;
+        int position = 0, depth = 0, numMessages = 0;
+        int sizes [4];
+
+        bool writeInt (int32 value) noexcept;
+        bool writeFloat (float value) noexcept;
+        bool writeString (const char* text) noexcept;
+    };
+
+    /** Converts a Time::getMillisecondCounterHiRes() time to an OSC time tag */
+    static uint64 toTimeTag (double timeMs, double counterNowMs, int64 wallNowMs) noexcept;
+
 private:
+    struct Event
+    {
+        double time;
+        uint32 block;
+        int size;
+        uint8 data [3];
+    };
 
     Semaphore sem;
     CriticalSection lock;
@@ -92,26 +151,35 @@ private:
     bool createdPorts = false;
 
     /** OSC */
-    OSCSender oscSender;
+    std::unique_ptr<DatagramSocket> socket;
 
-    bool connected = false;
-    bool paused = false;
+    std::atomic<bool> connected { false };
+    std::atomic<bool> paused { false };
 
     int currentPortNumber = 9002;
     String currentHostName = "127.0.0.1";
 
-    /** Max messages in queue before they start getting dropped */
-    int maxOscMessages = 100;
-
-    /** GUI */
-    std::vector<OSCMessage> oscMessagesToLog;
-
-    /** To be processed and sent as OSC messages */
-    MidiMessageCollector midiMessageQueue;
-
-    Atomic<int> numSamples = 0;
-    double currentSampleRate = 0;
-    bool midiMessageQueueInitDone = false;
+    /** Render thread to sender thread */
+    enum { queueSize = 2048 };
+    AbstractFifo queue { queueSize };
+    HeapBlock<Event> events;
+    uint32 blockSerial = 0;
+
+    /** Sender thread */
+    enum { maxPacketSize = 8192 };
+    HeapBlock<Event> sending;
+    HeapBlock<uint8> packet;
+    void sendBlock (const Event* block, int numEvents);
+    void sendPacket (PacketWriter&);
+
+    /** GUI, the last maxOscMessages sent */
+    enum { maxOscMessages = 128 };
+    struct LogEntry { int size; uint8 data [3]; };
+    SpinLock logLock;
+    LogEntry logEntries [maxOscMessages];
+    int logStart = 0, logSize = 0;
+
+    double currentSampleRate = 44100.0;
 };
 
 }
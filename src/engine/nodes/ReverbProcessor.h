@@ -111,6 +111,7 @@ namespace Element {
         const String getProgramName (int index) override                   { ignoreUnused (index); return "Default"; }
         void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
         
+        bool canGetStateOffMessageThread() const override { return true; }
         void getStateInformation (juce::MemoryBlock& destData) override
         {
             ValueTree state (Tags::state);
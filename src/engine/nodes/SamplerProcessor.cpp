@@ -0,0 +1,317 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/SamplerProcessor.h"
+#include "gui/LookAndFeel.h"
+
+namespace Element {
+
+struct SamplerProcessor::DiskThread : public TimeSliceThread
+{
+    DiskThread() : TimeSliceThread ("SamplerDiskIO") { startThread (6); }
+    ~DiskThread() { stopThread (2000); }
+};
+
+struct SamplerProcessor::LoadThread : public TimeSliceThread
+{
+    LoadThread() : TimeSliceThread ("SamplerLoader") { startThread (4); }
+    ~LoadThread() { stopThread (2000); }
+};
+
+/** Loads requested files off the disk thread */
+struct SamplerProcessor::Loader : public TimeSliceClient
+{
+    Loader (SamplerProcessor& p) : processor (p) { }
+
+    int useTimeSlice() override
+    {
+        if (processor.loadRequested.compareAndSetBool (0, 1))
+        {
+            processor.load (processor.getFile());
+            return 0;
+        }
+
+        // requests move it to the front of the queue
+        return 500;
+    }
+
+    SamplerProcessor& processor;
+};
+
+//=============================================================================
+
+class SamplerEditor : public AudioProcessorEditor,
+                      public FilenameComponentListener,
+                      public ChangeListener,
+                      public Timer
+{
+public:
+    SamplerEditor (SamplerProcessor& p)
+        : AudioProcessorEditor (&p),
+          processor (p)
+    {
+        setOpaque (true);
+        chooser.reset (new FilenameComponent ("Instrument", File(),
+                                              false, false, false,
+                                              p.getWildcard(), String(),
+                                              TRANS("Select SFZ or Sample")));
+        addAndMakeVisible (chooser.get());
+        addAndMakeVisible (status);
+        addAndMakeVisible (usage);
+
+        addAndMakeVisible (volume);
+        volume.setSliderStyle (Slider::LinearBar);
+        volume.setRange (-60.0, 12.0, 0.1);
+        volume.textFromValueFunction = [](double value) { return String ("Volume: ") + String (value, 1) + " dB"; };
+        volume.onValueChange = [this]()
+        {
+            if (auto* const param = dynamic_cast<AudioParameterFloat*> (processor.getParameters()[0]))
+                *param = static_cast<float> (volume.getValue());
+        };
+
+        chooser->addListener (this);
+        processor.addChangeListener (this);
+        stabilizeComponents();
+
+        setSize (360, 100);
+        startTimer (250);
+    }
+
+    ~SamplerEditor() noexcept
+    {
+        stopTimer();
+        processor.removeChangeListener (this);
+        chooser->removeListener (this);
+        volume.onValueChange = nullptr;
+        chooser = nullptr;
+    }
+
+    void timerCallback() override { stabilizeComponents(); }
+    void changeListenerCallback (ChangeBroadcaster*) override { stabilizeComponents(); }
+
+    void stabilizeComponents()
+    {
+        if (chooser->getCurrentFile() != processor.getFile())
+            chooser->setCurrentFile (processor.getFile(), dontSendNotification);
+        status.setText (processor.getStatus(), dontSendNotification);
+
+        String text;
+        text << "Voices: " << processor.getNumActiveVoices()
+             << "  Memory: " << File::descriptionOfSizeInBytes ((int64) processor.getMemoryUsage());
+        usage.setText (text, dontSendNotification);
+
+        if (auto* const param = dynamic_cast<AudioParameterFloat*> (processor.getParameters()[0]))
+            volume.setValue ((double) param->get(), dontSendNotification);
+    }
+
+    void filenameComponentChanged (FilenameComponent*) override
+    {
+        processor.loadFile (chooser->getCurrentFile());
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        chooser->setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+        status.setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+        usage.setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+        volume.setBounds (r.removeFromTop (18));
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+private:
+    SamplerProcessor& processor;
+    std::unique_ptr<FilenameComponent> chooser;
+    Label status, usage;
+    Slider volume;
+};
+
+//=============================================================================
+
+SamplerProcessor::SamplerProcessor()
+    : BaseProcessor (BusesProperties()
+        .withOutput ("Main", AudioChannelSet::stereo(), true))
+{
+    setRateAndBufferSizeDetails (44100.0, 1024);
+    addParameter (volume = new AudioParameterFloat ("volume", "Volume [dB]", -60.0f, 12.0f, 0.0f));
+
+    formats.registerBasicFormats();
+    loader.reset (new Loader (*this));
+    loadThread->addTimeSliceClient (loader.get());
+    disk->addTimeSliceClient (this);
+}
+
+SamplerProcessor::~SamplerProcessor()
+{
+    loadThread->removeTimeSliceClient (loader.get());
+    disk->removeTimeSliceClient (this);
+}
+
+void SamplerProcessor::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_SAMPLER;
+    desc.descriptiveName    = "Multisample Player";
+    desc.numInputChannels   = 0;
+    desc.numOutputChannels  = 2;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = true;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_SAMPLER;
+}
+
+bool SamplerProcessor::isBusesLayoutSupported (const BusesLayout& layout) const
+{
+    return layout.getMainInputChannelSet() == AudioChannelSet::disabled()
+        && layout.getMainOutputChannelSet() == AudioChannelSet::stereo();
+}
+
+//=============================================================================
+
+void SamplerProcessor::loadFile (const File& newFile)
+{
+    {
+        ScopedLock sl (lock);
+        file = newFile;
+        status = newFile == File() ? String() : String ("Loading...");
+    }
+
+    loadRequested.set (1);
+    loadThread->moveToFrontOfQueue (loader.get());
+}
+
+File SamplerProcessor::getFile() const
+{
+    ScopedLock sl (lock);
+    return file;
+}
+
+String SamplerProcessor::getStatus() const
+{
+    ScopedLock sl (lock);
+    return status;
+}
+
+int SamplerProcessor::useTimeSlice()
+{
+    sampler.collectGarbage();
+    return sampler.serviceStreams() ? 0 : 5;
+}
+
+void SamplerProcessor::load (const File& newFile)
+{
+    String error, message;
+    SampleMap* map = nullptr;
+
+    if (newFile == File())
+        map = new SampleMap();
+    else if (newFile.hasFileExtension ("sfz"))
+        map = SampleMap::fromSFZ (newFile, formats, error);
+    else
+        map = SampleMap::fromSample (newFile, formats, error);
+
+    if (map != nullptr && newFile != File())
+    {
+        message << newFile.getFileName() << ": " << map->getNumZones()
+                << (map->getNumZones() == 1 ? " zone" : " zones");
+        if (error.isNotEmpty())
+            message << " (" << error << ")";
+    }
+    else
+    {
+        message = error;
+    }
+
+    // a failed load keeps the current instrument
+    if (map != nullptr)
+        sampler.setSampleMap (map);
+
+    {
+        ScopedLock sl (lock);
+        status = message;
+    }
+
+    sendChangeMessage();
+}
+
+//=============================================================================
+
+void SamplerProcessor::prepareToPlay (double sampleRate, int maxBlockSize)
+{
+    setRateAndBufferSizeDetails (sampleRate, maxBlockSize);
+    sampler.prepare (sampleRate, maxBlockSize);
+    lastGain = Decibels::decibelsToGain ((float) *volume);
+}
+
+void SamplerProcessor::releaseResources()
+{
+    sampler.release();
+}
+
+void SamplerProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    ScopedNoDenormals denormals;
+    buffer.clear();
+    sampler.render (buffer, midi);
+
+    const float gain = Decibels::decibelsToGain ((float) *volume);
+    buffer.applyGainRamp (0, buffer.getNumSamples(), lastGain, gain);
+    lastGain = gain;
+}
+
+//=============================================================================
+
+AudioProcessorEditor* SamplerProcessor::createEditor()
+{
+    return new SamplerEditor (*this);
+}
+
+void SamplerProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("file",   getFile().getFullPathName(), nullptr);
+    state.setProperty ("volume", (float) *volume, nullptr);
+    if (auto e = state.createXml())
+        AudioProcessor::copyXmlToBinary (*e, destData);
+}
+
+void SamplerProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    if (auto e = AudioProcessor::getXmlFromBinary (data, sizeInBytes))
+    {
+        auto state = ValueTree::fromXml (*e);
+        if (state.isValid())
+        {
+            *volume = (float) state.getProperty ("volume", 0.0f);
+            const String path = state.getProperty ("file").toString();
+            loadFile (File::isAbsolutePath (path) ? File (path) : File());
+        }
+    }
+}
+
+}
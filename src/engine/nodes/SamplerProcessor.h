@@ -0,0 +1,111 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/Sampler.h"
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Plays an SFZ instrument or a single sample from MIDI.
+
+    Files are parsed and their sample heads read on a loader thread, then
+    streamed on a disk thread. Both are shared by every sampler, so a slow
+    load never holds up streaming and only the head of each sample is kept
+    in memory.
+ */
+class SamplerProcessor : public BaseProcessor,
+                         public ChangeBroadcaster,
+                         private TimeSliceClient
+{
+public:
+    SamplerProcessor();
+    virtual ~SamplerProcessor();
+
+    /** Load an SFZ file or an audio file. Loading happens in the background
+        and a change message is sent when done */
+    void loadFile (const File& file);
+
+    /** Returns the requested file */
+    File getFile() const;
+
+    /** Returns a description of the loaded instrument or an error */
+    String getStatus() const;
+
+    /** Returns the number of voices playing */
+    int getNumActiveVoices() const noexcept { return sampler.getNumActiveVoices(); }
+
+    /** Returns bytes held in memory for voices and sample heads */
+    size_t getMemoryUsage() const           { return sampler.getMemoryUsage(); }
+
+    String getWildcard() const { return String ("*.sfz;") + formats.getWildcardForAllFormats(); }
+
+    const String getName() const override { return "Sampler"; }
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    void prepareToPlay (double sampleRate, int maxBlockSize) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi) override;
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override                     { return true; }
+
+    double getTailLengthSeconds() const override        { return 0.0; }
+    bool acceptsMidi() const override                   { return true; }
+    bool producesMidi() const override                  { return false; }
+
+    int getNumPrograms() override                                      { return 1; };
+    int getCurrentProgram() override                                   { return 0; };
+    void setCurrentProgram (int index) override                        { ignoreUnused (index); };
+    const String getProgramName (int index) override                   { ignoreUnused (index); return "Default"; }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+protected:
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    struct DiskThread;
+    SharedResourcePointer<DiskThread> disk;
+    struct LoadThread;
+    SharedResourcePointer<LoadThread> loadThread;
+    struct Loader;
+    std::unique_ptr<Loader> loader;
+    AudioFormatManager formats;
+    Sampler sampler;
+
+    AudioParameterFloat* volume { nullptr };
+    float lastGain = 1.0f;
+
+    CriticalSection lock;
+    File file;
+    String status;
+    Atomic<int> loadRequested { 0 };
+
+    int useTimeSlice() override;
+    void load (const File& file);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplerProcessor)
+};
+
+}
@@ -0,0 +1,318 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/TruePeakLimiterProcessor.h"
+#include "gui/nodes/KnobsComponent.h"
+
+namespace Element {
+
+static const float maxLookaheadMs = 10.0f;
+
+//=============================================================================
+
+class TruePeakLimiterEditor : public AudioProcessorEditor,
+                              private Timer
+{
+public:
+    TruePeakLimiterEditor (TruePeakLimiterProcessor& p)
+        : AudioProcessorEditor (p),
+          proc (p),
+          knobs (p, [] { })
+    {
+        addAndMakeVisible (knobs);
+        addAndMakeVisible (readout);
+        readout.setJustificationType (Justification::centred);
+        readout.setFont (Font (15.0f));
+        setSize (400, 140);
+        startTimerHz (15);
+    }
+
+    ~TruePeakLimiterEditor()
+    {
+        stopTimer();
+    }
+
+    void resized() override
+    {
+        auto r = getLocalBounds();
+        readout.setBounds (r.removeFromTop (30));
+        knobs.setBounds (r);
+    }
+
+private:
+    TruePeakLimiterProcessor& proc;
+    KnobsComponent knobs;
+    Label readout;
+
+    void timerCallback() override
+    {
+        String text ("Peak ");
+        text << String (proc.getInputPeakDB(), 1) << " dBTP   Reduction "
+             << String (proc.getGainReductionDB(), 1) << " dB";
+        readout.setText (text, dontSendNotification);
+    }
+};
+
+//=============================================================================
+
+TruePeakLimiterProcessor::TruePeakLimiterProcessor (const int numChannels)
+    : BaseProcessor (BusesProperties()
+        .withInput  ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, numChannels)))
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, numChannels))))
+{
+    setRateAndBufferSizeDetails (44100.0, 1024);
+
+    NormalisableRange<float> releaseRange (1.0f, 1000.0f);
+    releaseRange.setSkewForCentre (100.0f);
+
+    addParameter (ceilingDB   = new AudioParameterFloat ("ceiling",   "Ceiling [dB]",   -12.0f, 0.0f, -1.0f));
+    addParameter (inputDB     = new AudioParameterFloat ("input",     "Input [dB]",     0.0f, 24.0f, 0.0f));
+    addParameter (releaseMs   = new AudioParameterFloat ("release",   "Release [ms]",   releaseRange, 100.0f));
+    addParameter (lookaheadMs = new AudioParameterFloat ("lookahead", "Lookahead [ms]", 0.5f, maxLookaheadMs, 2.0f));
+
+    inputGain.reset (200);
+}
+
+TruePeakLimiterProcessor::~TruePeakLimiterProcessor()
+{
+    cancelPendingUpdate();
+}
+
+void TruePeakLimiterProcessor::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name = getName();
+    desc.fileOrIdentifier   = EL_INTERNAL_ID_TRUE_PEAK_LIMITER;
+    desc.descriptiveName    = "True Peak Limiter";
+    desc.numInputChannels   = 2;
+    desc.numOutputChannels  = 2;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_TRUE_PEAK_LIMITER;
+}
+
+void TruePeakLimiterProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+
+    const int numChannels = jmax (1, getMainBusNumInputChannels());
+    const int blockSize = jmax (32, maximumExpectedSamplesPerBlock);
+    detector.prepare (numChannels, blockSize);
+    scratch.setSize (2, blockSize, false, false, true);
+
+    maxWindowSize = jmax (1, roundToInt (sampleRate * maxLookaheadMs / 1000.0));
+    holdCapacity = maxWindowSize + 1;
+    holdValues.allocate ((size_t) holdCapacity, true);
+    holdTimes.allocate ((size_t) holdCapacity, true);
+    averageValues.allocate ((size_t) maxWindowSize, true);
+    delayLine.setSize (numChannels, maxWindowSize + detector.getLatencySamples() + blockSize, false, false, true);
+
+    inputGain.setCurrentAndTargetValue (Decibels::decibelsToGain ((float) *inputDB));
+    resetWindow (getWindowSize());
+    setLatencySamples (delaySamples);
+
+    inputPeak.set (0.0f);
+    minGain.set (1.0f);
+}
+
+void TruePeakLimiterProcessor::releaseResources()
+{
+    scratch.setSize (1, 1);
+    delayLine.setSize (1, 1);
+    holdValues.free();
+    holdTimes.free();
+    averageValues.free();
+    holdCapacity = 0;
+    maxWindowSize = windowSize = 1;
+}
+
+int TruePeakLimiterProcessor::getWindowSize() const
+{
+    return jlimit (1, maxWindowSize, roundToInt (getSampleRate() * (double) *lookaheadMs / 1000.0));
+}
+
+void TruePeakLimiterProcessor::resetWindow (int newWindowSize)
+{
+    windowSize = newWindowSize;
+    holdStart = holdSize = 0;
+    sampleTime = 0;
+    FloatVectorOperations::fill (averageValues.getData(), 1.0f, windowSize);
+    averageSum = (double) windowSize;
+    averagePos = 0;
+    releaseGain = 1.0f;
+
+    // the moving average delays by window - 1, the detector by its latency
+    delaySamples = windowSize - 1 + detector.getLatencySamples();
+    pendingLatency.set (delaySamples);
+    delayLine.clear();
+    detector.reset();
+}
+
+float TruePeakLimiterProcessor::processGain (float neededGain, float releaseCoef)
+{
+    // sliding minimum over the window, kept as a queue of rising values
+    while (holdSize > 0 && holdValues[(holdStart + holdSize - 1) % holdCapacity] >= neededGain)
+        --holdSize;
+    const int back = (holdStart + holdSize) % holdCapacity;
+    holdValues[back] = neededGain;
+    holdTimes[back] = sampleTime;
+    ++holdSize;
+    if (holdTimes[holdStart] <= sampleTime - windowSize)
+    {
+        holdStart = (holdStart + 1) % holdCapacity;
+        --holdSize;
+    }
+    ++sampleTime;
+
+    const float held = holdValues[holdStart];
+    releaseGain = held < releaseGain ? held : releaseGain + (held - releaseGain) * releaseCoef;
+
+    averageSum += (double) releaseGain - (double) averageValues[averagePos];
+    averageValues[averagePos] = releaseGain;
+    if (++averagePos == windowSize)
+        averagePos = 0;
+
+    return jmin (1.0f, (float) (averageSum / (double) windowSize));
+}
+
+void TruePeakLimiterProcessor::applyDelay (int channel, float* data, int numSamples)
+{
+    // the line holds the last delaySamples of input followed by this block
+    auto* const line = delayLine.getWritePointer (channel);
+    FloatVectorOperations::copy (line + delaySamples, data, numSamples);
+    FloatVectorOperations::copy (data, line, numSamples);
+    memmove (line, line + numSamples, sizeof (float) * (size_t) delaySamples);
+}
+
+void TruePeakLimiterProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    const int newWindowSize = getWindowSize();
+    if (newWindowSize != windowSize)
+    {
+        // latency can only be reported from the message thread
+        resetWindow (newWindowSize);
+        triggerAsyncUpdate();
+    }
+
+    auto mainBuffer = getBusBuffer (buffer, true, 0);
+    const int numChannels = jmin (mainBuffer.getNumChannels(), delayLine.getNumChannels());
+    if (numChannels <= 0 || holdCapacity <= 0)
+        return;
+
+    const float ceiling = Decibels::decibelsToGain ((float) *ceilingDB);
+    const float releaseCoef = 1.0f - std::exp (-1.0f / ((float) getSampleRate() * (float) *releaseMs / 1000.0f));
+    inputGain.setTargetValue (Decibels::decibelsToGain ((float) *inputDB));
+
+    auto* const peaks = scratch.getWritePointer (0);
+    auto* const gains = scratch.getWritePointer (1);
+    float peakLevel = 0.0f;
+    float lowestGain = 1.0f;
+
+    for (int offset = 0; offset < mainBuffer.getNumSamples();)
+    {
+        const int numSamples = jmin (mainBuffer.getNumSamples() - offset, scratch.getNumSamples());
+        AudioBuffer<float> block (mainBuffer.getArrayOfWritePointers(), numChannels, offset, numSamples);
+
+        if (inputGain.isSmoothing())
+            inputGain.applyGain (block, numSamples);
+        else if (inputGain.getTargetValue() != 1.0f)
+            block.applyGain (inputGain.getTargetValue());
+
+        detector.process (block, peaks);
+        peakLevel = jmax (peakLevel, FloatVectorOperations::findMaximum (peaks, numSamples));
+
+        for (int i = 0; i < numSamples; ++i)
+            gains[i] = processGain (peaks[i] > ceiling ? ceiling / peaks[i] : 1.0f, releaseCoef);
+        lowestGain = jmin (lowestGain, FloatVectorOperations::findMinimum (gains, numSamples));
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* const data = block.getWritePointer (ch);
+            applyDelay (ch, data, numSamples);
+            FloatVectorOperations::multiply (data, gains, numSamples);
+        }
+
+        offset += numSamples;
+    }
+
+    inputPeak.set (peakLevel);
+    minGain.set (lowestGain);
+}
+
+void TruePeakLimiterProcessor::handleAsyncUpdate()
+{
+    setLatencySamples (pendingLatency.get());
+}
+
+String TruePeakLimiterProcessor::getMeterName (int meter) const
+{
+    switch (meter)
+    {
+        case 0: return "peak"; break;
+        case 1: return "reduction"; break;
+    }
+
+    return String();
+}
+
+float TruePeakLimiterProcessor::getMeterValue (int meter) const
+{
+    switch (meter)
+    {
+        case 0: return getInputPeakDB(); break;
+        case 1: return getGainReductionDB(); break;
+    }
+
+    return 0.0f;
+}
+
+AudioProcessorEditor* TruePeakLimiterProcessor::createEditor()
+{
+    return new TruePeakLimiterEditor (*this);
+}
+
+void TruePeakLimiterProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("ceiling",   (float) *ceilingDB,   0);
+    state.setProperty ("input",     (float) *inputDB,     0);
+    state.setProperty ("release",   (float) *releaseMs,   0);
+    state.setProperty ("lookahead", (float) *lookaheadMs, 0);
+    if (auto e = state.createXml())
+        AudioProcessor::copyXmlToBinary (*e, destData);
+}
+
+void TruePeakLimiterProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    if (auto e = AudioProcessor::getXmlFromBinary (data, sizeInBytes))
+    {
+        auto state = ValueTree::fromXml (*e);
+        if (state.isValid())
+        {
+            *ceilingDB   = (float) state.getProperty ("ceiling",   (float) *ceilingDB);
+            *inputDB     = (float) state.getProperty ("input",     (float) *inputDB);
+            *releaseMs   = (float) state.getProperty ("release",   (float) *releaseMs);
+            *lookaheadMs = (float) state.getProperty ("lookahead", (float) *lookaheadMs);
+        }
+    }
+}
+
+}
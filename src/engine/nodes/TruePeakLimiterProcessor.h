@@ -0,0 +1,140 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/LoudnessMeter.h"
+#include "engine/MeterSource.h"
+#include "ElementApp.h"
+
+namespace Element {
+
+/** A brickwall limiter which keeps inter-sample peaks under a ceiling.
+
+    Peaks are detected on 4x oversampled audio. The gain needed for each
+    sample is held with a sliding minimum over the lookahead window, released
+    exponentially, then smoothed with a moving average of the same length,
+    so the gain is fully down before the peak arrives. The audio is delayed
+    by the window plus the detector latency, and that is reported as
+    latency.
+ */
+class TruePeakLimiterProcessor : public BaseProcessor,
+                                 public MeterSource,
+                                 private AsyncUpdater
+{
+public:
+    explicit TruePeakLimiterProcessor (const int numChannels = 2);
+    ~TruePeakLimiterProcessor();
+
+    const String getName() const override { return "True Peak Limiter"; }
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override;
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override                 { return true; }
+
+    double getTailLengthSeconds() const override    { return 0.0; };
+    bool acceptsMidi() const override               { return false; }
+    bool producesMidi() const override              { return false; }
+
+    int getNumPrograms() override                                      { return 1; };
+    int getCurrentProgram() override                                   { return 1; };
+    void setCurrentProgram (int index) override                        { ignoreUnused (index); };
+    const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    bool canGetStateOffMessageThread() const override { return true; }
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+    /** Returns the highest true peak of the last block, after the input gain,
+        in dBTP. Safe to call from any thread */
+    float getInputPeakDB() const noexcept       { return Decibels::gainToDecibels (inputPeak.get()); }
+
+    /** Returns the most gain reduction applied in the last block in decibels.
+        Safe to call from any thread */
+    float getGainReductionDB() const noexcept   { return Decibels::gainToDecibels (minGain.get()); }
+
+    int getNumMeters() const override           { return 2; }
+    String getMeterName (int meter) const override;
+    float getMeterValue (int meter) const override;
+
+protected:
+    inline bool isBusesLayoutSupported (const BusesLayout& layout) const override
+    {
+        if (layout.getMainInputChannels() != layout.getMainOutputChannels())
+            return false;
+        const auto nchans = layout.getMainInputChannels();
+        return nchans >= 1 && nchans <= 2;
+    }
+
+    inline bool canApplyBusesLayout (const BusesLayout& layouts) const override { return isBusesLayoutSupported (layouts); }
+    inline bool canApplyBusCountChange (bool isInput, bool isAddingBuses, BusProperties& outNewBusProperties) override
+    {
+        ignoreUnused (isInput, isAddingBuses, outNewBusProperties);
+        return false;
+    }
+
+private:
+    AudioParameterFloat* ceilingDB   = nullptr;
+    AudioParameterFloat* inputDB     = nullptr;
+    AudioParameterFloat* releaseMs   = nullptr;
+    AudioParameterFloat* lookaheadMs = nullptr;
+
+    SmoothedValue<float, ValueSmoothingTypes::Multiplicative> inputGain = 1.0f;
+
+    TruePeakDetector detector;
+    AudioBuffer<float> scratch;     // peaks and gains
+    AudioBuffer<float> delayLine;
+
+    // sliding minimum of the needed gain
+    HeapBlock<float> holdValues;
+    HeapBlock<int64> holdTimes;
+    int holdStart = 0, holdSize = 0, holdCapacity = 0;
+    int64 sampleTime = 0;
+
+    // moving average of the held gain
+    HeapBlock<float> averageValues;
+    double averageSum = 0.0;
+    int averagePos = 0;
+
+    float releaseGain = 1.0f;
+    int windowSize = 1;
+    int maxWindowSize = 1;
+    int delaySamples = 0;
+    Atomic<int> pendingLatency { 0 };
+
+    Atomic<float> inputPeak { 0.0f };
+    Atomic<float> minGain { 1.0f };
+
+    int getWindowSize() const;
+    void resetWindow (int newWindowSize);
+    float processGain (float neededGain, float releaseCoef);
+    void applyDelay (int channel, float* data, int numSamples);
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TruePeakLimiterProcessor)
+};
+
+}
@@ -78,7 +78,12 @@ public:
         
     }
     
-    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override    { process (buffer); }
+    void processBlock (AudioBuffer<double>& buffer, MidiBuffer&) override   { process (buffer); }
+    bool supportsDoublePrecisionProcessing() const override                 { return true; }
+
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>& buffer)
     {
         if (lastVolume != (float) *volume) {
             gain = (float)*volume <= -30.f ? 0.f : Decibels::decibelsToGain ((float) *volume);
@@ -104,6 +109,7 @@ public:
     const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
     void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
     
+    bool canGetStateOffMessageThread() const override { return true; }
     void getStateInformation (juce::MemoryBlock& destData) override
     {
         ValueTree state (Tags::state);
@@ -86,7 +86,12 @@ public:
     
     void releaseResources() override { }
     
-    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override    { process (buffer); }
+    void processBlock (AudioBuffer<double>& buffer, MidiBuffer&) override   { process (buffer); }
+    bool supportsDoublePrecisionProcessing() const override                 { return true; }
+
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>& buffer)
     {
         if (lastWetLevel != (float)*wetLevel || lastDryLevel != (float)*dryLevel)
             setLevels (*wetLevel, *dryLevel);
@@ -99,9 +104,9 @@ public:
             
             for (int i = 0; i < numSamples; ++i)
             {
-                const float dry  = dryGain.getNextValue();
-                const float wet1 = wetGain1.getNextValue();
-                const float wet2 = wetGain2.getNextValue();
+                const FloatType dry  = dryGain.getNextValue();
+                const FloatType wet1 = wetGain1.getNextValue();
+                const FloatType wet2 = wetGain2.getNextValue();
                 
                 output[0][i] = input[0][i] * wet1 + input[1][i] * wet2 + input[2][i] * dry;
                 output[1][i] = input[1][i] * wet1 + input[0][i] * wet2 + input[3][i] * dry;
@@ -135,6 +140,7 @@ public:
     const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
     void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
     
+    bool canGetStateOffMessageThread() const override { return true; }
     void getStateInformation (juce::MemoryBlock& destData) override
     {
         ValueTree state (Tags::state);
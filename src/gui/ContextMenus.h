@@ -210,6 +210,10 @@ public:
         int index = 30000;
         GraphNodePtr ptr = node.getGraphNode();
         menu.addItem (index++, "Mute input ports", ptr != nullptr, ptr && ptr->isMutingInputs());
+        auto* proc = ptr != nullptr ? ptr->getAudioProcessor() : nullptr;
+        const bool canUseDouble = proc != nullptr && proc->supportsDoublePrecisionProcessing()
+            && ! ptr->isAudioIONode() && ! ptr->isMidiIONode();
+        menu.addItem (index++, "Double precision", canUseDouble, ptr && ptr->isDoublePrecisionRequested());
 
         addOversamplingSubmenu (menu);
 
@@ -229,6 +233,11 @@ public:
         osMenu.addItem (index++, "2x", true, ptr->getOversamplingFactor() == 2);
         osMenu.addItem (index++, "4x", true, ptr->getOversamplingFactor() == 4);
         osMenu.addItem (index++, "8x", true, ptr->getOversamplingFactor() == 8);
+        osMenu.addSeparator();
+        index = 40100;
+        for (const auto quality : { Oversampler::IIR, Oversampler::FIR })
+            osMenu.addItem (index++, Oversampler::getQualityName (quality), true,
+                            ptr->getOversamplingQuality() == quality);
                                                       
         menuToAddTo.addSubMenu ("Oversample", osMenu);
     }
@@ -361,11 +370,17 @@ public:
                 case 0:
                     node.setMuteInput (! node.isMutingInputs());
                     break;
+                case 1:
+                    // the graph prepares the node again when it rebuilds
+                    if (auto gNode = node.getGraphNode())
+                        gNode->setDoublePrecision (! gNode->isDoublePrecisionRequested());
+                    break;
             }
         }
         else if (result >= 40000 && result < 50000)
         {
-            const int osFactor = (int) powf(2, float (result - 40000));
+            const bool isQuality = result >= 40100;
+            const int osFactor = isQuality ? 1 : (int) powf(2, float (result - 40000));
             if (auto gNode = node.getGraphNode())
             {
                 auto* graph = gNode->getParentGraph();
@@ -373,7 +388,10 @@ public:
                 bool wasSuspended = graph->isSuspended();
                 graph->suspendProcessing (true);
                 graph->releaseResources();
-                gNode->setOversamplingFactor (osFactor);
+                if (isQuality)
+                    gNode->setOversamplingQuality (result == 40100 ? Oversampler::IIR : Oversampler::FIR);
+                else
+                    gNode->setOversamplingFactor (osFactor);
                 graph->prepareToPlay (gNode->getParentGraph()->getSampleRate(), gNode->getParentGraph()->getBlockSize());
                 graph->suspendProcessing (wasSuspended);
             }
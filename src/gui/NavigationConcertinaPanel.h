@@ -28,6 +28,7 @@
 #include "gui/widgets/SessionGraphsListBox.h"
 #include "session/Session.h"
 #include "session/Node.h"
+#include "session/StateStore.h"
 #include "DataPath.h"
 #include "Globals.h"
 
@@ -325,7 +326,9 @@ private:
         if (! AlertWindow::showOkCancelBox (AlertWindow::QuestionIcon, "Delete file", message))
             return;
         
-        if (! file.deleteFile()) {
+        // presets from older versions hold references to shared states
+        SharedResourcePointer<StateStore> store;
+        if (! store->deleteExternalized (file)) {
             AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Delete file", "Could not delete");
         } else {
             refresh();
@@ -683,6 +683,15 @@ namespace Element {
             sendClockToInput.setToggleState (settings.sendMidiClockToInput(), dontSendNotification);
             sendClockToInput.addListener (this);
            #endif
+
+            addAndMakeVisible (transportSyncLabel);
+            transportSyncLabel.setFont (Font (12.0, Font::bold));
+            transportSyncLabel.setText ("Sync Transport With Other Instances", dontSendNotification);
+            addAndMakeVisible (transportSync);
+            transportSync.setYesNoText ("Yes", "No");
+            transportSync.setClickingTogglesState (true);
+            transportSync.setToggleState (settings.transportSync(), dontSendNotification);
+            transportSync.addListener (this);
             
             addAndMakeVisible(midiInputHeader);
             midiInputHeader.setText ("Active MIDI Inputs", dontSendNotification);
@@ -728,6 +737,7 @@ namespace Element {
             layoutSetting (r, generateClockLabel, generateClock);
             layoutSetting (r, sendClockToInputLabel, sendClockToInput);
            #endif
+            layoutSetting (r, transportSyncLabel, transportSync);
             r.removeFromTop (roundToInt ((double) spacingBetweenSections * 1.5));
             midiInputHeader.setBounds (r.removeFromTop (24));
 
@@ -751,6 +761,13 @@ namespace Element {
                 if (auto engine = world.getAudioEngine())
                     engine->applySettings (settings);
             }
+            else if (button == &transportSync)
+            {
+                settings.setTransportSync (transportSync.getToggleState());
+                if (auto engine = world.getAudioEngine())
+                    engine->applySettings (settings);
+                transportSync.setToggleState (settings.transportSync(), dontSendNotification);
+            }
         }
 
         void comboBoxChanged (ComboBox* box) override
@@ -780,6 +797,8 @@ namespace Element {
         SettingButton generateClock;
         Label sendClockToInputLabel;
         SettingButton sendClockToInput;
+        Label transportSyncLabel;
+        SettingButton transportSync;
         Label midiInputHeader;
         StringArray outputs;
 
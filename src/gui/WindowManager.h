@@ -33,6 +33,7 @@
 #include "gui/nodes/MidiMonitorNodeEditor.h"
 #include "gui/nodes/MidiProgramMapEditor.h"
 #include "gui/nodes/MidiRouterEditor.h"
+#include "gui/nodes/MidiSequencerEditor.h"
 #include "gui/nodes/OSCReceiverNodeEditor.h"
 #include "gui/nodes/OSCSenderNodeEditor.h"
 #include "gui/nodes/VolumeNodeEditor.h"
@@ -193,6 +194,10 @@ public:
         {
             return createPluginWindowFor (node, new MidiRouterEditor (node));
         }
+        else if (node.getIdentifier().toString() == EL_INTERNAL_ID_MIDI_SEQUENCER)
+        {
+            return createPluginWindowFor (node, new MidiSequencerEditor (node));
+        }
         else if (node.getIdentifier().toString() == EL_INTERNAL_ID_MIDI_MONITOR)
         {
             return createPluginWindowFor (node, new MidiMonitorNodeEditor (node));
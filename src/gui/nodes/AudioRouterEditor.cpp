@@ -32,8 +32,8 @@ public:
         : editor (ed)
     {
         setMatrixCellSize (48);
-        setSize (getRowThickness() * 4, 
-                 getColumnThickness() * 4);
+        setSize (getRowThickness() * getNumRows(), 
+                 getColumnThickness() * getNumColumns());
         setRepaintsOnMouseActivity (true);
     }
 
@@ -60,17 +60,43 @@ public:
         }
         else
         {
-            g.setColour (matrix.connected (row, column) ?
-                            Colour (kv::Colors::elemental.brighter()) :
-                            Colour (kv::LookAndFeel_KV1::defaultMatrixCellOffColor));
-    
+            g.setColour (Colour (kv::LookAndFeel_KV1::defaultMatrixCellOffColor));
             g.fillRect (0, 0, width - gridPadding, height - gridPadding);
+
+            if (matrix.connected (row, column))
+            {
+                // brightness follows the crosspoint gain, unity is full
+                const auto gain = jlimit (0.0f, 1.0f, editor.getGain (row, column));
+                g.setColour (Colour (kv::Colors::elemental.brighter()).withAlpha (0.25f + 0.75f * gain));
+                g.fillRect (0, 0, width - gridPadding, height - gridPadding);
+            }
         }
     }
 
     void matrixCellClicked (const int row, const int col, const MouseEvent& ev) override
     {
-        ignoreUnused (ev);
+        if (ev.mods.isPopupMenu())
+        {
+            PopupMenu menu;
+            const float current = editor.getGain (row, col);
+            const float levels[] = { 0.0f, -3.0f, -6.0f, -12.0f };
+            int itemId = 1;
+            for (const auto db : levels)
+            {
+                const auto gain = Decibels::decibelsToGain (db);
+                menu.addItem (itemId++, String (db, 0) + " dB", true, std::abs (current - gain) < 0.001f);
+            }
+            menu.addItem (itemId, "Off", true, current <= 0.0f);
+
+            const int result = menu.show();
+            if (result > 0)
+            {
+                editor.setGain (row, col, result <= 4 ? Decibels::decibelsToGain (levels [result - 1]) : 0.0f);
+                repaint();
+            }
+            return;
+        }
+
         auto& matrix = editor.getMatrixState();
         matrix.toggleCell (row, col);
         editor.applyMatrix();
@@ -110,6 +136,12 @@ public:
 
         slider.onValueChange = [this] { owner.setFadeLength (slider.getValue()); };
 
+        addAndMakeVisible (sizeBox);
+        for (int size = 2; size <= AudioRouterNode::maxChannels; size *= 2)
+            sizeBox.addItem (String (size) + " x " + String (size), size);
+        sizeBox.setSelectedId (owner.getMatrixState().getNumRows(), dontSendNotification);
+        sizeBox.onChange = [this] { owner.setMatrixSize (sizeBox.getSelectedId()); };
+
         setSize (padding + labelWidth + matrix->getWidth(), 
                  padding + labelWidth + matrix->getHeight());
         matrixArea = { labelWidth, padding, matrix->getWidth(), matrix->getHeight() };
@@ -118,12 +150,13 @@ public:
     ~Content()
     {
         slider.onValueChange = nullptr;
+        sizeBox.onChange = nullptr;
     }
     
     void resized() override
     {
-        auto size = jlimit (24, 36, 
-            roundToInt ((double)(getWidth() - labelWidth - 32) / (double)matrix->getNumRows()));
+        auto size = jlimit (8, 36, 
+            roundToInt ((double)(getWidth() - labelWidth - 32) / (double) jmax (1, matrix->getNumColumns())));
         matrix->setMatrixCellSize (size, size);
 
         matrixArea = { labelWidth, padding, 
@@ -133,6 +166,7 @@ public:
         matrix->setBounds (matrixArea);
         if (slider.isVisible())
             slider.setBounds (matrixArea.getX() - size + 2, matrixArea.getBottom() + 4, size - 2, size - 2);
+        sizeBox.setBounds (padding, getHeight() - padding - 22, labelWidth + 20, 22);
     }
 
     void paint (Graphics& g) override
@@ -162,6 +196,7 @@ private:
     friend class AudioRouterEditor;
     AudioRouterEditor& owner;
     Slider slider;
+    ComboBox sizeBox;
     std::unique_ptr<AudioRouterMatrix> matrix;
 };
 
@@ -169,6 +204,8 @@ AudioRouterEditor::AudioRouterEditor (const Node& node)
     : NodeEditorComponent (node)
 {
     setOpaque (true);
+    if (auto* const node = getNodeObjectOfType<AudioRouterNode>())
+        matrix = node->getMatrixState();
     content.reset (new Content (*this));
     addAndMakeVisible (content.get());
     if (auto* const node = getNodeObjectOfType<AudioRouterNode>())
@@ -193,6 +230,25 @@ void AudioRouterEditor::setFadeLength (double length)
         node->setFadeLength (length);
 }
 
+float AudioRouterEditor::getGain (int src, int dst) const
+{
+    if (auto* const node = getNodeObjectOfType<AudioRouterNode>())
+        return node->getGain (src, dst);
+    return 0.0f;
+}
+
+void AudioRouterEditor::setGain (int src, int dst, float gain)
+{
+    if (auto* const node = getNodeObjectOfType<AudioRouterNode>())
+        node->setGain (src, dst, gain);
+}
+
+void AudioRouterEditor::setMatrixSize (int numChannels)
+{
+    if (auto* const node = getNodeObjectOfType<AudioRouterNode>())
+        node->setSize (numChannels, numChannels);
+}
+
 void AudioRouterEditor::applyMatrix()
 {
     if (auto* const node = getNodeObjectOfType<AudioRouterNode>())
@@ -204,7 +260,9 @@ void AudioRouterEditor::changeListenerCallback (ChangeBroadcaster*)
     if (auto* const node = getNodeObjectOfType<AudioRouterNode>())
     {
         matrix = node->getMatrixState();
-        content->matrix->repaint();
+        content->sizeBox.setSelectedId (matrix.getNumRows(), dontSendNotification);
+        content->resized();
+        content->repaint();
     }
 }
 
@@ -37,6 +37,9 @@ public:
     MatrixState& getMatrixState() { return matrix; }
     void applyMatrix();
     void setFadeLength (double length);
+    float getGain (int src, int dst) const;
+    void setGain (int src, int dst, float gain);
+    void setMatrixSize (int numChannels);
     void changeListenerCallback (ChangeBroadcaster*) override;
 
 private:
@@ -30,13 +30,10 @@ CompressorNodeEditor::CompViz::CompViz (CompressorProcessor& proc) :
     startTimer (40);
 
     updateCurve();
-
-    proc.addListener (this);
 }
 
 CompressorNodeEditor::CompViz::~CompViz()
 {
-    proc.removeListener (this);
 }
 
 float CompressorNodeEditor::CompViz::getDBForX (float x)
@@ -86,6 +83,8 @@ void CompressorNodeEditor::CompViz::updateInGainDB (float inDB)
 
 void CompressorNodeEditor::CompViz::timerCallback()
 {
+    updateInGainDB (proc.getInputLevelDB());
+    gainReductionDB = jlimit (0.0f, maxReductionDB, -proc.getGainReductionDB());
     repaint();
 }
 
@@ -113,6 +112,15 @@ void CompressorNodeEditor::CompViz::paint (Graphics& g)
     g.setColour (Colours::orange);
     g.fillEllipse (dotX - 5, dotY - 5, 10, 10);
 
+    // draw gain reduction, hanging down from the top
+    const float meterHeight = (float) getHeight() * gainReductionDB / maxReductionDB;
+    g.setColour (Colours::orange.withAlpha (0.75f));
+    g.fillRect ((float) getWidth() - 9.0f, 1.0f, 8.0f, meterHeight);
+    g.setColour (Colours::white);
+    g.setFont (11.0f);
+    g.drawText (String ("GR ") + String (-gainReductionDB, 1) + " dB",
+                getLocalBounds().reduced (14, 4), Justification::topRight);
+
     // Draw outline
     g.setColour (Colours::white);
     g.drawRect (getLocalBounds().toFloat().reduced (0.5f));
@@ -125,7 +133,7 @@ CompressorNodeEditor::CompressorNodeEditor (CompressorProcessor& proc) :
     knobs (proc, [this, &proc] { proc.updateParams(); compViz.updateCurve(); }),
     compViz (proc)
 {
-    setSize (550, 420);
+    setSize (740, 420);
 
     addAndMakeVisible (knobs);
     addAndMakeVisible (compViz);
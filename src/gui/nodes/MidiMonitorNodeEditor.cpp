@@ -79,7 +79,16 @@ MidiMonitorNodeEditor::MidiMonitorNodeEditor (const Node& node)
     setOpaque (true);
     logger.reset (new Logger (getNodeObjectOfType<MidiMonitorNode>()));
     addAndMakeVisible (logger.get());
-    setSize (320, 160);
+
+    addAndMakeVisible (filterButton);
+    filterButton.setButtonText ("Filter");
+    filterButton.onClick = [this]() { showFilterMenu(); };
+
+    addAndMakeVisible (captureButton);
+    captureButton.onClick = [this]() { toggleCapture(); };
+    updateCaptureButton();
+
+    setSize (320, 184);
 }
 
 MidiMonitorNodeEditor::~MidiMonitorNodeEditor()
@@ -89,7 +98,78 @@ MidiMonitorNodeEditor::~MidiMonitorNodeEditor()
 
 void MidiMonitorNodeEditor::resized ()
 {
-    logger->setBounds (getLocalBounds().reduced (4));
+    auto r = getLocalBounds().reduced (4);
+    auto buttons = r.removeFromTop (20);
+    captureButton.setBounds (buttons.removeFromRight (72));
+    buttons.removeFromRight (4);
+    filterButton.setBounds (buttons.removeFromRight (56));
+    r.removeFromTop (4);
+    logger->setBounds (r);
+}
+
+void MidiMonitorNodeEditor::showFilterMenu()
+{
+    auto node = getNodeObjectOfType<MidiMonitorNode>();
+    if (node == nullptr)
+        return;
+
+    const std::pair<int, const char*> items[] = {
+        { MidiMonitorNode::notes,            "Notes" },
+        { MidiMonitorNode::controllers,      "Controllers & Programs" },
+        { MidiMonitorNode::pitchAndPressure, "Pitch Bend & Pressure" },
+        { MidiMonitorNode::clock,            "Clock & Active Sensing" },
+        { MidiMonitorNode::transport,        "Transport" },
+        { MidiMonitorNode::sysex,            "SysEx" },
+        { MidiMonitorNode::other,            "Other" }
+    };
+
+    const int filter = node->getFilter();
+    PopupMenu menu;
+    for (const auto& item : items)
+        menu.addItem (item.first, item.second, true, (filter & item.first) != 0);
+    menu.addSeparator();
+    menu.addItem (1 << 16, "Clear Log");
+
+    const int result = menu.showAt (&filterButton);
+    if (result == (1 << 16))
+        node->clearMessages();
+    else if (result > 0)
+        node->setFilter (filter ^ result);
+}
+
+void MidiMonitorNodeEditor::toggleCapture()
+{
+    auto node = getNodeObjectOfType<MidiMonitorNode>();
+    if (node == nullptr)
+        return;
+
+    if (node->isCapturing())
+    {
+        node->stopCapture();
+    }
+    else
+    {
+        FileChooser chooser ("Capture MIDI To File",
+            File::getSpecialLocation (File::userDocumentsDirectory).getChildFile ("MIDI Capture.csv"),
+            "*.csv", true, false);
+        if (chooser.browseForFileToSave (true))
+        {
+            if (! node->startCapture (chooser.getResult()))
+                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "MIDI Monitor",
+                    "Could not write to " + chooser.getResult().getFullPathName());
+        }
+    }
+
+    updateCaptureButton();
+}
+
+void MidiMonitorNodeEditor::updateCaptureButton()
+{
+    auto node = getNodeObjectOfType<MidiMonitorNode>();
+    const bool capturing = node != nullptr && node->isCapturing();
+    captureButton.setButtonText (capturing ? "Stop" : "Capture");
+    captureButton.setTooltip (capturing ? node->getCaptureFile().getFullPathName()
+                                        : String ("Write every message to a CSV file"));
 }
 
 };
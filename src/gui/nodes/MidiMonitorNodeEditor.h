@@ -34,6 +34,11 @@ public:
 
 private:
     class Logger; std::unique_ptr<Logger> logger;
+    TextButton filterButton, captureButton;
+
+    void showFilterMenu();
+    void toggleCapture();
+    void updateCaptureButton();
 };
 
 }
@@ -66,11 +66,50 @@ public:
     
             g.fillRect (0, 0, width - gridPadding, height - gridPadding);
         }
+
+        // mark routes which filter or move channels
+        if (editor.getRouteChannelMask (row, column) != 0xffff ||
+            editor.getRouteOutputChannel (row, column) != 0)
+        {
+            g.setColour (LookAndFeel::textColor);
+            g.fillEllipse ((float) width - gridPadding - 8.f, 3.f, 5.f, 5.f);
+        }
     }
 
     void matrixCellClicked (const int row, const int col, const MouseEvent& ev) override
     {
-        ignoreUnused (ev);
+        if (ev.mods.isPopupMenu())
+        {
+            const int mask = editor.getRouteChannelMask (row, col);
+            const int output = editor.getRouteOutputChannel (row, col);
+
+            PopupMenu channels;
+            channels.addItem (100, "All", true, mask == 0xffff);
+            channels.addSeparator();
+            for (int ch = 0; ch < 16; ++ch)
+                channels.addItem (101 + ch, String ("Channel ") + String (ch + 1), true, (mask & (1 << ch)) != 0);
+
+            PopupMenu outputs;
+            outputs.addItem (200, "Same Channel", true, output == 0);
+            outputs.addSeparator();
+            for (int ch = 1; ch <= 16; ++ch)
+                outputs.addItem (200 + ch, String ("Channel ") + String (ch), true, output == ch);
+
+            PopupMenu menu;
+            menu.addSubMenu ("Input Channels", channels);
+            menu.addSubMenu ("Output Channel", outputs);
+
+            const int result = menu.show();
+            if (result == 100)
+                editor.setRouteChannels (row, col, 0xffff, output);
+            else if (result > 100 && result <= 116)
+                editor.setRouteChannels (row, col, mask ^ (1 << (result - 101)), output);
+            else if (result >= 200 && result <= 216)
+                editor.setRouteChannels (row, col, mask, result - 200);
+            repaint();
+            return;
+        }
+
         auto& matrix = editor.getMatrixState();
         matrix.toggleCell (row, col);
         editor.applyMatrix();
@@ -193,6 +232,26 @@ void MidiRouterEditor::applyMatrix()
         node->setMatrixState (matrix);
 }
 
+int MidiRouterEditor::getRouteChannelMask (int src, int dst)
+{
+    if (auto* const node = getNodeObjectOfType<MidiRouterNode>())
+        return node->getRouteChannelMask (src, dst);
+    return 0xffff;
+}
+
+int MidiRouterEditor::getRouteOutputChannel (int src, int dst)
+{
+    if (auto* const node = getNodeObjectOfType<MidiRouterNode>())
+        return node->getRouteOutputChannel (src, dst);
+    return 0;
+}
+
+void MidiRouterEditor::setRouteChannels (int src, int dst, int channelMask, int outputChannel)
+{
+    if (auto* const node = getNodeObjectOfType<MidiRouterNode>())
+        node->setRouteChannels (src, dst, channelMask, outputChannel);
+}
+
 void MidiRouterEditor::changeListenerCallback (ChangeBroadcaster*)
 {
     if (auto* const node = getNodeObjectOfType<MidiRouterNode>())
@@ -35,6 +35,13 @@ public:
 
     MatrixState& getMatrixState() { return matrix; }
     void applyMatrix();
+
+    /** Source channels and output channel of a route,
+        see MidiRouterNode::setRouteChannels */
+    int getRouteChannelMask (int src, int dst);
+    int getRouteOutputChannel (int src, int dst);
+    void setRouteChannels (int src, int dst, int channelMask, int outputChannel);
+
     void changeListenerCallback (ChangeBroadcaster*) override;
 
 private:
@@ -0,0 +1,259 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "engine/nodes/MidiSequencerNode.h"
+#include "gui/nodes/MidiSequencerEditor.h"
+#include "gui/LookAndFeel.h"
+#include "Common.h"
+#include "Utils.h"
+
+namespace Element {
+
+/** Step lengths offered, in quarter notes */
+static const double stepLengths[] = { 1.0, 0.5, 1.0 / 3.0, 0.25, 1.0 / 6.0, 0.125 };
+static const char* stepLengthNames[] = { "1/4", "1/8", "1/8 T", "1/16", "1/16 T", "1/32" };
+
+/** Every step of the pattern. Clicking toggles a step, dragging up or
+    down changes its note and dragging with shift changes its velocity */
+class MidiSequencerEditor::StepGrid : public Component
+{
+public:
+    enum { numColumns = 16 };
+
+    StepGrid (MidiSequencerEditor& ed) : editor (ed) { }
+
+    void paint (Graphics& g) override
+    {
+        auto* const node = editor.getNodeObjectOfType<MidiSequencerNode>();
+        if (node == nullptr)
+            return;
+
+        auto& sequencer = node->getSequencer();
+        g.setFont (11.f);
+
+        for (int i = 0; i < PatternSequencer::maxSteps; ++i)
+        {
+            const auto step  = sequencer.getStep (i);
+            const auto cell  = getCellBounds (i).reduced (1);
+            const bool inLoop = i >= sequencer.getLoopStart() && i < sequencer.getLoopEnd();
+
+            auto colour = step.enabled ? Colour (kv::Colors::elemental)
+                                       : Colour (kv::LookAndFeel_KV1::defaultMatrixCellOffColor);
+            if (! inLoop)
+                colour = colour.withMultipliedAlpha (0.4f);
+            g.setColour (colour);
+            g.fillRect (cell);
+
+            // velocity as a bar along the bottom
+            g.setColour (LookAndFeel::textColor.withAlpha (0.5f));
+            g.fillRect (cell.withTop (cell.getBottom() - 3)
+                            .withWidth (roundToInt (cell.getWidth() * step.velocity / 127.f)));
+
+            g.setColour (LookAndFeel::textColor);
+            g.drawText (Util::noteValueToString (step.note), cell, Justification::centred, false);
+        }
+    }
+
+    void mouseDown (const MouseEvent& ev) override
+    {
+        dragStep = getStepAt (ev.getPosition());
+        dragged = false;
+        if (auto* const node = editor.getNodeObjectOfType<MidiSequencerNode>())
+            if (isPositiveAndBelow (dragStep, (int) PatternSequencer::maxSteps))
+                dragStart = node->getSequencer().getStep (dragStep);
+    }
+
+    void mouseDrag (const MouseEvent& ev) override
+    {
+        auto* const node = editor.getNodeObjectOfType<MidiSequencerNode>();
+        if (node == nullptr || ! isPositiveAndBelow (dragStep, (int) PatternSequencer::maxSteps))
+            return;
+
+        const int delta = -ev.getDistanceFromDragStartY() / 4;
+        dragged = dragged || delta != 0;
+        auto step = dragStart;
+        if (ev.mods.isShiftDown())
+            step.velocity = jlimit (1, 127, dragStart.velocity + delta);
+        else
+            step.note = jlimit (0, 127, dragStart.note + delta);
+        node->getSequencer().setStep (dragStep, step);
+        repaint();
+    }
+
+    void mouseUp (const MouseEvent&) override
+    {
+        auto* const node = editor.getNodeObjectOfType<MidiSequencerNode>();
+        if (node == nullptr || dragged || ! isPositiveAndBelow (dragStep, (int) PatternSequencer::maxSteps))
+            return;
+
+        auto step = node->getSequencer().getStep (dragStep);
+        step.enabled = ! step.enabled;
+        node->getSequencer().setStep (dragStep, step);
+        repaint();
+    }
+
+private:
+    MidiSequencerEditor& editor;
+    int dragStep = -1;
+    bool dragged = false;
+    PatternSequencer::Step dragStart;
+
+    int getNumRows() const { return PatternSequencer::maxSteps / numColumns; }
+
+    Rectangle<int> getCellBounds (const int index) const
+    {
+        const int w = getWidth() / numColumns, h = getHeight() / getNumRows();
+        return { w * (index % numColumns), h * (index / numColumns), w, h };
+    }
+
+    int getStepAt (Point<int> pos) const
+    {
+        const int w = jmax (1, getWidth() / numColumns), h = jmax (1, getHeight() / getNumRows());
+        if (pos.x < 0 || pos.y < 0 || pos.x >= w * numColumns || pos.y >= h * getNumRows())
+            return -1;
+        return (pos.y / h) * numColumns + pos.x / w;
+    }
+};
+
+MidiSequencerEditor::MidiSequencerEditor (const Node& node)
+    : NodeEditorComponent (node)
+{
+    setOpaque (true);
+
+    modeBox.addItemList ({ "Sequence", "Arp Up", "Arp Down", "Arp Up/Down", "Arp As Played" }, 1);
+    for (int i = 0; i < numElementsInArray (stepLengthNames); ++i)
+        lengthBox.addItem (stepLengthNames[i], i + 1);
+
+    swingSlider.setRange (0.0, 1.0, 0.01);
+    octavesSlider.setRange (1.0, 4.0, 1.0);
+    channelSlider.setRange (1.0, 16.0, 1.0);
+    loopStartSlider.setRange (0.0, (double) PatternSequencer::maxSteps - 1.0, 1.0);
+    loopEndSlider.setRange (1.0, (double) PatternSequencer::maxSteps, 1.0);
+
+    addSetting (modeBox, "Mode");
+    addSetting (lengthBox, "Step");
+    addSetting (swingSlider, "Swing");
+    addSetting (octavesSlider, "Octaves");
+    addSetting (channelSlider, "Channel");
+    addSetting (loopStartSlider, "Loop Start");
+    addSetting (loopEndSlider, "Loop End");
+
+    for (auto* slider : { &swingSlider, &octavesSlider, &channelSlider, &loopStartSlider, &loopEndSlider })
+    {
+        slider->setSliderStyle (Slider::LinearBar);
+        slider->onValueChange = [this]() { applySettings(); };
+    }
+    modeBox.onChange = lengthBox.onChange = [this]() { applySettings(); };
+
+    grid.reset (new StepGrid (*this));
+    addAndMakeVisible (grid.get());
+
+    if (auto* const object = getNodeObjectOfType<MidiSequencerNode>())
+    {
+        updateSettings();
+        object->addChangeListener (this);
+    }
+
+    setSize (640, 300);
+}
+
+MidiSequencerEditor::~MidiSequencerEditor()
+{
+    if (auto* const object = getNodeObjectOfType<MidiSequencerNode>())
+        object->removeChangeListener (this);
+    for (auto* slider : { &swingSlider, &octavesSlider, &channelSlider, &loopStartSlider, &loopEndSlider })
+        slider->onValueChange = nullptr;
+    modeBox.onChange = lengthBox.onChange = nullptr;
+    grid.reset();
+}
+
+void MidiSequencerEditor::addSetting (Component& component, const String& name)
+{
+    auto* label = labels.add (new Label (String(), name));
+    label->setJustificationType (Justification::centredLeft);
+    label->attachToComponent (&component, false);
+    addAndMakeVisible (component);
+}
+
+void MidiSequencerEditor::applySettings()
+{
+    auto* const object = getNodeObjectOfType<MidiSequencerNode>();
+    if (object == nullptr)
+        return;
+
+    auto& sequencer = object->getSequencer();
+    sequencer.setMode (modeBox.getSelectedItemIndex());
+    if (isPositiveAndBelow (lengthBox.getSelectedItemIndex(), numElementsInArray (stepLengths)))
+        sequencer.setStepLength (stepLengths [lengthBox.getSelectedItemIndex()]);
+    sequencer.setSwing ((float) swingSlider.getValue());
+    sequencer.setOctaves (roundToInt (octavesSlider.getValue()));
+    sequencer.setChannel (roundToInt (channelSlider.getValue()));
+    sequencer.setLoop (roundToInt (loopStartSlider.getValue()), roundToInt (loopEndSlider.getValue()));
+    grid->repaint();
+}
+
+void MidiSequencerEditor::updateSettings()
+{
+    auto* const object = getNodeObjectOfType<MidiSequencerNode>();
+    if (object == nullptr)
+        return;
+
+    const auto& sequencer = object->getSequencer();
+    modeBox.setSelectedItemIndex (sequencer.getMode(), dontSendNotification);
+
+    int lengthIndex = 0;
+    for (int i = 1; i < numElementsInArray (stepLengths); ++i)
+        if (std::abs (stepLengths[i] - sequencer.getStepLength()) < std::abs (stepLengths[lengthIndex] - sequencer.getStepLength()))
+            lengthIndex = i;
+    lengthBox.setSelectedItemIndex (lengthIndex, dontSendNotification);
+
+    swingSlider.setValue (sequencer.getSwing(), dontSendNotification);
+    octavesSlider.setValue (sequencer.getOctaves(), dontSendNotification);
+    channelSlider.setValue (sequencer.getChannel(), dontSendNotification);
+    loopStartSlider.setValue (sequencer.getLoopStart(), dontSendNotification);
+    loopEndSlider.setValue (sequencer.getLoopEnd(), dontSendNotification);
+    grid->repaint();
+}
+
+void MidiSequencerEditor::changeListenerCallback (ChangeBroadcaster*)
+{
+    updateSettings();
+}
+
+void MidiSequencerEditor::resized()
+{
+    auto r = getLocalBounds().reduced (8);
+    auto settings = r.removeFromTop (44).withTrimmedTop (20);
+    const int w = settings.getWidth() / 7;
+    for (auto* c : { (Component*) &modeBox, (Component*) &lengthBox, (Component*) &swingSlider,
+                     (Component*) &octavesSlider, (Component*) &channelSlider,
+                     (Component*) &loopStartSlider, (Component*) &loopEndSlider })
+        c->setBounds (settings.removeFromLeft (w).reduced (2, 0));
+
+    r.removeFromTop (8);
+    grid->setBounds (r);
+}
+
+void MidiSequencerEditor::paint (Graphics& g)
+{
+    g.fillAll (LookAndFeel::contentBackgroundColor);
+}
+
+}
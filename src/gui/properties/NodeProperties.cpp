@@ -21,6 +21,7 @@
 #include "gui/properties/NodeProperties.h"
 #include "gui/widgets/NodeMidiProgramComponent.h"
 #include "session/Node.h"
+#include "session/StateStore.h"
 #include "Utils.h"
 
 #ifndef EL_PROGRAM_NAME_PLACEHOLDER
@@ -91,7 +92,9 @@ public:
                     if (isPositiveAndBelow (ptr->getMidiProgram(), 128))
                     {
                         node.savePluginState();
-                        node.writeToFile (ptr->getMidiProgramFile());
+                        SharedResourcePointer<StateStore> store;
+                        store->writeExternalized (node.getValueTree(), ptr->getMidiProgramFile());
+                        ptr->refreshMidiPrograms();
                     }
                 }
                 else
@@ -153,6 +156,11 @@ private:
                 program.saveButton.setEnabled (enabled);
                 program.trashButton.setEnabled (enabled);
                 program.powerButton.setToggleState (enabled, dontSendNotification);
+
+                const auto switchTime = object->getMidiProgramSwitchTime();
+                program.loadButton.setTooltip (switchTime > 0.0
+                    ? String ("Reload saved MIDI program (last change took ") + String (switchTime, 1) + " ms)"
+                    : String ("Reload saved MIDI program"));
             }
             else
             {
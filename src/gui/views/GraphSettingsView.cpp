@@ -20,6 +20,7 @@
 #include "controllers/AppController.h"
 #include "controllers/EngineController.h"
 
+#include "engine/MidiPrefilter.h"
 #include "engine/VelocityCurve.h"
 
 #include "gui/properties/MidiMultiChannelPropertyComponent.h"
@@ -27,6 +28,7 @@
 #include "gui/views/GraphSettingsView.h"
 
 #include "ScopedFlag.h"
+#include "Utils.h"
 
 namespace Element {
     typedef Array<PropertyComponent*> PropertyArray;
@@ -138,6 +140,107 @@ namespace Element {
         int index;
     };
 
+    class MidiKindsPropertyComponent : public PropertyComponent
+    {
+    public:
+        MidiKindsPropertyComponent (const Node& g)
+            : PropertyComponent ("MIDI Messages", 50),
+              graph (g)
+        {
+            const int kinds[] = { MidiPrefilter::notes, MidiPrefilter::polyPressure, MidiPrefilter::controllers,
+                                  MidiPrefilter::programChanges, MidiPrefilter::channelPressure,
+                                  MidiPrefilter::pitchBend, MidiPrefilter::system };
+            const char* names[] = { "Notes", "Poly AT", "CC", "Program", "Chan AT", "Bend", "System" };
+
+            for (int i = 0; i < numElementsInArray (kinds); ++i)
+            {
+                auto* button = buttons.add (new ToggleButton (names[i]));
+                const int kind = kinds[i];
+                button->onClick = [this, kind]() { toggleKind (kind); };
+                addAndMakeVisible (button);
+                buttonKinds.add (kind);
+            }
+
+            refresh();
+        }
+
+        void refresh() override
+        {
+            const int mask = graph.getProperty (Tags::midiKinds, (int) MidiPrefilter::allKinds);
+            for (int i = 0; i < buttons.size(); ++i)
+                buttons.getUnchecked(i)->setToggleState ((mask & buttonKinds[i]) != 0, dontSendNotification);
+        }
+
+        void resized() override
+        {
+            auto r = getLookAndFeel().getPropertyComponentContentPosition (*this);
+            const int columns = 4;
+            const int w = r.getWidth() / columns, h = r.getHeight() / 2;
+            for (int i = 0; i < buttons.size(); ++i)
+                buttons.getUnchecked(i)->setBounds (r.getX() + w * (i % columns), r.getY() + h * (i / columns), w, h);
+        }
+
+    private:
+        Node graph;
+        OwnedArray<ToggleButton> buttons;
+        Array<int> buttonKinds;
+
+        void toggleKind (const int kind)
+        {
+            const int mask = (int) graph.getProperty (Tags::midiKinds, (int) MidiPrefilter::allKinds) ^ kind;
+            graph.setProperty (Tags::midiKinds, mask);
+            if (auto* obj = graph.getGraphNode())
+                if (auto* proc = dynamic_cast<RootGraph*> (obj->getAudioProcessor()))
+                    proc->setMidiKinds (mask);
+        }
+    };
+
+    class GraphKeyPropertyComponent : public SliderPropertyComponent
+    {
+    public:
+        GraphKeyPropertyComponent (const Node& g, const Identifier& key, const String& name)
+            : SliderPropertyComponent (name, 0.0, 127.0, 1.0, 1.0, false),
+              graph (g), property (key)
+        {
+            slider.textFromValueFunction = Util::noteValueToString;
+            slider.updateText();
+        }
+
+        ~GraphKeyPropertyComponent()
+        {
+            slider.textFromValueFunction = nullptr;
+        }
+
+        void setValue (double v) override
+        {
+            graph.setProperty (property, roundToInt (v));
+
+            // the other end follows so the range stays valid
+            int start = graph.getProperty (Tags::keyStart, 0);
+            int end   = graph.getProperty (Tags::keyEnd, 127);
+            if (start > end)
+            {
+                if (property == Tags::keyStart)
+                    graph.setProperty (Tags::keyEnd, end = start);
+                else
+                    graph.setProperty (Tags::keyStart, start = end);
+            }
+
+            if (auto* obj = graph.getGraphNode())
+                if (auto* proc = dynamic_cast<RootGraph*> (obj->getAudioProcessor()))
+                    proc->setMidiNoteRange ({ start, end });
+        }
+
+        double getValue() const override
+        {
+            return (double) graph.getProperty (property, property == Tags::keyEnd ? 127 : 0);
+        }
+
+    private:
+        Node graph;
+        Identifier property;
+    };
+
     class RootGraphMidiChannels : public MidiMultiChannelPropertyComponent
     {
     public:
@@ -313,6 +416,9 @@ namespace Element {
            #else
             props.add (new RootGraphMidiChanel (g));
            #endif
+            props.add (new MidiKindsPropertyComponent (g));
+            props.add (new GraphKeyPropertyComponent (g, Tags::keyStart, "Key Start"));
+            props.add (new GraphKeyPropertyComponent (g, Tags::keyEnd, "Key End"));
 
            #if defined (EL_PRO)
             props.add (new MidiProgramPropertyComponent (g));
@@ -28,6 +28,7 @@
 #include "gui/nodes/AudioRouterEditor.h"
 #include "gui/nodes/GenericNodeEditor.h"
 #include "gui/nodes/MidiIONodeEditor.h"
+#include "gui/nodes/MidiSequencerEditor.h"
 #include "gui/views/NodeEditorContentView.h"
 #include "gui/widgets/AudioDeviceSelectorComponent.h"
 #include "gui/ViewHelpers.h"
@@ -467,6 +468,11 @@ Component* NodeEditorContentView::createEmbededEditor()
         auto* const midiRouterEditor = new MidiRouterEditor (node);
         return midiRouterEditor;
     }
+    else if (node.getIdentifier() == EL_INTERNAL_ID_MIDI_SEQUENCER)
+    {
+        auto* const midiSequencerEditor = new MidiSequencerEditor (node);
+        return midiSequencerEditor;
+    }
 
     return nullptr;
 }
@@ -17,6 +17,7 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include "engine/MeterSource.h"
 #include "engine/MidiPipe.h"
 #include "session/CommandManager.h"
 #include "session/MediaManager.h"
@@ -227,6 +228,16 @@ static void openModel (sol::state& lua)
         "muted",                property (&Node::isMuted, &Node::setMuted),
         "bypassed",             readonly_property (&Node::isBypassed),
         "editor",               readonly_property (&Node::hasEditor),
+        "meters", [](Node* self, this_state s) -> table
+        {
+            state_view lua (s);
+            auto meters = lua.create_table();
+            if (auto* object = self->getGraphNode())
+                if (auto* source = object->processor<MeterSource>())
+                    for (int i = 0; i < source->getNumMeters(); ++i)
+                        meters [source->getMeterName (i).toStdString()] = source->getMeterValue (i);
+            return meters;
+        },
 
         "toxmlstring", [](Node* self) -> std::string
         {
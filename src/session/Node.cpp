@@ -19,6 +19,7 @@
 
 #include "session/Node.h"
 #include "session/Session.h"
+#include "session/StateStore.h"
 #include "controllers/GraphManager.h"
 #include "ScopedFlag.h"
 
@@ -253,6 +254,8 @@ ValueTree Node::parse (const File& file)
             data.removeChild (nodeData, 0);
         
         Node::sanitizeProperties (nodeData);
+        SharedResourcePointer<StateStore> store;
+        store->internalize (nodeData);
         return nodeData;
     }
     
@@ -286,6 +289,7 @@ bool Node::writeToFile (const File& targetFile) const
 {
     ValueTree data = objectData.createCopy();
     sanitizeProperties (data, true);
+    StateStore::pack (data);
     
     #if EL_SAVE_BINARY_FORMAT
     TemporaryFile tempFile (targetFile);
@@ -318,20 +322,25 @@ bool Node::savePresetTo (const DataPath& path, const String& name) const
     const auto targetFile = path.createNewPresetFile (*this, name);
     data.setProperty (Tags::name, targetFile.getFileNameWithoutExtension(), 0);
     data.setProperty (Tags::type, Tags::node.toString(), 0);
+
+    // presets travel between machines, keep their states inside
+    StateStore::pack (data);
     
+    bool saved = false;
     #if EL_SAVE_BINARY_FORMAT
     TemporaryFile tempFile(targetFile);
     if (auto out = std::unique_ptr<FileOutputStream>(tempFile.getFile().createOutputStream()))
     {
         data.writeToStream(*out);
         out.reset();
-        return tempFile.overwriteTargetFileWithTemporary();
+        saved = tempFile.overwriteTargetFileWithTemporary();
     }
     #else
     if (auto e = preset.createXml())
-        return e->writeToFile (targetFile, String());
+        saved = e->writeToFile (targetFile, String());
     #endif
-    return false;
+
+    return saved;
 }
 
 Node Node::createGraph (const String& name)
@@ -728,7 +737,10 @@ void Node::restorePluginState()
         if (hasProperty (Tags::transpose))
             obj->setTransposeOffset (getProperty (Tags::transpose));
         
+        obj->setOversamplingQuality (getProperty (Tags::oversamplingQuality).toString() == "fir"
+            ? Oversampler::FIR : Oversampler::IIR);
         obj->setOversamplingFactor (jmax (1, (int) getProperty (Tags::oversamplingFactor, 1)));
+        obj->setDoublePrecision ((bool) getProperty (Tags::doublePrecision, false));
     }
 
     // this was originally here to help reduce memory usage
@@ -750,6 +762,7 @@ void Node::savePluginState()
     GraphNodePtr obj = getGraphNode();
     if (obj && obj->isPrepared)
     {
+        SharedResourcePointer<StateStore> store;
         MemoryBlock state;
         
         if (auto* proc = obj->getAudioProcessor())
@@ -757,7 +770,7 @@ void Node::savePluginState()
             proc->getStateInformation (state);
             if (state.getSize() > 0)
             {
-                objectData.setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+                objectData.setProperty (Tags::state, store->intern (state), nullptr);
             }
             else
             {
@@ -770,7 +783,7 @@ void Node::savePluginState()
             proc->getCurrentProgramStateInformation (state);
             if (state.getSize() > 0)
             {
-                objectData.setProperty (Tags::programState, state.toBase64Encoding(), 0);
+                objectData.setProperty (Tags::programState, store->intern (state), 0);
             }
 
             setProperty (Tags::bypass, proc->isSuspended());
@@ -780,7 +793,7 @@ void Node::savePluginState()
         {
             obj->getState (state);
             if (state.getSize() > 0)
-                objectData.setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+                objectData.setProperty (Tags::state, store->intern (state), nullptr);
         }
 
         setProperty (Tags::midiProgram, obj->getMidiProgram());
@@ -791,6 +804,8 @@ void Node::savePluginState()
         String mps; obj->getMidiProgramsState (mps);
         setProperty (Tags::midiProgramsState, mps);
         setProperty (Tags::oversamplingFactor, obj->getOversamplingFactor());
+        setProperty (Tags::oversamplingQuality, obj->getOversamplingQuality() == Oversampler::FIR ? "fir" : "iir");
+        setProperty (Tags::doublePrecision, obj->isDoublePrecisionRequested());
     }
 
     for (int i = 0; i < getNumNodes(); ++i)
@@ -26,6 +26,7 @@
 #include "engine/nodes/MidiMonitorNode.h"
 #include "engine/nodes/MidiProgramMapNode.h"
 #include "engine/nodes/MidiRouterNode.h"
+#include "engine/nodes/MidiSequencerNode.h"
 #include "engine/nodes/OSCReceiverNode.h"
 #include "engine/nodes/OSCSenderNode.h"
 #include "DataPath.h"
@@ -745,6 +746,10 @@ GraphNode* PluginManager::createGraphNode (const PluginDescription& desc, String
     {
         return new MidiMonitorNode();
     }
+    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_MIDI_SEQUENCER)
+    {
+        return new MidiSequencerNode();
+    }
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_OSC_RECEIVER)
     {
         return new OSCReceiverNode();
@@ -25,6 +25,7 @@
 #include "Globals.h"
 
 #include "session/Session.h"
+#include "session/StateStore.h"
 
 namespace Element {
 
@@ -109,6 +110,8 @@ namespace Element {
     {
         if (! data.hasType (Tags::session))
             return false;
+        SharedResourcePointer<StateStore> store;
+        store->internalize (data);
         objectData.removeListener (this);
         objectData = data;
         setMissingProperties();
@@ -120,6 +123,7 @@ namespace Element {
     {
         ValueTree saveData = objectData.createCopy();
         Node::sanitizeProperties (saveData, true);
+        StateStore::pack (saveData);
         return saveData.createXml();
     }
 
@@ -309,6 +313,7 @@ namespace Element {
     {
         ValueTree saveData = objectData.createCopy();
         Node::sanitizeProperties (saveData, true);
+        StateStore::pack (saveData);
         TemporaryFile tempFile (file);
 
         if (auto fos = std::unique_ptr<FileOutputStream> (tempFile.getFile().createOutputStream()))
@@ -334,6 +339,9 @@ namespace Element {
             data = ValueTree::readFromStream (gzip);
         }
 
+        SharedResourcePointer<StateStore> store;
+        store->internalize (data);
+
         return data;
     }
 }
@@ -0,0 +1,447 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/Node.h"
+#include "session/SessionJournal.h"
+
+namespace Element {
+
+namespace JournalHelpers
+{
+    const int magic             = (int) ByteOrder::littleEndianInt ("ELJ1");
+    const int recordEnd         = (int) ByteOrder::littleEndianInt ("ELJE");
+    const int snapshotRecord    = 1;
+    const int nodeStateRecord   = 2;
+
+    /** Bytes written per time slice */
+    const int chunkSize         = 64 * 1024;
+
+    /** Journal size at which it gets rewritten with only the latest records */
+    const int64 compactSize     = 64 * 1024 * 1024;
+
+    static int64 hashBlock (const MemoryBlock& block)
+    {
+        // FNV-1a, only used to skip writing identical states twice
+        uint64 hash = 14695981039346656037ull;
+        const auto* data = static_cast<const uint8*> (block.getData());
+        for (size_t i = 0; i < block.getSize(); ++i)
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        return static_cast<int64> (hash);
+    }
+
+    static void writeHeader (OutputStream& out, const String& sessionPath)
+    {
+        out.writeInt (magic);
+        out.writeString (sessionPath);
+    }
+
+    static void writeRecordStart (OutputStream& out, int type, const String& uuid, int64 size)
+    {
+        out.writeInt (type);
+        out.writeString (uuid);
+        out.writeInt64 (size);
+    }
+
+    static void writeRecord (OutputStream& out, int type, const String& uuid, const MemoryBlock& payload)
+    {
+        writeRecordStart (out, type, uuid, (int64) payload.getSize());
+        out.write (payload.getData(), payload.getSize());
+        out.writeInt (recordEnd);
+    }
+
+    static ValueTree findNode (const ValueTree& tree, const String& uuid)
+    {
+        if (tree.hasType (Tags::node) && tree.getProperty (Tags::uuid).toString() == uuid)
+            return tree;
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+        {
+            auto node = findNode (tree.getChild (i), uuid);
+            if (node.isValid())
+                return node;
+        }
+        return {};
+    }
+}
+
+//=============================================================================
+
+struct SessionJournal::Record
+{
+    int type = 0;
+    String uuid;
+    ValueTree data;
+    GraphNodePtr node;
+    MemoryBlock state, programState;
+    MemoryBlock payload;
+    size_t written = 0;
+    bool encoded = false;
+    bool started = false;
+    bool skip = false;
+};
+
+//=============================================================================
+
+SessionJournal::SessionJournal() { }
+
+SessionJournal::~SessionJournal()
+{
+    thread.removeTimeSliceClient (this);
+    thread.stopThread (2000);
+    cancelPendingUpdate();
+    closeStream();
+}
+
+File SessionJournal::getDefaultFile()
+{
+    return DataPath::applicationDataDir().getChildFile ("Autosave.elj");
+}
+
+bool SessionJournal::canRecover (const File& journalFile)
+{
+    if (! journalFile.existsAsFile())
+        return false;
+    FileInputStream in (journalFile);
+    return in.openedOk() && in.getTotalLength() > 8 && in.readInt() == JournalHelpers::magic;
+}
+
+ValueTree SessionJournal::recover (const File& journalFile, File& sessionFile)
+{
+    using namespace JournalHelpers;
+    FileInputStream in (journalFile);
+    if (! in.openedOk() || in.readInt() != magic)
+        return {};
+
+    const auto path = in.readString();
+    sessionFile = File::isAbsolutePath (path) ? File (path) : File();
+
+    ValueTree session;
+    std::map<String, ValueTree> states;
+
+    while (! in.isExhausted())
+    {
+        const int type      = in.readInt();
+        const String uuid   = in.readString();
+        const int64 size    = in.readInt64();
+        if (size < 0 || size > in.getNumBytesRemaining())
+            break;
+
+        MemoryBlock payload;
+        if (in.readIntoMemoryBlock (payload, (ssize_t) size) != (size_t) size)
+            break;
+        if (in.readInt() != recordEnd)
+            break; // torn record from a crash, everything before it is usable
+
+        const auto data = ValueTree::readFromGZIPData (payload.getData(), payload.getSize());
+        if (type == snapshotRecord && data.hasType (Tags::session))
+            session = data;
+        else if (type == nodeStateRecord && data.isValid())
+            states[uuid] = data;
+    }
+
+    if (! session.isValid())
+        return {};
+
+    for (const auto& item : states)
+    {
+        auto node = findNode (session, item.first);
+        if (! node.isValid())
+            continue;
+
+        if (auto* block = item.second.getProperty (Tags::state).getBinaryData())
+            if (block->getSize() > 0)
+                node.setProperty (Tags::state, block->toBase64Encoding(), nullptr);
+        if (auto* block = item.second.getProperty (Tags::programState).getBinaryData())
+            if (block->getSize() > 0)
+                node.setProperty (Tags::programState, block->toBase64Encoding(), nullptr);
+    }
+
+    return session;
+}
+
+//=============================================================================
+
+void SessionJournal::start (const File& journalFile, const File& sessionFile, const ValueTree& sessionData)
+{
+    discard();
+
+    file        = journalFile;
+    sessionPath = sessionFile.getFullPathName();
+    active      = true;
+    startNewFile = true;
+
+    writeSnapshot (sessionData);
+    thread.addTimeSliceClient (this);
+    if (! thread.isThreadRunning())
+        thread.startThread (2);
+}
+
+void SessionJournal::discard()
+{
+    thread.removeTimeSliceClient (this);
+
+    cancelPendingUpdate();
+    {
+        ScopedLock sl (lock);
+        pending.clear();
+        finished.clear();
+    }
+
+    closeStream();
+    lastStateHashes.clear();
+    if (active && file.existsAsFile())
+        file.deleteFile();
+    active = false;
+}
+
+void SessionJournal::writeSnapshot (const ValueTree& sessionData)
+{
+    auto* record = new Record();
+    record->type = JournalHelpers::snapshotRecord;
+    record->data = sessionData.createCopy();
+    // object properties must not be released on the journal thread
+    Node::sanitizeProperties (record->data, true);
+    enqueue (record);
+}
+
+void SessionJournal::writeNodeState (const String& uuid, MemoryBlock& state, MemoryBlock& programState)
+{
+    auto* record = new Record();
+    record->type = JournalHelpers::nodeStateRecord;
+    record->uuid = uuid;
+    record->state.swapWith (state);
+    record->programState.swapWith (programState);
+    enqueue (record);
+}
+
+void SessionJournal::writeNodeState (const String& uuid, GraphNodePtr node)
+{
+    jassert (node != nullptr && node->canGetStateOffMessageThread());
+    auto* record = new Record();
+    record->type = JournalHelpers::nodeStateRecord;
+    record->uuid = uuid;
+    record->node = node;
+    enqueue (record);
+}
+
+void SessionJournal::enqueue (Record* record)
+{
+    if (! active)
+    {
+        delete record;
+        return;
+    }
+
+    ScopedLock sl (lock);
+    pending.add (record);
+}
+
+int SessionJournal::getNumPending() const
+{
+    ScopedLock sl (lock);
+    return pending.size();
+}
+
+bool SessionJournal::flush (int timeoutMs)
+{
+    const auto start = Time::getMillisecondCounter();
+    while (getNumPending() > 0)
+    {
+        thread.moveToFrontOfQueue (this);
+        if (timeoutMs >= 0 && Time::getMillisecondCounter() - start > (uint32) timeoutMs)
+            return false;
+        Thread::sleep (2);
+    }
+
+    return true;
+}
+
+//=============================================================================
+
+bool SessionJournal::openStream()
+{
+    if (stream != nullptr)
+        return true;
+
+    // only a new journal replaces the file. reopening after a failure
+    // appends, so records already written are never thrown away
+    if (startNewFile)
+        file.deleteFile();
+    const bool needsHeader = ! file.existsAsFile() || file.getSize() <= 0;
+
+    stream.reset (file.createOutputStream (JournalHelpers::chunkSize));
+    if (stream == nullptr || stream->failedToOpen())
+    {
+        stream.reset();
+        return false;
+    }
+
+    startNewFile = false;
+    if (needsHeader)
+    {
+        JournalHelpers::writeHeader (*stream, sessionPath);
+        stream->flush();
+    }
+
+    return true;
+}
+
+void SessionJournal::closeStream()
+{
+    if (stream != nullptr)
+        stream->flush();
+    stream.reset();
+}
+
+bool SessionJournal::encode (Record& record)
+{
+    using namespace JournalHelpers;
+    MemoryOutputStream mo (record.payload, false);
+
+    if (record.type == snapshotRecord)
+    {
+        GZIPCompressorOutputStream gzip (mo, 1);
+        record.data.writeToStream (gzip);
+        record.data = ValueTree();
+    }
+    else if (record.type == nodeStateRecord)
+    {
+        if (record.node != nullptr)
+            record.node->getState (record.state);
+
+        const auto hash = hashBlock (record.state) ^ hashBlock (record.programState);
+        auto iter = lastStateHashes.find (record.uuid);
+        if (iter != lastStateHashes.end() && iter->second == hash)
+            return false;
+        lastStateHashes[record.uuid] = hash;
+
+        ValueTree data (Tags::state);
+        data.setProperty (Tags::uuid, record.uuid, nullptr)
+            .setProperty (Tags::state, var (record.state), nullptr)
+            .setProperty (Tags::programState, var (record.programState), nullptr);
+        record.state.reset();
+        record.programState.reset();
+
+        GZIPCompressorOutputStream gzip (mo, 1);
+        data.writeToStream (gzip);
+    }
+
+    mo.flush();
+    return true;
+}
+
+void SessionJournal::handleAsyncUpdate()
+{
+    OwnedArray<Record> records;
+    {
+        ScopedLock sl (lock);
+        records.swapWith (finished);
+    }
+}
+
+int SessionJournal::useTimeSlice()
+{
+    using namespace JournalHelpers;
+    Record* record = nullptr;
+
+    {
+        ScopedLock sl (lock);
+        record = pending.getFirst();
+    }
+
+    if (record == nullptr)
+        return 250;
+
+    if (! record->encoded)
+    {
+        record->encoded = true;
+        record->skip = ! encode (*record);
+        return 0;
+    }
+
+    if (! record->skip && ! record->started)
+    {
+        // retried until the file can be opened
+        if (! openStream())
+            return 1000;
+        writeRecordStart (*stream, record->type, record->uuid, (int64) record->payload.getSize());
+        record->started = true;
+        return 0;
+    }
+
+    if (! record->skip)
+    {
+        const auto remaining = record->payload.getSize() - record->written;
+        const auto numBytes  = jmin ((size_t) chunkSize, remaining);
+        stream->write (static_cast<const char*> (record->payload.getData()) + record->written, numBytes);
+        record->written += numBytes;
+        stream->flush();
+
+        if (record->written < record->payload.getSize())
+            return 0;
+
+        stream->writeInt (recordEnd);
+        stream->flush();
+    }
+
+    {
+        // records can hold the last reference to a node, so they
+        // are deleted on the message thread
+        ScopedLock sl (lock);
+        pending.removeObject (record, false);
+        finished.add (record);
+    }
+    triggerAsyncUpdate();
+
+    if (stream != nullptr && stream->getPosition() > compactSize)
+    {
+        // the next snapshot starts a fresh file. node states already in
+        // the journal are newer than the model, so they are carried over
+        // by re-reading them before the file is replaced.
+        closeStream();
+        File dummy;
+        const auto session = recover (file, dummy);
+        if (session.isValid())
+        {
+            // the old journal stays until its replacement is complete
+            TemporaryFile temp (file);
+            if (auto out = std::unique_ptr<FileOutputStream> (temp.getFile().createOutputStream()))
+            {
+                MemoryOutputStream mo;
+                {
+                    GZIPCompressorOutputStream gzip (mo, 1);
+                    session.writeToStream (gzip);
+                }
+                writeHeader (*out, sessionPath);
+                writeRecord (*out, snapshotRecord, String(), mo.getMemoryBlock());
+                out->flush();
+                const bool written = out->getStatus().wasOk();
+                out.reset();
+                if (written)
+                    temp.overwriteTargetFileWithTemporary();
+            }
+        }
+
+        // appends to whichever file is there now, or retries later
+        openStream();
+    }
+
+    return 0;
+}
+
+}
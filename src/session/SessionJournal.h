@@ -0,0 +1,117 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include <map>
+#include "ElementApp.h"
+#include "engine/GraphNode.h"
+
+namespace Element {
+
+/** Append-only autosave journal for a session.
+
+    The journal holds a copy of the session model followed by node state
+    records. Encoding and file writes happen on a background thread in
+    small chunks so the message thread only pays for capturing the states
+    which actually changed. A record is only considered valid once its end
+    marker has been written, so a crash mid-write loses at most the record
+    that was in flight.
+ */
+class SessionJournal : private TimeSliceClient,
+                       private AsyncUpdater
+{
+public:
+    SessionJournal();
+    ~SessionJournal();
+
+    /** Returns the default location of the autosave journal */
+    static File getDefaultFile();
+
+    /** Returns true if the file looks like a journal with something in it */
+    static bool canRecover (const File& journalFile);
+
+    /** Rebuilds session data from a journal. Node states found in the journal
+        are applied to the most recent model snapshot.
+
+        @param journalFile  The journal to read
+        @param sessionFile  Set to the session file that was open when the
+                            journal was written, if any
+     */
+    static ValueTree recover (const File& journalFile, File& sessionFile);
+
+    /** Starts a new journal, replacing any previous contents
+
+        @param journalFile  Where to write the journal
+        @param sessionFile  The session file currently open, can be empty
+        @param sessionData  The session model. A copy is taken immediately
+                            and serialized on the background thread
+     */
+    void start (const File& journalFile, const File& sessionFile, const ValueTree& sessionData);
+
+    /** Returns true if start has been called and the journal not discarded */
+    bool isActive() const { return active; }
+
+    /** Returns the file being written */
+    const File& getFile() const { return file; }
+
+    /** Appends a copy of the session model */
+    void writeSnapshot (const ValueTree& sessionData);
+
+    /** Appends a node state captured by the caller. The blocks are swapped
+        out, not copied */
+    void writeNodeState (const String& uuid, MemoryBlock& state, MemoryBlock& programState);
+
+    /** Appends a node state which will be captured on the journal thread.
+        Only use this if the node can get state off the message thread */
+    void writeNodeState (const String& uuid, GraphNodePtr node);
+
+    /** Blocks until all pending records are written. Returns false if the
+        timeout expired first */
+    bool flush (int timeoutMs = -1);
+
+    /** Stops writing and deletes the journal file */
+    void discard();
+
+    /** Returns the number of records waiting to be written */
+    int getNumPending() const;
+
+private:
+    struct Record;
+    TimeSliceThread thread { "SessionJournal" };
+    CriticalSection lock;
+    OwnedArray<Record> pending, finished;
+    std::unique_ptr<FileOutputStream> stream;
+    File file;
+    String sessionPath;
+    bool active = false;
+    bool startNewFile = false;
+    std::map<String, int64> lastStateHashes;
+
+    int useTimeSlice() override;
+    void handleAsyncUpdate() override;
+    void enqueue (Record*);
+    bool openStream();
+    void closeStream();
+    bool encode (Record&);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionJournal)
+};
+
+}
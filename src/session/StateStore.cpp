@@ -0,0 +1,420 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/Node.h"
+#include "session/StateStore.h"
+
+namespace Element {
+
+namespace StateStoreTags
+{
+    const Identifier blob       = "blob";
+    const Identifier hash       = "hash";
+    const Identifier index      = "index";
+    const Identifier refs       = "refs";
+    const Identifier stateFormat = "stateFormat";
+    const Identifier stateRef   = "stateRef";
+    const Identifier programStateRef = "programStateRef";
+
+    /** pairs of (inline property, reference property) */
+    static const Identifier* const stateProperties[][2] = {
+        { &Tags::state,         &stateRef },
+        { &Tags::programState,  &programStateRef }
+    };
+
+    /** Written to packed trees, which keep the first copy of each
+        state inline */
+    static const int packFormat = 2;
+}
+
+/** Visits every tree which can hold a state. Nodes and MIDI programs
+    both use the same property names */
+template<typename Fn>
+static void forEachStateTree (ValueTree tree, Fn&& fn)
+{
+    fn (tree);
+    for (int i = 0; i < tree.getNumChildren(); ++i)
+        forEachStateTree (tree.getChild (i), fn);
+}
+
+/** Returns true if a tree resolves its state references itself */
+static bool isPacked (const ValueTree& tree)
+{
+    if (tree.hasProperty (StateStoreTags::stateFormat))
+        return true;
+    for (int i = 0; i < tree.getNumChildren(); ++i)
+        if (isPacked (tree.getChild (i)))
+            return true;
+    return false;
+}
+
+//=============================================================================
+
+StateStore::StateStore() : StateStore (getDefaultDirectory()) { }
+
+StateStore::StateStore (const File& dir)
+    : directory (dir),
+      indexFile (dir.getChildFile ("index"))
+{ }
+
+StateStore::~StateStore() { }
+
+File StateStore::getDefaultDirectory()
+{
+    return DataPath::applicationDataDir().getChildFile ("States");
+}
+
+String StateStore::hash (const String& encoded)
+{
+    return SHA256 (encoded.toRawUTF8(), encoded.getNumBytesAsUTF8()).toHexString();
+}
+
+File StateStore::getBlobFile (const String& hash) const
+{
+    return directory.getChildFile (hash).withFileExtension ("elstate");
+}
+
+//=============================================================================
+
+String StateStore::intern (const MemoryBlock& state)
+{
+    if (state.getSize() <= 0)
+        return {};
+    return internEncoded (state.toBase64Encoding());
+}
+
+String StateStore::internEncoded (const String& encoded)
+{
+    if (encoded.isEmpty())
+        return {};
+
+    const auto key = hash (encoded);
+    ScopedLock sl (lock);
+    auto iter = interned.find (key);
+    if (iter != interned.end())
+        return iter->second;
+    interned[key] = encoded;
+    return encoded;
+}
+
+void StateStore::purgeUnused()
+{
+    ScopedLock sl (lock);
+    for (auto iter = interned.begin(); iter != interned.end();)
+    {
+        // only the table holds it
+        if (iter->second.getReferenceCount() <= 1)
+            iter = interned.erase (iter);
+        else
+            ++iter;
+    }
+}
+
+int StateStore::getNumInterned() const
+{
+    ScopedLock sl (lock);
+    return static_cast<int> (interned.size());
+}
+
+//=============================================================================
+
+void StateStore::loadIndex() const
+{
+    if (indexLoaded)
+        return;
+    indexLoaded = true;
+    refs.clear();
+
+    FileInputStream in (indexFile);
+    if (! in.openedOk())
+        return;
+
+    const auto index = ValueTree::readFromStream (in);
+    for (int i = 0; i < index.getNumChildren(); ++i)
+    {
+        const auto blob = index.getChild (i);
+        const auto key  = blob.getProperty (StateStoreTags::hash).toString();
+        const int count = blob.getProperty (StateStoreTags::refs, 0);
+        if (key.isNotEmpty() && count > 0)
+            refs[key] = count;
+    }
+}
+
+void StateStore::saveIndex()
+{
+    ValueTree index (StateStoreTags::index);
+    for (const auto& item : refs)
+    {
+        ValueTree blob (StateStoreTags::blob);
+        blob.setProperty (StateStoreTags::hash, item.first, nullptr)
+            .setProperty (StateStoreTags::refs, item.second, nullptr);
+        index.appendChild (blob, nullptr);
+    }
+
+    directory.createDirectory();
+    TemporaryFile temp (indexFile);
+    if (auto out = std::unique_ptr<FileOutputStream> (temp.getFile().createOutputStream()))
+    {
+        index.writeToStream (*out);
+        out.reset();
+        temp.overwriteTargetFileWithTemporary();
+    }
+}
+
+String StateStore::retain (const MemoryBlock& state)
+{
+    if (state.getSize() <= 0)
+        return {};
+
+    const auto encoded = intern (state);
+    const auto key = hash (encoded);
+
+    ScopedLock sl (lock);
+    const auto file = getBlobFile (key);
+    if (! file.existsAsFile())
+    {
+        directory.createDirectory();
+        TemporaryFile temp (file);
+        if (! temp.getFile().replaceWithData (state.getData(), state.getSize()) ||
+            ! temp.overwriteTargetFileWithTemporary())
+        {
+            jassertfalse;
+            return {};
+        }
+    }
+
+    retain (key);
+    return key;
+}
+
+void StateStore::retain (const String& key)
+{
+    ScopedLock sl (lock);
+    loadIndex();
+    refs[key] = refs[key] + 1;
+    saveIndex();
+}
+
+void StateStore::release (const String& key)
+{
+    ScopedLock sl (lock);
+    loadIndex();
+    auto iter = refs.find (key);
+    if (iter == refs.end())
+        return;
+
+    if (--iter->second <= 0)
+    {
+        refs.erase (iter);
+        getBlobFile (key).deleteFile();
+    }
+
+    saveIndex();
+    purgeUnused();
+}
+
+int StateStore::getReferenceCount (const String& key) const
+{
+    ScopedLock sl (lock);
+    loadIndex();
+    auto iter = refs.find (key);
+    return iter != refs.end() ? iter->second : 0;
+}
+
+bool StateStore::contains (const String& key) const
+{
+    return key.isNotEmpty() && getBlobFile (key).existsAsFile();
+}
+
+String StateStore::readEncoded (const String& key)
+{
+    {
+        ScopedLock sl (lock);
+        auto iter = interned.find (key);
+        if (iter != interned.end())
+            return iter->second;
+    }
+
+    MemoryBlock state;
+    if (! contains (key) || ! getBlobFile (key).loadFileAsData (state))
+        return {};
+    return intern (state);
+}
+
+//=============================================================================
+
+void StateStore::externalize (ValueTree tree)
+{
+    using namespace StateStoreTags;
+    forEachStateTree (tree, [this] (ValueTree node)
+    {
+        for (const auto& props : stateProperties)
+        {
+            const auto encoded = node.getProperty (*props[0]).toString().trim();
+            if (encoded.isEmpty())
+                continue;
+
+            MemoryBlock state;
+            state.fromBase64Encoding (encoded);
+            const auto key = retain (state);
+            if (key.isEmpty())
+                continue;
+
+            node.removeProperty (*props[0], nullptr);
+            node.setProperty (*props[1], key, nullptr);
+        }
+    });
+}
+
+void StateStore::internalize (ValueTree tree)
+{
+    using namespace StateStoreTags;
+    jassert ((int) tree.getProperty (stateFormat, 0) <= packFormat); // written by a newer version
+    tree.removeProperty (stateFormat, nullptr);
+
+    bool referenced = false;
+    forEachStateTree (tree, [&referenced] (ValueTree node)
+    {
+        for (const auto& props : stateProperties)
+            referenced = referenced || node.hasProperty (*props[1]);
+    });
+
+    if (! referenced)
+        return;
+
+    // only hash inline states when something refers to them
+    std::map<String, String> packed;
+    forEachStateTree (tree, [&packed] (ValueTree node)
+    {
+        for (const auto& props : stateProperties)
+        {
+            const auto encoded = node.getProperty (*props[0]).toString().trim();
+            if (encoded.isNotEmpty())
+                packed.insert ({ StateStore::hash (encoded), encoded });
+        }
+    });
+
+    forEachStateTree (tree, [this, &packed] (ValueTree node)
+    {
+        for (const auto& props : stateProperties)
+        {
+            const auto key = node.getProperty (*props[1]).toString();
+            if (key.isEmpty())
+                continue;
+
+            auto iter = packed.find (key);
+            const auto encoded = iter != packed.end() ? internEncoded (iter->second)
+                                                      : readEncoded (key);
+            jassert (encoded.isNotEmpty()); // missing state
+            node.setProperty (*props[0], encoded, nullptr);
+            node.removeProperty (*props[1], nullptr);
+        }
+    });
+}
+
+void StateStore::releaseReferences (const ValueTree& tree)
+{
+    using namespace StateStoreTags;
+    if (isPacked (tree))
+        return;
+
+    forEachStateTree (tree, [this] (ValueTree node)
+    {
+        for (const auto& props : stateProperties)
+        {
+            const auto key = node.getProperty (*props[1]).toString();
+            if (key.isNotEmpty())
+                release (key);
+        }
+    });
+}
+
+static ValueTree readExternalized (const File& file)
+{
+    FileInputStream in (file);
+    if (! in.openedOk())
+        return {};
+    if (auto xml = XmlDocument::parse (file))
+        return ValueTree::fromXml (*xml);
+    return ValueTree::readFromStream (in);
+}
+
+bool StateStore::writeExternalized (const ValueTree& node, const File& file)
+{
+    const auto previous = file.existsAsFile() ? readExternalized (file) : ValueTree();
+
+    ValueTree data = node.createCopy();
+    Node::sanitizeProperties (data, true);
+    externalize (data);
+
+    TemporaryFile temp (file);
+    bool ok = false;
+    if (auto xml = data.createXml())
+        ok = xml->writeToFile (temp.getFile(), String()) && temp.overwriteTargetFileWithTemporary();
+
+    if (ok && previous.isValid())
+        releaseReferences (previous);
+    else if (! ok)
+        releaseReferences (data);
+    return ok;
+}
+
+bool StateStore::deleteExternalized (const File& file)
+{
+    const auto data = readExternalized (file);
+    if (! file.deleteFile())
+        return false;
+    if (data.isValid())
+        releaseReferences (data);
+    return true;
+}
+
+void StateStore::pack (ValueTree tree)
+{
+    using namespace StateStoreTags;
+    std::map<String, bool> added;
+    bool referenced = false;
+
+    forEachStateTree (tree, [&added, &referenced] (ValueTree node)
+    {
+        for (const auto& props : stateProperties)
+        {
+            const auto encoded = node.getProperty (*props[0]).toString().trim();
+            if (encoded.isEmpty())
+                continue;
+
+            // the first copy stays where older versions look for it
+            const auto key = StateStore::hash (encoded);
+            if (! added[key])
+            {
+                added[key] = true;
+                continue;
+            }
+
+            node.removeProperty (*props[0], nullptr);
+            node.setProperty (*props[1], key, nullptr);
+            referenced = true;
+        }
+    });
+
+    if (referenced)
+        tree.setProperty (stateFormat, packFormat, nullptr);
+}
+
+}
@@ -0,0 +1,130 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include <map>
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Content addressed storage for plugin states.
+
+    States are keyed by the SHA-256 of their base64 encoding, which is the
+    form states already take in node models. In memory, identical
+    states resolve to the same base64 String so node models that share a
+    state also share its storage. On disk, global MIDI programs reference
+    blobs in the store directory which are refcounted and deleted when the
+    last reference goes away. Session, graph and preset files pack each
+    unique state once inside the file so they stay self contained.
+
+    Use it through SharedResourcePointer<StateStore>.
+ */
+class StateStore
+{
+public:
+    StateStore();
+    explicit StateStore (const File& directory);
+    ~StateStore();
+
+    /** Returns the default blob directory */
+    static File getDefaultDirectory();
+
+    /** Returns the content hash of an encoded state */
+    static String hash (const String& encoded);
+
+    //=========================================================================
+    /** Returns a shared base64 encoding of the state. Equal states return
+        the same String object */
+    String intern (const MemoryBlock& state);
+
+    /** Same as above but for already encoded data */
+    String internEncoded (const String& encoded);
+
+    /** Drops interned states that are no longer referenced anywhere else */
+    void purgeUnused();
+
+    /** Returns the number of interned states */
+    int getNumInterned() const;
+
+    //=========================================================================
+    /** Writes the state to disk if needed and adds a reference to it.
+        Returns the hash */
+    String retain (const MemoryBlock& state);
+
+    /** Adds a reference to an existing blob */
+    void retain (const String& hash);
+
+    /** Removes a reference, deleting the blob when none remain. Interned
+        states nothing else holds are dropped too */
+    void release (const String& hash);
+
+    /** Returns the number of references to a blob on disk */
+    int getReferenceCount (const String& hash) const;
+
+    /** Returns true if the blob exists on disk */
+    bool contains (const String& hash) const;
+
+    /** Returns the interned encoding of a blob on disk, or empty if it
+        doesn't exist */
+    String readEncoded (const String& hash);
+
+    //=========================================================================
+    /** Moves node states in a tree into the store, replacing them with
+        references. Used for global MIDI program files */
+    void externalize (ValueTree tree);
+
+    /** Resolves state references in a tree. Handles both references to
+        the store and states packed inside the tree itself */
+    void internalize (ValueTree tree);
+
+    /** Releases every reference held by a tree, e.g. before deleting the
+        file it was read from. Packed trees hold none */
+    void releaseReferences (const ValueTree& tree);
+
+    /** Writes a node with its states externalized. Any references held
+        by the file being replaced are released */
+    bool writeExternalized (const ValueTree& node, const File& file);
+
+    /** Releases the references held by a file and deletes it */
+    bool deleteExternalized (const File& file);
+
+    /** Stores each unique state in the tree only once. The first node
+        using a state keeps it inline and later ones reference it, so
+        files without shared states read the same as before. The tree is
+        marked with the format version when anything was referenced.
+        Used for session, graph and preset files */
+    static void pack (ValueTree tree);
+
+private:
+    File directory;
+    File indexFile;
+    CriticalSection lock;
+    std::map<String, String> interned;
+    mutable std::map<String, int> refs;
+    mutable bool indexLoaded = false;
+
+    File getBlobFile (const String& hash) const;
+    void loadIndex() const;
+    void saveIndex();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StateStore)
+};
+
+}
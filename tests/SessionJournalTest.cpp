@@ -0,0 +1,123 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SessionJournal.h"
+
+namespace Element {
+
+class SessionJournalTest : public UnitTestBase
+{
+public:
+    SessionJournalTest() : UnitTestBase ("Session Journal", "sessionSave", "journal") { }
+
+    void runTest() override
+    {
+        testRecover();
+        testTornRecord();
+    }
+
+private:
+    File journalFile;
+
+    ValueTree createSessionData (Node& node)
+    {
+        ValueTree data (Tags::session);
+        ValueTree graphs (Tags::graphs);
+        auto graph = Node::createGraph ("Journal");
+        node = Node (Tags::plugin);
+        graph.getNodesValueTree().appendChild (node.getValueTree(), nullptr);
+        graphs.appendChild (graph.getValueTree(), nullptr);
+        data.appendChild (graphs, nullptr);
+        return data;
+    }
+
+    void testRecover()
+    {
+        beginTest ("recover node states");
+        journalFile = File::getSpecialLocation (File::tempDirectory).getChildFile ("ElementTest.elj");
+        Node node;
+        const auto data = createSessionData (node);
+
+        SessionJournal journal;
+        journal.start (journalFile, File(), data);
+
+        MemoryBlock state ("first", 5), programState;
+        journal.writeNodeState (node.getUuidString(), state, programState);
+        state = MemoryBlock ("second", 6);
+        journal.writeNodeState (node.getUuidString(), state, programState);
+        expect (journal.flush (5000));
+        expect (SessionJournal::canRecover (journalFile));
+
+        File sessionFile;
+        const auto recovered = SessionJournal::recover (journalFile, sessionFile);
+        expect (recovered.hasType (Tags::session));
+        expect (sessionFile == File());
+
+        const Node graph (recovered.getChildWithName (Tags::graphs).getChild (0), false);
+        const auto restored = graph.getNodeByUuid (node.getUuid());
+        expect (restored.isValid());
+
+        MemoryBlock block;
+        block.fromBase64Encoding (restored.getProperty (Tags::state).toString());
+        expect (block == MemoryBlock ("second", 6));
+
+        journal.discard();
+        expect (! journalFile.existsAsFile());
+    }
+
+    void testTornRecord()
+    {
+        beginTest ("ignores torn records");
+        Node node;
+        const auto data = createSessionData (node);
+
+        SessionJournal journal;
+        journal.start (journalFile, File(), data);
+        MemoryBlock state ("intact", 6), programState;
+        journal.writeNodeState (node.getUuidString(), state, programState);
+        state = MemoryBlock ("torn record data", 16);
+        journal.writeNodeState (node.getUuidString(), state, programState);
+        expect (journal.flush (5000));
+
+        // simulate a crash in the middle of the last record
+        const auto copy = journalFile.getSiblingFile ("ElementTestCopy.elj");
+        expect (journalFile.copyFileTo (copy));
+        {
+            FileOutputStream out (copy);
+            expect (out.openedOk());
+            out.setPosition (copy.getSize() - 8);
+            out.truncate();
+        }
+
+        File sessionFile;
+        const auto recovered = SessionJournal::recover (copy, sessionFile);
+        const Node graph (recovered.getChildWithName (Tags::graphs).getChild (0), false);
+        const auto restored = graph.getNodeByUuid (node.getUuid());
+        MemoryBlock block;
+        block.fromBase64Encoding (restored.getProperty (Tags::state).toString());
+        expect (block == MemoryBlock ("intact", 6));
+
+        copy.deleteFile();
+        journal.discard();
+    }
+};
+
+static SessionJournalTest sSessionJournalTest;
+
+}
@@ -0,0 +1,147 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/StateStore.h"
+
+namespace Element {
+
+class StateStoreTest : public UnitTestBase
+{
+public:
+    StateStoreTest() : UnitTestBase ("State Store", "sessionSave", "stateStore") { }
+
+    void initialise() override
+    {
+        directory = File::getSpecialLocation (File::tempDirectory)
+            .getChildFile ("ElementStateStoreTest");
+        directory.deleteRecursively();
+    }
+
+    void shutdown() override
+    {
+        directory.deleteRecursively();
+    }
+
+    void runTest() override
+    {
+        testIntern();
+        testRefcount();
+        testPack();
+        testPackedReferences();
+    }
+
+private:
+    File directory;
+
+    void testIntern()
+    {
+        beginTest ("intern");
+        StateStore store (directory);
+        const MemoryBlock state ("plugin state", 12);
+        const auto a = store.intern (state);
+        const auto b = store.intern (MemoryBlock (state));
+        expect (a == state.toBase64Encoding());
+        expect (a.getCharPointer() == b.getCharPointer());
+        expectEquals (store.getNumInterned(), 1);
+    }
+
+    void testRefcount()
+    {
+        beginTest ("refcount");
+        StateStore store (directory);
+        const MemoryBlock state ("preset state", 12);
+        const auto key = store.retain (state);
+        expect (store.retain (state) == key);
+        expect (store.contains (key));
+        expectEquals (store.getReferenceCount (key), 2);
+
+        // the index survives between instances
+        StateStore other (directory);
+        expectEquals (other.getReferenceCount (key), 2);
+
+        store.release (key);
+        expect (store.contains (key));
+        store.release (key);
+        expect (! store.contains (key));
+        expectEquals (store.getReferenceCount (key), 0);
+
+        // nothing else holds the state once its last reference is gone
+        expectEquals (store.getNumInterned(), 0);
+    }
+
+    void testPack()
+    {
+        beginTest ("pack and internalize");
+        const String encoded = MemoryBlock ("shared", 6).toBase64Encoding();
+        auto graph = Node::createGraph ("Packed");
+        for (int i = 0; i < 3; ++i)
+        {
+            Node node (Tags::plugin);
+            node.getValueTree().setProperty (Tags::state, encoded, nullptr);
+            graph.getNodesValueTree().appendChild (node.getValueTree(), nullptr);
+        }
+
+        auto data = graph.getValueTree().createCopy();
+        StateStore::pack (data);
+        expect (data.hasProperty ("stateFormat"));
+        expect (! data.getChildWithName ("blobs").isValid());
+        expect (data.getChildWithName (Tags::nodes).getChild(0).getProperty (Tags::state).toString() == encoded);
+        expect (! data.getChildWithName (Tags::nodes).getChild(1).hasProperty (Tags::state));
+
+        // a unique state is written the same as before
+        auto single = Node (Tags::plugin).getValueTree();
+        single.setProperty (Tags::state, encoded, nullptr);
+        StateStore::pack (single);
+        expect (! single.hasProperty ("stateFormat"));
+        expect (single.getProperty (Tags::state).toString() == encoded);
+
+        StateStore store (directory);
+        store.internalize (data);
+        expect (! data.hasProperty ("stateFormat"));
+        const auto nodes = data.getChildWithName (Tags::nodes);
+        for (int i = 0; i < nodes.getNumChildren(); ++i)
+            expect (nodes.getChild(i).getProperty (Tags::state).toString() == encoded);
+    }
+
+    void testPackedReferences()
+    {
+        beginTest ("packed files hold no references");
+        StateStore store (directory);
+        const MemoryBlock state ("kept", 4);
+        const auto key = store.retain (state);
+
+        auto graph = Node::createGraph ("Packed");
+        for (int i = 0; i < 2; ++i)
+        {
+            Node node (Tags::plugin);
+            node.getValueTree().setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+            graph.getNodesValueTree().appendChild (node.getValueTree(), nullptr);
+        }
+
+        auto data = graph.getValueTree().createCopy();
+        StateStore::pack (data);
+        store.releaseReferences (data);
+        expectEquals (store.getReferenceCount (key), 1);
+        store.release (key);
+    }
+};
+
+static StateStoreTest sStateStoreTest;
+
+}
@@ -0,0 +1,148 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/AudioMixerProcessor.h"
+
+namespace Element {
+
+class AudioMixerBenchmark : public UnitTestBase
+{
+public:
+    AudioMixerBenchmark() : UnitTestBase ("Audio Mixer Benchmark", "benchmarks", "audioMixer") { }
+
+    void runTest() override
+    {
+        testRouting();
+        testChangeMessages();
+        benchmark (16);
+        benchmark (64);
+    }
+
+private:
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+    const int numBlocks = 1000;
+
+    void process (AudioMixerProcessor& mixer, AudioBuffer<float>& buffer, int numTrackChannels)
+    {
+        // inputs and outputs share channels, refill the tracks each block
+        for (int c = 0; c < buffer.getNumChannels(); ++c)
+            buffer.clear (c, 0, blockSize);
+        for (int c = 0; c < numTrackChannels; ++c)
+            FloatVectorOperations::fill (buffer.getWritePointer (c), 0.5f, blockSize);
+        MidiBuffer midi;
+        mixer.processBlock (buffer, midi);
+    }
+
+    void testRouting()
+    {
+        beginTest ("pan, mute and sends");
+        AudioMixerProcessor mixer (2, sampleRate, blockSize);
+        mixer.setNumSends (1);
+        expectEquals (mixer.getNumSends(), 1);
+        mixer.prepareToPlay (sampleRate, blockSize);
+
+        mixer.getMonitor (0)->requestPan (1.f);
+        mixer.getMonitor (0)->requestSendLevel (0, 1.f);
+        mixer.getMonitor (1)->requestMute (true);
+        mixer.setSendPreFader (0, true);
+
+        AudioBuffer<float> buffer (jmax (mixer.getTotalNumInputChannels(), mixer.getTotalNumOutputChannels()), blockSize);
+        for (int b = 0; b < 2; ++b)
+            process (mixer, buffer, mixer.getTotalNumInputChannels());
+
+        // track 0 hard right, track 1 muted
+        expectWithinAbsoluteError (buffer.getSample (0, blockSize - 1), 0.f, 1.0e-6f);
+        expectWithinAbsoluteError (buffer.getSample (1, blockSize - 1), 0.5f, 1.0e-6f);
+
+        // pre fader send ignores the pan
+        expectWithinAbsoluteError (buffer.getSample (2, blockSize - 1), 0.5f, 1.0e-6f);
+        expectWithinAbsoluteError (buffer.getSample (3, blockSize - 1), 0.5f, 1.0e-6f);
+
+        // a VCA group scales its members
+        mixer.getMonitor (0)->requestGroup (2);
+        mixer.getGroupMonitor (2)->requestGain (0.5f);
+        for (int b = 0; b < 2; ++b)
+            process (mixer, buffer, mixer.getTotalNumInputChannels());
+        expectWithinAbsoluteError (buffer.getSample (1, blockSize - 1), 0.25f, 1.0e-6f);
+        expect (mixer.getChangeCount() != 0);
+    }
+
+    struct ChangeCounter : public ChangeListener
+    {
+        void changeListenerCallback (ChangeBroadcaster*) override { ++count; }
+        int count = 0;
+    };
+
+    void testChangeMessages()
+    {
+        beginTest ("change messages");
+        AudioMixerProcessor mixer (2, sampleRate, blockSize);
+        mixer.prepareToPlay (sampleRate, blockSize);
+        ChangeCounter counter;
+        mixer.addChangeListener (&counter);
+        AudioBuffer<float> buffer (jmax (mixer.getTotalNumInputChannels(), mixer.getTotalNumOutputChannels()), blockSize);
+
+        // levels settle, then a steady signal sends nothing more
+        for (int b = 0; b < 8; ++b)
+            process (mixer, buffer, mixer.getTotalNumInputChannels());
+        MessageManager::getInstance()->runDispatchLoopUntil (20);
+        expectGreaterThan (counter.count, 0);
+
+        const int settled = counter.count;
+        for (int b = 0; b < 8; ++b)
+            process (mixer, buffer, mixer.getTotalNumInputChannels());
+        MessageManager::getInstance()->runDispatchLoopUntil (20);
+        expectEquals (counter.count, settled);
+
+        // a request goes out once the interval passed
+        mixer.getMonitor (0)->requestMute (true);
+        for (int b = 0; b < 8; ++b)
+            process (mixer, buffer, mixer.getTotalNumInputChannels());
+        MessageManager::getInstance()->runDispatchLoopUntil (20);
+        expectGreaterThan (counter.count, settled);
+
+        mixer.removeChangeListener (&counter);
+    }
+
+    void benchmark (int numTracks)
+    {
+        const String name = String (numTracks) + " stereo tracks";
+        beginTest (name);
+        AudioMixerProcessor mixer (numTracks, sampleRate, blockSize);
+        mixer.prepareToPlay (sampleRate, blockSize);
+        for (int i = 0; i < numTracks; ++i)
+            mixer.getMonitor (i)->requestPan ((float) (i % 3) - 1.f);
+
+        AudioBuffer<float> buffer (mixer.getTotalNumInputChannels(), blockSize);
+        const auto start = Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+            process (mixer, buffer, buffer.getNumChannels());
+        const auto ms = 1000.0 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+        String message = name;
+        message << ": " << String (ms / (double) numBlocks * 1000.0, 2) << " us per block";
+        logMessage (message);
+        expect (buffer.getMagnitude (0, 0, blockSize) <= (float) numTracks);
+    }
+};
+
+static AudioMixerBenchmark sAudioMixerBenchmark;
+
+}
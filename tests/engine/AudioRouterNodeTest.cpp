@@ -0,0 +1,142 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/AudioRouterNode.h"
+
+namespace Element {
+
+class AudioRouterNodeTest : public UnitTestBase
+{
+public:
+    AudioRouterNodeTest() : UnitTestBase ("Audio Router Node", "nodes", "audioRouter") { }
+
+    void runTest() override
+    {
+        testGains();
+        testState();
+        testRender();
+        testRetarget();
+    }
+
+private:
+    void testGains()
+    {
+        beginTest ("gains");
+        GraphNodePtr node = new AudioRouterNode (4, 4);
+        auto* router = dynamic_cast<AudioRouterNode*> (node.get());
+        expectEquals (router->getGain (0, 0), 1.0f);
+        router->setGain (0, 1, 0.5f);
+        expectEquals (router->getGain (0, 1), 0.5f);
+        expect (router->getMatrixState().connected (0, 1));
+        router->setGain (0, 1, 0.0f);
+        expect (! router->getMatrixState().connected (0, 1));
+    }
+
+    void testState()
+    {
+        beginTest ("state");
+        GraphNodePtr node = new AudioRouterNode (4, 4);
+        auto* router = dynamic_cast<AudioRouterNode*> (node.get());
+        router->setSize (64, 64);
+        router->setGain (63, 10, 0.25f);
+
+        MemoryBlock block;
+        router->getState (block);
+
+        GraphNodePtr other = new AudioRouterNode (4, 4);
+        auto* restored = dynamic_cast<AudioRouterNode*> (other.get());
+        restored->setState (block.getData(), (int) block.getSize());
+        expectEquals (restored->getNumSources(), 64);
+        expectEquals (restored->getNumDestinations(), 64);
+        expectEquals (restored->getGain (63, 10), 0.25f);
+        expectEquals (restored->getGain (0, 0), 1.0f);
+    }
+
+    void testRender()
+    {
+        beginTest ("render");
+        GraphNodePtr node = new AudioRouterNode (4, 4);
+        auto* router = dynamic_cast<AudioRouterNode*> (node.get());
+        router->prepareToRender (44100.0, 512);
+        router->setFadeLength (0.001);
+
+        MatrixState matrix (4, 4);
+        matrix.set (0, 1, true);
+        matrix.set (2, 1, true);
+        router->setMatrixState (matrix);
+        router->setGain (2, 1, 0.5f);
+
+        AudioSampleBuffer audio (4, 512);
+        MidiBuffer midiBuffer;
+        MidiBuffer* buffers[] = { &midiBuffer };
+
+        // first block fades in, the second is steady
+        for (int i = 0; i < 2; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+                FloatVectorOperations::fill (audio.getWritePointer (c), (float) (c + 1), 512);
+            MidiPipe pipe (buffers, 1);
+            router->render (audio, pipe);
+        }
+
+        expectEquals (audio.getSample (1, 100), 1.0f + 3.0f * 0.5f);
+        expectEquals (audio.getSample (0, 100), 0.0f);
+        expectEquals (audio.getSample (3, 100), 0.0f);
+        router->releaseResources();
+    }
+
+    void testRetarget()
+    {
+        beginTest ("retarget mid fade");
+        GraphNodePtr node = new AudioRouterNode (4, 4);
+        auto* router = dynamic_cast<AudioRouterNode*> (node.get());
+        router->prepareToRender (44100.0, 100);
+        router->setFadeLength (0.01);
+
+        AudioSampleBuffer audio (4, 100);
+        MidiBuffer midiBuffer;
+        MidiBuffer* buffers[] = { &midiBuffer };
+        auto renderBlock = [&]()
+        {
+            for (int c = 0; c < 4; ++c)
+                FloatVectorOperations::fill (audio.getWritePointer (c), 1.0f, 100);
+            MidiPipe pipe (buffers, 1);
+            router->render (audio, pipe);
+        };
+
+        for (int i = 0; i < 10; ++i)
+            renderBlock();
+        expectEquals (audio.getSample (0, 99), 1.0f);
+
+        // turn off, then back on before the fade out is done
+        router->setGain (0, 0, 0.0f);
+        renderBlock();
+        const float heard = audio.getSample (0, 99);
+        expect (heard > 0.0f && heard < 1.0f);
+
+        router->setGain (0, 0, 1.0f);
+        renderBlock();
+        expectWithinAbsoluteError (audio.getSample (0, 0), heard, 0.01f);
+        expect (audio.getSample (0, 99) > audio.getSample (0, 0));
+    }
+};
+
+static AudioRouterNodeTest sAudioRouterNodeTest;
+
+}
@@ -0,0 +1,123 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/BandSplitter.h"
+#include "engine/nodes/FreqSplitterProcessor.h"
+
+namespace Element {
+
+class BandSplitterTest : public UnitTestBase
+{
+public:
+    BandSplitterTest() : UnitTestBase ("Band Splitter", "engine", "bandSplitter") { }
+
+    void runTest() override
+    {
+        testFlatSum (3);
+        testFlatSum (8);
+        testBandCount();
+        benchmark();
+    }
+
+private:
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+
+    /** Runs a sine through the splitter and returns the settled peak of the
+        summed bands */
+    float getSummedPeak (BandSplitter& splitter, double freq)
+    {
+        const int numBands = splitter.getNumBands();
+        AudioBuffer<float> buffer (2 * numBands, blockSize);
+        splitter.reset();
+
+        float peak = 0.0f;
+        for (int offset = 0; offset < (int) sampleRate / 2; offset += blockSize)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < blockSize; ++i)
+                    buffer.setSample (ch, i, (float) std::sin (
+                        MathConstants<double>::twoPi * freq * (double) (offset + i) / sampleRate));
+
+            splitter.process (buffer.getArrayOfReadPointers(), buffer.getArrayOfWritePointers(), blockSize);
+            if (offset < (int) sampleRate / 4)
+                continue;
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                float sum = 0.0f;
+                for (int band = 0; band < numBands; ++band)
+                    sum += buffer.getSample (band * 2, i);
+                peak = jmax (peak, std::abs (sum));
+            }
+        }
+
+        return peak;
+    }
+
+    void testFlatSum (int numBands)
+    {
+        beginTest (String (numBands) + " bands sum flat");
+        const float crossovers[] = { 120.0f, 500.0f, 1200.0f, 3000.0f, 6000.0f, 10000.0f, 15000.0f };
+        BandSplitter splitter;
+        splitter.prepare (numBands, 2);
+        splitter.setCrossovers (sampleRate, crossovers, false);
+
+        for (const double freq : { 50.0, 120.0, 700.0, 2500.0, 9000.0, 16000.0 })
+            expectWithinAbsoluteError (getSummedPeak (splitter, freq), 1.0f, 0.01f);
+    }
+
+    void testBandCount()
+    {
+        beginTest ("band count sets outputs");
+        FreqSplitterProcessor proc;
+        expectEquals (proc.getTotalNumOutputChannels(), 6);
+        proc.setNumBands (5);
+        expectEquals (proc.getTotalNumOutputChannels(), 10);
+        proc.setNumBands (20);
+        expectEquals (proc.getTotalNumOutputChannels(), 2 * BandSplitter::maxBands);
+    }
+
+    void benchmark()
+    {
+        beginTest ("8 bands stereo");
+        const float crossovers[] = { 120.0f, 500.0f, 1200.0f, 3000.0f, 6000.0f, 10000.0f, 15000.0f };
+        AudioBuffer<float> buffer (16, blockSize);
+        Random rng (1234);
+        for (int i = 0; i < blockSize; ++i)
+            buffer.setSample (0, i, rng.nextFloat() * 2.0f - 1.0f);
+        buffer.copyFrom (1, 0, buffer, 0, 0, blockSize);
+
+        BandSplitter splitter;
+        splitter.prepare (8, 2);
+        const auto start = Time::getHighResolutionTicks();
+        for (int b = 0; b < 1000; ++b)
+        {
+            splitter.setCrossovers (sampleRate, crossovers, b % 100 == 0);
+            splitter.process (buffer.getArrayOfReadPointers(), buffer.getArrayOfWritePointers(), blockSize);
+        }
+        const auto ms = 1000.0 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        logMessage (String ("1000 blocks: ") + String (ms, 2) + " ms");
+        expect (buffer.getMagnitude (0, blockSize) < 100.0f);
+    }
+};
+
+static BandSplitterTest sBandSplitterTest;
+
+}
@@ -0,0 +1,180 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/BiquadCascade.h"
+#include "engine/nodes/EQFilterProcessor.h"
+
+namespace Element {
+
+/** The filter as it was: one channel at a time, coefficients recalculated
+    every sample while smoothing */
+struct ScalarBiquad
+{
+    BiquadCoefficients c;
+    float z1 = 0.0f, z2 = 0.0f;
+
+    inline float process (float x)
+    {
+        const float y = x * c.b0 + z1;
+        z1 = x * c.b1 - y * c.a1 + z2;
+        z2 = x * c.b2 - y * c.a2;
+        return y;
+    }
+};
+
+class BiquadBenchmark : public UnitTestBase
+{
+public:
+    BiquadBenchmark() : UnitTestBase ("Biquad Benchmark", "benchmarks", "biquad") { }
+
+    void runTest() override
+    {
+        testMatchesScalar();
+        benchmarkStatic();
+        benchmarkSmoothing();
+    }
+
+private:
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+    const int numBlocks = 1000;
+
+    void fillNoise (AudioBuffer<float>& buffer)
+    {
+        Random rng (1234);
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample (ch, i, rng.nextFloat() * 2.0f - 1.0f);
+    }
+
+    void testMatchesScalar()
+    {
+        beginTest ("cascade matches scalar");
+        AudioBuffer<float> buffer (2, blockSize);
+        fillNoise (buffer);
+        AudioBuffer<float> expected (buffer);
+
+        const auto coefs = BiquadCoefficients::lowPass ((float) sampleRate, 1000.0f, 0.7071f);
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            ScalarBiquad a, b;
+            a.c = b.c = coefs;
+            auto* data = expected.getWritePointer (ch);
+            for (int i = 0; i < blockSize; ++i)
+                data[i] = b.process (a.process (data[i]));
+        }
+
+        BiquadCascade cascade (2);
+        cascade.setCoefficients (coefs, false);
+        cascade.process (buffer.getArrayOfWritePointers(), 2, blockSize);
+
+        float maxError = 0.0f;
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                maxError = jmax (maxError, std::abs (buffer.getSample (ch, i) - expected.getSample (ch, i)));
+        expectLessThan (maxError, 1.0e-5f);
+    }
+
+    void report (const String& name, int64 scalarTicks, int64 cascadeTicks)
+    {
+        const auto scalarMs  = 1000.0 * Time::highResolutionTicksToSeconds (scalarTicks);
+        const auto cascadeMs = 1000.0 * Time::highResolutionTicksToSeconds (cascadeTicks);
+        String message = name;
+        message << ": scalar " << String (scalarMs, 2) << " ms, cascade "
+                << String (cascadeMs, 2) << " ms, speedup "
+                << String (scalarMs / jmax (0.001, cascadeMs), 2) << "x";
+        logMessage (message);
+    }
+
+    void benchmarkStatic()
+    {
+        beginTest ("stereo static coefficients");
+        AudioBuffer<float> buffer (2, blockSize);
+        fillNoise (buffer);
+        const auto coefs = BiquadCoefficients::bell ((float) sampleRate, 1000.0f, 0.7071f, 2.0f);
+
+        ScalarBiquad scalar[2];
+        scalar[0].c = scalar[1].c = coefs;
+        auto start = Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < blockSize; ++i)
+                    buffer.getWritePointer (ch)[i] = scalar[ch].process (buffer.getReadPointer (ch)[i]);
+        const auto scalarTicks = Time::getHighResolutionTicks() - start;
+
+        fillNoise (buffer);
+        BiquadCascade cascade;
+        cascade.setCoefficients (coefs, false);
+        start = Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+            cascade.process (buffer.getArrayOfWritePointers(), 2, blockSize);
+        const auto cascadeTicks = Time::getHighResolutionTicks() - start;
+
+        report ("static", scalarTicks, cascadeTicks);
+        expect (buffer.getMagnitude (0, blockSize) < 100.0f);
+    }
+
+    void benchmarkSmoothing()
+    {
+        beginTest ("stereo smoothing frequency");
+        AudioBuffer<float> buffer (2, blockSize);
+        fillNoise (buffer);
+
+        // the old EQFilter: each channel smoothed and recalculated per sample
+        SmoothedValue<float, ValueSmoothingTypes::Linear> freq[2];
+        ScalarBiquad scalar[2];
+        for (auto& f : freq)
+            f.reset (500);
+        auto start = Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                freq[ch].setTargetValue (b % 2 == 0 ? 2000.0f : 500.0f);
+                auto* data = buffer.getWritePointer (ch);
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    scalar[ch].c = BiquadCoefficients::bell ((float) sampleRate, freq[ch].getNextValue(), 0.7071f, 2.0f);
+                    data[i] = scalar[ch].process (data[i]);
+                }
+            }
+        }
+        const auto scalarTicks = Time::getHighResolutionTicks() - start;
+
+        fillNoise (buffer);
+        EQFilter filter;
+        filter.setQ (0.7071f);
+        filter.setGain (2.0f);
+        filter.reset (sampleRate);
+        start = Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            filter.setFrequency (b % 2 == 0 ? 2000.0f : 500.0f);
+            filter.processBlock (buffer.getArrayOfWritePointers(), 2, blockSize);
+        }
+        const auto cascadeTicks = Time::getHighResolutionTicks() - start;
+
+        report ("smoothing", scalarTicks, cascadeTicks);
+        expect (buffer.getMagnitude (0, blockSize) < 100.0f);
+    }
+};
+
+static BiquadBenchmark sBiquadBenchmark;
+
+}
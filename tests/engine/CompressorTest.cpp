@@ -0,0 +1,164 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/CompressorProcessor.h"
+
+namespace Element {
+
+class CompressorTest : public UnitTestBase
+{
+public:
+    CompressorTest() : UnitTestBase ("Compressor", "engine", "compressor") { }
+
+    void runTest() override
+    {
+        testBlockMatchesReference();
+        testLookahead();
+        testSidechain();
+    }
+
+private:
+    enum Params { Threshold = 0, Ratio, Knee, Attack, Release, Makeup, Lookahead, Detector };
+
+    static void setParam (AudioProcessor& proc, int index, float value)
+    {
+        if (auto* param = dynamic_cast<AudioParameterFloat*> (proc.getParameters()[index]))
+            *param = value;
+        else if (auto* choice = dynamic_cast<AudioParameterChoice*> (proc.getParameters()[index]))
+            *choice = roundToInt (value);
+    }
+
+    static void setup (CompressorProcessor& comp)
+    {
+        setParam (comp, Threshold, -20.f);
+        setParam (comp, Ratio,     4.f);
+        setParam (comp, Knee,      6.f);
+        setParam (comp, Attack,    2.f);
+        setParam (comp, Release,   80.f);
+        setParam (comp, Makeup,    0.f);
+    }
+
+    void testBlockMatchesReference()
+    {
+        beginTest ("block processing matches per sample");
+        const double sampleRate = 48000.0;
+        const int blockSize = 512;
+        CompressorProcessor comp (1);
+        setup (comp);
+        comp.prepareToPlay (sampleRate, blockSize);
+
+        LevelDetector detector;
+        GainComputer gainComputer;
+        detector.setAttackMs (2.f);
+        detector.setReleaseMs (80.f);
+        detector.reset ((float) sampleRate);
+        gainComputer.setThreshold (-20.f);
+        gainComputer.setRatio (4.f);
+        gainComputer.setKnee (6.f);
+        gainComputer.reset();
+
+        Random random (1234);
+        AudioSampleBuffer audio (1, blockSize);
+        MidiBuffer midi;
+        float maxError = 0.f;
+        for (int block = 0; block < 8; ++block)
+        {
+            // loud and quiet blocks so both attack and release are covered
+            const float amp = (block % 2 == 0) ? 0.9f : 0.01f;
+            HeapBlock<float> input (blockSize);
+            for (int i = 0; i < blockSize; ++i)
+                input[i] = amp * (random.nextFloat() * 2.f - 1.f);
+            audio.copyFrom (0, 0, input.getData(), blockSize);
+            comp.processBlock (audio, midi);
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const auto gain = gainComputer.process (detector.process (input[i]));
+                maxError = jmax (maxError, std::abs (audio.getSample (0, i) - input[i] * gain));
+            }
+        }
+
+        expect (maxError < 1.0e-5f, String ("max error ") + String (maxError));
+        comp.releaseResources();
+    }
+
+    void testLookahead()
+    {
+        beginTest ("lookahead delays the signal and reports latency");
+        const double sampleRate = 48000.0;
+        CompressorProcessor comp (1);
+        setup (comp);
+        setParam (comp, Ratio, 1.f);
+        setParam (comp, Lookahead, 5.f);
+        comp.prepareToPlay (sampleRate, 512);
+        const int delay = roundToInt (sampleRate * 0.005);
+        expectEquals (comp.getLatencySamples(), delay);
+
+        AudioSampleBuffer audio (1, 512);
+        MidiBuffer midi;
+        audio.clear();
+        audio.setSample (0, 0, 0.5f);
+        comp.processBlock (audio, midi);
+        expectEquals (audio.getSample (0, 0), 0.f);
+        expectWithinAbsoluteError (audio.getSample (0, delay), 0.5f, 1.0e-6f);
+        expectEquals (audio.getMagnitude (0, 0, delay), 0.f);
+        comp.releaseResources();
+    }
+
+    void testSidechain()
+    {
+        beginTest ("sidechain drives the detector");
+        CompressorProcessor comp (1);
+        comp.enableAllBuses();
+        setup (comp);
+        comp.prepareToPlay (48000.0, 512);
+
+        AudioSampleBuffer audio (comp.getTotalNumInputChannels(), 512);
+        MidiBuffer midi;
+        expectEquals (audio.getNumChannels(), 2);
+
+        auto render = [&]() -> float {
+            for (int block = 0; block < 4; ++block)
+            {
+                audio.clear();
+                for (int i = 0; i < audio.getNumSamples(); ++i)
+                {
+                    audio.setSample (0, i, 0.05f);  // main, below threshold
+                    audio.setSample (1, i, 1.0f);   // sidechain, well above
+                }
+                comp.processBlock (audio, midi);
+            }
+            return audio.getSample (0, audio.getNumSamples() - 1);
+        };
+
+        setParam (comp, Detector, 0.f);
+        expectWithinAbsoluteError (render(), 0.05f, 1.0e-5f);
+        expectWithinAbsoluteError (comp.getGainReductionDB(), 0.f, 1.0e-3f);
+
+        setParam (comp, Detector, 1.f);
+        expect (render() < 0.02f, "main should be reduced by the sidechain");
+        expect (comp.getGainReductionDB() < -10.f);
+        comp.releaseResources();
+    }
+};
+
+static CompressorTest sCompressorTest;
+
+}
@@ -0,0 +1,106 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/Convolver.h"
+
+namespace Element {
+
+/** Runs tail jobs on a thread, like the convolution node */
+struct TestTailScheduler : public Thread,
+                           public Convolver::Scheduler
+{
+    TestTailScheduler() : Thread ("TestTail") { startThread(); }
+    ~TestTailScheduler() { stopThread (1000); }
+
+    bool schedule (Convolver& c) override
+    {
+        job.store (&c);
+        notify();
+        return true;
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            if (auto* c = job.exchange (nullptr))
+                c->runTail();
+            wait (5);
+        }
+    }
+
+    std::atomic<Convolver*> job { nullptr };
+};
+
+class ConvolverTest : public UnitTestBase
+{
+public:
+    ConvolverTest() : UnitTestBase ("Convolver", "engine", "convolver") { }
+
+    void runTest() override
+    {
+        testImpulse (40, false);
+        testImpulse (1500, false);
+        testImpulse (5000, false);
+        testImpulse (5000, true);
+    }
+
+private:
+    void testImpulse (int length, bool threaded)
+    {
+        beginTest (String ("impulse ") + String (length) + (threaded ? " threaded" : ""));
+
+        Random rng (length);
+        HeapBlock<float> impulse ((size_t) length);
+        for (int i = 0; i < length; ++i)
+            impulse[i] = (rng.nextFloat() * 2.0f - 1.0f) * std::exp (-4.0f * (float) i / (float) length);
+
+        const int numSamples = 12000;
+        HeapBlock<float> input ((size_t) numSamples), output ((size_t) numSamples, true);
+        for (int i = 0; i < numSamples; ++i)
+            input[i] = rng.nextFloat() * 2.0f - 1.0f;
+
+        // the scheduler outlives the convolver, which waits for a pending tail
+        TestTailScheduler scheduler;
+        Convolver convolver (impulse, length);
+
+        // odd block sizes cross partition boundaries
+        for (int offset = 0; offset < numSamples;)
+        {
+            const int count = jmin (numSamples - offset, 1 + rng.nextInt (700));
+            convolver.process (input + offset, output + offset, count, threaded ? &scheduler : nullptr);
+            offset += count;
+        }
+
+        float maxError = 0.0f;
+        for (int n = 0; n < numSamples; n += 7)
+        {
+            double expected = 0.0;
+            for (int k = 0; k < length && k <= n; ++k)
+                expected += (double) impulse[k] * (double) input[n - k];
+            maxError = jmax (maxError, std::abs ((float) expected - output[n]));
+        }
+
+        expectLessThan (maxError, 1.0e-3f);
+    }
+};
+
+static ConvolverTest sConvolverTest;
+
+}
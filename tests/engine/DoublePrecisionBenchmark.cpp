@@ -0,0 +1,199 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+/** First order all pass in the precision it is called with. Deep chains of
+    these build up rounding error the way filter heavy mastering chains do */
+class AllPassStage : public BaseProcessor
+{
+public:
+    AllPassStage (float coefficient, bool doublePrecision)
+        : coef (coefficient), canProcessDouble (doublePrecision)
+    {
+        setPlayConfigDetails (2, 2, 48000.0, 512);
+    }
+
+    const String getName() const override                    { return "All Pass"; }
+    void prepareToPlay (double, int) override                 { zeromem (state, sizeof (state)); }
+    void releaseResources() override                          { }
+    void processBlock (AudioBuffer<float>& b, MidiBuffer&) override     { process (b); }
+    void processBlock (AudioBuffer<double>& b, MidiBuffer&) override    { process (b); }
+    bool supportsDoublePrecisionProcessing() const override  { return canProcessDouble; }
+
+    double getTailLengthSeconds() const override             { return 0.0; }
+    bool acceptsMidi() const override                        { return false; }
+    bool producesMidi() const override                       { return false; }
+    AudioProcessorEditor* createEditor() override            { return nullptr; }
+    bool hasEditor() const override                          { return false; }
+    int getNumPrograms() override                            { return 1; }
+    int getCurrentProgram() override                         { return 0; }
+    void setCurrentProgram (int) override                    { }
+    const String getProgramName (int) override               { return String(); }
+    void changeProgramName (int, const String&) override     { }
+    void getStateInformation (MemoryBlock&) override         { }
+    void setStateInformation (const void*, int) override     { }
+
+    void fillInPluginDescription (PluginDescription& desc) const override
+    {
+        desc.name = getName();
+        desc.fileOrIdentifier = "test.allpass";
+        desc.pluginFormatName = "Element";
+        desc.numInputChannels = desc.numOutputChannels = 2;
+    }
+
+    /** The same filter in long double, for reference */
+    static long double reference (long double x, long double a, long double* s)
+    {
+        const long double y = a * x + s[0] - a * s[1];
+        s[0] = x; s[1] = y;
+        return y;
+    }
+
+private:
+    const float coef;
+    const bool canProcessDouble;
+    double state [2][2];
+
+    template<typename FloatType>
+    void process (AudioBuffer<FloatType>& buffer)
+    {
+        const auto a = static_cast<FloatType> (coef);
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            auto x1 = static_cast<FloatType> (state[ch][0]);
+            auto y1 = static_cast<FloatType> (state[ch][1]);
+            auto* data = buffer.getWritePointer (ch);
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                const FloatType x = data[i];
+                const FloatType y = a * x + x1 - a * y1;
+                x1 = x; y1 = y;
+                data[i] = y;
+            }
+
+            state[ch][0] = x1;
+            state[ch][1] = y1;
+        }
+    }
+};
+
+class DoublePrecisionBenchmark : public UnitTestBase
+{
+public:
+    DoublePrecisionBenchmark() : UnitTestBase ("Double Precision Benchmark", "benchmarks", "doublePrecision") { }
+
+    void runTest() override
+    {
+        const auto floatError  = run ("32 bit graph", false, numStages);
+        const auto doubleError = run ("64 bit graph", true, numStages);
+        const auto mixedError  = run ("64 bit graph, half 32 bit nodes", true, numStages / 2);
+
+        beginTest ("64 bit accumulates less error");
+        expectLessThan (doubleError, floatError);
+        expectLessThan (doubleError, 1.0e-9);
+        expectLessThan (mixedError, floatError);
+    }
+
+private:
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+    const int numBlocks = 200;
+    const int numStages = 64;
+
+    static float getCoefficient (int stage) { return 0.9f - 0.025f * (float) (stage % 64); }
+
+    /** Renders noise through a chain of all passes and returns the largest
+        difference from a long double reference */
+    double run (const String& name, bool doublePrecision, int numDoubleStages)
+    {
+        beginTest (name);
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, sampleRate, blockSize);
+        if (doublePrecision)
+            graph.setProcessingPrecision (AudioProcessor::doublePrecision);
+
+        GraphNodePtr last = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        for (int i = 0; i < numStages; ++i)
+        {
+            GraphNodePtr stage = graph.addNode (new AllPassStage (getCoefficient (i), i < numDoubleStages));
+            last->connectAudioTo (stage);
+            last = stage;
+        }
+        GraphNodePtr output = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        last->connectAudioTo (output);
+        graph.prepareToPlay (sampleRate, blockSize);
+
+        Random rng (1234);
+        long double state [64][2] = {};
+        double maxError = 0.0;
+        int64 ticks = 0;
+        MidiBuffer midi;
+        AudioBuffer<float> floatBuffer (2, blockSize);
+        AudioBuffer<double> doubleBuffer (2, blockSize);
+        HeapBlock<long double> expected ((size_t) blockSize);
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const float x = rng.nextFloat() * 2.0f - 1.0f;
+                floatBuffer.setSample (0, i, x);
+                floatBuffer.setSample (1, i, x);
+                doubleBuffer.setSample (0, i, x);
+                doubleBuffer.setSample (1, i, x);
+
+                long double y = x;
+                for (int s = 0; s < numStages; ++s)
+                    y = AllPassStage::reference (y, getCoefficient (s), state[s]);
+                expected[i] = y;
+            }
+
+            const auto start = Time::getHighResolutionTicks();
+            if (doublePrecision)
+                graph.processBlock (doubleBuffer, midi);
+            else
+                graph.processBlock (floatBuffer, midi);
+            ticks += Time::getHighResolutionTicks() - start;
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const long double y = doublePrecision ? doubleBuffer.getSample (0, i)
+                                                      : floatBuffer.getSample (0, i);
+                maxError = jmax (maxError, (double) std::abs (y - expected[i]));
+            }
+        }
+
+        String message = name;
+        message << ": " << String (1000.0 * Time::highResolutionTicksToSeconds (ticks), 2)
+                << " ms, max error " << String (maxError, 12);
+        logMessage (message);
+
+        graph.releaseResources();
+        graph.clear();
+        return maxError;
+    }
+};
+
+static DoublePrecisionBenchmark sDoublePrecisionBenchmark;
+
+}
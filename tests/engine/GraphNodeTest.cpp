@@ -240,6 +240,96 @@ public:
 
 static GetTypeStringTest sGetTypeStringTest;
 
+/** Records how the graph prepared and rendered it */
+class RecordingProcessor : public BaseProcessor
+{
+public:
+    RecordingProcessor()                                      { setPlayConfigDetails (2, 2, 44100.0, 1024); }
+
+    const String getName() const override                    { return "Recording"; }
+    void prepareToPlay (double sampleRate, int) override     { preparedRate = sampleRate; }
+    void releaseResources() override                          { }
+    void processBlock (AudioBuffer<float>&, MidiBuffer&) override   { ++numFloatBlocks; }
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override  { ++numDoubleBlocks; }
+    bool supportsDoublePrecisionProcessing() const override  { return true; }
+
+    double getTailLengthSeconds() const override             { return 0.0; }
+    bool acceptsMidi() const override                        { return false; }
+    bool producesMidi() const override                       { return false; }
+    AudioProcessorEditor* createEditor() override            { return nullptr; }
+    bool hasEditor() const override                          { return false; }
+    int getNumPrograms() override                            { return 1; }
+    int getCurrentProgram() override                         { return 0; }
+    void setCurrentProgram (int) override                    { }
+    const String getProgramName (int) override               { return String(); }
+    void changeProgramName (int, const String&) override     { }
+    void getStateInformation (MemoryBlock&) override         { }
+    void setStateInformation (const void*, int) override     { }
+
+    void fillInPluginDescription (PluginDescription& desc) const override
+    {
+        desc.name = getName();
+        desc.fileOrIdentifier = "test.recording";
+        desc.pluginFormatName = "Element";
+        desc.numInputChannels = desc.numOutputChannels = 2;
+    }
+
+    double preparedRate = 0.0;
+    int numFloatBlocks = 0;
+    int numDoubleBlocks = 0;
+};
+
+/** A session load applies saved node settings after the engine has
+    already prepared the node */
+class LoadedSettingsTest : public GraphNodeTest
+{
+public:
+    LoadedSettingsTest() : GraphNodeTest ("Node Settings On Load", "loadedSettings") { }
+    void runTest() override
+    {
+        auto* const proc = new RecordingProcessor();
+        GraphNodePtr node = graph->addNode (proc);
+        graph->handleUpdateNowIfNeeded();
+        expectEquals (proc->preparedRate, 44100.0);
+
+        beginTest ("oversampling");
+        node->setOversamplingFactor (2);
+        graph->handleUpdateNowIfNeeded();
+        expectEquals (proc->preparedRate, 88200.0);
+        expectEquals (node->getLatencySamples(),
+                      Oversampler::getLatencySamples (2, node->getOversamplingQuality()));
+        render();
+        expectGreaterThan (proc->numFloatBlocks, 0);
+
+        beginTest ("double precision");
+        node->setOversamplingFactor (1);
+        node->setDoublePrecision (true);
+        graph->handleUpdateNowIfNeeded();
+        expect (node->isRenderingDoublePrecision());
+        expect (proc->getProcessingPrecision() == AudioProcessor::doublePrecision);
+        render();
+        expectGreaterThan (proc->numDoubleBlocks, 0);
+
+        beginTest ("io nodes follow the graph");
+        GraphNodePtr output = graph->addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        output->setDoublePrecision (true);
+        graph->handleUpdateNowIfNeeded();
+        expect (! output->isRenderingDoublePrecision());
+        render();
+    }
+
+    void render()
+    {
+        AudioBuffer<float> audio (2, 1024);
+        audio.clear();
+        MidiBuffer midi;
+        graph->processBlock (audio, midi);
+    }
+};
+
+static LoadedSettingsTest sLoadedSettingsTest;
+
 }
 
 }
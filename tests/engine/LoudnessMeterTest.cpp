@@ -0,0 +1,123 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/LoudnessMeter.h"
+#include "engine/nodes/TruePeakLimiterProcessor.h"
+
+namespace Element {
+
+class LoudnessMeterTest : public UnitTestBase
+{
+public:
+    LoudnessMeterTest() : UnitTestBase ("Loudness Meter", "engine", "loudnessMeter") { }
+
+    void runTest() override
+    {
+        testSine (48000.0);
+        testSine (44100.0);
+        testGating();
+        testLimiter();
+    }
+
+private:
+    const int blockSize = 480;
+
+    static void fillSine (AudioBuffer<float>& buffer, int offset, double sampleRate, float dBFS)
+    {
+        const float amplitude = Decibels::decibelsToGain (dBFS);
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample (ch, i, amplitude * (float) std::sin (
+                    MathConstants<double>::twoPi * 1000.0 * (double) (offset + i) / sampleRate));
+    }
+
+    // EBU Tech 3341 case 1: stereo 1 kHz at -23 dBFS reads -23 LUFS
+    void testSine (double sampleRate)
+    {
+        beginTest (String ("1 kHz sine at ") + String (sampleRate) + " Hz");
+        LoudnessMeter meter;
+        meter.prepare (sampleRate, 2, blockSize);
+        AudioBuffer<float> buffer (2, blockSize);
+        for (int offset = 0; offset < (int) sampleRate * 20; offset += blockSize)
+        {
+            fillSine (buffer, offset, sampleRate, -23.0f);
+            meter.process (buffer);
+        }
+
+        const auto s = meter.getSnapshot();
+        expectWithinAbsoluteError (s.momentary,  -23.0f, 0.1f);
+        expectWithinAbsoluteError (s.shortTerm,  -23.0f, 0.1f);
+        expectWithinAbsoluteError (s.integrated, -23.0f, 0.1f);
+        expectWithinAbsoluteError (s.truePeak,   -23.0f, 0.2f);
+        expectLessThan (s.range, 0.5f);
+    }
+
+    void testGating()
+    {
+        beginTest ("silence is gated");
+        const double sampleRate = 48000.0;
+        LoudnessMeter meter;
+        meter.prepare (sampleRate, 2, blockSize);
+        AudioBuffer<float> buffer (2, blockSize);
+        for (int offset = 0; offset < (int) sampleRate * 10; offset += blockSize)
+        {
+            fillSine (buffer, offset, sampleRate, -20.0f);
+            if (offset >= (int) sampleRate * 5)
+                buffer.clear();
+            meter.process (buffer);
+        }
+
+        const auto s = meter.getSnapshot();
+        expectEquals (s.momentary, LoudnessMeter::minLoudness);
+        expectWithinAbsoluteError (s.integrated, -20.0f, 0.1f);
+
+        meter.requestReset();
+        meter.process (buffer);
+        expectEquals (meter.getSnapshot().integrated, LoudnessMeter::minLoudness);
+    }
+
+    void testLimiter()
+    {
+        beginTest ("true peak limiter");
+        const double sampleRate = 48000.0;
+        TruePeakLimiterProcessor limiter;
+        limiter.prepareToPlay (sampleRate, blockSize);
+        expect (limiter.getLatencySamples() > 0);
+
+        // 6 dB over full scale must come out under the -1 dBTP ceiling
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+        float peak = 0.0f;
+        for (int offset = 0; offset < (int) sampleRate; offset += blockSize)
+        {
+            fillSine (buffer, offset, sampleRate, 6.0f);
+            limiter.processBlock (buffer, midi);
+            if (offset > limiter.getLatencySamples())
+                peak = jmax (peak, buffer.getMagnitude (0, blockSize));
+        }
+
+        expectLessThan (Decibels::gainToDecibels (peak), -0.9f);
+        expectLessThan (limiter.getGainReductionDB(), -6.0f);
+        expectWithinAbsoluteError (limiter.getInputPeakDB(), 6.0f, 0.2f);
+    }
+};
+
+static LoudnessMeterTest sLoudnessMeterTest;
+
+}
@@ -0,0 +1,246 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiClock.h"
+
+namespace Element {
+
+/** Feeds synthetic clocks with jitter and measures how the follower locks */
+class MidiClockTest : public UnitTestBase
+{
+public:
+    MidiClockTest() : UnitTestBase ("MIDI Clock", "engine", "midiClock") { }
+
+    void runTest() override
+    {
+        testLockAndPhase (120.0, 0.0);
+        testLockAndPhase (120.0, 1.0);
+        testLockAndPhase (87.3, 2.0);
+        testSongPosition();
+        testTempoChange();
+        testDropout();
+        testMaster();
+    }
+
+private:
+    /** A jittered clock source */
+    struct Source
+    {
+        Source (double bpm, double jitter, int seed)
+            : period (60.0 / (bpm * MidiClock::ticksPerBeat)), jitterMs (jitter), random (seed) { }
+
+        /** Sends the next tick, returns its true time */
+        double tick (MidiClock& clock)
+        {
+            const double ideal = time;
+            send (clock, MidiMessage::midiClock(), ideal + (random.nextDouble() * 2.0 - 1.0) * jitterMs * 0.001);
+            time += period;
+            return ideal;
+        }
+
+        void send (MidiClock& clock, MidiMessage msg, double at)
+        {
+            msg.setTimeStamp (at);
+            clock.process (msg);
+        }
+
+        double period, jitterMs;
+        double time = 100.0;
+        Random random;
+    };
+
+    static const int sampleRate = 48000;
+
+    void testLockAndPhase (double bpm, double jitterMs)
+    {
+        beginTest (String ("lock and phase at ") + String (bpm) + " bpm, "
+                    + String (jitterMs) + " ms jitter");
+
+        MidiClock clock;
+        clock.reset (sampleRate, 256);
+        Source source (bpm, jitterMs, 1234);
+
+        const double start = source.time;
+        int ticks = 0;
+        while (! clock.isLocked() && ticks < 48 * 10)
+        {
+            source.tick (clock);
+            ++ticks;
+        }
+
+        expect (clock.isLocked(), "should lock");
+        const double lockSeconds = source.time - start;
+        expectLessThan (lockSeconds, 3.0);
+
+        // settle at the narrow bandwidth, then start
+        for (int i = 0; i < MidiClock::ticksPerBeat * 16; ++i)
+            source.tick (clock);
+        source.send (clock, MidiMessage::midiStart(), source.time - 0.5 * source.period);
+        const double beatZero = source.time;
+
+        double sumSquares = 0.0, maxError = 0.0;
+        int numMeasured = 0;
+        for (int i = 0; i < MidiClock::ticksPerBeat * 32; ++i)
+        {
+            const double tickTime = source.tick (clock);
+            const double queryTime = tickTime + 0.5 * source.period;
+            double beats = 0.0, tempo = 0.0;
+            if (! clock.getPosition (queryTime, beats, tempo))
+                continue;
+
+            const double expected = (queryTime - beatZero) / (source.period * MidiClock::ticksPerBeat);
+            const double errorMs = (beats - expected) * source.period * MidiClock::ticksPerBeat * 1000.0;
+            sumSquares += errorMs * errorMs;
+            maxError = jmax (maxError, std::abs (errorMs));
+            ++numMeasured;
+        }
+
+        expectEquals (numMeasured, MidiClock::ticksPerBeat * 32);
+        const double rmsError = std::sqrt (sumSquares / jmax (1, numMeasured));
+        logMessage (String ("  lock ") + String (lockSeconds, 3) + " s, phase error rms "
+                    + String (rmsError, 3) + " ms, max " + String (maxError, 3) + " ms");
+
+        expectLessThan (rmsError, 0.25 + 0.25 * jitterMs);
+        expectLessThan (maxError, 0.5 + 0.75 * jitterMs);
+
+        const auto stats = clock.getStats();
+        expect (stats.locked);
+        expectWithinAbsoluteError (stats.tempo, bpm, 0.1);
+    }
+
+    void testSongPosition()
+    {
+        beginTest ("song position pointer");
+        MidiClock clock;
+        clock.reset (sampleRate, 256);
+        Source source (120.0, 0.5, 99);
+        for (int i = 0; i < 48 * 4; ++i)
+            source.tick (clock);
+
+        // sixteenth 32 is beat 8
+        source.send (clock, MidiMessage::songPositionPointer (32), source.time - 0.5 * source.period);
+        source.send (clock, MidiMessage::midiContinue(), source.time - 0.25 * source.period);
+        const double tickTime = source.tick (clock);
+
+        double beats = 0.0, tempo = 0.0;
+        expect (clock.getPosition (tickTime, beats, tempo));
+        expectWithinAbsoluteError (beats, 8.0, 0.01);
+
+        source.send (clock, MidiMessage::midiStop(), source.time);
+        expect (! clock.isRunning());
+        expect (! clock.getPosition (source.time, beats, tempo));
+    }
+
+    void testTempoChange()
+    {
+        beginTest ("tempo change");
+        MidiClock clock;
+        clock.reset (sampleRate, 256);
+        Source source (120.0, 0.5, 7);
+        for (int i = 0; i < 48 * 4; ++i)
+            source.tick (clock);
+
+        source.period = 60.0 / (126.0 * MidiClock::ticksPerBeat);
+        for (int i = 0; i < 48 * 12; ++i)
+            source.tick (clock);
+
+        expect (clock.isLocked());
+        expectWithinAbsoluteError (clock.getStats().tempo, 126.0, 0.1);
+    }
+
+    void testDropout()
+    {
+        beginTest ("dropout");
+        MidiClock clock;
+        clock.reset (sampleRate, 256);
+        Source source (120.0, 0.5, 3);
+        source.send (clock, MidiMessage::midiStart(), source.time);
+        for (int i = 0; i < 48 * 4; ++i)
+            source.tick (clock);
+        expect (clock.isLocked());
+
+        double beats = 0.0, tempo = 0.0;
+        expect (! clock.getPosition (source.time + 1.0, beats, tempo), "a quiet clock has no position");
+
+        source.time += 1.0;
+        source.tick (clock);
+        expect (! clock.isLocked(), "a gap should drop lock");
+
+        // every tick counts, including the one that restarted the loop
+        int64 numTicks = 48 * 4 + 1;
+        double tickTime = 0.0;
+        while (! clock.isLocked() && numTicks < 48 * 12)
+        {
+            tickTime = source.tick (clock);
+            ++numTicks;
+        }
+
+        expect (clock.isLocked(), "should lock again after a gap");
+        expect (clock.getPosition (tickTime, beats, tempo));
+        expectWithinAbsoluteError (beats, (double) (numTicks - 1) / MidiClock::ticksPerBeat, 0.01);
+    }
+
+    void testMaster()
+    {
+        beginTest ("master ticks are sample accurate");
+        const double bpm = 123.4;
+        const double samplesPerTick = 60.0 * sampleRate / (bpm * MidiClock::ticksPerBeat);
+        MidiClockMaster master;
+        master.setSampleRate (sampleRate);
+        master.setTempo (bpm);
+        master.reset();
+
+        MidiBuffer midi;
+        int64 position = 0, tick = 0;
+        bool exact = true;
+        for (int block = 0; block < (sampleRate * 60) / 333; ++block)
+        {
+            midi.clear();
+            master.render (midi, 333);
+            MidiBuffer::Iterator iter (midi);
+            const uint8* data = nullptr;
+            int size = 0, frame = 0;
+            while (iter.getNextEvent (data, size, frame))
+            {
+                const auto expected = (int64) std::floor ((double) tick * samplesPerTick + 0.5);
+                exact &= position + frame == expected;
+                ++tick;
+            }
+            position += 333;
+        }
+
+        expect (exact, "ticks should land on the nearest sample");
+        expectEquals (tick, (int64) std::ceil (((double) position - 0.5) / samplesPerTick));
+
+        beginTest ("master follows the transport position");
+        master.setPositionBeats (2.5);
+        midi.clear();
+        master.render (midi, 512);
+        MidiBuffer::Iterator iter (midi);
+        const uint8* data = nullptr;
+        int size = 0, frame = -1;
+        expect (iter.getNextEvent (data, size, frame));
+        expectEquals (frame, 0);
+        expect (MidiClockMaster::songPositionPointer (2.5).getSongPositionPointerMidiBeat() == 10);
+    }
+};
+
+static MidiClockTest sMidiClockTest;
+
+}
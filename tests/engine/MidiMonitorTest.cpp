@@ -0,0 +1,152 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/MidiMonitorNode.h"
+
+namespace Element {
+
+class MidiMonitorTest : public UnitTestBase
+{
+public:
+    MidiMonitorTest() : UnitTestBase ("MIDI Monitor", "engine", "midiMonitor") { }
+
+    void runTest() override
+    {
+        testFilter();
+        testThinning();
+        testRateLimit();
+        testGaps();
+        testCaptureGaps();
+    }
+
+private:
+    using Event = MidiMonitorNode::Event;
+
+    static Event event (int64 frame, uint8 status, uint8 d1 = 0, uint8 d2 = 0, int size = 3)
+    {
+        Event e;
+        e.frame = frame;
+        e.size = size;
+        e.data[0] = status; e.data[1] = d1; e.data[2] = d2;
+        return e;
+    }
+
+    void testFilter()
+    {
+        beginTest ("filtering");
+        const Event events[] = {
+            event (0, 0xf8, 0, 0, 1), event (1, 0x90, 60, 100), event (2, 0xf8, 0, 0, 1),
+            event (3, 0xfa, 0, 0, 1), event (4, 0xf0, 0x7e, 0x00, 12)
+        };
+
+        StringArray lines;
+        expectEquals (MidiMonitorNode::formatEvents (events, 5, MidiMonitorNode::defaultFilter, 100, lines), 3);
+        expectEquals (lines[1], String ("Start"));
+        expect (lines[2].contains ("12 bytes"));
+
+        lines.clear();
+        expectEquals (MidiMonitorNode::formatEvents (events, 5, MidiMonitorNode::clock, 100, lines), 2);
+    }
+
+    void testThinning()
+    {
+        beginTest ("controller runs are thinned");
+        Array<Event> events;
+        for (int i = 0; i < 50; ++i)
+            events.add (event (i, 0xb0, 7, (uint8) i));
+        events.add (event (50, 0xb0, 10, 64));
+        for (int i = 0; i < 50; ++i)
+            events.add (event (51 + i, 0xb0, 7, (uint8) (100 - i)));
+
+        StringArray lines;
+        expectEquals (MidiMonitorNode::formatEvents (events.getRawDataPointer(), events.size(),
+                                                     MidiMonitorNode::allMessages, 100, lines), 3);
+        expect (lines[0].contains ("49"));
+        expect (lines[2].contains ("51"));
+    }
+
+    void testRateLimit()
+    {
+        beginTest ("lines are limited per refresh");
+        Array<Event> events;
+        for (int i = 0; i < 100; ++i)
+            events.add (event (i, 0x90, (uint8) i, 100));
+
+        StringArray lines;
+        expectEquals (MidiMonitorNode::formatEvents (events.getRawDataPointer(), events.size(),
+                                                     MidiMonitorNode::allMessages, 10, lines), 11);
+        expectEquals (lines[10], String ("(90 more)"));
+    }
+
+    void testGaps()
+    {
+        beginTest ("gaps are always logged");
+        Event gap = event (2, 0);
+        gap.size = -7;
+        const Event events[] = { event (0, 0xf8, 0, 0, 1), event (1, 0x90, 60, 100), gap };
+
+        StringArray lines;
+        expectEquals (MidiMonitorNode::formatEvents (events, 3, MidiMonitorNode::transport, 100, lines), 1);
+        expectEquals (lines[0], String ("(7 dropped)"));
+    }
+
+    void testCaptureGaps()
+    {
+        beginTest ("overflow is recorded in the capture");
+        MessageManager::getInstance();
+        TemporaryFile csv (".csv");
+        GraphNodePtr node = new MidiMonitorNode();
+        auto* monitor = dynamic_cast<MidiMonitorNode*> (node.get());
+        monitor->prepareToRender (44100.0, 512);
+        expect (monitor->startCapture (csv.getFile()));
+
+        // more than the ring holds in one block
+        AudioSampleBuffer audio (1, 512);
+        MidiBuffer buffer;
+        MidiBuffer* buffers[] = { &buffer };
+        MidiPipe pipe (buffers, 1);
+        for (int i = 0; i < 5000; ++i)
+            buffer.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), i % 512);
+        monitor->render (audio, pipe);
+        const int numDropped = monitor->getNumDropped();
+        expect (numDropped > 0);
+
+        // the gap is marked once the ring has been drained
+        MessageManager::getInstance()->runDispatchLoopUntil (50);
+        buffer.clear();
+        buffer.addEvent (MidiMessage::noteOff (1, 60), 0);
+        monitor->render (audio, pipe);
+        MessageManager::getInstance()->runDispatchLoopUntil (50);
+        monitor->stopCapture();
+        monitor->releaseResources();
+
+        StringArray rows;
+        rows.addLines (csv.getFile().loadFileAsString());
+        rows.removeEmptyStrings();
+        expectEquals (rows.size(), 1 + (5000 - numDropped) + 1 + 1);
+        const auto gapRow = StringArray::fromTokens (rows[rows.size() - 2], ",", "");
+        expectEquals (gapRow[3], String ("dropped"));
+        expectEquals (gapRow[4].getIntValue(), numDropped);
+        expect (monitor->getLog().contains (String ("(") + String (numDropped) + " dropped)"));
+    }
+};
+
+static MidiMonitorTest sMidiMonitorTest;
+
+}
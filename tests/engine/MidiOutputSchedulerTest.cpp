@@ -0,0 +1,125 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiOutputScheduler.h"
+
+namespace Element {
+
+class MidiOutputSchedulerTest : public UnitTestBase
+{
+public:
+    MidiOutputSchedulerTest() : UnitTestBase ("MIDI Output Scheduler", "engine", "midiOutputScheduler") { }
+
+    void runTest() override
+    {
+        testClock();
+        testOrdering();
+        testRealtime();
+    }
+
+private:
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+
+    void testClock()
+    {
+        beginTest ("callback jitter is filtered");
+        MidiOutputScheduler scheduler;
+        Random random (1234);
+        const double period = 1000.0 * blockSize / sampleRate;
+        double maxError = 0.0;
+
+        for (int block = 0; block < 4000; ++block)
+        {
+            // callbacks wander up to a millisecond late
+            const double ideal = 1000.0 + block * period;
+            scheduler.beginBlock (sampleRate, blockSize, ideal + random.nextDouble());
+            if (block >= 2000)
+                maxError = jmax (maxError, std::abs (scheduler.getEventTime (0) - (ideal + 0.5 + period + 1.5)));
+        }
+
+        expectLessThan (maxError, 0.25);
+    }
+
+    void testOrdering()
+    {
+        beginTest ("events are sent in time order");
+        MidiOutputScheduler scheduler;
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 0);
+        midi.addEvent (MidiMessage::noteOff (1, 60), 128);
+        midi.addEvent (MidiMessage::noteOn (1, 62, (uint8) 100), 300); // past the block
+
+        scheduler.beginBlock (sampleRate, blockSize, 0.0);
+        expect (scheduler.schedule (nullptr, midi, blockSize));
+
+        const double first = scheduler.getEventTime (0);
+        const double second = scheduler.getEventTime (128);
+        expectWithinAbsoluteError (second - first, 128.0 * 1000.0 / sampleRate, 0.0001);
+
+        expectEquals (scheduler.dispatch (first - 0.1), first);
+        expectEquals (scheduler.getStats().numSent, 0);
+        expectEquals (scheduler.dispatch (first), second);
+        expectEquals (scheduler.getStats().numSent, 1);
+        expectEquals (scheduler.dispatch (second + 0.5), -1.0);
+
+        const auto stats = scheduler.getStats();
+        expectEquals (stats.numSent, 2);
+        expectEquals (stats.numLate, 0);
+        expectWithinAbsoluteError (stats.maxMs, 0.5, 0.0001);
+    }
+
+    void testRealtime()
+    {
+        beginTest ("dispatch jitter");
+        MidiOutputScheduler scheduler;
+        scheduler.start();
+
+        MidiBuffer midi;
+        for (int i = 0; i < blockSize; i += 32)
+            midi.addEvent (MidiMessage::midiClock(), i);
+
+        const double period = 1000.0 * blockSize / sampleRate;
+        const double start = Time::getMillisecondCounterHiRes();
+        for (int block = 0; block < 100; ++block)
+        {
+            while (Time::getMillisecondCounterHiRes() < start + block * period)
+                Thread::yield();
+            scheduler.beginBlock (sampleRate, blockSize);
+            scheduler.schedule (nullptr, midi, blockSize);
+        }
+
+        Thread::sleep (50);
+        scheduler.stop();
+
+        const auto stats = scheduler.getStats();
+        expectEquals (stats.numSent, 800);
+        expectEquals (stats.numDropped, 0);
+
+        String message;
+        message << "late mean " << String (stats.meanMs, 3) << " ms, rms " << String (stats.rmsMs, 3)
+                << " ms, max " << String (stats.maxMs, 3) << " ms, " << stats.numLate << " over "
+                << String (MidiOutputScheduler::lateThresholdMs, 1) << " ms";
+        logMessage (message);
+    }
+};
+
+static MidiOutputSchedulerTest sMidiOutputSchedulerTest;
+
+}
@@ -0,0 +1,131 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/GraphProcessor.h"
+#include "engine/MidiPrefilter.h"
+
+namespace Element {
+
+class MidiPrefilterTest : public UnitTestBase
+{
+public:
+    MidiPrefilterTest() : UnitTestBase ("MIDI Prefilter", "engine", "midiPrefilter") { }
+
+    void runTest() override
+    {
+        testDefaults();
+        testChannels();
+        testKinds();
+        testNoteRange();
+        testGraphChannels();
+    }
+
+private:
+    void testDefaults()
+    {
+        beginTest ("accepts everything by default");
+        MidiPrefilter filter;
+        expect (filter.acceptsAll());
+        bool all = true;
+        for (int status = 0x80; status < 0xf0; ++status)
+        {
+            const uint8 data[3] = { (uint8) status, 60, 100 };
+            all &= filter.accepts (data, 3);
+        }
+        expect (all);
+        expect (filter.accepts (MidiMessage::midiClock()));
+    }
+
+    void testChannels()
+    {
+        beginTest ("channels");
+        MidiPrefilter filter;
+        filter.setChannels ((1 << 1) | (1 << 9));
+        expect (! filter.acceptsAll());
+        expect (filter.accepts (MidiMessage::noteOn (2, 60, (uint8) 100)));
+        expect (filter.accepts (MidiMessage::controllerEvent (10, 7, 100)));
+        expect (! filter.accepts (MidiMessage::noteOn (1, 60, (uint8) 100)));
+        expect (! filter.accepts (MidiMessage::pitchWheel (16, 0)));
+        expect (filter.accepts (MidiMessage::midiStart()), "system messages have no channel");
+
+        filter.setOmni();
+        expect (filter.acceptsAll());
+    }
+
+    void testKinds()
+    {
+        beginTest ("message kinds");
+        MidiPrefilter filter;
+        filter.setKinds (MidiPrefilter::notes | MidiPrefilter::pitchBend);
+        expect (filter.accepts (MidiMessage::noteOff (3, 60)));
+        expect (filter.accepts (MidiMessage::pitchWheel (3, 100)));
+        expect (! filter.accepts (MidiMessage::controllerEvent (3, 1, 1)));
+        expect (! filter.accepts (MidiMessage::programChange (3, 1)));
+        expect (! filter.accepts (MidiMessage::midiClock()));
+    }
+
+    void testNoteRange()
+    {
+        beginTest ("note range");
+        MidiPrefilter filter;
+        filter.setNoteRange (48, 72);
+        expect (filter.accepts (MidiMessage::noteOn (1, 48, (uint8) 1)));
+        expect (filter.accepts (MidiMessage::noteOff (1, 72)));
+        expect (! filter.accepts (MidiMessage::noteOn (1, 47, (uint8) 1)));
+        expect (! filter.accepts (MidiMessage::aftertouchChange (1, 73, 10)));
+        expect (filter.accepts (MidiMessage::controllerEvent (1, 100, 1)), "controllers ignore the range");
+
+        filter.setChannels (1);
+        expect (! filter.accepts (MidiMessage::noteOn (2, 60, (uint8) 1)));
+        expect (filter.getNoteRange() == Range<int> (48, 72));
+    }
+
+    void testGraphChannels()
+    {
+        beginTest ("graph channels build the table");
+        GraphProcessor graph;
+        expect (graph.getMidiPrefilter().acceptsAll());
+        graph.setMidiChannel (5);
+        expectEquals (graph.getMidiPrefilter().getChannels(), 1 << 4);
+        expect (graph.getMidiPrefilter().accepts (MidiMessage::noteOn (5, 60, (uint8) 100)));
+        expect (! graph.getMidiPrefilter().accepts (MidiMessage::noteOn (6, 60, (uint8) 100)));
+        graph.setMidiChannel (0);
+        expect (graph.getMidiPrefilter().acceptsAll());
+
+        beginTest ("graph kinds and note range build the table");
+        graph.setMidiKinds (MidiPrefilter::notes);
+        graph.setMidiNoteRange ({ 48, 72 });
+        const auto filter (graph.getMidiPrefilterCopy());
+        expect (! filter.acceptsAll());
+        expect (filter.accepts (MidiMessage::noteOn (1, 60, (uint8) 100)));
+        expect (! filter.accepts (MidiMessage::noteOn (1, 80, (uint8) 100)));
+        expect (! filter.accepts (MidiMessage::controllerEvent (1, 1, 1)));
+        graph.setMidiChannel (2);
+        expect (! graph.getMidiPrefilter().accepts (MidiMessage::noteOn (1, 60, (uint8) 100)));
+        expect (graph.getMidiPrefilter().getNoteRange() == Range<int> (48, 72), "channels keep the range");
+        graph.setMidiChannel (0);
+        graph.setMidiKinds (MidiPrefilter::allKinds);
+        graph.setMidiNoteRange ({ 0, 127 });
+        expect (graph.getMidiPrefilter().acceptsAll());
+    }
+};
+
+static MidiPrefilterTest sMidiPrefilterTest;
+
+}
@@ -0,0 +1,119 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/MidiRouterNode.h"
+
+namespace Element {
+
+class MidiProgramCacheTest : public UnitTestBase
+{
+public:
+    MidiProgramCacheTest() : UnitTestBase ("MIDI Program Cache", "engine", "midiProgramCache") { }
+
+    void initialise() override
+    {
+        MessageManager::getInstance();
+    }
+
+    void runTest() override
+    {
+        testSwitch();
+        testLatestRequestWins();
+    }
+
+private:
+    /** Saves a program whose state connects one input to one output */
+    static void addProgram (ValueTree& programs, int program, int input, int output)
+    {
+        MidiRouterNode router (4, 4);
+        MatrixState matrix (4, 4);
+        matrix.set (input, output, true);
+        router.setMatrixState (matrix);
+        MemoryBlock state;
+        router.getState (state);
+
+        ValueTree data ("program");
+        data.setProperty (Tags::program, program, nullptr)
+            .setProperty (Tags::name, String ("Program ") + String (program), nullptr)
+            .setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+        programs.appendChild (data, nullptr);
+    }
+
+    static String encode (const ValueTree& programs)
+    {
+        MemoryOutputStream mo;
+        {
+            GZIPCompressorOutputStream gzipStream (mo, 9);
+            programs.writeToStream (gzipStream);
+        }
+        return mo.getMemoryBlock().toBase64Encoding();
+    }
+
+    static bool waitForSwitch (GraphNode& node)
+    {
+        for (int i = 0; i < 100 && node.isSwitchingMidiProgram(); ++i)
+            MessageManager::getInstance()->runDispatchLoopUntil (10);
+        return ! node.isSwitchingMidiProgram();
+    }
+
+    void testSwitch()
+    {
+        beginTest ("switch");
+        ValueTree programs ("programs");
+        addProgram (programs, 3, 2, 1);
+        GraphNodePtr node = new MidiRouterNode (4, 4);
+        auto* router = dynamic_cast<MidiRouterNode*> (node.get());
+        node->setMidiProgramsState (encode (programs));
+
+        node->setMidiProgram (3);
+        node->reloadMidiProgram();
+        expect (node->isSwitchingMidiProgram());
+        expect (waitForSwitch (*node), "switch didn't finish");
+        expect (router->getMatrixState().connected (2, 1));
+        expect (! router->getMatrixState().connected (0, 0));
+
+        // the worker idles for a second, so this only passes if the request woke it
+        expect (node->getMidiProgramSwitchTime() < 200.0,
+                String ("switch took ") + String (node->getMidiProgramSwitchTime()) + " ms");
+    }
+
+    void testLatestRequestWins()
+    {
+        beginTest ("latest request wins");
+        ValueTree programs ("programs");
+        addProgram (programs, 3, 2, 1);
+        addProgram (programs, 5, 3, 0);
+        GraphNodePtr node = new MidiRouterNode (4, 4);
+        auto* router = dynamic_cast<MidiRouterNode*> (node.get());
+        node->setMidiProgramsState (encode (programs));
+
+        node->setMidiProgram (3);
+        node->reloadMidiProgram();
+        node->setMidiProgram (5);
+        node->reloadMidiProgram();
+        expect (waitForSwitch (*node), "switch didn't finish");
+        expect (router->getMatrixState().connected (3, 0));
+        expect (! router->getMatrixState().connected (2, 1));
+    }
+};
+
+static MidiProgramCacheTest sMidiProgramCacheTest;
+
+}
@@ -0,0 +1,201 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/MidiRouterNode.h"
+
+namespace Element {
+
+class MidiRouterNodeTest : public UnitTestBase
+{
+public:
+    MidiRouterNodeTest() : UnitTestBase ("MIDI Router Node", "nodes", "midiRouter") { }
+
+    void runTest() override
+    {
+        testPrograms();
+        testFanOut();
+        testChannels();
+        testState();
+        testLatestWins();
+    }
+
+private:
+    MidiBuffer buffers[4];
+
+    void fillInputs()
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            buffers[i].clear();
+            buffers[i].addEvent (MidiMessage::noteOn (1 + i, 60 + i, (uint8) 100), i);
+        }
+    }
+
+    void render (MidiRouterNode& router)
+    {
+        AudioSampleBuffer audio (1, 512);
+        MidiBuffer* pointers[] = { &buffers[0], &buffers[1], &buffers[2], &buffers[3] };
+        MidiPipe pipe (pointers, 4);
+        router.render (audio, pipe);
+    }
+
+    int getNote (int buffer, int index = 0)
+    {
+        MidiBuffer::Iterator iter (buffers[buffer]);
+        MidiMessage msg; int frame = 0;
+        for (int i = 0; iter.getNextEvent (msg, frame); ++i)
+            if (i == index)
+                return msg.getNoteNumber();
+        return -1;
+    }
+
+    void testPrograms()
+    {
+        beginTest ("programs");
+        GraphNodePtr node = new MidiRouterNode (4, 4);
+        auto* router = dynamic_cast<MidiRouterNode*> (node.get());
+
+        fillInputs();
+        render (*router);
+        for (int i = 0; i < 4; ++i)
+            expectEquals (getNote (i), 60 + i, "linear should pass each input through");
+
+        router->setCurrentProgram (2);  // 1-2 to 3-4
+        fillInputs();
+        render (*router);
+        expect (buffers[0].isEmpty() && buffers[1].isEmpty());
+        expectEquals (getNote (2), 60);
+        expectEquals (getNote (3), 61);
+
+        router->setCurrentProgram (3);  // 3-4 to 1-2
+        fillInputs();
+        render (*router);
+        expectEquals (getNote (0), 62);
+        expectEquals (getNote (1), 63);
+        expect (buffers[2].isEmpty() && buffers[3].isEmpty());
+    }
+
+    void testFanOut()
+    {
+        beginTest ("fan out");
+        GraphNodePtr node = new MidiRouterNode (4, 4);
+        auto* router = dynamic_cast<MidiRouterNode*> (node.get());
+
+        MatrixState matrix (4, 4);
+        matrix.set (0, 0, true);
+        matrix.set (0, 1, true);
+        matrix.set (0, 3, true);
+        matrix.set (1, 3, true);
+        router->setMatrixState (matrix);
+
+        fillInputs();
+        render (*router);
+        expectEquals (getNote (0), 60);
+        expectEquals (getNote (1), 60);
+        expect (buffers[2].isEmpty());
+        expectEquals (buffers[3].getNumEvents(), 2);
+        expectEquals (getNote (3, 0), 60);
+        expectEquals (getNote (3, 1), 61);
+    }
+
+    void testChannels()
+    {
+        beginTest ("route channels");
+        GraphNodePtr node = new MidiRouterNode (4, 4);
+        auto* router = dynamic_cast<MidiRouterNode*> (node.get());
+
+        MatrixState matrix (4, 4);
+        matrix.set (0, 1, true);
+        matrix.set (1, 2, true);
+        router->setMatrixState (matrix);
+        router->setRouteChannels (0, 1, 0xffff, 10);
+        router->setRouteChannels (1, 2, 1 << 0);    // input 2 sends on channel 2
+        expectEquals (router->getRouteOutputChannel (0, 1), 10);
+        expectEquals (router->getRouteChannelMask (1, 2), 1);
+
+        fillInputs();
+        render (*router);
+        MidiBuffer::Iterator iter (buffers[1]);
+        MidiMessage msg; int frame = 0;
+        expect (iter.getNextEvent (msg, frame));
+        expectEquals (msg.getChannel(), 10);
+        expectEquals (msg.getNoteNumber(), 60);
+        expect (buffers[2].isEmpty(), "channel 2 should be filtered");
+
+        router->setRouteChannels (1, 2, 1 << 1);
+        fillInputs();
+        render (*router);
+        expectEquals (getNote (2), 61);
+    }
+
+    void testLatestWins()
+    {
+        beginTest ("latest routing wins");
+        GraphNodePtr node = new MidiRouterNode (4, 4);
+        auto* router = dynamic_cast<MidiRouterNode*> (node.get());
+
+        // several edits between blocks, only the last should be heard
+        for (int i = 0; i < 3; ++i)
+        {
+            router->setCurrentProgram (2);  // 1-2 to 3-4
+            router->setCurrentProgram (3);  // 3-4 to 1-2
+            router->setRouteChannels (2, 0, 0xffff, 9);
+            fillInputs();
+            render (*router);
+            expectEquals (getNote (0), 62);
+            expect (buffers[2].isEmpty() && buffers[3].isEmpty());
+            MidiBuffer::Iterator iter (buffers[0]);
+            MidiMessage msg; int frame = 0;
+            expect (iter.getNextEvent (msg, frame) && msg.getChannel() == 9);
+
+            // and an edit made after a block is picked up by the next one
+            router->setRouteChannels (2, 0, 0xffff, 0);
+            router->setCurrentProgram (0);
+            fillInputs();
+            render (*router);
+            expectEquals (getNote (0), 60);
+        }
+    }
+
+    void testState()
+    {
+        beginTest ("state");
+        GraphNodePtr node = new MidiRouterNode (4, 4);
+        auto* router = dynamic_cast<MidiRouterNode*> (node.get());
+        MatrixState matrix (4, 4);
+        matrix.set (3, 0, true);
+        router->setMatrixState (matrix);
+        router->setRouteChannels (3, 0, 0x00ff, 5);
+
+        MemoryBlock block;
+        router->getState (block);
+
+        GraphNodePtr other = new MidiRouterNode (4, 4);
+        auto* restored = dynamic_cast<MidiRouterNode*> (other.get());
+        restored->setState (block.getData(), (int) block.getSize());
+        expect (restored->getMatrixState().connected (3, 0));
+        expect (! restored->getMatrixState().connected (0, 0));
+        expectEquals (restored->getRouteChannelMask (3, 0), 0x00ff);
+        expectEquals (restored->getRouteOutputChannel (3, 0), 5);
+    }
+};
+
+static MidiRouterNodeTest sMidiRouterNodeTest;
+
+}
@@ -0,0 +1,215 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/OSCIngress.h"
+#include "engine/nodes/OSCReceiverNode.h"
+
+namespace Element {
+
+class OSCIngressTest : public UnitTestBase
+{
+public:
+    OSCIngressTest() : UnitTestBase ("OSC Ingress", "engine", "oscIngress") { }
+
+    void runTest() override
+    {
+        testTrie();
+        testParser();
+        testMidi();
+    }
+
+private:
+    /** Writes a message the way OSCSender does */
+    static MemoryBlock writeMessage (const OSCMessage& message)
+    {
+        MemoryBlock block;
+        MemoryOutputStream out (block, false);
+        auto writeString = [&out] (const String& s)
+        {
+            out.write (s.toRawUTF8(), s.getNumBytesAsUTF8() + 1);
+            while (out.getPosition() % 4 != 0)
+                out.writeByte (0);
+        };
+
+        writeString (message.getAddressPattern().toString());
+        String types (",");
+        for (const auto& arg : message)
+            types << (char) arg.getType();
+        writeString (types);
+
+        for (const auto& arg : message)
+        {
+            if (arg.isInt32())
+                out.writeIntBigEndian (arg.getInt32());
+            else if (arg.isFloat32())
+                out.writeFloatBigEndian (arg.getFloat32());
+            else if (arg.isString())
+                writeString (arg.getString());
+            else if (arg.isBlob())
+            {
+                const auto& blob = arg.getBlob();
+                out.writeIntBigEndian ((int) blob.getSize());
+                out.write (blob.getData(), blob.getSize());
+                while (out.getPosition() % 4 != 0)
+                    out.writeByte (0);
+            }
+        }
+
+        out.flush();
+        return block;
+    }
+
+    void testTrie()
+    {
+        beginTest ("trie matching");
+        OSCAddressTrie trie;
+        trie.add ("/midi/noteOn", 1);
+        trie.add ("/midi/*/noteOn", 2);
+        trie.add ("/midi/dev/start", 3);
+        trie.add ("/a/*/c", 4);
+        trie.add ("/a/b/d", 5);
+        trie.compile();
+
+        expectEquals (trie.match ("/midi/noteOn"), 1);
+        expectEquals (trie.match ("/midi/keys/noteOn"), 2);
+        expectEquals (trie.match ("/midi/dev/start"), 3);
+        expectEquals (trie.match ("/midi/dev/noteOn"), 2, "should backtrack to the wildcard");
+        expectEquals (trie.match ("/a/b/c"), 4, "should backtrack to the wildcard");
+        expectEquals (trie.match ("/a/b/d"), 5);
+        expectEquals (trie.match ("/midi/noteOff"), -1);
+        expectEquals (trie.match ("/midi"), -1);
+        expectEquals (trie.match ("/midi/keys/noteOn/extra"), -1);
+    }
+
+    void testParser()
+    {
+        beginTest ("message parsing");
+        OSCMessage message ("/test/path", 42, 0.5f, String ("hello"));
+        const auto packet = writeMessage (message);
+
+        int count = 0;
+        expect (OSCPacketParser::parse (packet.getData(), (int) packet.getSize(),
+            [this, &count] (const OSCMessageView& view)
+            {
+                ++count;
+                expectEquals (String::fromUTF8 (view.address, view.addressLength), String ("/test/path"));
+                expectEquals (view.numArguments, 3);
+                expectEquals (view.getInt (0), 42);
+                expectEquals (view.getFloat (1), 0.5f);
+                expectEquals (String::fromUTF8 (view.getString (2)), String ("hello"));
+
+                OSCMessage copy ("/");
+                expect (view.toMessage (copy));
+                expectEquals (copy.size(), 3);
+            }));
+        expectEquals (count, 1);
+
+        beginTest ("bundle parsing");
+        MemoryBlock bundle;
+        {
+            MemoryOutputStream out (bundle, false);
+            out.write ("#bundle", 8);
+            out.writeInt64BigEndian (1);
+            for (int i = 0; i < 3; ++i)
+            {
+                const auto element = writeMessage (OSCMessage ("/n", i));
+                out.writeIntBigEndian ((int) element.getSize());
+                out << element;
+            }
+        }
+
+        Array<int> values;
+        expect (OSCPacketParser::parse (bundle.getData(), (int) bundle.getSize(),
+            [&values] (const OSCMessageView& view) { values.add (view.getInt (0)); }));
+        expectEquals (values.size(), 3);
+        for (int i = 0; i < values.size(); ++i)
+            expectEquals (values[i], i);
+
+        beginTest ("malformed packets");
+        auto truncated = writeMessage (message);
+        truncated.setSize (truncated.getSize() - 8);
+        expect (! OSCPacketParser::parse (truncated.getData(), (int) truncated.getSize(),
+                                          [] (const OSCMessageView&) { }));
+        const char junk[] = "not osc";
+        expect (! OSCPacketParser::parse (junk, (int) sizeof (junk), [] (const OSCMessageView&) { }));
+
+        // a blob claiming nearly 2 GB must not pass the bounds check
+        OSCMessage blobMessage ("/blob");
+        blobMessage.addBlob (MemoryBlock (4, true));
+        auto huge = writeMessage (blobMessage);
+        auto* const blobSize = static_cast<uint8*> (huge.getData()) + huge.getSize() - 8;
+        const uint8 length[] = { 0x7f, 0xff, 0xff, 0xfd };
+        memcpy (blobSize, length, sizeof (length));
+        bool parsed = false;
+        expect (! OSCPacketParser::parse (huge.getData(), (int) huge.getSize(),
+                                          [&parsed] (const OSCMessageView&) { parsed = true; }));
+        expect (! parsed, "an oversized blob should be rejected");
+    }
+
+    int decode (const OSCMessage& message, uint8* data)
+    {
+        const auto packet = writeMessage (message);
+        int size = -1;
+        OSCPacketParser::parse (packet.getData(), (int) packet.getSize(), [&] (const OSCMessageView& view) {
+            size = OSCReceiverNode::decodeMidi (view, data, 16);
+        });
+        return size;
+    }
+
+    void testMidi()
+    {
+        beginTest ("decoding midi");
+        uint8 data[16];
+
+        expectEquals (decode (OSCMessage ("/midi/noteOn", 2, 60, 1.0f), data), 3);
+        expect (data[0] == 0x91 && data[1] == 60 && data[2] == 127);
+
+        expectEquals (decode (OSCMessage ("/midi/keys/noteOff", 1, 61, 0.0f), data), 3);
+        expect (data[0] == 0x80 && data[1] == 61 && data[2] == 0);
+
+        expectEquals (decode (OSCMessage ("/midi/programChange", 16, 5), data), 2);
+        expect (data[0] == 0xcf && data[1] == 5);
+
+        expectEquals (decode (OSCMessage ("/midi/channelPressure", 1, 100), data), 2);
+        expect (data[0] == 0xd0 && data[1] == 100);
+
+        expectEquals (decode (OSCMessage ("/midi/pitchBend", 1, 8192), data), 3);
+        expect (data[0] == 0xe0 && data[1] == 0 && data[2] == 64);
+
+        expectEquals (decode (OSCMessage ("/midi/controlChange", 1, 7, 100), data), 3);
+        expect (data[0] == 0xb0 && data[1] == 7 && data[2] == 100);
+
+        expectEquals (decode (OSCMessage ("/midi/allNotesOff", 3), data), 3);
+        expect (data[0] == 0xb2 && data[1] == 123);
+
+        expectEquals (decode (OSCMessage ("/midi/clock"), data), 1);
+        expect (data[0] == 0xf8);
+
+        const uint8 raw[] = { 0x90, 64, 100 };
+        expectEquals (decode (OSCMessage ("/midi/raw", MemoryBlock (raw, 3)), data), 3);
+        expect (memcmp (data, raw, 3) == 0);
+
+        expectEquals (decode (OSCMessage ("/midi/unknown", 1), data), 0);
+        expectEquals (decode (OSCMessage ("/other/noteOn", 1, 60, 1.0f), data), 0);
+    }
+};
+
+static OSCIngressTest sOSCIngressTest;
+
+}
@@ -0,0 +1,135 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/OSCIngress.h"
+#include "engine/nodes/OSCReceiverNode.h"
+#include "engine/nodes/OSCSenderNode.h"
+
+namespace Element {
+
+class OSCSenderTest : public UnitTestBase
+{
+public:
+    OSCSenderTest() : UnitTestBase ("OSC Sender", "engine", "oscSender") { }
+
+    void runTest() override
+    {
+        testRoundTrip();
+        testBundles();
+        testOverflow();
+        testTimeTags();
+    }
+
+private:
+    using PacketWriter = OSCSenderNode::PacketWriter;
+
+    void testRoundTrip()
+    {
+        beginTest ("midi round trip");
+        const uint8 messages[][3] = {
+            { 0x91, 60, 127 }, { 0x80, 61, 0 }, { 0xb3, 7, 100 }, { 0xc0, 5, 0 },
+            { 0xd1, 90, 0 }, { 0xe0, 0, 64 }, { 0xa2, 60, 30 }
+        };
+        const int sizes[] = { 3, 3, 3, 2, 2, 3, 3 };
+
+        uint8 buffer[512];
+        for (int i = 0; i < numElementsInArray (sizes); ++i)
+        {
+            PacketWriter writer (buffer, sizeof (buffer));
+            expect (writer.addMidi (messages[i], sizes[i]));
+            expect (! writer.isEmpty());
+
+            uint8 decoded[16];
+            int size = 0;
+            expect (OSCPacketParser::parse (buffer, writer.getSize(), [&] (const OSCMessageView& view) {
+                size = OSCReceiverNode::decodeMidi (view, decoded, sizeof (decoded));
+            }));
+            expectEquals (size, sizes[i]);
+            expect (memcmp (decoded, messages[i], (size_t) sizes[i]) == 0);
+        }
+
+        PacketWriter writer (buffer, sizeof (buffer));
+        const uint8 sysex[] = { 0xf0, 0x7e, 0xf7 };
+        expect (writer.addMidi (sysex, 3));
+        expect (writer.isEmpty(), "messages without an address are skipped");
+    }
+
+    void testBundles()
+    {
+        beginTest ("nested bundles");
+        uint8 buffer[2048];
+        PacketWriter writer (buffer, sizeof (buffer));
+        expect (writer.beginBundle (1));
+        for (int offset = 0; offset < 4; ++offset)
+        {
+            expect (writer.beginBundle (100 + (uint64) offset));
+            for (int cc = 0; cc < 8; ++cc)
+            {
+                const uint8 midi[] = { 0xb0, (uint8) cc, (uint8) offset };
+                expect (writer.addMidi (midi, 3));
+            }
+            writer.endBundle();
+        }
+        writer.endBundle();
+        expectEquals (writer.getDepth(), 0);
+
+        int count = 0;
+        bool inOrder = true;
+        expect (OSCPacketParser::parse (buffer, writer.getSize(), [&] (const OSCMessageView& view) {
+            inOrder &= view.getInt (1) == count % 8 && view.getInt (2) == count / 8;
+            ++count;
+        }));
+        expectEquals (count, 32);
+        expect (inOrder);
+    }
+
+    void testOverflow()
+    {
+        beginTest ("full packets are left intact");
+        uint8 buffer[64];
+        PacketWriter writer (buffer, sizeof (buffer));
+        expect (writer.beginBundle (1));
+        const uint8 midi[] = { 0x90, 60, 100 };
+        int added = 0;
+        while (writer.addMidi (midi, 3))
+            ++added;
+        expectGreaterThan (added, 0);
+        writer.endBundle();
+
+        int count = 0;
+        expect (OSCPacketParser::parse (buffer, writer.getSize(), [&count] (const OSCMessageView&) { ++count; }));
+        expectEquals (count, added);
+    }
+
+    void testTimeTags()
+    {
+        beginTest ("time tags");
+        const int64 wall = 1500000000000;
+        const uint64 tag = OSCSenderNode::toTimeTag (1500.0, 1000.0, wall);
+        expectEquals ((int64) (tag >> 32), (int64) 1500000000 + 2208988800);
+        expectWithinAbsoluteError ((double) (tag & 0xffffffff) / 4294967296.0, 0.5, 1.0e-6);
+
+        const uint64 later = OSCSenderNode::toTimeTag (1500.0 + 1000.0 / 48000.0, 1000.0, wall);
+        expectGreaterThan (later, tag);
+    }
+};
+
+static OSCSenderTest sOSCSenderTest;
+
+}
@@ -0,0 +1,117 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/Oversampler.h"
+
+namespace Element {
+
+class OversamplerBenchmark : public UnitTestBase
+{
+public:
+    OversamplerBenchmark() : UnitTestBase ("Oversampler Benchmark", "benchmarks", "oversampling") { }
+
+    void runTest() override
+    {
+        for (const auto quality : { Oversampler::IIR, Oversampler::FIR })
+        {
+            testRoundTrip (quality);
+            for (int factor = 2; factor <= Oversampler::maxFactor; factor *= 2)
+                benchmark (factor, quality);
+        }
+    }
+
+private:
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+    const int numBlocks = 1000;
+
+    static void fillSine (AudioBuffer<float>& buffer, int offset, double freq)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample (ch, i, (float) std::sin (MathConstants<double>::twoPi * freq * (double) (offset + i)));
+    }
+
+    void testRoundTrip (Oversampler::Quality quality)
+    {
+        beginTest (Oversampler::getQualityName (quality) + " round trip");
+        Oversampler oversampler;
+        oversampler.prepare (2, blockSize, 4, quality);
+        expectEquals (oversampler.getLatencySamples(), Oversampler::getLatencySamples (4, quality));
+
+        // a low tone comes back with the same level
+        AudioBuffer<float> buffer (2, blockSize);
+        float inputLevel = 0.0f, outputLevel = 0.0f;
+        for (int b = 0; b < 8; ++b)
+        {
+            fillSine (buffer, b * blockSize, 1000.0 / sampleRate);
+            inputLevel = buffer.getRMSLevel (0, 0, blockSize);
+            oversampler.processUp (buffer);
+            oversampler.processDown (buffer);
+            outputLevel = buffer.getRMSLevel (0, 0, blockSize);
+        }
+
+        expectWithinAbsoluteError (Decibels::gainToDecibels (outputLevel / inputLevel), 0.0f, 0.1f);
+    }
+
+    void benchmark (int factor, Oversampler::Quality quality)
+    {
+        const String name = Oversampler::getQualityName (quality) + " " + String (factor) + "x";
+        beginTest (name);
+        AudioBuffer<float> buffer (2, blockSize);
+        fillSine (buffer, 0, 440.0 / sampleRate);
+
+        Oversampler oversampler;
+        oversampler.prepare (2, blockSize, factor, quality);
+        auto start = Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            oversampler.processUp (buffer);
+            oversampler.processDown (buffer);
+        }
+        const auto ticks = Time::getHighResolutionTicks() - start;
+
+        // the juce implementation it replaced
+        using JuceOversampling = dsp::Oversampling<float>;
+        JuceOversampling reference (2, (size_t) std::log2 (factor), quality == Oversampler::FIR
+            ? JuceOversampling::filterHalfBandFIREquiripple : JuceOversampling::filterHalfBandPolyphaseIIR);
+        reference.initProcessing ((size_t) blockSize);
+        start = Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            dsp::AudioBlock<float> block (buffer);
+            reference.processSamplesUp (block);
+            reference.processSamplesDown (block);
+        }
+        const auto referenceTicks = Time::getHighResolutionTicks() - start;
+
+        const auto ms = 1000.0 * Time::highResolutionTicksToSeconds (ticks);
+        const auto referenceMs = 1000.0 * Time::highResolutionTicksToSeconds (referenceTicks);
+        String message = name;
+        message << ": " << String (ms / (double) numBlocks * 1000.0, 2) << " us per block, dsp::Oversampling "
+                << String (referenceMs / (double) numBlocks * 1000.0, 2) << " us, latency "
+                << oversampler.getLatencySamples() << " samples";
+        logMessage (message);
+        expect (buffer.getMagnitude (0, blockSize) < 10.0f);
+    }
+};
+
+static OversamplerBenchmark sOversamplerBenchmark;
+
+}
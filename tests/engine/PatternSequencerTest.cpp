@@ -0,0 +1,198 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/PatternSequencer.h"
+
+namespace Element {
+
+class PatternSequencerTest : public UnitTestBase
+{
+public:
+    PatternSequencerTest() : UnitTestBase ("Pattern Sequencer", "engine", "patternSequencer") { }
+
+    void runTest() override
+    {
+        testTiming();
+        testSwing();
+        testLoop();
+        testArpeggiator();
+        testStopAndRelocate();
+    }
+
+private:
+    // 120 bpm at 44.1 kHz is 22050 samples a beat
+    const double sampleRate = 44100.0;
+    const double samplesPerBeat = 22050.0;
+    const int blockSize = 512;
+
+    struct Event
+    {
+        int64 frame;
+        int status;
+        int note;
+    };
+
+    Array<Event> run (PatternSequencer& seq, int numBlocks, double startBeat = 0.0,
+                      const MidiBuffer& firstInput = MidiBuffer())
+    {
+        Array<Event> events;
+        PatternSequencer::Position position;
+        position.playing = true;
+        position.tempo = 120.0;
+        MidiBuffer output, empty;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            position.beat = startBeat + (double) (b * blockSize) / samplesPerBeat;
+            output.clear();
+            seq.render (position, blockSize, b == 0 ? firstInput : empty, output);
+
+            MidiBuffer::Iterator iter (output);
+            const uint8* data = nullptr;
+            int size = 0, frame = 0;
+            while (iter.getNextEvent (data, size, frame))
+                events.add ({ (int64) b * blockSize + frame, data[0] & 0xf0, (int) data[1] });
+        }
+
+        return events;
+    }
+
+    static Array<Event> noteOns (const Array<Event>& events)
+    {
+        Array<Event> ons;
+        for (const auto& event : events)
+            if (event.status == 0x90)
+                ons.add (event);
+        return ons;
+    }
+
+    void testTiming()
+    {
+        beginTest ("steps land on their samples");
+        PatternSequencer seq;
+        seq.prepare (sampleRate);
+        seq.setStepLength (0.5);
+
+        const auto events = run (seq, 100);
+        const auto ons = noteOns (events);
+        expectGreaterOrEqual (ons.size(), 4);
+        for (int i = 0; i < 4; ++i)
+            expectEquals (ons[i].frame, (int64) (i * 11025));
+
+        // a 50% gate releases a quarter of a beat later
+        expectEquals (events[1].status, 0x80);
+        expect (std::abs (events[1].frame - 5512) <= 1);
+    }
+
+    void testSwing()
+    {
+        beginTest ("swing delays every second step");
+        PatternSequencer seq;
+        seq.prepare (sampleRate);
+        seq.setStepLength (0.5);
+        seq.setSwing (0.5f);
+
+        const auto ons = noteOns (run (seq, 100));
+        expectEquals (ons[0].frame, (int64) 0);
+        expectEquals (ons[1].frame, (int64) 13781);     // 0.625 beats
+        expectEquals (ons[2].frame, (int64) 22050);
+    }
+
+    void testLoop()
+    {
+        beginTest ("loop points");
+        PatternSequencer seq;
+        seq.prepare (sampleRate);
+        seq.setStepLength (0.5);
+        for (int i = 0; i < 4; ++i)
+        {
+            PatternSequencer::Step step;
+            step.note = 60 + i;
+            seq.setStep (i, step);
+        }
+        seq.setLoop (2, 4);
+        expectEquals (seq.getPatternStep (1), 1);
+        expectEquals (seq.getPatternStep (4), 2);
+        expectEquals (seq.getPatternStep (7), 3);
+
+        const auto ons = noteOns (run (seq, 200));
+        const int expected[] = { 60, 61, 62, 63, 62, 63, 62 };
+        for (int i = 0; i < numElementsInArray (expected); ++i)
+            expectEquals (ons[i].note, expected[i]);
+    }
+
+    void testArpeggiator()
+    {
+        beginTest ("arpeggiator");
+        PatternSequencer seq;
+        seq.prepare (sampleRate);
+        seq.setStepLength (0.5);
+        seq.setMode (PatternSequencer::arpUpDown);
+
+        MidiBuffer held;
+        held.addEvent (MidiMessage::noteOn (1, 64, (uint8) 100), 0);
+        held.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 0);
+        held.addEvent (MidiMessage::noteOn (1, 67, (uint8) 100), 0);
+        held.addEvent (MidiMessage::controllerEvent (1, 1, 64), 0);
+
+        const auto events = run (seq, 200, 0.0, held);
+        expectEquals (seq.getNumHeldNotes(), 3);
+        expectEquals (events[0].status, 0xb0, "other messages should pass");
+
+        const auto ons = noteOns (events);
+        const int upDown[] = { 60, 64, 67, 64, 60, 64 };
+        for (int i = 0; i < numElementsInArray (upDown); ++i)
+            expectEquals (ons[i].note, upDown[i]);
+
+        seq.setMode (PatternSequencer::arpUp);
+        seq.setOctaves (2);
+        const auto octaves = noteOns (run (seq, 200, 0.0));
+        const int up[] = { 60, 64, 67, 72, 76, 79, 60 };
+        for (int i = 0; i < numElementsInArray (up); ++i)
+            expectEquals (octaves[i].note, up[i]);
+    }
+
+    void testStopAndRelocate()
+    {
+        beginTest ("stopping and relocating release notes");
+        PatternSequencer seq;
+        seq.prepare (sampleRate);
+        seq.setStepLength (1.0);
+
+        // the first note is still sounding after one block
+        run (seq, 1);
+        expectEquals (seq.getNumSoundingNotes(), 1);
+
+        MidiBuffer output;
+        PatternSequencer::Position stopped;
+        seq.render (stopped, blockSize, MidiBuffer(), output);
+        expectEquals (output.getNumEvents(), 1);
+        expectEquals (seq.getNumSoundingNotes(), 0);
+
+        run (seq, 1);
+        const auto events = run (seq, 1, 8.25);
+        expectEquals (events.size(), 1);
+        expectEquals (events[0].status, 0x80, "a jump should release the old note");
+        expectEquals (seq.getNumSoundingNotes(), 0);
+    }
+};
+
+static PatternSequencerTest sPatternSequencerTest;
+
+}
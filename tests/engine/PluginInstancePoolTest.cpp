@@ -0,0 +1,180 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/PluginInstancePool.h"
+
+namespace Element {
+
+static const int64 megabyte = 1024 * 1024;
+
+class PluginInstancePoolTest : public UnitTestBase
+{
+public:
+    PluginInstancePoolTest() : UnitTestBase ("Plugin Instance Pool", "engine", "pluginPool") { }
+
+    void initialise() override
+    {
+        MessageManager::getInstance();
+    }
+
+    void runTest() override
+    {
+        testReuse();
+        testNodeReuse();
+        testEviction();
+        testTimeout();
+    }
+
+private:
+    class TestInstance : public AudioPluginInstance
+    {
+    public:
+        TestInstance (const String& n) : name (n) { }
+
+        void fillInPluginDescription (PluginDescription& desc) const override
+        {
+            desc.name               = name;
+            desc.pluginFormatName   = "Test";
+            desc.fileOrIdentifier   = name;
+            desc.uid                = name.hashCode();
+        }
+
+        PluginDescription getDescription() const
+        {
+            PluginDescription desc;
+            fillInPluginDescription (desc);
+            return desc;
+        }
+
+        const String getName() const override                        { return name; }
+        void prepareToPlay (double, int) override                    { }
+        void releaseResources() override                             { }
+        void processBlock (AudioSampleBuffer&, MidiBuffer&) override { }
+        double getTailLengthSeconds() const override                 { return 0.0; }
+        bool acceptsMidi() const override                            { return false; }
+        bool producesMidi() const override                           { return false; }
+        AudioProcessorEditor* createEditor() override                { return nullptr; }
+        bool hasEditor() const override                              { return false; }
+        int getNumPrograms() override                                { return 1; }
+        int getCurrentProgram() override                             { return 0; }
+        void setCurrentProgram (int) override                        { }
+        const String getProgramName (int) override                   { return String(); }
+        void changeProgramName (int, const String&) override         { }
+        void getStateInformation (MemoryBlock& block) override       { block.setSize (stateSize, true); }
+        void setStateInformation (const void*, int) override         { }
+
+        size_t stateSize = 0;
+
+    private:
+        String name;
+    };
+
+    void testReuse()
+    {
+        beginTest ("reuse");
+        PluginInstancePool pool;
+        auto* first = new TestInstance ("One");
+        auto* second = new TestInstance ("Two");
+        const auto desc = first->getDescription();
+        pool.add (first, megabyte);
+        pool.add (second, megabyte);
+        expectEquals (pool.size(), 2);
+        expectEquals (pool.getMemoryUsed(), 2 * megabyte);
+
+        std::unique_ptr<AudioPluginInstance> taken (pool.take (desc));
+        expect (taken.get() == first, "should hand back the parked instance");
+        expectEquals (pool.size(), 1);
+        expectEquals (pool.getMemoryUsed(), megabyte);
+        expect (pool.take (desc) == nullptr, "an instance can only be taken once");
+        pool.clear();
+        expectEquals (pool.getMemoryUsed(), (int64) 0);
+    }
+
+    void testNodeReuse()
+    {
+        beginTest ("node reuse");
+        PluginInstancePool pool;
+        GraphProcessor graph;
+        auto* instance = new TestInstance ("One");
+        GraphNodePtr node = graph.addNode (instance, 0);
+        expect (node != nullptr);
+        expect (pool.canPool (*node));
+        node->setMuted (true);
+        node->setGain (0.5f);
+        graph.removeNode (node->nodeId);
+
+        expect (pool.add (node));
+        expect (node->getAudioProcessor() == nullptr, "instance should be detached from the node");
+        node = nullptr;
+
+        auto* pooled = pool.take (instance->getDescription());
+        expect (pooled == instance);
+        node = graph.addNode (pooled, 0);
+        expect (node != nullptr && node->getAudioProcessor() == instance);
+        expect (! node->isMuted(), "node settings shouldn't carry over");
+        expectEquals (node->getGain(), 1.f);
+        node = nullptr;
+        graph.clear();
+    }
+
+    void testEviction()
+    {
+        beginTest ("eviction");
+        PluginInstancePool pool;
+        pool.setMaxMemory (3 * megabyte);
+        auto* oldest = new TestInstance ("One");
+        const auto oldestDesc = oldest->getDescription();
+        pool.add (oldest, megabyte);
+        pool.add (new TestInstance ("Two"), megabyte);
+        pool.add (new TestInstance ("Three"), 2 * megabyte);
+        expectEquals (pool.size(), 2);
+        expectEquals (pool.getMemoryUsed(), 3 * megabyte);
+        expect (pool.take (oldestDesc) == nullptr, "oldest should be evicted first");
+
+        pool.add (new TestInstance ("Four"), 4 * megabyte);
+        expectEquals (pool.size(), 2, "instances larger than the budget aren't kept");
+
+        pool.setMaxMemory (2 * megabyte);
+        expectEquals (pool.size(), 1);
+        expectEquals (pool.getMemoryUsed(), 2 * megabyte);
+
+        TestInstance sized ("Five");
+        expectEquals (PluginInstancePool::estimateSize (sized), 8 * megabyte);
+        sized.stateSize = 20 * megabyte;
+        expectEquals (PluginInstancePool::estimateSize (sized), 20 * megabyte);
+    }
+
+    void testTimeout()
+    {
+        beginTest ("timeout");
+        PluginInstancePool pool;
+        pool.add (new TestInstance ("One"), megabyte);
+        expectEquals (pool.size(), 1);
+        pool.setTimeout (0);
+        expectEquals (pool.size(), 0);
+        expectEquals (pool.getMemoryUsed(), (int64) 0);
+        pool.add (new TestInstance ("Two"), megabyte);
+        expectEquals (pool.size(), 0, "a zero timeout disables the pool");
+    }
+};
+
+static PluginInstancePoolTest sPluginInstancePoolTest;
+
+}
@@ -0,0 +1,111 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/Sampler.h"
+
+namespace Element {
+
+class SamplerBenchmark : public UnitTestBase
+{
+public:
+    SamplerBenchmark() : UnitTestBase ("Sampler Benchmark", "benchmarks", "sampler") { }
+
+    void initialise() override
+    {
+        formats.registerBasicFormats();
+        writeSine (wavFile.getFile(), sampleLength);
+    }
+
+    void runTest() override
+    {
+        testVoiceCost();
+    }
+
+private:
+    const double sampleRate = 44100.0;
+    const int sampleLength = 441000;
+    const int blockSize = 256;
+    AudioFormatManager formats;
+    TemporaryFile wavFile { ".wav" };
+
+    static float sourceSample (int frame)
+    {
+        return 0.5f * (float) std::sin (MathConstants<double>::twoPi * 441.0 * (double) frame / 44100.0);
+    }
+
+    void writeSine (const File& file, int numFrames)
+    {
+        AudioBuffer<float> sine (1, numFrames);
+        for (int i = 0; i < numFrames; ++i)
+            sine.setSample (0, i, sourceSample (i));
+
+        file.deleteFile();
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatWriter> writer (wav.createWriterFor (
+            file.createOutputStream(), sampleRate, 1, 32, {}, 0));
+        expect (writer != nullptr);
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer (sine, 0, numFrames);
+    }
+
+    static void noteOn (MidiBuffer& midi, int note)
+    {
+        midi.addEvent (MidiMessage::noteOn (1, note, (uint8) 127), 0);
+    }
+
+    void testVoiceCost()
+    {
+        beginTest ("voice cost");
+        String error;
+        Sampler sampler;
+        sampler.setSampleMap (SampleMap::fromSample (wavFile.getFile(), formats, error));
+        sampler.prepare (sampleRate, blockSize);
+
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+        for (int i = 0; i < Sampler::maxVoices; ++i)
+            noteOn (midi, 48 + i);
+
+        const int numBlocks = 500;
+        int64 ticks = 0;
+        int64 voiceSamples = 0;
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            buffer.clear();
+            const auto start = Time::getHighResolutionTicks();
+            sampler.render (buffer, midi);
+            ticks += Time::getHighResolutionTicks() - start;
+            voiceSamples += (int64) sampler.getNumActiveVoices() * blockSize;
+            midi.clear();
+            while (sampler.serviceStreams()) { }
+        }
+
+        expectEquals (sampler.getNumUnderruns(), 0);
+
+        const auto ns = 1.0e9 * Time::highResolutionTicksToSeconds (ticks) / (double) jmax ((int64) 1, voiceSamples);
+        String message;
+        message << "memory: " << File::descriptionOfSizeInBytes ((int64) sampler.getMemoryUsage())
+                << ", " << String (ns, 2) << " ns per voice sample";
+        logMessage (message);
+    }
+};
+
+static SamplerBenchmark sSamplerBenchmark;
+
+}
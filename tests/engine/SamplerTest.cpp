@@ -0,0 +1,203 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/SamplerProcessor.h"
+#include "engine/Sampler.h"
+
+namespace Element {
+
+class SamplerTest : public UnitTestBase
+{
+public:
+    SamplerTest() : UnitTestBase ("Sampler", "engine", "sampler") { }
+
+    void initialise() override
+    {
+        formats.registerBasicFormats();
+        writeSine (wavFile.getFile(), sampleLength);
+    }
+
+    void runTest() override
+    {
+        testStreaming();
+        testStealing();
+        testSFZ();
+        testLoader();
+    }
+
+private:
+    const double sampleRate = 44100.0;
+    const int sampleLength = 441000;
+    const int blockSize = 256;
+    AudioFormatManager formats;
+    TemporaryFile wavFile { ".wav" };
+
+    static float sourceSample (int frame)
+    {
+        return 0.5f * (float) std::sin (MathConstants<double>::twoPi * 441.0 * (double) frame / 44100.0);
+    }
+
+    void writeSine (const File& file, int numFrames)
+    {
+        AudioBuffer<float> sine (1, numFrames);
+        for (int i = 0; i < numFrames; ++i)
+            sine.setSample (0, i, sourceSample (i));
+
+        file.deleteFile();
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatWriter> writer (wav.createWriterFor (
+            file.createOutputStream(), sampleRate, 1, 32, {}, 0));
+        expect (writer != nullptr);
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer (sine, 0, numFrames);
+    }
+
+    static void noteOn (MidiBuffer& midi, int note)
+    {
+        midi.addEvent (MidiMessage::noteOn (1, note, (uint8) 127), 0);
+    }
+
+    void testStreaming()
+    {
+        beginTest ("streams past the head");
+        String error;
+        Sampler sampler;
+        sampler.setSampleMap (SampleMap::fromSample (wavFile.getFile(), formats, error, 1024));
+        expect (error.isEmpty(), error);
+        sampler.prepare (sampleRate, blockSize);
+
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+        noteOn (midi, 60);
+
+        float maxError = 0.0f;
+        for (int offset = 0; offset < 100000; offset += blockSize)
+        {
+            buffer.clear();
+            sampler.render (buffer, midi);
+            midi.clear();
+            while (sampler.serviceStreams()) { }
+
+            for (int i = 0; i < blockSize; ++i)
+                for (int ch = 0; ch < 2; ++ch)
+                    maxError = jmax (maxError, std::abs (buffer.getSample (ch, i) - sourceSample (offset + i)));
+        }
+
+        expectLessThan (maxError, 1.0e-6f);
+        expectEquals (sampler.getNumUnderruns(), 0);
+        expectEquals (sampler.getNumActiveVoices(), 1);
+    }
+
+    void testStealing()
+    {
+        beginTest ("stolen voices fade out");
+        String error;
+        Sampler sampler;
+        sampler.setSampleMap (SampleMap::fromSample (wavFile.getFile(), formats, error));
+        sampler.prepare (sampleRate, blockSize);
+
+        // every voice plays the same note in phase
+        AudioBuffer<float> buffer (2, blockSize);
+        MidiBuffer midi;
+        for (int i = 0; i < Sampler::maxVoices; ++i)
+            noteOn (midi, 60);
+        sampler.render (buffer, midi);
+        midi.clear();
+        while (sampler.serviceStreams()) { }
+        expectEquals (sampler.getNumActiveVoices(), Sampler::maxVoices);
+
+        // one more steals the oldest, which fades instead of cutting
+        buffer.clear();
+        noteOn (midi, 60);
+        sampler.render (buffer, midi);
+        expectEquals (sampler.getNumActiveVoices(), Sampler::maxVoices);
+
+        const int fadeFrames = roundToInt (Sampler::stealFadeSeconds * sampleRate);
+        auto stolen = [&] (int i) {
+            return buffer.getSample (0, i) - (float) (Sampler::maxVoices - 1) * sourceSample (blockSize + i)
+                                           - sourceSample (i);
+        };
+
+        expectWithinAbsoluteError (stolen (0), sourceSample (blockSize), 0.01f);
+        float maxAfterFade = 0.f;
+        for (int i = 0; i < blockSize; ++i)
+        {
+            expect (std::abs (stolen (i)) <= std::abs (sourceSample (blockSize + i)) + 1.0e-4f);
+            if (i > fadeFrames)
+                maxAfterFade = jmax (maxAfterFade, std::abs (stolen (i)));
+        }
+        expectLessThan (maxAfterFade, 1.0e-4f);
+    }
+
+    void testSFZ()
+    {
+        beginTest ("sfz zones");
+        const auto name = wavFile.getFile().getFileName();
+        String text;
+        text << "// test\n"
+             << "<global> volume=-6\n"
+             << "<group> lovel=1 hivel=63\n"
+             << "<region> sample=" << name << " lokey=c4 hikey=b4 pitch_keycenter=e4\n"
+             << "<group> lovel=64\n"
+             << "<region> sample=" << name << " key=72 tune=50 ampeg_release=0.5\n";
+
+        String error;
+        std::unique_ptr<SampleMap> map (SampleMap::fromSFZText (
+            text, wavFile.getFile().getParentDirectory(), formats, error));
+        expect (map != nullptr, error);
+        if (map == nullptr)
+            return;
+
+        expectEquals (map->getNumZones(), 2);
+        auto* low = map->getZone (0);
+        expectEquals (low->loKey, 60);
+        expectEquals (low->hiKey, 71);
+        expectEquals (low->rootKey, 64);
+        expectEquals (low->hiVel, 63);
+        expectWithinAbsoluteError (low->gain, Decibels::decibelsToGain (-6.0f), 0.001f);
+
+        auto* high = map->getZone (1);
+        expectEquals (high->loKey, 72);
+        expectEquals (high->rootKey, 72);
+        expectEquals (high->loVel, 64);
+        expectWithinAbsoluteError (high->tune, 0.5f, 0.001f);
+        expectWithinAbsoluteError (high->release, 0.5f, 0.001f);
+
+        expect (map->findZone (65, 10) == low);
+        expect (map->findZone (72, 100) == high);
+        expect (map->findZone (72, 10) == nullptr);
+    }
+
+    void testLoader()
+    {
+        beginTest ("loads in the background");
+        SamplerProcessor sampler;
+        sampler.loadFile (wavFile.getFile());
+
+        const auto timeout = Time::getMillisecondCounter() + 5000;
+        while (sampler.getStatus() == "Loading..." && Time::getMillisecondCounter() < timeout)
+            Thread::sleep (5);
+
+        expect (sampler.getStatus().startsWith (wavFile.getFile().getFileName()), sampler.getStatus());
+    }
+};
+
+static SamplerTest sSamplerTest;
+
+}
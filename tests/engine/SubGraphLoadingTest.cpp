@@ -0,0 +1,129 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "controllers/GraphManager.h"
+
+namespace Element {
+
+class SubGraphLoadingTest : public UnitTestBase
+{
+public:
+    SubGraphLoadingTest() : UnitTestBase ("Sub Graph Loading", "engine", "subGraphLoading") { }
+
+    void initialise() override
+    {
+        initializeWorld();
+        graph.reset (new GraphProcessor());
+        graph->prepareToPlay (44100.0, 512);
+    }
+
+    void shutdown() override
+    {
+        graph->releaseResources();
+        graph.reset (nullptr);
+        shutdownWorld();
+    }
+
+    void runTest() override
+    {
+        testLoadsWhenEnabled();
+        testPrefetch();
+    }
+
+private:
+    std::unique_ptr<GraphProcessor> graph;
+
+    /** A root graph holding one disabled sub graph with the default IO nodes */
+    static Node createModel()
+    {
+        Node root = Node::createDefaultGraph ("Root");
+        ValueTree sub (Tags::node);
+        sub.copyPropertiesAndChildrenFrom (Node::createDefaultGraph ("Sub").getValueTree(), nullptr);
+        sub.setProperty (Tags::id, static_cast<int64> (100), nullptr)
+           .setProperty (Tags::format, "Element", nullptr)
+           .setProperty (Tags::identifier, EL_INTERNAL_ID_GRAPH, nullptr)
+           .setProperty (Tags::enabled, false, nullptr);
+        root.getNodesValueTree().appendChild (sub, nullptr);
+        return root;
+    }
+
+    static GraphNodePtr findSubGraph (GraphManager& controller)
+    {
+        for (int i = 0; i < controller.getNumFilters(); ++i)
+            if (auto node = controller.getNode (i))
+                if (node->processor<SubGraphProcessor>() != nullptr)
+                    return node;
+        return nullptr;
+    }
+
+    void testLoadsWhenEnabled()
+    {
+        beginTest ("disabled sub graphs load when enabled");
+        GraphManager controller (*graph, getWorld().getPluginManager());
+        controller.setNodeModel (createModel());
+        GraphNodePtr node = findSubGraph (controller);
+        expect (node != nullptr, "sub graph wasn't created");
+        if (node == nullptr)
+            return;
+
+        auto* const sub = node->processor<SubGraphProcessor>();
+        expect (! node->isEnabled());
+        expect (sub->getController().isDeferred(), "a disabled sub graph shouldn't load");
+        expectEquals (sub->getNumNodes(), 0);
+
+        node->setEnabled (true);
+        runDispatchLoop (10);
+        expect (! sub->getController().isDeferred());
+        expectEquals (sub->getNumNodes(), 4);
+
+        node = nullptr;
+        controller.clear();
+    }
+
+    void testPrefetch()
+    {
+        beginTest ("prefetch loads disabled sub graphs");
+        GraphManager controller (*graph, getWorld().getPluginManager());
+        controller.setNodeModel (createModel());
+        GraphNodePtr node = findSubGraph (controller);
+        expect (node != nullptr, "sub graph wasn't created");
+        if (node == nullptr)
+            return;
+
+        // what EngineController does on each prefetch tick
+        auto* const sub = node->processor<SubGraphProcessor>();
+        auto* deferred = controller.findDeferredSubGraph();
+        expect (deferred == &sub->getController());
+        if (deferred != nullptr)
+            deferred->loadDeferredModel();
+
+        expect (! sub->getController().isDeferred());
+        expectEquals (sub->getNumNodes(), 4);
+        expect (! node->isEnabled(), "prefetching shouldn't enable the graph");
+        expect (controller.findDeferredSubGraph() == nullptr);
+
+        node = nullptr;
+        controller.clear();
+    }
+};
+
+static SubGraphLoadingTest sSubGraphLoadingTest;
+
+}
@@ -0,0 +1,152 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/TransportSync.h"
+
+namespace Element {
+
+class TransportSyncTest : public UnitTestBase
+{
+public:
+    TransportSyncTest() : UnitTestBase ("Transport Sync", "engine", "transportSync") { }
+
+    void runTest() override
+    {
+        testOffsetEstimator();
+        testTimeline();
+        testPeers();
+    }
+
+private:
+    void testOffsetEstimator()
+    {
+        beginTest ("clock offset estimator");
+        ClockOffsetEstimator estimator;
+        const double offset = 1234.5;
+        Random random (42);
+
+        // one way delays differ, the quickest round trip is nearly symmetric
+        for (int i = 0; i < 8; ++i)
+        {
+            const double t1 = 1000.0 * i;
+            const double out = i == 5 ? 0.1 : 0.2 + random.nextDouble() * 3.0;
+            const double back = i == 5 ? 0.1 : 0.2 + random.nextDouble() * 0.5;
+            const double t2 = t1 + out + offset;
+            const double t3 = t2 + 0.05;
+            const double t4 = t3 - offset + back;
+            estimator.addSample (t1, t2, t3, t4);
+        }
+
+        expectEquals (estimator.getNumSamples(), 8);
+        expectWithinAbsoluteError (estimator.getOffset(), offset, 1.0e-9);
+        expectWithinAbsoluteError (estimator.getRoundTrip(), 0.2, 1.0e-9);
+
+        estimator.reset();
+        expectEquals (estimator.getNumSamples(), 0);
+        expectEquals (estimator.getOffset(), 0.0);
+    }
+
+    void testTimeline()
+    {
+        beginTest ("timeline");
+        TransportSync::Timeline timeline;
+        timeline.tempo = 90.0;
+        timeline.beatOrigin = 8.0;
+        timeline.timeOrigin = 5000.0;
+        expectWithinAbsoluteError (timeline.getBeatsAt (6000.0), 9.5, 1.0e-9);
+        expectWithinAbsoluteError (timeline.getTimeAt (timeline.getBeatsAt (7777.0)), 7777.0, 1.0e-9);
+
+        expectEquals (TransportSync::getQuantizedStart (5.1, 4.0), 8.0);
+        expectEquals (TransportSync::getQuantizedStart (8.0, 4.0), 8.0);
+        expectEquals (TransportSync::getQuantizedStart (5.1, 0.0), 5.1);
+    }
+
+    template<class Condition>
+    static bool waitFor (Condition condition, int timeoutMs)
+    {
+        const auto end = Time::getMillisecondCounter() + (uint32) timeoutMs;
+        while (! condition())
+        {
+            if (Time::getMillisecondCounter() > end)
+                return false;
+            Thread::sleep (10);
+        }
+        return true;
+    }
+
+    static TransportSync::Snapshot snapshot (const TransportSync& sync)
+    {
+        TransportSync::Snapshot state;
+        sync.getSnapshot (state);
+        return state;
+    }
+
+    void testPeers()
+    {
+        beginTest ("two peers");
+        const int port = TransportSync::defaultPort + 1;
+        TransportSync first (port), second (port);
+        if (! first.enable (100.0))
+        {
+            logMessage ("  skipped, couldn't open the socket");
+            return;
+        }
+
+        if (! waitFor ([&] { return first.hasLoopback(); }, 1000))
+        {
+            logMessage ("  skipped, multicast doesn't loop back here");
+            return;
+        }
+
+        // the first founds the session, the second joins it
+        Thread::sleep (1300);
+        expect (second.enable (140.0));
+        expect (waitFor ([&] { return second.getNumPeers() == 1 && ! second.isLeader(); }, 2000));
+        expect (waitFor ([&] { return snapshot (second).timeline.tempo == 100.0; }, 2000),
+                "the joining peer should adopt the session tempo");
+        expect (first.isLeader());
+
+        second.requestTempo (130.0);
+        expect (waitFor ([&] { return snapshot (first).timeline.tempo == 130.0; }, 1000));
+
+        beginTest ("quantized start");
+        first.requestPlaying (true, 4.0);
+        expect (waitFor ([&] { return snapshot (second).startStop.playing; }, 1000));
+
+        const auto a = snapshot (first), b = snapshot (second);
+        expectEquals (std::fmod (a.startStop.beats, 4.0), 0.0);
+        expectEquals (b.startStop.beats, a.startStop.beats);
+        expectEquals (b.startStop.time, a.startStop.time);
+
+        // same machine, so both session clocks should agree closely
+        const double host = Time::getMillisecondCounterHiRes();
+        expectWithinAbsoluteError (second.getSessionTime (host), first.getSessionTime (host), 1.0);
+
+        second.requestPlaying (false, 4.0);
+        expect (waitFor ([&] { return ! snapshot (first).startStop.playing; }, 1000));
+
+        second.disable();
+        first.disable();
+        expect (! first.isEnabled());
+    }
+};
+
+static TransportSyncTest sTransportSyncTest;
+
+}
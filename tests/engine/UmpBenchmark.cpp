@@ -0,0 +1,349 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiChannelMap.h"
+#include "engine/MidiTranspose.h"
+#include "engine/Ump.h"
+#include "engine/VelocityCurve.h"
+
+namespace Element {
+
+class UmpBenchmark : public UnitTestBase
+{
+public:
+    UmpBenchmark() : UnitTestBase ("UMP Benchmark", "benchmarks", "ump") { }
+
+    void runTest() override
+    {
+        testScaling();
+        testRoundTrip();
+        testHighResolution();
+        benchmarkFilters();
+        benchmarkNodeInput();
+        benchmarkRouting();
+    }
+
+private:
+    const int blockSize = 512;
+    const int numEvents = 256;
+    const int numBlocks = 2000;
+
+    void fillBlock (MidiBuffer& midi)
+    {
+        Random rng (4321);
+        for (int i = 0; i < numEvents; ++i)
+        {
+            const int frame = i * blockSize / numEvents;
+            const int channel = 1 + rng.nextInt (16);
+            switch (i % 4)
+            {
+                case 0: midi.addEvent (MidiMessage::noteOn (channel, 36 + rng.nextInt (48), (uint8) (1 + rng.nextInt (126))), frame); break;
+                case 1: midi.addEvent (MidiMessage::noteOff (channel, 36 + rng.nextInt (48)), frame); break;
+                case 2: midi.addEvent (MidiMessage::controllerEvent (channel, 1 + rng.nextInt (64), rng.nextInt (128)), frame); break;
+                case 3: midi.addEvent (MidiMessage::pitchWheel (channel, rng.nextInt (16384)), frame); break;
+            }
+        }
+    }
+
+    void testScaling()
+    {
+        beginTest ("min, center and max survive scaling");
+        expectEquals ((int64) Ump::scaleUp (0, 7, 32), (int64) 0);
+        expectEquals ((int64) Ump::scaleUp (64, 7, 32), (int64) 0x80000000);
+        expectEquals ((int64) Ump::scaleUp (127, 7, 32), (int64) 0xffffffff);
+        expectEquals ((int64) Ump::scaleUp (127, 7, 16), (int64) 0xffff);
+        expectEquals ((int64) Ump::scaleUp (8192, 14, 32), (int64) 0x80000000);
+        expectEquals ((int64) Ump::scaleUp (16383, 14, 32), (int64) 0xffffffff);
+
+        bool reversible = true;
+        for (uint32 v = 0; v < 128; ++v)
+            reversible &= Ump::scaleDown (Ump::scaleUp (v, 7, 32), 32, 7) == v
+                       && Ump::scaleDown (Ump::scaleUp (v, 7, 16), 16, 7) == v;
+        for (uint32 v = 0; v < 16384; ++v)
+            reversible &= Ump::scaleDown (Ump::scaleUp (v, 14, 32), 32, 14) == v;
+        expect (reversible, "scaling down should undo scaling up");
+    }
+
+    void testRoundTrip()
+    {
+        beginTest ("MIDI 1.0 round trip");
+        MidiBuffer source;
+        fillBlock (source);
+        source.addEvent (MidiMessage::programChange (3, 12), 100);
+        source.addEvent (MidiMessage::channelPressureChange (4, 90), 101);
+        source.addEvent (MidiMessage::aftertouchChange (5, 60, 70), 102);
+        source.addEvent (MidiMessage::midiClock(), 103);
+        source.addEvent (MidiMessage::songPositionPointer (300), 104);
+        const uint8 sysex[] = { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xf7 };
+        source.addEvent (sysex, sizeof (sysex), 105);
+
+        UmpBuffer ump;
+        ump.addFromMidiBuffer (source);
+        MidiBuffer result;
+        ump.addToMidiBuffer (result);
+
+        MidiBuffer::Iterator a (source), b (result);
+        const uint8* da = nullptr; const uint8* db = nullptr;
+        int sa = 0, sb = 0, fa = 0, fb = 0, count = 0;
+        bool same = true;
+        while (a.getNextEvent (da, sa, fa))
+        {
+            if (! b.getNextEvent (db, sb, fb))
+            {
+                same = false;
+                break;
+            }
+
+            // a note on with velocity 0 comes back as a note off
+            const bool releasedNoteOn = (da[0] & 0xf0) == 0x90 && da[2] == 0;
+            same &= fa == fb && sa == sb && (releasedNoteOn || memcmp (da, db, (size_t) sa) == 0);
+            ++count;
+        }
+
+        expect (same, "events should come back unchanged");
+        expectEquals (count, source.getNumEvents());
+        expectEquals (result.getNumEvents(), source.getNumEvents());
+
+        beginTest ("registered controllers leave as four controllers");
+        ump.clear();
+        const uint32 rpn[2] = { 0x40220003, Ump::scaleUp (0x2000 | 5, 14, 32) };
+        ump.addPacket (rpn, 0);
+        result.clear();
+        ump.addToMidiBuffer (result);
+        expectEquals (result.getNumEvents(), 4);
+    }
+
+    void testHighResolution()
+    {
+        beginTest ("high resolution values pass the filters");
+        MidiChannelMap channels;
+        channels.set (1, 9);
+        MidiTranspose transpose;
+        transpose.setNoteOffset (12);
+
+        UmpBuffer ump;
+        const uint32 note[2]     = { 0x40903c00, 0x12340000 };   // ch 1, note 60, velocity 0x1234
+        const uint32 bend[2]     = { 0x40603c00, 0x87654321 };   // per-note pitch bend on note 60
+        const uint32 control[2]  = { 0x40b00100, 0x89abcdef };   // mod wheel
+        ump.addPacket (note, 0);
+        ump.addPacket (bend, 1);
+        ump.addPacket (control, 2);
+
+        channels.render (ump);
+        transpose.process (ump, blockSize);
+
+        UmpBuffer::Iterator iter (ump);
+        const uint32* words = nullptr;
+        int numWords = 0, frame = 0;
+        expect (iter.getNextEvent (words, numWords, frame));
+        expectEquals (Ump::getChannel (words[0]), 9);
+        expectEquals (Ump::getNoteNumber (words[0]), 72);
+        expectEquals (Ump::getVelocity (words), 0x1234);
+        expect (iter.getNextEvent (words, numWords, frame));
+        expectEquals (Ump::getNoteNumber (words[0]), 72, "per-note bend follows its note");
+        expectEquals ((int64) words[1], (int64) 0x87654321);
+        expect (iter.getNextEvent (words, numWords, frame));
+        expectEquals ((int64) words[1], (int64) 0x89abcdef);
+
+        VelocityCurve curve;
+        curve.setMode (VelocityCurve::Soft_1);
+        const auto before = (uint16) 0x1234;
+        curve.process (ump);
+        UmpBuffer::Iterator again (ump);
+        expect (again.getNextEvent (words, numWords, frame));
+        expectEquals (Ump::getVelocity (words), (int) curve.process (before));
+    }
+
+    template<class Function>
+    double measure (Function&& function)
+    {
+        const auto start = Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+            function();
+        return 1000000.0 * Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) / (double) numBlocks;
+    }
+
+    void report (const String& name, double bytesUs, double umpUs)
+    {
+        String message = name;
+        message << ": bytes " << String (bytesUs, 2) << " us, ump " << String (umpUs, 2)
+                << " us per block (" << String (bytesUs / jmax (umpUs, 1.0e-6), 2) << "x)";
+        logMessage (message);
+    }
+
+    void benchmarkFilters()
+    {
+        beginTest ("channel map, transpose and velocity");
+        MidiBuffer source;
+        fillBlock (source);
+        UmpBuffer umpSource;
+        umpSource.addFromMidiBuffer (source);
+
+        MidiChannelMap channels;
+        for (int ch = 1; ch <= 16; ++ch)
+            channels.set (ch, 17 - ch);
+        MidiTranspose transpose;
+        transpose.setNoteOffset (-5);
+        VelocityCurve curve;
+        curve.setMode (VelocityCurve::Hard_1);
+
+        MidiBuffer midi, filtered;
+        const double bytesUs = measure ([&] {
+            midi = source;
+            channels.render (midi);
+            transpose.process (midi, blockSize);
+
+            // the velocity pass as the graph does it
+            filtered.clear();
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+            {
+                if (msg.isNoteOn())
+                    msg.setVelocity (curve.process (msg.getFloatVelocity()));
+                filtered.addEvent (msg, frame);
+            }
+        });
+
+        UmpBuffer ump;
+        ump.ensureSize (umpSource.getNumWords());
+        const double umpUs = measure ([&] {
+            ump = umpSource;
+            channels.render (ump);
+            transpose.process (ump, blockSize);
+            curve.process (ump);
+        });
+
+        report ("filters", bytesUs, umpUs);
+        expectEquals (ump.getNumEvents(), filtered.getNumEvents());
+    }
+
+    /** The per node key range, channel and transpose stage in the graph,
+        with the conversions at the plugin boundary counted against UMP */
+    void benchmarkNodeInput()
+    {
+        beginTest ("node input filters");
+        MidiBuffer source;
+        fillBlock (source);
+        source.addEvent (MidiMessage::createSysExMessage ("\x7d\x01\x02\x03\x04\x05\x06\x07", 8), 0);
+
+        const Range<int> keys (48, 72);
+        BigInteger channels;
+        channels.setRange (0, 8, true);
+        MidiTranspose transpose;
+        transpose.setNoteOffset (7);
+
+        MidiBuffer midi, temp;
+        const double bytesUs = measure ([&] {
+            midi = source;
+            temp.clear();
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+            {
+                if (msg.isNoteOnOrOff() && (msg.getNoteNumber() < keys.getStart() || msg.getNoteNumber() > keys.getEnd()))
+                    continue;
+                if (msg.getChannel() > 0 && ! channels[msg.getChannel() - 1])
+                    continue;
+                transpose.process (msg);
+                temp.addEvent (msg, frame);
+            }
+            midi.swapWith (temp);
+        });
+
+        MidiBuffer umpMidi;
+        UmpBuffer ump;
+        ump.ensureSize (2048);
+        const double umpUs = measure ([&] {
+            umpMidi = source;
+            ump.clear();
+            ump.addFromMidiBuffer (umpMidi);
+            ump.removeIf ([&] (int, const uint32* words, int) -> bool {
+                const uint32 word = words[0];
+                if (! Ump::isChannelVoice (word))
+                    return false;
+                const int status = Ump::getStatus (word);
+                const int note = Ump::getNoteNumber (word);
+                if ((status == Ump::noteOn || status == Ump::noteOff) && (note < keys.getStart() || note > keys.getEnd()))
+                    return true;
+                return ! channels[Ump::getChannel (word) - 1];
+            });
+            transpose.process (ump, blockSize);
+            umpMidi.clear();
+            ump.addToMidiBuffer (umpMidi);
+        });
+
+        report ("node input", bytesUs, umpUs);
+        expectEquals (umpMidi.getNumEvents(), midi.getNumEvents());
+
+        bool same = true;
+        MidiBuffer::Iterator a (midi), b (umpMidi);
+        const uint8* da = nullptr; const uint8* db = nullptr;
+        int sa = 0, sb = 0, fa = 0, fb = 0;
+        while (a.getNextEvent (da, sa, fa))
+        {
+            if (! b.getNextEvent (db, sb, fb) || fa != fb || sa != sb || memcmp (da, db, (size_t) sa) != 0)
+                same = false;
+        }
+        expect (same, "both paths should keep the same events");
+    }
+
+    void benchmarkRouting()
+    {
+        beginTest ("four by four routing");
+        const int numPorts = 4;
+        MidiBuffer source;
+        fillBlock (source);
+        UmpBuffer umpSource;
+        umpSource.addFromMidiBuffer (source);
+
+        OwnedArray<MidiBuffer> outs;
+        OwnedArray<UmpBuffer> umpOuts;
+        for (int i = 0; i < numPorts; ++i)
+        {
+            outs.add (new MidiBuffer())->ensureSize ((size_t) (numEvents * 4 * numPorts));
+            umpOuts.add (new UmpBuffer())->ensureSize (umpSource.getNumWords() * numPorts);
+        }
+
+        const double bytesUs = measure ([&] {
+            for (auto* out : outs)
+            {
+                out->clear();
+                for (int src = 0; src < numPorts; ++src)
+                    out->addEvents (source, 0, blockSize, 0);
+            }
+        });
+
+        const double umpUs = measure ([&] {
+            for (auto* out : umpOuts)
+            {
+                out->clear();
+                for (int src = 0; src < numPorts; ++src)
+                    out->addEvents (umpSource, 0, blockSize, 0);
+            }
+        });
+
+        report ("routing", bytesUs, umpUs);
+        expectEquals (umpOuts[0]->getNumEvents(), outs[0]->getNumEvents());
+    }
+};
+
+static UmpBenchmark sUmpBenchmark;
+
+}